@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""
+Compressione gzip degli asset web prima della creazione dell'immagine SPIFFS
+
+Per ogni file testuale in data/ (html, js, css, json, svg) crea <file>.gz
+accanto all'originale. Il web server invia la variante .gz con
+Content-Encoding: gzip ai client che la accettano.
+
+Uso:
+  - automatico come extra_script PlatformIO (pio run -t buildfs / uploadfs)
+  - manuale: python3 compress_assets.py [cartella_data]
+"""
+
+import gzip
+import os
+import sys
+
+COMPRESS_EXTENSIONS = ('.html', '.js', '.css', '.json', '.svg')
+MIN_SAVING = 0.10   # Salta i file che si riducono meno del 10%
+
+
+def compress_file(src_path):
+    """
+    Crea src_path.gz se manca o è più vecchio dell'originale
+    Ritorna (dimensione originale, dimensione compressa) o None se saltato
+    """
+    gz_path = src_path + '.gz'
+
+    with open(src_path, 'rb') as f:
+        data = f.read()
+
+    # mtime=0: stesso contenuto -> stesso .gz (immagine SPIFFS riproducibile)
+    compressed = gzip.compress(data, compresslevel=9, mtime=0)
+
+    if len(data) == 0 or len(compressed) > len(data) * (1 - MIN_SAVING):
+        if os.path.exists(gz_path):
+            os.remove(gz_path)
+        return None
+
+    if not os.path.exists(gz_path) or os.path.getmtime(gz_path) < os.path.getmtime(src_path):
+        with open(gz_path, 'wb') as f:
+            f.write(compressed)
+
+    return len(data), len(compressed)
+
+
+def compress_assets(data_dir):
+    total_in = 0
+    total_out = 0
+
+    for name in sorted(os.listdir(data_dir)):
+        path = os.path.join(data_dir, name)
+        if not os.path.isfile(path) or not name.endswith(COMPRESS_EXTENSIONS):
+            continue
+
+        result = compress_file(path)
+        if result is None:
+            print(f"  {name}: non compresso")
+            continue
+
+        size_in, size_out = result
+        total_in += size_in
+        total_out += size_out
+        print(f"  {name}: {size_in} -> {size_out} bytes ({100 * size_out // size_in}%)")
+
+    if total_in > 0:
+        print(f"Asset compressi: {total_in} -> {total_out} bytes")
+
+
+def before_buildfs(source, target, env):
+    compress_assets(env.subst("$PROJECT_DATA_DIR"))
+
+
+try:
+    Import("env")  # noqa: F821 - definito da PlatformIO (SCons)
+    # L'immagine SPIFFS è costruita sia da buildfs che da uploadfs
+    env.AddPreAction("$BUILD_DIR/${ESP32_FS_IMAGE_NAME}.bin", before_buildfs)  # noqa: F821
+except NameError:
+    if __name__ == '__main__':
+        compress_assets(sys.argv[1] if len(sys.argv) > 1 else 'data')
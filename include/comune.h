@@ -82,7 +82,8 @@ typedef struct {
                                //   bit 0: relay_on (caldaia accesa)
                                //   bit 1: manual_mode
                                //   bit 2: exception_active
-                               //   bit 3-7: riservati
+                               //   bit 3: backfilled (minuto mancato, interpolato)
+                               //   bit 4-7: riservati
     int16_t setpoint;          // Soglia attiva × 100 (°C)
     uint8_t active_bank;       // Banco programma attivo (0-3)
     uint8_t reserved;          // Riservato per allineamento/futuro
@@ -93,6 +94,7 @@ typedef struct {
 #define HISTORY_FLAG_RELAY_ON       0x01
 #define HISTORY_FLAG_MANUAL_MODE    0x02
 #define HISTORY_FLAG_EXCEPTION      0x04
+#define HISTORY_FLAG_BACKFILLED     0x08
 
 // ============================================================================
 // THERMOSTAT CONFIGURATION
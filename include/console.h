@@ -0,0 +1,33 @@
+/**
+ * @file console.h
+ * @brief Comandi di diagnostica dalla console seriale
+ *
+ * Comandi a un carattere letti da stdin (UART0 del monitor seriale):
+ *   t  profilo CPU e stack dei task
+ *   w  stato WiFi
+ *   h  elenco comandi
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+
+#define CONSOLE_POLL_MS         100     // Attesa quando stdin è vuoto
+#define CONSOLE_STACK_SIZE      4096    // printf con formattazione
+#define CONSOLE_PRIORITY        1
+
+/**
+ * @brief Avvia il task della console
+ */
+esp_err_t console_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONSOLE_H
@@ -0,0 +1,141 @@
+/**
+ * @file history_backend.h
+ * @brief Backend di memorizzazione dei giorni dello storico
+ *
+ * history_manager non accede direttamente ai file: scrive, legge ed
+ * elenca i giorni attraverso la tabella di funzioni del backend scelto
+ * in compilazione.
+ *
+ *   - spiffs: un file log_YYYYMMDD.bin (v2 compresso) più log_YYYYMMDD.ext
+ *     per gli estremi. È il formato servito così com'è da /api/log.
+ *   - log: record a dimensione fissa accodati in una partizione dedicata
+ *     (esp_partition_write), in un ring di settori. Nessun metadato di
+ *     filesystem, nessun limite di file aperti, niente garbage collection.
+ *     Ogni settore viene cancellato una volta per giro (usura uniforme).
+ *
+ * Rollup mensili, indice annuale, configurazione e pagine web restano su
+ * SPIFFS con entrambi i backend.
+ */
+
+#ifndef HISTORY_BACKEND_H
+#define HISTORY_BACKEND_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include "history_manager.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// ============================================================================
+// COSTANTI (ridefinibili con build_flags)
+// ============================================================================
+
+// 1 = log strutturato sulla partizione HISTORY_LOG_PARTITION
+// (partitions_tslog.csv), 0 = un file SPIFFS per giorno
+#ifndef HISTORY_BACKEND_LOG
+#define HISTORY_BACKEND_LOG         0
+#endif
+
+#ifndef HISTORY_LOG_PARTITION
+#define HISTORY_LOG_PARTITION       "tslog"
+#endif
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief Callback di history_backend_t::foreach_day
+ *
+ * @param num_samples num_samples del giorno salvato
+ * @param size Byte occupati dal giorno
+ */
+typedef void (*history_backend_day_cb_t)(uint16_t year, uint8_t month, uint8_t day,
+                                         uint16_t num_samples, uint32_t size, void* arg);
+
+/**
+ * @brief Operazioni di un backend
+ *
+ * write_day ed write_extremes sono chiamate solo dal task writer (con il
+ * lock di I/O di history_manager); le letture possono arrivare da
+ * qualsiasi task in parallelo.
+ */
+typedef struct {
+    const char* name;
+
+    /**
+     * @brief Prepara il backend (dopo storage_init)
+     */
+    esp_err_t (*init)(void);
+
+    /**
+     * @brief Salva i sample del giorno di b
+     *
+     * Con append solo [persisted_samples, num_samples), altrimenti tutti i
+     * minuti modificati. Aggiorna persisted_bytes di b e il predittore.
+     *
+     * @return ESP_OK, ESP_ERR_NOT_FOUND se l'append non è possibile
+     *         (il chiamante riprova senza append), ESP_FAIL se errore I/O
+     */
+    esp_err_t (*write_day)(history_buffer_t* b, tlog2_state_t* codec, bool append,
+                           size_t* bytes_written);
+
+    /**
+     * @brief Salva gli estremi dei minuti [from, num_samples) di b
+     */
+    esp_err_t (*write_extremes)(const history_buffer_t* b, uint16_t from);
+
+    /**
+     * @brief Legge gli estremi salvati di un giorno
+     *
+     * I minuti senza estremi restano invariati (HISTORY_EXT_UNKNOWN).
+     */
+    void (*read_extremes)(uint16_t year, uint8_t month, uint8_t day,
+                          history_extremes_t* extremes);
+
+    /**
+     * @brief Implementazioni di history_reader_open/next/close
+     */
+    esp_err_t (*reader_open)(history_reader_t* reader, uint16_t year, uint8_t month, uint8_t day);
+    esp_err_t (*reader_next)(history_reader_t* reader, history_sample_t* sample);
+    void (*reader_close)(history_reader_t* reader);
+
+    /**
+     * @brief true se il giorno è salvato
+     */
+    bool (*day_exists)(uint16_t year, uint8_t month, uint8_t day);
+
+    /**
+     * @brief Chiama cb per ogni giorno salvato dell'anno (ricostruzione indice)
+     *
+     * year = 0: tutti gli anni presenti, in una sola passata.
+     */
+    void (*foreach_day)(uint16_t year, history_backend_day_cb_t cb, void* arg);
+
+    /**
+     * @brief true se i giorni sono file /spiffs/log_YYYYMMDD.bin inviabili così come sono
+     */
+    bool raw_files;
+} history_backend_t;
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+extern const history_backend_t history_backend_spiffs;
+extern const history_backend_t history_backend_log;
+
+/**
+ * @brief Backend scelto con HISTORY_BACKEND_LOG
+ */
+const history_backend_t* history_backend_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HISTORY_BACKEND_H
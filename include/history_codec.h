@@ -0,0 +1,101 @@
+/**
+ * @file history_codec.h
+ * @brief Codifica compressa TLOG v2 dei sample giornalieri
+ *
+ * Ogni minuto è un record a lunghezza variabile: un byte maschera seguito
+ * dai soli campi cambiati rispetto al sample precedente. I canali numerici
+ * sono delta zig-zag in varint (LEB128), flags e banco sono byte grezzi.
+ * Il minuto è implicito (posizione del record nel file).
+ *
+ * Encoder e decoder lavorano un sample alla volta e mantengono come unico
+ * stato l'ultimo sample valido (predittore), senza buffer della giornata.
+ */
+
+#ifndef HISTORY_CODEC_H
+#define HISTORY_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include "comune.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+// Bit del byte maschera di ogni record
+#define TLOG2_F_TEMP        0x01    // Delta temperatura presente
+#define TLOG2_F_HUM         0x02    // Delta umidità presente
+#define TLOG2_F_SETPOINT    0x04    // Delta setpoint presente
+#define TLOG2_F_PRESSURE    0x08    // Delta pressione presente
+#define TLOG2_F_FLAGS       0x10    // Byte flags presente
+#define TLOG2_F_BANK        0x20    // Byte banco presente
+#define TLOG2_F_EMPTY       0x40    // Minuto senza dati (nessun campo segue)
+#define TLOG2_F_RESERVED    0x80    // Riservato, deve essere 0
+
+// Dimensione massima di un record: maschera + 4 varint da 3 byte + 2 byte
+#define TLOG2_MAX_RECORD_SIZE   15
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief Stato del predittore condiviso da encoder e decoder
+ */
+typedef struct {
+    history_sample_t prev;      // Ultimo sample valido codificato/decodificato
+} tlog2_state_t;
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Inizializza il predittore (inizio file)
+ */
+void tlog2_init(tlog2_state_t* state);
+
+/**
+ * @brief Verifica se un sample è vuoto (tutti i valori invalidi)
+ */
+bool tlog2_sample_is_empty(const history_sample_t* sample);
+
+/**
+ * @brief Imposta un sample vuoto per il minuto indicato
+ */
+void tlog2_make_empty(history_sample_t* sample, uint16_t minute_of_day);
+
+/**
+ * @brief Codifica un sample
+ *
+ * @param state Stato predittore (aggiornato)
+ * @param sample Sample da codificare
+ * @param out Buffer di almeno TLOG2_MAX_RECORD_SIZE byte
+ * @return Numero di byte scritti in out
+ */
+size_t tlog2_encode(tlog2_state_t* state, const history_sample_t* sample, uint8_t* out);
+
+/**
+ * @brief Decodifica un sample
+ *
+ * @param state Stato predittore (aggiornato solo se il record è completo)
+ * @param minute_of_day Minuto del record (posizione nel file)
+ * @param in Byte disponibili
+ * @param len Numero di byte disponibili
+ * @param sample Sample decodificato
+ * @return Byte consumati, 0 se servono altri byte, -1 se il record non è valido
+ */
+int tlog2_decode(tlog2_state_t* state, uint16_t minute_of_day,
+                 const uint8_t* in, size_t len, history_sample_t* sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HISTORY_CODEC_H
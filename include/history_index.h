@@ -0,0 +1,132 @@
+/**
+ * @file history_index.h
+ * @brief Indice annuale dei file log giornalieri
+ *
+ * Per ogni anno esiste un file /spiffs/idx_YYYY.bin con una bitmap dei
+ * giorni presenti e un record riassuntivo per giorno (dimensione file,
+ * min/max temperatura, minuti caldaia). Gli indici degli ultimi anni sono
+ * tenuti in PSRAM, così /api/log/list e il calendario web non scandiscono
+ * più la directory SPIFFS.
+ *
+ * L'indice viene ricostruito elencando i giorni del backend (scansione
+ * della directory SPIFFS o indice in RAM del log, history_backend.h) se il
+ * file dell'anno manca (primo avvio, file caricati via /api/upload).
+ */
+
+#ifndef HISTORY_INDEX_H
+#define HISTORY_INDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define HISTORY_INDEX_MAGIC         "TIDX"  // Magic number file indice
+#define HISTORY_INDEX_VERSION       1       // Versione formato
+#define HISTORY_INDEX_DAYS          366     // Giorni per anno (bisestile incluso)
+#define HISTORY_INDEX_YEARS         2       // Anni tenuti in cache (corrente + precedente)
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief Riassunto di un giorno (12 bytes)
+ */
+typedef struct {
+    uint32_t file_size;     // Byte committati del file log_YYYYMMDD.bin
+    int16_t t_min;          // Temperatura minima × 100 (-32768 = sconosciuta)
+    int16_t t_max;          // Temperatura massima × 100 (-32768 = sconosciuta)
+    uint16_t heater_on;     // Minuti caldaia accesa
+    uint16_t num_samples;   // num_samples dell'header del file
+} __attribute__((packed)) history_index_entry_t;
+
+/**
+ * @brief Indice di un anno (immagine del file idx_YYYY.bin, 4448 bytes)
+ */
+typedef struct {
+    char magic[4];                                      // "TIDX"
+    uint8_t version;                                    // Versione formato (1)
+    uint8_t reserved;                                   // Riservato
+    uint16_t year;                                      // Anno
+    uint8_t bitmap[48];                                 // Bit n = giorno dell'anno n presente
+    history_index_entry_t days[HISTORY_INDEX_DAYS];     // Indicizzato per giorno dell'anno (0-365)
+} __attribute__((packed)) history_index_t;
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Alloca la cache degli indici in PSRAM
+ *
+ * @return ESP_OK se successo, ESP_ERR_NO_MEM se allocazione fallita
+ */
+esp_err_t history_index_init(void);
+
+/**
+ * @brief Registra o aggiorna il riassunto di un giorno
+ *
+ * Aggiorna la copia in PSRAM e il file dell'anno (solo il record e il byte
+ * di bitmap coinvolti).
+ */
+esp_err_t history_index_update(uint16_t year, uint8_t month, uint8_t day,
+                               const history_index_entry_t* entry);
+
+/**
+ * @brief Verifica se un giorno è presente nell'indice
+ *
+ * Per un anno fuori dalla cache senza file indice chiede al backend.
+ */
+bool history_index_has_day(uint16_t year, uint8_t month, uint8_t day);
+
+/**
+ * @brief Legge il riassunto di un giorno
+ *
+ * Gli anni fuori dalla cache (più vecchi di HISTORY_INDEX_YEARS) vengono
+ * letti direttamente dal file, senza sostituire un anno in cache.
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND se il giorno non è indicizzato,
+ *         ESP_ERR_INVALID_STATE se l'anno è fuori dalla cache e non ha un
+ *         file indice (presenza sconosciuta)
+ */
+esp_err_t history_index_get_entry(uint16_t year, uint8_t month, uint8_t day,
+                                  history_index_entry_t* entry);
+
+/**
+ * @brief Callback per history_index_foreach()
+ */
+typedef void (*history_index_cb_t)(uint16_t year, uint8_t month, uint8_t day,
+                                   const history_index_entry_t* entry, void* ctx);
+
+/**
+ * @brief Enumera in ordine cronologico tutti i giorni presenti
+ *
+ * Gli anni con dati vengono letti una volta dal backend, anche con l'ora
+ * non ancora sincronizzata. Quelli fuori dalla cache sono elencati dal
+ * loro file idx_YYYY.bin, ricostruito se manca.
+ *
+ * @param cb Callback chiamata per ogni giorno con una copia del record (fuori dal lock)
+ * @param ctx Contesto passato alla callback
+ */
+void history_index_foreach(history_index_cb_t cb, void* ctx);
+
+/**
+ * @brief Scarta l'indice di un anno, ricostruito al prossimo accesso
+ *
+ * Da chiamare quando un file log viene scritto fuori da history_manager.
+ */
+void history_index_invalidate(uint16_t year);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HISTORY_INDEX_H
@@ -0,0 +1,84 @@
+/**
+ * @file history_journal.h
+ * @brief Journal degli ultimi sample in memoria RTC non inizializzata
+ *
+ * Il file del giorno viene scritto solo al cambio d'ora e di giorno: un
+ * reset (watchdog, panic, brownout, riavvio dopo OTA) perderebbe fino a
+ * 59 minuti. Ogni sample registrato viene copiato anche in un piccolo
+ * ring in RTC_NOINIT, che sopravvive ai reset software e non costa
+ * scritture su flash. All'avvio history_init() reinserisce nel buffer i
+ * minuti del giorno che il file non contiene.
+ *
+ * Ogni record ha un CRC proprio: un reset durante una scrittura invalida
+ * al più quel record. Dopo un'accensione a freddo il ring viene azzerato.
+ */
+
+#ifndef HISTORY_JOURNAL_H
+#define HISTORY_JOURNAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "history_manager.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// ============================================================================
+// COSTANTI (ridefinibili con build_flags)
+// ============================================================================
+
+// Record nel ring (24 byte ciascuno): più dei 60 minuti tra due flush
+// orari, con margine per i minuti interpolati
+#ifndef HISTORY_JOURNAL_ENTRIES
+#define HISTORY_JOURNAL_ENTRIES     96
+#endif
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief Callback di replay, una volta per record valido della data richiesta
+ */
+typedef void (*history_journal_cb_t)(const history_sample_t* sample,
+                                     const history_extremes_t* extremes, void* arg);
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Verifica il ring dopo il boot
+ *
+ * Azzera il ring dopo un'accensione a freddo o se l'intestazione non è
+ * valida; altrimenti lo lascia intatto per history_journal_replay().
+ */
+void history_journal_init(void);
+
+/**
+ * @brief Copia un sample nel ring (pochi µs, nessun accesso a flash)
+ *
+ * @param year Anno del giorno del sample
+ * @param month Mese
+ * @param day Giorno
+ * @param sample Sample registrato
+ * @param extremes Estremi del minuto
+ */
+void history_journal_append(uint16_t year, uint8_t month, uint8_t day,
+                            const history_sample_t* sample,
+                            const history_extremes_t* extremes);
+
+/**
+ * @brief Chiama cb per ogni record integro della data indicata
+ *
+ * @return Numero di record passati a cb
+ */
+uint16_t history_journal_replay(uint16_t year, uint8_t month, uint8_t day,
+                                history_journal_cb_t cb, void* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HISTORY_JOURNAL_H
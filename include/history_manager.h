@@ -16,8 +16,10 @@ extern "C" {
 
 #include "esp_err.h"
 #include "comune.h"
+#include "history_codec.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
 
 // ============================================================================
 // COSTANTI
@@ -29,7 +31,32 @@ extern "C" {
 #define HISTORY_FILE_SIZE           (HISTORY_HEADER_SIZE + HISTORY_SAMPLES_PER_DAY * HISTORY_SAMPLE_SIZE)
 
 #define HISTORY_MAGIC               "TLOG"  // Magic number per file
-#define HISTORY_VERSION             1       // Versione formato
+#define HISTORY_VERSION             2       // Versione formato scritta (compressa, history_codec.h)
+#define HISTORY_VERSION_V1          1       // Record fissi da 12 byte (sola lettura)
+
+// File compagno con gli estremi di ogni minuto: log_YYYYMMDD.ext, 2 byte
+// per minuto a posizione fissa (history_extremes_t), senza header
+#define HISTORY_EXT_UNKNOWN         0xFF
+#define HISTORY_EXT_MAX_DELTA       0xFE    // 2.54 °C dalla media
+
+// Minuti mancati colmati per interpolazione (HISTORY_FLAG_BACKFILLED);
+// buchi più lunghi (riavvio, salto NTP in avanti) restano senza sample
+#ifndef HISTORY_MAX_BACKFILL
+#define HISTORY_MAX_BACKFILL        15
+#endif
+
+// Minuti per cui il cambio giorno aspetta che il giorno precedente sia
+// scritto e non più in lettura; i minuti del nuovo giorno restano nel
+// journal. Oltre, il giorno concluso viene perso.
+#ifndef HISTORY_DAY_SWAP_MAX_DEFER
+#define HISTORY_DAY_SWAP_MAX_DEFER  30
+#endif
+
+// Flush incrementale: accoda su file solo i sample nuovi dall'ultimo salvataggio
+// e riscrive l'header (commit) per ultimo. Con 0 torna alla riscrittura completa.
+#ifndef HISTORY_INCREMENTAL_FLUSH
+#define HISTORY_INCREMENTAL_FLUSH   1
+#endif
 
 // ============================================================================
 // STRUTTURE
@@ -40,7 +67,7 @@ extern "C" {
  */
 typedef struct {
     char magic[4];          // "TLOG"
-    uint8_t version;        // Versione formato (1)
+    uint8_t version;        // Versione formato (1 = record fissi, 2 = compresso)
     uint16_t year;          // Anno (little endian)
     uint8_t month;          // Mese (1-12)
     uint8_t day;            // Giorno (1-31)
@@ -48,13 +75,76 @@ typedef struct {
     uint8_t reserved;       // Riservato
 } __attribute__((packed)) history_header_t;
 
+/**
+ * @brief Lettore sequenziale di un giorno salvato (file v1/v2 o log)
+ *
+ * Restituisce i sample committati uno alla volta. Con i file usa solo un
+ * piccolo buffer interno, indipendentemente dalla versione; con il backend
+ * log il giorno viene ricostruito in PSRAM all'apertura.
+ */
+typedef struct {
+    FILE* file;                                     // File aperto (backend spiffs)
+    history_sample_t* day;                          // Giorno ricostruito (backend log)
+    history_header_t header;                        // Header letto dal file
+    tlog2_state_t codec;                            // Predittore v2
+    uint16_t next_minute;                           // Prossimo record da leggere
+    uint32_t offset;                                // Byte consumati (header incluso)
+    uint8_t buf[64];                                // Buffer di lettura v2
+    uint8_t buf_len;                                // Byte validi in buf
+    uint8_t buf_pos;                                // Posizione di lettura in buf
+} history_reader_t;
+
+/**
+ * @brief Aggregati della giornata, mantenuti a ogni history_add_sample()
+ *
+ * Valori interi in centesimi come nei sample; le medie si ricavano
+ * dividendo le somme per count.
+ */
+typedef struct {
+    uint16_t count;                                 // Minuti con temperatura valida
+    int32_t t_sum;                                  // Somma temperature × 100
+    int16_t t_min;                                  // Temperatura minima × 100
+    int16_t t_max;                                  // Temperatura massima × 100
+    uint16_t heater_on;                             // Minuti caldaia accesa
+    uint16_t sp_count;                              // Minuti con temperatura e setpoint validi
+    uint64_t sp_err_sq_sum;                         // Somma (temperatura - setpoint)² × 10^4
+} history_stats_t;
+
+/**
+ * @brief Valori di un minuto aggregati dalle letture a 1 Hz (minute_aggregator.h)
+ */
+typedef struct {
+    int64_t epoch_minute;                           // Minuto aggregato (time / 60), non quello corrente
+    int16_t temperature;                            // Media × 100
+    int16_t t_min;                                  // Minima × 100
+    int16_t t_max;                                  // Massima × 100
+    uint8_t humidity;                               // Media %
+    uint16_t pressure;                              // Media, decimi di hPa
+} history_minute_t;
+
+/**
+ * @brief Estremi di temperatura di un minuto (file compagno .ext)
+ *
+ * Distanze da media del sample, in centesimi di grado, saturate a
+ * HISTORY_EXT_MAX_DELTA. HISTORY_EXT_UNKNOWN = estremi non disponibili
+ * (minuto vuoto, interpolato o registrato prima di questo formato).
+ */
+typedef struct {
+    uint8_t below;                                  // Media - minima
+    uint8_t above;                                  // Massima - media
+} history_extremes_t;
+
 /**
  * @brief Stato del buffer log in memoria
  */
 typedef struct {
     history_header_t header;                        // Header corrente
     history_sample_t* samples;                      // Puntatore al buffer PSRAM
+    history_extremes_t* extremes;                   // Estremi per minuto (PSRAM)
     uint16_t current_minute;                        // Ultimo minuto scritto
+    uint16_t persisted_samples;                     // Sample già committati su file
+    uint32_t persisted_bytes;                       // Fine dati committati nel file (offset append)
+    uint16_t dirty_from;                            // Primo minuto modificato dall'ultimo flush
     bool initialized;                               // Buffer inizializzato
     bool dirty;                                     // Dati modificati da salvare
 } history_buffer_t;
@@ -66,7 +156,10 @@ typedef struct {
 /**
  * @brief Inizializza il gestore storico
  *
- * Alloca il buffer in PSRAM e carica eventuali dati esistenti per oggi.
+ * Alloca il buffer in PSRAM, carica eventuali dati esistenti per oggi e
+ * recupera dal journal RTC (history_journal.h) i minuti registrati prima
+ * di un reset e non ancora salvati. Registra un handler di shutdown che
+ * salva il buffer prima di esp_restart().
  *
  * @return ESP_OK se successo, ESP_ERR_NO_MEM se PSRAM non disponibile
  */
@@ -89,44 +182,71 @@ void history_deinit(void);
 esp_err_t history_add_sample(const history_sample_t* sample);
 
 /**
- * @brief Aggiunge sample con i valori correnti
+ * @brief Aggiunge il sample del minuto appena concluso dai valori aggregati
  *
- * Convenience function che crea il sample dai parametri.
+ * Il sample porta la media delle letture del minuto minute->epoch_minute
+ * (finestra che termina al confine del minuto) e va nel giorno e nella
+ * posizione di quel minuto: il minuto 23:59, registrato alle 00:00, chiude
+ * il giorno prima e il cambio giorno avviene con il minuto 00:00.
+ * Minima e massima vanno nel file compagno .ext. I minuti mancati dall'ultimo sample del giorno (fino a
+ * HISTORY_MAX_BACKFILL) vengono interpolati e marcati con
+ * HISTORY_FLAG_BACKFILLED. Un minuto già registrato (orologio tornato
+ * indietro) non viene sovrascritto.
  *
- * @param temperature Temperatura in °C
- * @param humidity Umidità %
- * @param pressure Pressione hPa
+ * @param minute Media, minima e massima delle letture (minute_aggregator_finish)
  * @param setpoint Setpoint attivo °C
  * @param relay_on Stato relè
  * @param manual_mode Modalità manuale attiva
  * @param active_bank Banco programma attivo
- * @return ESP_OK se successo
+ * @return ESP_OK se successo, ESP_ERR_INVALID_STATE se il minuto è già registrato
+ *         o di un giorno già chiuso, ESP_ERR_NOT_FINISHED se il cambio giorno è rimandato (minuto solo nel journal)
  */
-esp_err_t history_record(float temperature, uint8_t humidity, uint16_t pressure,
-                         float setpoint, bool relay_on, bool manual_mode,
-                         uint8_t active_bank);
+esp_err_t history_record(const history_minute_t* minute, float setpoint,
+                         bool relay_on, bool manual_mode, uint8_t active_bank);
 
 /**
  * @brief Controlla se è necessario cambiare giorno e gestisce la rotazione
  *
  * Da chiamare periodicamente (es. ogni minuto).
  * Se il giorno è cambiato:
- * 1. Salva il buffer corrente su file
+ * 1. Sposta il giorno concluso in un secondo buffer PSRAM e accoda al
+ *    task writer (storage_writer.h) il salvataggio e l'indice
  * 2. Reinizializza il buffer per il nuovo giorno
  *
+ * Nessun accesso a flash nel chiamante.
+ *
  * @return true se è avvenuto un cambio giorno
  */
 bool history_check_day_change(void);
 
 /**
- * @brief Salva il buffer corrente su SPIFFS
+ * @brief Salva il buffer corrente su SPIFFS (sincrona)
+ *
+ * Copia il buffer sotto lock e scrive la copia senza lock: chi registra
+ * sample non aspetta la flash. Normalmente eseguita dal task writer
+ * tramite history_request_save().
+ *
+ * Se il file del giorno è già allineato fino a persisted_samples e nessun
+ * minuto già salvato è stato modificato, accoda solo i sample nuovi e poi
+ * riscrive l'header. L'header (num_samples) è il marker di commit: record
+ * oltre num_samples lasciati da un crash vengono ignorati al caricamento
+ * e sovrascritti al flush successivo. Altrimenti riscrive tutto il file.
  *
  * @return ESP_OK se successo, ESP_FAIL se errore I/O
  */
 esp_err_t history_save_to_file(void);
 
 /**
- * @brief Carica dati da file SPIFFS nel buffer
+ * @brief Accoda history_save_to_file() al task writer senza bloccare
+ *
+ * Richieste ripetute prima dell'esecuzione producono una sola scrittura.
+ *
+ * @return ESP_OK se accodata, ESP_ERR_TIMEOUT se la coda è piena
+ */
+esp_err_t history_request_save(void);
+
+/**
+ * @brief Carica un giorno salvato nel buffer (dal backend, history_backend.h)
  *
  * @param year Anno
  * @param month Mese
@@ -135,13 +255,65 @@ esp_err_t history_save_to_file(void);
  */
 esp_err_t history_load_from_file(uint16_t year, uint8_t month, uint8_t day);
 
+/**
+ * @brief Apre un file giornaliero per la lettura sequenziale
+ *
+ * @param reader Lettore da inizializzare
+ * @param year Anno
+ * @param month Mese
+ * @param day Giorno
+ * @return ESP_OK se aperto, ESP_ERR_NOT_FOUND se il file non esiste,
+ *         ESP_ERR_INVALID_VERSION se magic o versione non validi
+ */
+esp_err_t history_reader_open(history_reader_t* reader,
+                              uint16_t year, uint8_t month, uint8_t day);
+
+/**
+ * @brief Legge il prossimo sample committato
+ *
+ * @param reader Lettore aperto
+ * @param sample Sample letto (minute_of_day = posizione nel file)
+ * @return ESP_OK, ESP_ERR_NOT_FOUND a fine file, ESP_FAIL se file corrotto/troncato
+ */
+esp_err_t history_reader_next(history_reader_t* reader, history_sample_t* sample);
+
+/**
+ * @brief Chiude il lettore
+ */
+void history_reader_close(history_reader_t* reader);
+
 /**
  * @brief Ottiene puntatore al buffer corrente (read-only)
  *
+ * Gli array vengono modificati da status_task senza preavviso: per leggere
+ * i sample usare history_read_samples() o history_acquire_day().
+ *
  * @return Puntatore al buffer o NULL se non inizializzato
  */
 const history_buffer_t* history_get_buffer(void);
 
+/**
+ * @brief Blocca un giorno in PSRAM per una lettura lunga (es. invio HTTP)
+ *
+ * Copia in view header e puntatori agli array. Finché la lettura non è
+ * rilasciata gli array non vengono svuotati né riusati: al cambio giorno
+ * il giorno corrente passa nel secondo buffer e resta leggibile come
+ * giorno precedente finché il task writer non lo ha scritto su file.
+ *
+ * @param previous false = giorno corrente, true = giorno precedente
+ * @param view Destinazione (array condivisi, sola lettura)
+ * @return ESP_OK, ESP_ERR_NOT_FOUND se il giorno precedente non è più in
+ *         PSRAM (già su file), ESP_ERR_INVALID_STATE se non inizializzato
+ */
+esp_err_t history_acquire_day(bool previous, history_buffer_t* view);
+
+/**
+ * @brief Rilascia una lettura ottenuta con history_acquire_day()
+ *
+ * @param view Stessa view passata a history_acquire_day()
+ */
+void history_release_day(const history_buffer_t* view);
+
 /**
  * @brief Ottiene un sample specifico dal buffer corrente
  *
@@ -151,6 +323,35 @@ const history_buffer_t* history_get_buffer(void);
  */
 esp_err_t history_get_sample(uint16_t minute_of_day, history_sample_t* sample);
 
+/**
+ * @brief Copia coerente di un intervallo di sample del giorno corrente
+ *
+ * Nessun lock: la copia viene ripetuta se history_record() modifica il
+ * buffer nel frattempo (vedi seqlock.h), quindi il task che registra non
+ * attende mai. Header e sample appartengono alla stessa versione; per
+ * letture lunghe si copiano blocchi brevi (decine di sample) e si
+ * confronta la data dell'header tra un blocco e l'altro.
+ *
+ * @param from Primo minuto (0-1440)
+ * @param count Sample da copiare (0 = solo header)
+ * @param samples Destinazione (count elementi, NULL se count = 0)
+ * @param header Header del buffer (opzionale, NULL)
+ * @return ESP_OK, ESP_ERR_INVALID_ARG se l'intervallo esce dal giorno,
+ *         ESP_ERR_INVALID_STATE se non inizializzato
+ */
+esp_err_t history_read_samples(uint16_t from, uint16_t count,
+                               history_sample_t* samples, history_header_t* header);
+
+/**
+ * @brief Minima e massima di un minuto del buffer corrente
+ *
+ * @param minute_of_day Minuto (0-1439)
+ * @param t_min Temperatura minima × 100
+ * @param t_max Temperatura massima × 100
+ * @return ESP_OK, ESP_ERR_NOT_FOUND se gli estremi non sono disponibili
+ */
+esp_err_t history_get_extremes(uint16_t minute_of_day, int16_t* t_min, int16_t* t_max);
+
 /**
  * @brief Ottiene il numero di sample validi nel buffer
  *
@@ -170,16 +371,31 @@ uint16_t history_get_sample_count(void);
 void history_get_filename(uint16_t year, uint8_t month, uint8_t day,
                           char* buffer, size_t buffer_size);
 
+/**
+ * @brief Nome del file compagno con gli estremi per minuto (.ext)
+ */
+void history_get_extremes_filename(uint16_t year, uint8_t month, uint8_t day,
+                                   char* buffer, size_t buffer_size);
+
 /**
  * @brief Verifica se esiste un file log per una data
  *
  * @param year Anno
  * @param month Mese
  * @param day Giorno
- * @return true se il file esiste
+ * @return true se il giorno è salvato (file o log, secondo il backend)
  */
 bool history_file_exists(uint16_t year, uint8_t month, uint8_t day);
 
+/**
+ * @brief Verifica se un giorno può ancora cambiare
+ *
+ * Vero per il giorno del buffer attivo, per il giorno concluso finché il
+ * task writer non lo ha scritto e per oggi o date future (cambio giorno
+ * rimandato). Gli altri giorni sono definitivi: risposte HTTP cacheabili.
+ */
+bool history_day_is_open(uint16_t year, uint8_t month, uint8_t day);
+
 /**
  * @brief Ottiene statistiche sul buffer corrente
  *
@@ -191,6 +407,18 @@ bool history_file_exists(uint16_t year, uint8_t month, uint8_t day);
 void history_get_stats(float* min_temp, float* max_temp, float* avg_temp,
                        uint16_t* heater_on_minutes);
 
+/**
+ * @brief Copia gli aggregati della giornata corrente
+ *
+ * Costo costante: gli aggregati sono aggiornati in history_add_sample().
+ * Min/max vengono ricalcolati solo se un minuto che li deteneva è stato
+ * sovrascritto con un valore diverso.
+ *
+ * @param stats Destinazione
+ * @return ESP_OK, ESP_ERR_INVALID_STATE se il buffer non è inizializzato
+ */
+esp_err_t history_get_stats_ex(history_stats_t* stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,150 @@
+/**
+ * @file history_rollup.h
+ * @brief Aggregati orari/giornalieri dello storico in file mensili
+ *
+ * Per ogni mese esiste un file /spiffs/rollup_YYYYMM.bin a dimensione fissa:
+ * header (8 bytes) + 31 record giornalieri + 31×24 record orari (16 bytes).
+ * Le query su lunghi periodi leggono solo i record aggregati invece dei
+ * file giornalieri al minuto (un anno a risoluzione giornaliera ≈ 6 KB).
+ *
+ * Gli aggregati orari sono ricalcolati dal buffer PSRAM per le sole ore
+ * modificate, quindi restano esatti anche se un minuto viene riscritto.
+ */
+
+#ifndef HISTORY_ROLLUP_H
+#define HISTORY_ROLLUP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include "comune.h"
+#include "history_manager.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define ROLLUP_MAGIC                "TRUP"  // Magic number file mensile
+#define ROLLUP_VERSION              1       // Versione formato
+#define ROLLUP_DAYS_PER_MONTH       31
+#define ROLLUP_HOURS_PER_DAY        24
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief Risoluzione delle query
+ */
+typedef enum {
+    ROLLUP_RES_HOUR = 0,
+    ROLLUP_RES_DAY,
+    ROLLUP_RES_MONTH
+} rollup_resolution_t;
+
+/**
+ * @brief Header del file mensile (8 bytes)
+ */
+typedef struct {
+    char magic[4];          // "TRUP"
+    uint8_t version;        // Versione formato (1)
+    uint8_t month;          // Mese (1-12)
+    uint16_t year;          // Anno
+} __attribute__((packed)) rollup_header_t;
+
+/**
+ * @brief Aggregato di un'ora o di un giorno (16 bytes)
+ *
+ * count = 0 indica un periodo senza dati.
+ */
+typedef struct {
+    int16_t t_min;          // Temperatura minima × 100
+    int16_t t_max;          // Temperatura massima × 100
+    int32_t t_sum;          // Somma temperature × 100 (media = t_sum / count)
+    uint16_t count;         // Minuti con temperatura valida
+    uint16_t heater_on;     // Minuti con caldaia accesa
+    uint32_t sp_err_sum;    // Somma |temperatura - setpoint| × 100
+} __attribute__((packed)) rollup_record_t;
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Azzera le ore da aggiornare (nuovo giorno o ricarica)
+ */
+void history_rollup_reset(void);
+
+/**
+ * @brief Segnala che il sample di un minuto è stato aggiunto o modificato
+ *
+ * Chiamata da history_add_sample(), costo O(1).
+ *
+ * @param minute_of_day Minuto del giorno (0-1439)
+ */
+void history_rollup_mark(uint16_t minute_of_day);
+
+/**
+ * @brief Preleva e azzera le ore segnate da history_rollup_mark()
+ *
+ * @return Bitmask delle ore (bit h = ora h)
+ */
+uint32_t history_rollup_take_dirty(void);
+
+/**
+ * @brief Rimette da aggiornare le ore di un flush fallito
+ */
+void history_rollup_restore_dirty(uint32_t dirty_hours);
+
+/**
+ * @brief Aggiorna su file le ore modificate e l'aggregato del giorno
+ *
+ * Le ore aggiornate restano in RAM per l'aggregato del giorno; se la data
+ * è diversa da quella del flush precedente vengono ricalcolate tutte.
+ * Da chiamare da un solo task (writer).
+ *
+ * @param header Header del buffer (data del giorno)
+ * @param samples Buffer dei 1440 sample del giorno
+ * @param dirty_hours Ore da ricalcolare (history_rollup_take_dirty)
+ * @return ESP_OK se successo, ESP_FAIL se errore I/O
+ */
+esp_err_t history_rollup_flush(const history_header_t* header, const history_sample_t* samples,
+                               uint32_t dirty_hours);
+
+/**
+ * @brief Aggregato del giorno dell'ultimo history_rollup_flush()
+ */
+void history_rollup_get_day(rollup_record_t* day);
+
+/**
+ * @brief Legge record aggregati da un file mensile
+ *
+ * @param year Anno
+ * @param month Mese
+ * @param hourly true per i record orari del giorno indicato, false per i giornalieri
+ * @param day Giorno (1-31, usato solo se hourly)
+ * @param records Destinazione (24 record se hourly, 31 altrimenti)
+ * @return ESP_OK, ESP_ERR_NOT_FOUND se il file del mese non esiste
+ */
+esp_err_t history_rollup_read(uint16_t year, uint8_t month, bool hourly, uint8_t day,
+                              rollup_record_t* records);
+
+/**
+ * @brief Accumula un aggregato in un altro
+ */
+void history_rollup_combine(rollup_record_t* acc, const rollup_record_t* rec);
+
+/**
+ * @brief Inizializza un aggregato vuoto
+ */
+void history_rollup_clear(rollup_record_t* rec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HISTORY_ROLLUP_H
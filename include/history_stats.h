@@ -0,0 +1,62 @@
+/**
+ * @file history_stats.h
+ * @brief Aggregati incrementali della giornata (history_stats_t)
+ *
+ * Ogni sample entra negli aggregati quando viene scritto e ne esce quando
+ * il suo minuto viene sovrascritto: le query costano O(1). Solo min/max
+ * non si possono togliere e vanno ricalcolati con una scansione quando il
+ * minuto sovrascritto deteneva un estremo.
+ */
+
+#ifndef HISTORY_STATS_H
+#define HISTORY_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include "comune.h"
+#include "history_manager.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Azzera gli aggregati
+ */
+void history_stats_reset(history_stats_t* stats);
+
+/**
+ * @brief Aggiunge (sign = 1) o toglie (sign = -1) un sample dagli aggregati
+ */
+void history_stats_apply(history_stats_t* stats, const history_sample_t* sample, int sign);
+
+/**
+ * @brief Sostituisce il sample old di un minuto con sample
+ *
+ * @return true se old deteneva min o max: serve history_stats_rescan_extremes()
+ */
+bool history_stats_replace(history_stats_t* stats, const history_sample_t* old,
+                           const history_sample_t* sample);
+
+/**
+ * @brief Ricalcola min/max con una scansione dei sample
+ */
+void history_stats_rescan_extremes(history_stats_t* stats, const history_sample_t* samples,
+                                   uint16_t count);
+
+/**
+ * @brief Ricostruisce tutti gli aggregati dai sample (dopo un caricamento)
+ */
+void history_stats_rebuild(history_stats_t* stats, const history_sample_t* samples,
+                           uint16_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HISTORY_STATS_H
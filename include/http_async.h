@@ -0,0 +1,107 @@
+/**
+ * @file http_async.h
+ * @brief Worker per gli handler HTTP lunghi
+ *
+ * Il server httpd ha un solo task: un download di log o un upload lo
+ * occupa per tutta la durata del trasferimento e le altre richieste
+ * (/api/status, pagina, WebSocket) aspettano. Gli handler lunghi passano
+ * la richiesta a un pool di worker con httpd_req_async_handler_begin()
+ * e ritornano subito; le GET leggere restano sul task httpd.
+ *
+ * Uso all'inizio di un handler lungo:
+ *
+ *     if (!http_async_is_worker()) {
+ *         return http_async_submit(req, my_handler);
+ *     }
+ *
+ * Il worker prende l'accesso condiviso a SPIFFS per tutta la durata
+ * dell'handler (storage_acquire): un OTA della partizione o un upload,
+ * accodati con HTTP_ASYNC_STORAGE_EXCLUSIVE, non smontano né riscrivono
+ * file mentre un altro worker li sta inviando. Se l'accesso non è
+ * disponibile la richiesta riceve 503 con Retry-After.
+ */
+
+#ifndef HTTP_ASYNC_H
+#define HTTP_ASYNC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include <esp_http_server.h>
+#include <stdbool.h>
+
+// ============================================================================
+// COSTANTI (ridefinibili con build_flags)
+// ============================================================================
+
+#ifndef HTTP_ASYNC_WORKERS
+#define HTTP_ASYNC_WORKERS      2       // Task worker
+#endif
+
+#ifndef HTTP_ASYNC_QUEUE_LEN
+#define HTTP_ASYNC_QUEUE_LEN    4       // Richieste in attesa di un worker
+#endif
+
+#define HTTP_ASYNC_STACK_SIZE   8192    // Come il task httpd
+#define HTTP_ASYNC_PRIORITY     4       // Sotto httpd e status_task (5)
+
+#ifndef HTTP_ASYNC_EXCLUSIVE_WAIT_MS
+#define HTTP_ASYNC_EXCLUSIVE_WAIT_MS    5000    // Attesa fine download prima di un OTA
+#endif
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief Accesso a SPIFFS preso dal worker attorno all'handler
+ */
+typedef enum {
+    HTTP_ASYNC_STORAGE_SHARED = 0,      // Legge o scrive file (default)
+    HTTP_ASYNC_STORAGE_EXCLUSIVE,       // Smonta o riscrive SPIFFS (OTA, upload)
+    HTTP_ASYNC_STORAGE_NONE,            // Non usa SPIFFS (OTA firmware)
+} http_async_storage_t;
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Crea la coda e i task worker (una volta sola)
+ */
+esp_err_t http_async_init(void);
+
+/**
+ * @brief true se il chiamante è un worker (handler già spostato)
+ */
+bool http_async_is_worker(void);
+
+/**
+ * @brief Passa la richiesta a un worker che eseguirà handler
+ *
+ * Se la coda è piena risponde 503 con Retry-After.
+ *
+ * @return Valore da restituire dall'handler sul task httpd
+ */
+esp_err_t http_async_submit(httpd_req_t *req, esp_err_t (*handler)(httpd_req_t *req));
+
+/**
+ * @brief Come http_async_submit() con l'accesso a SPIFFS indicato
+ */
+esp_err_t http_async_submit_storage(httpd_req_t *req, esp_err_t (*handler)(httpd_req_t *req),
+                                    http_async_storage_t storage);
+
+/**
+ * @brief true se l'ultimo handler sul task httpd ha accodato la richiesta
+ *
+ * Azzera il flag. Il completamento verrà registrato dal worker.
+ */
+bool http_async_take_submitted(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_ASYNC_H
@@ -28,6 +28,48 @@ void stop_webserver(void);
  */
 bool is_webserver_running(void);
 
+/**
+ * @brief Get the running server handle
+ * @return Server handle, or NULL if the server is stopped
+ */
+httpd_handle_t get_webserver_handle(void);
+
+/**
+ * @brief Check the request If-None-Match header against an ETag
+ * @param req HTTP request
+ * @param etag Quoted ETag of the current representation (e.g. "\"20251221-3512\"")
+ * @return true if the client copy is current and a 304 can be sent
+ */
+bool http_etag_matches(httpd_req_t *req, const char *etag);
+
+/**
+ * @brief Send an empty 304 Not Modified response
+ * @param req HTTP request
+ * @param etag ETag to repeat in the response
+ * @param cache_control Cache-Control value (NULL = none)
+ */
+esp_err_t http_send_not_modified(httpd_req_t *req, const char *etag, const char *cache_control);
+
+/**
+ * @brief Register a URI handler with request metrics
+ *
+ * Same as httpd_register_uri_handler(), but requests, errors, response
+ * bytes and latency of the handler are exported on /metrics, labelled
+ * with URI and method. The handler still receives its own user_ctx.
+ */
+esp_err_t http_register_uri(httpd_handle_t server, const httpd_uri_t *uri);
+
+/**
+ * @brief Record a request completed outside its handler
+ *
+ * Used by the async workers: the handler on the httpd task only queues
+ * the request, so latency and errors are recorded when the worker ends.
+ * @param req Async copy of the request
+ * @param ret Handler result
+ * @param start_us esp_timer_get_time() when the request was queued
+ */
+void http_request_done(httpd_req_t *req, esp_err_t ret, int64_t start_us);
+
 #ifdef __cplusplus
 }
 #endif
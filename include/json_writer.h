@@ -0,0 +1,107 @@
+/**
+ * @file json_writer.h
+ * @brief Scrittura JSON in streaming su risposta HTTP chunked
+ *
+ * Il testo viene accumulato in un buffer di alcuni KB e inviato con un
+ * solo httpd_resp_send_chunk quando è pieno, invece di un chunk per ogni
+ * record. I numeri a virgola fissa (temperature × 100) sono formattati con
+ * sole operazioni intere, senza snprintf("%.2f").
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include <esp_http_server.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define JSON_WRITER_BUF_SIZE    4096    // Dimensione consigliata del buffer
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief Stato dello writer
+ *
+ * Dopo il primo errore di invio le scritture successive vengono ignorate
+ * e json_writer_finish() restituisce l'errore.
+ */
+typedef struct {
+    httpd_req_t* req;       // Richiesta su cui inviare
+    char* buf;              // Buffer di accumulo
+    size_t cap;             // Dimensione buffer
+    size_t len;             // Byte in attesa di invio
+    esp_err_t err;          // Primo errore di invio
+    uint32_t bytes_sent;    // Byte inviati
+    uint16_t chunks_sent;   // Chunk HTTP inviati
+} json_writer_t;
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Inizializza lo writer su un buffer fornito dal chiamante
+ */
+void json_writer_init(json_writer_t* w, httpd_req_t* req, char* buf, size_t cap);
+
+/**
+ * @brief Accoda byte senza modifiche (testo JSON già valido)
+ */
+void json_writer_raw(json_writer_t* w, const char* data, size_t len);
+
+/**
+ * @brief Accoda una stringa C senza modifiche
+ */
+void json_writer_str(json_writer_t* w, const char* s);
+
+/**
+ * @brief Accoda un carattere
+ */
+void json_writer_char(json_writer_t* w, char c);
+
+/**
+ * @brief Accoda un intero con segno
+ */
+void json_writer_int(json_writer_t* w, int32_t value);
+
+/**
+ * @brief Accoda un numero a virgola fissa
+ *
+ * @param value Valore scalato (es. 2150 con decimals = 2 → "21.50")
+ * @param decimals Cifre decimali (0-4)
+ */
+void json_writer_fixed(json_writer_t* w, int32_t value, uint8_t decimals);
+
+/**
+ * @brief Accoda un intero a 2 cifre con zero iniziale (ore, minuti)
+ */
+void json_writer_2digits(json_writer_t* w, uint8_t value);
+
+/**
+ * @brief Invia il contenuto del buffer come chunk
+ */
+esp_err_t json_writer_flush(json_writer_t* w);
+
+/**
+ * @brief Invia il buffer residuo e chiude la risposta chunked
+ *
+ * @return ESP_OK o il primo errore di invio
+ */
+esp_err_t json_writer_finish(json_writer_t* w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JSON_WRITER_H
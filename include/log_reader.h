@@ -41,6 +41,9 @@ esp_err_t register_log_handlers(httpd_handle_t server);
 /**
  * @brief Read log file and return JSON data
  *
+ * Query: ?date=YYYYMMDD[&fields=temp,hum,heat,setpoint,press]
+ * Without fields all columns are returned; "t" is always present.
+ *
  * @param req HTTP request
  * @return ESP_OK on success
  */
@@ -58,7 +61,12 @@ esp_err_t log_raw_handler(httpd_req_t *req);
  * @brief Return current day log from PSRAM buffer
  *
  * Serves the live log data being collected today.
- * Returns binary data in the same format as log files.
+ * Returns binary data in the same format as log files (v1 records).
+ * With ?since=<minute> only records after that minute are sent (header
+ * still included). The X-Log-Generation header (YYYYMMDD) changes at
+ * day rollover so the client knows to drop its cursor.
+ * With ?day=yesterday the previous day is served from its PSRAM buffer
+ * while the storage writer has not yet recycled it, then from its file.
  *
  * @param req HTTP request
  * @return ESP_OK on success
@@ -75,6 +83,31 @@ esp_err_t log_current_handler(httpd_req_t *req);
  */
 esp_err_t log_list_handler(httpd_req_t *req);
 
+/**
+ * @brief Return aggregated history (min/max/avg, heater minutes, setpoint error)
+ *
+ * Query: ?from=YYYYMMDD&to=YYYYMMDD&res=hour|day|month
+ * Reads only the monthly rollup files, never the per-minute day logs.
+ *
+ * @param req HTTP request
+ * @return ESP_OK on success
+ */
+esp_err_t log_rollup_handler(httpd_req_t *req);
+
+/**
+ * @brief Return a downsampled multi-day temperature series
+ *
+ * Query: ?from=YYYYMMDD&to=YYYYMMDD[&points=N] (default 500, max 2000).
+ * Minutes are grouped in equal buckets; each bucket contributes its min and
+ * max sample in time order. Response data is an array of
+ * [minute_from_start, temp, setpoint|null, heat_percent].
+ * Memory use does not depend on the range length.
+ *
+ * @param req HTTP request
+ * @return ESP_OK on success
+ */
+esp_err_t log_range_handler(httpd_req_t *req);
+
 #ifdef __cplusplus
 }
 #endif
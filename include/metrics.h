@@ -0,0 +1,139 @@
+/**
+ * @file metrics.h
+ * @brief Registro di metriche esposto su /metrics (formato testo Prometheus)
+ *
+ * Tre tipi di metrica:
+ *   - counter: totale crescente (richieste, byte inviati, errori)
+ *   - gauge: valore istantaneo, impostato o letto da una callback
+ *   - histogram: distribuzione su bucket fissi (durate in µs)
+ *
+ * Gli aggiornamenti non usano lock: ogni core scrive nel proprio shard con
+ * operazioni atomiche, /metrics somma gli shard al momento della lettura.
+ * Un contatore a 64 bit è tenuto come due parole a 32 bit (lo + riporto
+ * in hi), senza atomiche a 64 bit che su Xtensa passano da un lock.
+ *
+ * Le metriche sono variabili statiche dei moduli che le aggiornano,
+ * registrate una volta con nome, help ed etichette.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include <esp_http_server.h>
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define METRICS_SHARDS          portNUM_PROCESSORS
+#define METRICS_MAX_ENTRIES     96      // Metriche registrabili (etichette distinte incluse)
+#define METRICS_MAX_BUCKETS     12      // Bucket per istogramma (escluso +Inf)
+
+/**
+ * @brief Bucket di latenza predefiniti (µs): 1 ms ... 10 s
+ */
+extern const uint32_t metrics_latency_bounds_us[];
+#define METRICS_LATENCY_NUM_BOUNDS  12
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+typedef enum {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM
+} metric_type_t;
+
+/**
+ * @brief Contatore a 64 bit per core
+ */
+typedef struct {
+    uint32_t lo[METRICS_SHARDS];
+    uint32_t hi[METRICS_SHARDS];
+} metrics_counter_t;
+
+/**
+ * @brief Valore istantaneo
+ *
+ * Se read non è NULL il valore viene letto a ogni richiesta di /metrics.
+ */
+typedef struct {
+    int32_t value;
+    int32_t (*read)(void);
+} metrics_gauge_t;
+
+/**
+ * @brief Istogramma a bucket fissi, per core
+ */
+typedef struct {
+    const uint32_t* bounds;     // Limiti superiori crescenti (µs)
+    uint8_t num_bounds;         // Numero di limiti (≤ METRICS_MAX_BUCKETS)
+    uint32_t buckets[METRICS_SHARDS][METRICS_MAX_BUCKETS + 1];  // Ultimo = +Inf, non cumulativi
+    metrics_counter_t sum;      // Somma dei valori (µs)
+} metrics_histogram_t;
+
+// Inizializzatore per un istogramma di latenza
+#define METRICS_HISTOGRAM_LATENCY_INIT  { metrics_latency_bounds_us, METRICS_LATENCY_NUM_BOUNDS }
+
+// ============================================================================
+// AGGIORNAMENTO (da qualsiasi task, senza lock)
+// ============================================================================
+
+void metrics_counter_add(metrics_counter_t* c, uint32_t n);
+
+static inline void metrics_counter_inc(metrics_counter_t* c)
+{
+    metrics_counter_add(c, 1);
+}
+
+void metrics_gauge_set(metrics_gauge_t* g, int32_t value);
+
+/**
+ * @brief Registra un valore (µs) nell'istogramma
+ */
+void metrics_histogram_observe(metrics_histogram_t* h, uint32_t value_us);
+
+/**
+ * @brief Somma degli shard di un contatore
+ */
+uint64_t metrics_counter_read(const metrics_counter_t* c);
+
+// ============================================================================
+// REGISTRO
+// ============================================================================
+
+/**
+ * @brief Registra una metrica per l'esposizione su /metrics
+ *
+ * name, help e labels devono restare validi per sempre (stringhe costanti
+ * o buffer statici). Metriche con lo stesso nome formano una famiglia.
+ *
+ * @param labels Etichette senza graffe (es. "uri=\"/api/log\"") o NULL
+ * @return ESP_ERR_NO_MEM se il registro è pieno
+ */
+esp_err_t metrics_register(const char* name, const char* help, const char* labels,
+                           metric_type_t type, void* metric);
+
+/**
+ * @brief Handler GET /metrics
+ *
+ * Metriche registrate più quelle di sistema: heap e PSRAM liberi
+ * (attuale e minimo), stack libero minimo dei task, riconnessioni WiFi,
+ * client WebSocket, uptime.
+ */
+esp_err_t metrics_handler(httpd_req_t *req);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_H
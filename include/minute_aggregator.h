@@ -0,0 +1,81 @@
+/**
+ * @file minute_aggregator.h
+ * @brief Aggregazione delle letture a 1 Hz in un sample al minuto
+ *
+ * Accumula le letture di un minuto in interi (temperatura × 100, umidità
+ * %, pressione in decimi di hPa) e ne ricava media, minima e massima per
+ * history_record(). Solo aritmetica intera: nessuna operazione in virgola
+ * mobile per lettura.
+ */
+
+#ifndef MINUTE_AGGREGATOR_H
+#define MINUTE_AGGREGATOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "history_manager.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief Accumulatore di un minuto
+ */
+typedef struct {
+    int32_t t_sum;          // Somma temperature × 100
+    int16_t t_min;
+    int16_t t_max;
+    uint32_t h_sum;         // Somma umidità
+    uint32_t p_sum;         // Somma pressioni (decimi di hPa)
+    uint16_t count;         // Letture accumulate
+} minute_aggregator_t;
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Azzera l'accumulatore (inizio minuto)
+ */
+void minute_aggregator_reset(minute_aggregator_t* agg);
+
+/**
+ * @brief Aggiunge una lettura
+ *
+ * @param temperature Temperatura × 100
+ * @param humidity Umidità %
+ * @param pressure Pressione in decimi di hPa
+ */
+void minute_aggregator_add(minute_aggregator_t* agg, int16_t temperature,
+                           uint8_t humidity, uint16_t pressure);
+
+/**
+ * @brief Calcola media, minima e massima e azzera l'accumulatore
+ *
+ * Va chiamata al primo giro del minuto successivo: epoch_minute è il
+ * minuto appena concluso, non quello corrente.
+ *
+ * @param epoch_minute Minuto delle letture accumulate (time / 60)
+ * @return false se nel minuto non ci sono letture
+ */
+bool minute_aggregator_finish(minute_aggregator_t* agg, int64_t epoch_minute,
+                              history_minute_t* out);
+
+/**
+ * @brief Giorno locale e posizione nel giorno di un minuto dall'epoch
+ *
+ * Alle 00:00 il minuto concluso è il 1439 del giorno prima.
+ */
+void minute_aggregator_slot(int64_t epoch_minute, uint16_t* year, uint8_t* month,
+                            uint8_t* day, uint16_t* minute_of_day);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MINUTE_AGGREGATOR_H
@@ -0,0 +1,110 @@
+/**
+ * @file seqlock.h
+ * @brief Pubblicazione di snapshot con contatore di sequenza (seqlock)
+ *
+ * Un solo scrittore alla volta aggiorna una struttura condivisa senza mai
+ * attendere i lettori: incrementa il contatore (dispari = scrittura in
+ * corso), modifica i dati e lo incrementa di nuovo. Il lettore copia i
+ * dati tra due letture del contatore e ripete la copia se il contatore è
+ * cambiato o era dispari. Nessun mutex: status_task (core 1) non viene mai
+ * rallentato dai lettori HTTP o dal display (core 0).
+ *
+ * Più scrittori vanno serializzati dal chiamante (es. con il lock del
+ * modulo). I dati vanno copiati dal lettore, mai usati in place, e la
+ * copia deve essere breve: la probabilità di ripetere cresce con la durata.
+ *
+ * Uso in lettura:
+ *
+ *     uint32_t seq;
+ *     do {
+ *         seq = seqlock_read_begin(&lock);
+ *         copy = shared;
+ *     } while (seqlock_read_retry(&lock, seq));
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief Contatore di sequenza (0 = nessuna pubblicazione)
+ */
+typedef struct {
+    volatile uint32_t seq;
+} seqlock_t;
+
+#define SEQLOCK_INIT    { 0 }
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Apre una scrittura (contatore dispari)
+ */
+static inline void seqlock_write_begin(seqlock_t* sl)
+{
+    __atomic_store_n(&sl->seq, sl->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);    // Contatore visibile prima dei dati
+}
+
+/**
+ * @brief Chiude una scrittura (contatore pari)
+ */
+static inline void seqlock_write_end(seqlock_t* sl)
+{
+    __atomic_store_n(&sl->seq, sl->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Inizio lettura: attende che non ci sia una scrittura in corso
+ *
+ * Lo scrittore può essere stato interrotto a metà sullo stesso core da un
+ * lettore a priorità maggiore: invece di girare a vuoto il lettore cede la
+ * CPU per un tick.
+ *
+ * @return Valore del contatore da passare a seqlock_read_retry()
+ */
+static inline uint32_t seqlock_read_begin(const seqlock_t* sl)
+{
+    uint32_t seq;
+    while ((seq = __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE)) & 1) {
+        vTaskDelay(1);
+    }
+    return seq;
+}
+
+/**
+ * @brief Fine lettura: true se i dati copiati vanno scartati e riletti
+ */
+static inline bool seqlock_read_retry(const seqlock_t* sl, uint32_t seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);    // Copia completata prima del controllo
+    return __atomic_load_n(&sl->seq, __ATOMIC_RELAXED) != seq;
+}
+
+/**
+ * @brief true se è stata pubblicata almeno una versione
+ */
+static inline bool seqlock_published(const seqlock_t* sl)
+{
+    return __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE) != 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SEQLOCK_H
@@ -0,0 +1,105 @@
+/**
+ * @file static_cache.h
+ * @brief Cache in PSRAM dei file statici della web UI
+ *
+ * I file serviti da serve_spiffs_file() (index.html, uPlot, varianti .gz)
+ * vengono letti da SPIFFS al primo accesso e poi inviati direttamente dalla
+ * PSRAM, senza fopen/fread e senza competere con i salvataggi dello storico.
+ * Anche l'assenza di un file (es. variante .gz mancante) viene ricordata,
+ * finché lo slot non serve: le assenze usate meno di recente lasciano il
+ * posto ai nuovi file.
+ *
+ * La cache va invalidata quando SPIFFS cambia: /api/upload e OTA SPIFFS.
+ */
+
+#ifndef STATIC_CACHE_H
+#define STATIC_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define STATIC_CACHE_MAX_ENTRIES    24              // File (presenti o assenti) in cache
+#define STATIC_CACHE_MAX_FILE       (256 * 1024)    // File più grandi: streaming da SPIFFS
+#define STATIC_CACHE_BUDGET         (2 * 1024 * 1024)  // PSRAM totale per i contenuti
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief File in cache
+ *
+ * Valido fino a static_cache_release(): un'invalidazione concorrente
+ * libera la memoria solo quando non è più in uso.
+ */
+typedef struct {
+    char path[48];          // Percorso completo (/spiffs/...)
+    uint8_t* data;          // Contenuto in PSRAM (NULL se il file non esiste)
+    size_t size;            // Dimensione contenuto
+    char etag[32];          // ETag forte (tra virgolette)
+    bool present;           // false = file non presente su SPIFFS
+    bool stale;             // Invalidato, da liberare al rilascio
+    uint16_t refs;          // Richieste che stanno inviando il contenuto
+    uint32_t last_used;     // Ultimo static_cache_get() (sostituzione LRU)
+} static_cache_entry_t;
+
+/**
+ * @brief Contatori della cache
+ */
+typedef struct {
+    uint32_t hits;          // Richieste servite dalla PSRAM (o 404 noti)
+    uint32_t misses;        // Caricamenti da SPIFFS
+    uint32_t bypass;        // File non cacheabili (troppo grandi, cache piena)
+    uint32_t invalidations; // Invalidazioni
+    uint16_t entries;       // File in cache
+    size_t bytes;           // Byte di PSRAM usati
+} static_cache_stats_t;
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Inizializza la cache
+ */
+esp_err_t static_cache_init(void);
+
+/**
+ * @brief Ottiene un file dalla cache, caricandolo da SPIFFS al primo accesso
+ *
+ * @param path Percorso completo del file
+ * @return Entry (da rilasciare con static_cache_release) o NULL se il file
+ *         non è cacheabile e va servito da SPIFFS
+ */
+static_cache_entry_t* static_cache_get(const char* path);
+
+/**
+ * @brief Rilascia un'entry ottenuta con static_cache_get()
+ */
+void static_cache_release(static_cache_entry_t* entry);
+
+/**
+ * @brief Invalida un file (NULL = tutta la cache)
+ */
+void static_cache_invalidate(const char* path);
+
+/**
+ * @brief Legge i contatori della cache
+ */
+void static_cache_get_stats(static_cache_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STATIC_CACHE_H
@@ -0,0 +1,104 @@
+/**
+ * @file status_push.h
+ * @brief Invio dello stato corrente ai client WebSocket
+ *
+ * status_task pubblica ogni secondo uno snapshot dello stato; se è cambiato
+ * rispetto all'ultimo inviato, i campi modificati vengono codificati in frame
+ * binari (ws_protocol.h) e accodati a tutti i client /ws (ws_session.h),
+ * senza attendere l'invio. Se nulla cambia non parte nessun frame: con
+ * valori stabili si invia al minuto il nuovo sample e l'ora.
+ */
+
+#ifndef STATUS_PUSH_H
+#define STATUS_PUSH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <time.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define STATUS_JSON_MAX_LEN     192     // JSON di /api/status e dei frame push
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief Snapshot dello stato del termostato
+ */
+typedef struct {
+    time_t timestamp;           // Ora locale della lettura
+    int16_t temperature;        // Temperatura × 100
+    uint8_t humidity;           // Umidità relativa (%)
+    uint16_t pressure;          // Pressione in decimi di hPa
+    int16_t setpoint;           // Soglia attiva × 100
+    bool heater_on;             // Stato caldaia
+    uint16_t samples;           // Sample nel buffer dello storico
+} status_snapshot_t;
+
+/**
+ * @brief Parametri di configurazione mostrati dalla pagina
+ */
+typedef struct {
+    int16_t hysteresis;         // Isteresi × 100
+    int16_t temp_correction;    // Correzione sensore × 100
+    bool manual_mode;           // Modo manuale
+    int16_t manual_setpoint;    // Soglia manuale × 100
+    uint8_t active_bank;        // Banco programma attivo
+} status_config_t;
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Inizializza il modulo e le sessioni WebSocket
+ */
+esp_err_t status_push_init(void);
+
+/**
+ * @brief Formatta uno snapshot nel JSON di /api/status
+ *
+ * @return Lunghezza del testo (troncato a len - 1)
+ */
+int status_format_json(const status_snapshot_t* snap, char* buf, size_t len);
+
+/**
+ * @brief Pubblica lo stato corrente (chiamata da status_task)
+ *
+ * Confronta lo snapshot con l'ultimo inviato alla risoluzione mostrata
+ * dalla pagina (0.1 °C, minuto) e accoda l'invio solo se differisce.
+ * Un cambio caldaia diventa un frame RELAY, un nuovo sample un frame SAMPLE.
+ */
+void status_push_publish(const status_snapshot_t* snap);
+
+/**
+ * @brief Copia l'ultimo stato pubblicato, senza lock (vedi seqlock.h)
+ *
+ * Sicura da qualsiasi task; status_task non attende mai i lettori.
+ *
+ * @return false se status_task non ha ancora pubblicato nulla
+ */
+bool status_push_get_current(status_snapshot_t* snap);
+
+/**
+ * @brief Pubblica i parametri di configurazione
+ *
+ * Da chiamare all'avvio e a ogni modifica; ai client va solo il delta.
+ */
+void status_push_publish_config(const status_config_t* config);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STATUS_PUSH_H
@@ -7,6 +7,9 @@
 #define STORAGE_MANAGER_H
 
 #include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -55,6 +58,47 @@ esp_err_t storage_unmount(void);
  */
 esp_err_t storage_remount(void);
 
+/**
+ * @brief Wait value for storage_acquire() that never times out
+ */
+#define STORAGE_WAIT_FOREVER    UINT32_MAX
+
+/**
+ * @brief Take shared access to SPIFFS
+ *
+ * Taken by code that keeps files open across a long operation (log
+ * downloads, static files, storage writer jobs). Any number of shared
+ * holders can run together; none can start while an exclusive holder is
+ * active or waiting.
+ *
+ * @param wait_ms How long to wait for an exclusive holder to finish
+ * @return true if acquired, release with storage_release()
+ */
+bool storage_acquire(uint32_t wait_ms);
+
+/**
+ * @brief Release shared access taken with storage_acquire()
+ */
+void storage_release(void);
+
+/**
+ * @brief Take exclusive access to SPIFFS
+ *
+ * Used by SPIFFS OTA (which unmounts the filesystem) and file uploads.
+ * New shared requests are refused at once; current holders are given
+ * wait_ms to finish.
+ *
+ * @param wait_ms How long to wait for shared holders to drain
+ * @return true if acquired, false if another exclusive holder is active
+ *         or the shared holders did not finish in time
+ */
+bool storage_acquire_exclusive(uint32_t wait_ms);
+
+/**
+ * @brief Release exclusive access taken with storage_acquire_exclusive()
+ */
+void storage_release_exclusive(void);
+
 #ifdef __cplusplus
 }
 #endif
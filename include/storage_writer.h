@@ -0,0 +1,78 @@
+/**
+ * @file storage_writer.h
+ * @brief Task dedicato alle scritture su SPIFFS
+ *
+ * Una pausa di SPIFFS (garbage collection, erase di settori) può durare
+ * secondi. Se la scrittura avviene in status_task si ferma l'orologio sul
+ * display e scatta il watchdog. I chiamanti accodano invece un job senza
+ * bloccare; il task writer lo esegue appena possibile.
+ *
+ * Un job è una funzione senza argomenti che fotografa da sé i dati da
+ * scrivere al momento dell'esecuzione: un job già in coda non viene
+ * accodato di nuovo (le richieste doppie si fondono in una scrittura).
+ *
+ * Profondità della coda, job fusi o scartati e durata delle scritture
+ * sono esposti su /metrics.
+ */
+
+#ifndef STORAGE_WRITER_H
+#define STORAGE_WRITER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+
+// ============================================================================
+// COSTANTI (ridefinibili con build_flags)
+// ============================================================================
+
+#ifndef STORAGE_WRITER_QUEUE_LEN
+#define STORAGE_WRITER_QUEUE_LEN    8       // Job distinti in attesa
+#endif
+
+#define STORAGE_WRITER_STACK_SIZE   4096
+#define STORAGE_WRITER_PRIORITY     3       // Sotto status_task (5) e worker HTTP (4)
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief Job di scrittura, eseguito dal task writer
+ */
+typedef esp_err_t (*storage_job_fn_t)(void);
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Crea la coda e il task writer (una volta sola)
+ */
+esp_err_t storage_writer_init(void);
+
+/**
+ * @brief Accoda un job senza bloccare
+ *
+ * Se lo stesso job è già in coda la richiesta viene fusa con quella.
+ * Senza task writer (init non chiamata) il job viene eseguito subito
+ * dal chiamante.
+ *
+ * @param fn Job da eseguire
+ * @param name Nome per log e diagnostica (stringa costante)
+ * @return ESP_OK se accodato o fuso, ESP_ERR_TIMEOUT se la coda è piena
+ */
+esp_err_t storage_writer_post(storage_job_fn_t fn, const char* name);
+
+/**
+ * @brief Job in coda (non ancora iniziati)
+ */
+int storage_writer_queue_depth(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STORAGE_WRITER_H
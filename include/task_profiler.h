@@ -0,0 +1,104 @@
+/**
+ * @file task_profiler.h
+ * @brief Profilo CPU e stack dei task FreeRTOS
+ *
+ * Un task a bassa priorità legge una volta al secondo i contatori di
+ * run-time di FreeRTOS (CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS, base
+ * esp_timer in µs) e ne conserva i delta degli ultimi 60 s. Da questi
+ * ricava per ogni task la CPU % su finestre scorrevoli di 1, 10 e 60 s e
+ * il carico di ogni core (100% - task IDLE del core).
+ *
+ * La CPU % è riferita a un core: la somma su tutti i task vale 200%.
+ * Il contatore a 32 bit si azzera ogni ~71 minuti: i delta senza segno
+ * restano corretti finché un periodo dura meno di così.
+ *
+ * FreeRTOS non conta i cambi di contesto per task: il profilo riporta
+ * stato, priorità (corrente e base), affinità e stack libero minimo.
+ *
+ * Esposto su GET /api/debug/tasks e con il comando 't' della console seriale.
+ */
+
+#ifndef TASK_PROFILER_H
+#define TASK_PROFILER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include <esp_http_server.h>
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define TASK_PROFILER_PERIOD_MS     1000    // Campionamento contatori
+#define TASK_PROFILER_HISTORY       60      // Periodi conservati (finestra più lunga)
+#define TASK_PROFILER_MAX_TASKS     40      // Task tracciati
+#define TASK_PROFILER_NUM_WINDOWS   3       // Finestre: 1, 10, 60 periodi
+
+#define TASK_PROFILER_STACK_SIZE    3072
+#define TASK_PROFILER_PRIORITY      1       // Sopra IDLE, sotto tutto il resto
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief Profilo di un task
+ */
+typedef struct {
+    char name[configMAX_TASK_NAME_LEN];
+    uint32_t number;                        // xTaskNumber (univoco)
+    int8_t core;                            // Affinità, -1 = qualsiasi core
+    uint8_t priority;                       // Priorità corrente (eredità mutex)
+    uint8_t base_priority;
+    char state;                             // X=running R=ready B=blocked S=suspended D=deleted
+    uint16_t cpu[TASK_PROFILER_NUM_WINDOWS];    // Centesimi di % di un core
+    uint32_t stack_free_min;                // Byte mai usati dello stack
+} task_profile_t;
+
+/**
+ * @brief Dati globali del profilo
+ */
+typedef struct {
+    uint16_t window_s[TASK_PROFILER_NUM_WINDOWS];   // Durata effettiva (più corta al boot)
+    uint16_t core_load[portNUM_PROCESSORS][TASK_PROFILER_NUM_WINDOWS];  // Centesimi di %
+} task_profiler_summary_t;
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Avvia il task di campionamento
+ */
+esp_err_t task_profiler_init(void);
+
+/**
+ * @brief Copia il profilo corrente, ordinato per CPU sulla finestra di 10 s
+ *
+ * @param tasks Array di uscita (TASK_PROFILER_MAX_TASKS basta sempre)
+ * @param max Dimensione di tasks
+ * @param summary Carico dei core e durata delle finestre (può essere NULL)
+ * @return Numero di task copiati (0 prima del primo campione)
+ */
+int task_profiler_get(task_profile_t* tasks, int max, task_profiler_summary_t* summary);
+
+/**
+ * @brief Stampa il profilo su console
+ */
+void task_profiler_print(void);
+
+/**
+ * @brief Handler GET /api/debug/tasks (JSON)
+ */
+esp_err_t task_profiler_handler(httpd_req_t *req);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TASK_PROFILER_H
@@ -0,0 +1,117 @@
+/**
+ * @file trace.h
+ * @brief Traccia a basso costo delle fasi dei percorsi caldi
+ *
+ * Ogni core scrive eventi da 16 byte in un proprio ring in RAM interna,
+ * con timestamp dal contatore di cicli della CPU. La scrittura maschera
+ * gli interrupt solo sul core corrente per pochi cicli: nessun lock tra
+ * i core, utilizzabile anche da ISR.
+ *
+ * GET /api/debug/trace restituisce il contenuto dei ring in formato
+ * Chrome trace-event (JSON), da aprire con Perfetto o chrome://tracing:
+ * un solo processo, una traccia per task (più una per gli interrupt di
+ * ogni core); il core di ogni evento è in args.core.
+ *
+ * I contatori di cicli dei due core non sono sincronizzati e a 240 MHz
+ * si azzerano ogni ~18 s: al momento del dump ogni core viene agganciato
+ * a esp_timer e gli eventi sono datati a ritroso. Pause senza eventi
+ * oltre ~8 s su un core rendono inaffidabili i tempi precedenti.
+ *
+ * Disattivata di default: le macro TRACE_* sono vuote e i ring non
+ * occupano memoria. Si attiva con build_flags = -DTRACE_ENABLE=1.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include <esp_http_server.h>
+#include <stdint.h>
+
+// ============================================================================
+// COSTANTI (ridefinibili con build_flags)
+// ============================================================================
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE            0
+#endif
+
+#ifndef TRACE_RING_EVENTS
+#define TRACE_RING_EVENTS       512     // Eventi per core (8 KB)
+#endif
+
+// ============================================================================
+// EVENTI
+// ============================================================================
+
+/**
+ * @brief Punti tracciati (nomi in trace.cpp)
+ */
+typedef enum {
+    TRACE_STATUS_LOOP = 0,      // Iterazione di status_task
+    TRACE_SENSOR_READ,          // Lettura BME280 o simulatore
+    TRACE_HISTORY_RECORD,       // history_record() al cambio minuto
+    TRACE_DISPLAY_UPDATE,       // display_update_status()
+    TRACE_STATUS_PRINTF,        // Riga di stato su console
+    TRACE_LVGL_FLUSH,           // lvgl_port_flush_callback()
+    TRACE_LVGL_CHUNK,           // Un trasferimento della flush (arg = indice)
+    TRACE_LCD_DMA_DONE,         // Fine trasferimento al pannello (ISR)
+    TRACE_HTTP_HANDLER,         // Handler HTTP (arg = URI, const char*)
+    TRACE_NUM_IDS
+} trace_id_t;
+
+typedef enum {
+    TRACE_PHASE_BEGIN = 'B',
+    TRACE_PHASE_END = 'E',
+    TRACE_PHASE_INSTANT = 'i'
+} trace_phase_t;
+
+/**
+ * @brief Evento nel ring (16 byte)
+ */
+typedef struct {
+    uint32_t cycles;            // esp_cpu_get_cycle_count() del core
+    uint32_t arg;               // Argomento (intero o puntatore a stringa costante)
+    uint32_t task;              // TaskHandle_t, 0 = ISR
+    uint16_t id;                // trace_id_t
+    uint8_t phase;              // trace_phase_t
+    uint8_t reserved;
+} trace_event_t;
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+#if TRACE_ENABLE
+
+/**
+ * @brief Registra un evento sul ring del core corrente (anche da ISR)
+ */
+void trace_record(uint16_t id, uint8_t phase, uint32_t arg);
+
+/**
+ * @brief Handler GET /api/debug/trace (Chrome trace-event JSON)
+ */
+esp_err_t trace_handler(httpd_req_t *req);
+
+#define TRACE_BEGIN(id, arg)    trace_record((id), TRACE_PHASE_BEGIN, (uint32_t)(uintptr_t)(arg))
+#define TRACE_END(id, arg)      trace_record((id), TRACE_PHASE_END, (uint32_t)(uintptr_t)(arg))
+#define TRACE_INSTANT(id, arg)  trace_record((id), TRACE_PHASE_INSTANT, (uint32_t)(uintptr_t)(arg))
+
+#else
+
+#define TRACE_BEGIN(id, arg)    do { } while (0)
+#define TRACE_END(id, arg)      do { } while (0)
+#define TRACE_INSTANT(id, arg)  do { } while (0)
+
+#endif // TRACE_ENABLE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_H
@@ -1,6 +1,6 @@
 /**
  * @file wifi.h
- * @brief WiFi management and WebSocket client handling
+ * @brief WiFi management
  */
 
 #ifndef WIFI_H
@@ -23,34 +23,6 @@ extern "C" {
  */
 void setup_wifi(void);
 
-// ============================================================================
-// WebSocket Client Management
-// ============================================================================
-
-/**
- * @brief Register a new WebSocket client for broadcast
- * @param fd File descriptor of the client socket
- */
-void register_ws_client(int fd);
-
-/**
- * @brief Unregister a WebSocket client
- * @param fd File descriptor of the client socket
- */
-void unregister_ws_client(int fd);
-
-/**
- * @brief WebSocket handler (called by http_server)
- * @param req HTTP request
- * @return ESP_OK on success
- */
-esp_err_t ws_handler(httpd_req_t *req);
-
-/**
- * @brief Cleanup dead WebSocket connections
- */
-void websocket_cleanup_dead_connections(void);
-
 // ============================================================================
 // Diagnostics
 // ============================================================================
@@ -63,6 +35,16 @@ void websocket_cleanup_dead_connections(void);
  */
 void get_wifi_status(char* buffer, size_t buffer_size, const char* subcommand);
 
+/**
+ * @brief Reconnection attempts since setup_wifi()
+ */
+uint32_t wifi_get_reconnect_count(void);
+
+/**
+ * @brief Disconnections since setup_wifi()
+ */
+uint32_t wifi_get_disconnect_count(void);
+
 // ============================================================================
 // Constants
 // ============================================================================
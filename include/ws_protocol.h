@@ -0,0 +1,141 @@
+/**
+ * @file ws_protocol.h
+ * @brief Frame binari del canale WebSocket /ws
+ *
+ * Ogni frame WebSocket binario contiene un messaggio:
+ *
+ *   [0] versione (WS_PROTO_VERSION)
+ *   [1] tipo (ws_msg_type_t)
+ *   [2] maschera di presenza dei campi (bit 0 = primo campo)
+ *   [3..] campi presenti, in ordine di bit, little-endian
+ *
+ * Lo stato viene inviato come delta: solo i campi cambiati rispetto al
+ * frame precedente. Il client tiene l'ultimo valore dei campi assenti.
+ * Nuovi campi vanno aggiunti solo in coda (bit più alti): un decoder
+ * vecchio legge i campi che conosce e ignora il resto del frame.
+ *
+ * Tempi: secondi dal 1970 dell'ora LOCALE del termostato, come se fosse
+ * UTC (il client usa getUTC* per data e ora, senza conversioni di fuso).
+ *
+ * Traffico stimato per client, valori stabili:
+ *   - polling JSON /api/status: ~190 B di corpo + ~450 B di header
+ *     HTTP per richiesta, 3600 richieste/ora → ~2.3 MB/ora
+ *   - push binario: al minuto un SAMPLE (15 B) e uno STATUS con ora e
+ *     contatore (9 B), + 2 B di header WebSocket ciascuno → ~1.7 KB/ora,
+ *     più 7-8 B per ogni variazione di temperatura/umidità.
+ */
+
+#ifndef WS_PROTOCOL_H
+#define WS_PROTOCOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include "comune.h"
+#include "status_push.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define WS_PROTO_VERSION        1
+#define WS_PROTO_HEADER_SIZE    3
+#define WS_PROTO_MAX_FRAME      20      // Frame più lungo (STATUS completo = 17 B)
+
+/**
+ * @brief Tipi di messaggio
+ */
+typedef enum {
+    WS_MSG_STATUS = 1,      // Stato corrente (delta)
+    WS_MSG_SAMPLE = 2,      // Nuovo sample dello storico
+    WS_MSG_RELAY = 3,       // Cambio stato caldaia
+    WS_MSG_CONFIG = 4       // Parametri di configurazione (delta)
+} ws_msg_type_t;
+
+// Campi WS_MSG_STATUS
+#define WS_STATUS_TIME          0x01    // uint32 ora locale
+#define WS_STATUS_TEMP          0x02    // int16 temperatura × 100
+#define WS_STATUS_HUM           0x04    // uint8 umidità %
+#define WS_STATUS_PRESS         0x08    // uint16 pressione in decimi di hPa
+#define WS_STATUS_SETPOINT      0x10    // int16 soglia × 100
+#define WS_STATUS_HEAT          0x20    // uint8 caldaia 0/1
+#define WS_STATUS_SAMPLES       0x40    // uint16 sample nel buffer
+#define WS_STATUS_ALL           0x7F
+
+// Campi WS_MSG_SAMPLE (sempre tutti presenti)
+#define WS_SAMPLE_TIME          0x01    // uint32 ora locale di inizio minuto
+#define WS_SAMPLE_TEMP          0x02    // int16 × 100 (-32768 = non valido)
+#define WS_SAMPLE_HUM           0x04    // uint8 (255 = non valido)
+#define WS_SAMPLE_FLAGS         0x08    // uint8 HISTORY_FLAG_*
+#define WS_SAMPLE_SETPOINT      0x10    // int16 × 100
+#define WS_SAMPLE_PRESS         0x20    // uint16 decimi di hPa (0 = non valido)
+#define WS_SAMPLE_ALL           0x3F
+
+// Campi WS_MSG_RELAY
+#define WS_RELAY_TIME           0x01    // uint32 ora locale del cambio
+#define WS_RELAY_STATE          0x02    // uint8 0/1
+#define WS_RELAY_ALL            0x03
+
+// Campi WS_MSG_CONFIG
+#define WS_CONFIG_HYSTERESIS    0x01    // int16 isteresi × 100
+#define WS_CONFIG_CORRECTION    0x02    // int16 correzione sensore × 100
+#define WS_CONFIG_MANUAL        0x04    // uint8 modo manuale 0/1
+#define WS_CONFIG_MANUAL_SP     0x08    // int16 soglia manuale × 100
+#define WS_CONFIG_BANK          0x10    // uint8 banco programma attivo
+#define WS_CONFIG_ALL           0x1F
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Converte un time_t nell'ora locale usata dai frame
+ */
+uint32_t ws_local_time(time_t t);
+
+/**
+ * @brief Campi di stato cambiati tra due snapshot
+ *
+ * Temperatura confrontata ai decimi (risoluzione della pagina), ora al minuto.
+ */
+uint8_t ws_status_diff(const status_snapshot_t* a, const status_snapshot_t* b);
+
+/**
+ * @brief Campi di configurazione cambiati tra due snapshot
+ */
+uint8_t ws_config_diff(const status_config_t* a, const status_config_t* b);
+
+/**
+ * @brief Codifica un messaggio STATUS con i campi in mask
+ *
+ * @return Byte scritti, 0 se il buffer è troppo piccolo
+ */
+size_t ws_encode_status(uint8_t* buf, size_t cap, const status_snapshot_t* snap, uint8_t mask);
+
+/**
+ * @brief Codifica un messaggio SAMPLE
+ *
+ * @param day_start Mezzanotte (ora locale dei frame) del giorno del sample
+ */
+size_t ws_encode_sample(uint8_t* buf, size_t cap, uint32_t day_start, const history_sample_t* sample);
+
+/**
+ * @brief Codifica un messaggio RELAY
+ */
+size_t ws_encode_relay(uint8_t* buf, size_t cap, time_t when, bool on);
+
+/**
+ * @brief Codifica un messaggio CONFIG con i campi in mask
+ */
+size_t ws_encode_config(uint8_t* buf, size_t cap, const status_config_t* config, uint8_t mask);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WS_PROTOCOL_H
@@ -0,0 +1,137 @@
+/**
+ * @file ws_session.h
+ * @brief Sessioni WebSocket con coda di invio per client
+ *
+ * Le sessioni seguono il ciclo di vita dei socket httpd: nascono con
+ * l'handshake su /ws e vengono eliminate da close_fn quando httpd chiude
+ * il socket (client disconnesso, LRU purge, stop del server).
+ *
+ * Chi pubblica (status_task) accoda i frame nella coda di ogni client e
+ * ritorna subito; l'invio avviene nel task httpd (httpd_queue_work).
+ * Un client lento non blocca gli altri:
+ *   - ogni send ha un timeout breve (WS_SEND_TIMEOUT_MS): se scade il
+ *     client viene disconnesso, lo stream non è più consistente;
+ *   - se la coda di un client si riempie i frame accodati vengono scartati
+ *     e sostituiti da uno stato completo (resync) al prossimo invio.
+ *
+ * Limite accettato: gli invii sono sequenziali nel task httpd, quindi un
+ * client che smette di leggere ritarda gli altri client e le richieste
+ * HTTP fino a WS_SEND_TIMEOUT_MS, una sola volta perché poi viene
+ * disconnesso. Nel caso peggiore un drain dura WS_MAX_SESSIONS ×
+ * WS_SEND_TIMEOUT_MS (1,6 s con i valori di default).
+ */
+
+#ifndef WS_SESSION_H
+#define WS_SESSION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include <esp_http_server.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// COSTANTI (ridefinibili con build_flags)
+// ============================================================================
+
+#ifndef WS_MAX_SESSIONS
+#define WS_MAX_SESSIONS         8       // Client WebSocket contemporanei
+#endif
+
+#ifndef WS_SESSION_QUEUE_LEN
+#define WS_SESSION_QUEUE_LEN    16      // Frame in coda per client
+#endif
+
+#ifndef WS_SESSION_FRAME_MAX
+#define WS_SESSION_FRAME_MAX    32      // Dimensione massima di un frame accodato
+#endif
+
+#ifndef WS_SEND_TIMEOUT_MS
+#define WS_SEND_TIMEOUT_MS      200     // Timeout di invio sui socket WebSocket
+#endif
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief Genera i frame di stato completo per un client da risincronizzare
+ *
+ * Chiamata ripetutamente con index = 0, 1, ... finché ritorna 0.
+ *
+ * @return Byte scritti in buf (0 = fine)
+ */
+typedef size_t (*ws_resync_fn_t)(uint8_t* buf, size_t cap, uint8_t index);
+
+/**
+ * @brief Contatori delle sessioni
+ */
+typedef struct {
+    uint8_t sessions;           // Client connessi
+    uint32_t opened;            // Sessioni aperte dall'avvio
+    uint32_t rejected;          // Handshake rifiutati (limite raggiunto)
+    uint32_t frames_sent;       // Frame inviati
+    uint32_t frames_dropped;    // Frame scartati per coda piena
+    uint32_t resyncs;           // Stati completi inviati (nuovi client + code piene)
+    uint32_t send_failures;     // Client disconnessi per invio fallito o lento
+} ws_session_stats_t;
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+/**
+ * @brief Inizializza le sessioni
+ *
+ * @param resync Generatore dello stato completo (nuovi client, code piene)
+ */
+esp_err_t ws_session_init(ws_resync_fn_t resync);
+
+/**
+ * @brief Callback open_fn di httpd
+ *
+ * Un fd riusato appartiene a una nuova connessione: eventuali sessioni
+ * rimaste con lo stesso fd vengono eliminate.
+ */
+esp_err_t ws_session_on_open(httpd_handle_t hd, int sockfd);
+
+/**
+ * @brief Callback close_fn di httpd (chiude anche il socket)
+ */
+void ws_session_on_close(httpd_handle_t hd, int sockfd);
+
+/**
+ * @brief Elimina tutte le sessioni (stop del server)
+ */
+void ws_session_close_all(void);
+
+/**
+ * @brief Handler /ws: crea la sessione all'handshake, logga i messaggi ricevuti
+ */
+esp_err_t ws_handler(httpd_req_t *req);
+
+/**
+ * @brief Accoda un frame binario a tutti i client
+ *
+ * Non bloccante: può essere chiamata da qualsiasi task.
+ */
+void ws_session_broadcast(const uint8_t* data, size_t len);
+
+/**
+ * @brief Numero di client connessi
+ */
+int ws_session_count(void);
+
+/**
+ * @brief Legge i contatori
+ */
+void ws_session_get_stats(ws_session_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WS_SESSION_H
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""
+Latenza di /api/status durante un download di log
+
+Misura p50/p99 di GET /api/status in due fasi:
+  1. a riposo
+  2. mentre uno o più client scaricano in continuo /api/log/raw
+     (o /api/log/range), cioè con un worker HTTP occupato su SPIFFS
+
+Con i download spostati sui worker (http_async) /api/status resta sul
+task httpd e la latenza in fase 2 deve restare vicina a quella a riposo.
+
+Uso:
+  python3 load_test_status.py <ip> [--date YYYYMMDD] [--requests N]
+                                   [--downloaders N] [--range]
+"""
+
+import argparse
+import statistics
+import sys
+import threading
+import time
+import urllib.error
+import urllib.request
+from datetime import datetime, timedelta
+
+
+def percentile(values, p):
+    """
+    Percentile con interpolazione lineare (p tra 0 e 100)
+    """
+    ordered = sorted(values)
+    if not ordered:
+        return 0.0
+    k = (len(ordered) - 1) * p / 100.0
+    lo = int(k)
+    hi = min(lo + 1, len(ordered) - 1)
+    return ordered[lo] + (ordered[hi] - ordered[lo]) * (k - lo)
+
+
+def measure_status(base_url, count, interval):
+    """
+    Esegue count richieste a /api/status, ritorna (latenze ms, errori)
+    """
+    latencies = []
+    errors = 0
+
+    for _ in range(count):
+        start = time.perf_counter()
+        try:
+            with urllib.request.urlopen(base_url + '/api/status', timeout=5) as resp:
+                resp.read()
+            latencies.append((time.perf_counter() - start) * 1000.0)
+        except (urllib.error.URLError, OSError):
+            errors += 1
+        time.sleep(interval)
+
+    return latencies, errors
+
+
+def download_loop(url, stop, stats):
+    """
+    Scarica url in continuo finché stop non è impostato
+    """
+    while not stop.is_set():
+        try:
+            with urllib.request.urlopen(url, timeout=30) as resp:
+                while True:
+                    chunk = resp.read(4096)
+                    if not chunk:
+                        break
+                    stats['bytes'] += len(chunk)
+            stats['downloads'] += 1
+        except urllib.error.HTTPError as e:
+            # 503: worker o storage occupati, riprova
+            stats['rejected' if e.code == 503 else 'errors'] += 1
+            time.sleep(0.2)
+        except (urllib.error.URLError, OSError):
+            stats['errors'] += 1
+            time.sleep(0.2)
+
+
+def report(label, latencies, errors):
+    if not latencies:
+        print(f"{label:<22} nessuna risposta ({errors} errori)")
+        return
+    print(f"{label:<22} n={len(latencies):4d}  p50={percentile(latencies, 50):7.1f} ms  "
+          f"p99={percentile(latencies, 99):7.1f} ms  max={max(latencies):7.1f} ms  "
+          f"media={statistics.mean(latencies):7.1f} ms  errori={errors}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Latenza /api/status con download di log in corso')
+    parser.add_argument('host', help='Indirizzo del dispositivo (es. 192.168.1.50)')
+    parser.add_argument('--date', default=time.strftime('%Y%m%d'),
+                        help='Giorno da scaricare (default: oggi)')
+    parser.add_argument('--requests', type=int, default=200, help='Richieste /api/status per fase')
+    parser.add_argument('--interval', type=float, default=0.05, help='Pausa tra richieste (s)')
+    parser.add_argument('--downloaders', type=int, default=1, help='Client che scaricano in parallelo')
+    parser.add_argument('--range', action='store_true',
+                        help='Scarica /api/log/range (ultimi 30 giorni) invece di /api/log/raw')
+    args = parser.parse_args()
+
+    base_url = args.host if args.host.startswith('http') else 'http://' + args.host
+
+    if args.range:
+        first = (datetime.strptime(args.date, '%Y%m%d') - timedelta(days=29)).strftime('%Y%m%d')
+        download_url = f"{base_url}/api/log/range?from={first}&to={args.date}&points=2000"
+    else:
+        download_url = f"{base_url}/api/log/raw?date={args.date}"
+
+    print(f"Fase 1: /api/status a riposo ({args.requests} richieste)")
+    idle, idle_errors = measure_status(base_url, args.requests, args.interval)
+
+    print(f"Fase 2: /api/status con {args.downloaders} download in corso di {download_url}")
+    stop = threading.Event()
+    stats = {'bytes': 0, 'downloads': 0, 'rejected': 0, 'errors': 0}
+    threads = [threading.Thread(target=download_loop, args=(download_url, stop, stats), daemon=True)
+               for _ in range(args.downloaders)]
+    for t in threads:
+        t.start()
+    time.sleep(0.5)     # Download avviati prima della prima misura
+
+    busy, busy_errors = measure_status(base_url, args.requests, args.interval)
+
+    stop.set()
+    for t in threads:
+        t.join(timeout=35)
+
+    print()
+    report('a riposo', idle, idle_errors)
+    report('durante download', busy, busy_errors)
+    print(f"download completati: {stats['downloads']}, byte: {stats['bytes']}, "
+          f"503: {stats['rejected']}, errori: {stats['errors']}")
+
+    return 0 if busy else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
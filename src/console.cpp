@@ -0,0 +1,83 @@
+/**
+ * @file console.cpp
+ * @brief Implementazione comandi di diagnostica dalla console seriale
+ */
+
+#include "console.h"
+#include "task_profiler.h"
+#include "wifi.h"
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char* TAG = "CONSOLE";
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static void print_help(void)
+{
+    printf("\nCommands:\n"
+           "  t  task CPU and stack profile\n"
+           "  w  WiFi status\n"
+           "  h  this help\n");
+}
+
+static void print_wifi(void)
+{
+    char* buf = (char*)malloc(1024);
+    if (buf == NULL) {
+        return;
+    }
+    get_wifi_status(buf, 1024, NULL);
+    printf("%s", buf);
+    free(buf);
+}
+
+static void console_task(void* pvParameters)
+{
+    while (1) {
+        // Senza driver UART installato la lettura non blocca: EOF se vuoto
+        int c = getchar();
+        if (c == EOF) {
+            clearerr(stdin);
+            vTaskDelay(pdMS_TO_TICKS(CONSOLE_POLL_MS));
+            continue;
+        }
+
+        switch (c) {
+        case 't':
+            task_profiler_print();
+            break;
+        case 'w':
+            print_wifi();
+            break;
+        case 'h':
+        case '?':
+            print_help();
+            break;
+        default:
+            break;      // Fine riga e tasti sconosciuti
+        }
+    }
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+esp_err_t console_start(void)
+{
+    if (xTaskCreate(console_task, "console", CONSOLE_STACK_SIZE, NULL,
+                    CONSOLE_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create console task");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Serial console ready, press 'h' for commands");
+    return ESP_OK;
+}
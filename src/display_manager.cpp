@@ -352,8 +352,8 @@ void display_set_program(const float* setpoints, int count)
 
 void display_load_history_temperatures(void)
 {
-    const history_buffer_t* hist = history_get_buffer();
-    if (hist == NULL || !hist->initialized || hist->samples == NULL) {
+    history_header_t header;
+    if (history_read_samples(0, 0, NULL, &header) != ESP_OK) {
         ESP_LOGW(TAG, "History buffer not available");
         return;
     }
@@ -365,13 +365,24 @@ void display_load_history_temperatures(void)
 
     int loaded = 0;
 
-    // Carica temperature dallo storico
+    // Carica temperature dallo storico a blocchi di un'ora: copie brevi e
+    // coerenti, status_task può registrare nel frattempo
     // 480 punti = 1 ogni 3 minuti
-    for (int minute = 0; minute < HISTORY_SAMPLES_PER_DAY; minute++) {
-        const history_sample_t* sample = &hist->samples[minute];
+    history_sample_t block[60];
+    for (int first = 0; first < header.num_samples; first += 60) {
+        if (history_read_samples(first, 60, block, NULL) != ESP_OK) {
+            break;
+        }
+
+        for (int j = 0; j < 60; j++) {
+            const history_sample_t* sample = &block[j];
+            int minute = first + j;
+
+            // Verifica se il sample è valido (temperatura != -32768 che è il marker invalido)
+            if (sample->temperature == -32768) {
+                continue;
+            }
 
-        // Verifica se il sample è valido (temperatura != -32768 che è il marker invalido)
-        if (sample->temperature != -32768) {
             float temp = sample->temperature / 100.0f;
 
             // Verifica range ragionevole (accetta anche fuori scala, clamp dopo)
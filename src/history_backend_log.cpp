@@ -0,0 +1,783 @@
+/**
+ * @file history_backend_log.cpp
+ * @brief Backend storico log-structured su partizione dedicata
+ *
+ * La partizione è un ring di settori da 4 KB. Ogni settore inizia con un
+ * header (magic, numero progressivo, CRC) seguito da 170 record da 24 byte
+ * scritti in ordine. Un record contiene un minuto di un giorno con i suoi
+ * estremi e il num_samples del giorno al momento della scrittura; il CRC
+ * proprio invalida al più il record interrotto da un reset.
+ *
+ * I record non vengono mai riscritti: un minuto modificato viene accodato
+ * di nuovo e in lettura vince il record più recente. Quando il settore in
+ * scrittura è pieno si passa al successivo, cancellandolo: il più vecchio
+ * del ring. Ogni settore viene così cancellato una volta per giro.
+ *
+ * All'avvio la partizione viene letta una volta per costruire l'indice in
+ * RAM: numero progressivo, record usati e giorni di ogni settore (fino a
+ * LOG_SECTOR_DAYS, con record e num_samples). Presenza ed elenco dei
+ * giorni si ricavano dall'indice senza leggere la flash; la lettura di un
+ * giorno legge solo i settori che lo coprono.
+ *
+ * Capacità: 170 record per settore, 1440 record per giorno completo. La
+ * partizione di partitions_tslog.csv (2032 settori) tiene circa 240 giorni.
+ *
+ * La partizione non deve essere cifrata: i record non sono allineati a 16
+ * byte.
+ */
+
+#include "history_backend.h"
+#include "metrics.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <stddef.h>
+
+static const char* TAG = "HIST_LOG";
+
+#define LOG_SECTOR_SIZE         4096
+#define LOG_MAGIC               0x474C5354  // "TSLG"
+#define LOG_VERSION             1
+#define LOG_DAY_EMPTY           0xFFFF      // Record mai scritto (flash cancellata)
+#define LOG_WRITE_BATCH         16          // Record per esp_partition_write
+#define LOG_READ_BATCH          34          // Record per esp_partition_read (5 per settore)
+#define LOG_SECTOR_DAYS         3           // Giorni distinti nell'indice di un settore
+
+// ============================================================================
+// STRUTTURE PRIVATE
+// ============================================================================
+
+/**
+ * @brief Header di settore (16 bytes)
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;                                   // Progressivo di apertura (> 0)
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t crc;                                   // CRC32 dei byte precedenti
+} log_sector_header_t;
+
+/**
+ * @brief Record di un minuto (24 bytes)
+ */
+typedef struct {
+    uint16_t day;                                   // Giorni dal 2000-01-01
+    uint16_t num_samples;                           // num_samples del giorno alla scrittura
+    history_sample_t sample;                        // 12 bytes
+    history_extremes_t extremes;                    // 2 bytes
+    uint16_t reserved;
+    uint32_t crc;                                   // CRC32 dei byte precedenti
+} log_record_t;
+
+/**
+ * @brief Giorno presente in un settore
+ */
+typedef struct {
+    uint16_t day;
+    uint16_t num_samples;                           // Dell'ultimo record del giorno nel settore
+    uint8_t records;                                // Record validi del giorno nel settore
+} log_sector_day_t;
+
+/**
+ * @brief Voce dell'indice in RAM
+ *
+ * Un settore contiene di norma uno o due giorni consecutivi. Con più di
+ * LOG_SECTOR_DAYS giorni distinti (riscrittura di giorni vecchi) overflow
+ * è impostato e per quel settore si rilegge la flash.
+ */
+typedef struct {
+    uint32_t seq;                                   // 0 = settore libero o non valido
+    uint16_t first_day;                             // Intervallo dei giorni dei record
+    uint16_t last_day;
+    uint8_t used;                                   // Record scritti
+    uint8_t num_days;
+    bool overflow;                                  // Giorni oltre days[]: usare scan_day()
+    log_sector_day_t days[LOG_SECTOR_DAYS];
+} log_sector_info_t;
+
+static_assert(sizeof(log_sector_header_t) == 16, "log_sector_header_t must be 16 bytes");
+static_assert(sizeof(log_record_t) == 24, "log_record_t must be 24 bytes");
+
+#define LOG_RECORDS_PER_SECTOR  ((LOG_SECTOR_SIZE - sizeof(log_sector_header_t)) / sizeof(log_record_t))
+
+// ============================================================================
+// VARIABILI STATICHE
+// ============================================================================
+
+static const esp_partition_t* s_part = NULL;
+static log_sector_info_t* s_sectors = NULL;         // Indice in PSRAM, uno per settore
+static uint32_t s_num_sectors = 0;
+static uint32_t s_head = 0;                         // Settore in scrittura
+static uint32_t s_next_seq = 1;
+static SemaphoreHandle_t s_mutex = NULL;            // Indice e accessi alla partizione
+
+static metrics_counter_t s_sector_erases;
+static metrics_counter_t s_corrupted_records;
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static bool is_leap(uint16_t year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static uint8_t days_in_month(uint16_t year, uint8_t month)
+{
+    static const uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return (month == 2 && is_leap(year)) ? 29 : days[month - 1];
+}
+
+/**
+ * @brief Giorni dal 2000-01-01; false per date prima del 2000 (ora non sincronizzata)
+ */
+static bool day_number(uint16_t year, uint8_t month, uint8_t day, uint16_t* number)
+{
+    if (year < 2000 || year > 2178 || month < 1 || month > 12 ||
+        day < 1 || day > days_in_month(year, month)) {
+        return false;
+    }
+
+    // Anno civile da marzo: il giorno bisestile è l'ultimo dell'anno
+    int32_t y = year - (month <= 2 ? 1 : 0);
+    int32_t mp = (month + 9) % 12;
+    int32_t doy = (153 * mp + 2) / 5 + day - 1;
+    int32_t days = y * 365 + y / 4 - y / 100 + y / 400 + doy;
+
+    *number = (uint16_t)(days - 730425);    // Stessa formula per il 2000-01-01
+    return true;
+}
+
+static uint32_t header_crc(const log_sector_header_t* h)
+{
+    return esp_rom_crc32_le(0, (const uint8_t*)h, offsetof(log_sector_header_t, crc));
+}
+
+static uint32_t record_crc(const log_record_t* r)
+{
+    return esp_rom_crc32_le(0, (const uint8_t*)r, offsetof(log_record_t, crc));
+}
+
+static size_t record_offset(uint32_t sector, uint32_t index)
+{
+    return sector * LOG_SECTOR_SIZE + sizeof(log_sector_header_t) + index * sizeof(log_record_t);
+}
+
+/**
+ * @brief Record mai scritto: tutti i byte a 0xFF
+ */
+static bool record_is_erased(const log_record_t* r)
+{
+    const uint8_t* p = (const uint8_t*)r;
+    for (size_t i = 0; i < sizeof(log_record_t); i++) {
+        if (p[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Aggiunge un record valido alla voce d'indice del suo settore
+ */
+static void index_record(log_sector_info_t* info, const log_record_t* r)
+{
+    if (r->day < info->first_day) info->first_day = r->day;
+    if (r->day > info->last_day) info->last_day = r->day;
+
+    for (uint8_t i = 0; i < info->num_days; i++) {
+        if (info->days[i].day == r->day) {
+            info->days[i].records++;
+            info->days[i].num_samples = r->num_samples;
+            return;
+        }
+    }
+
+    if (info->num_days < LOG_SECTOR_DAYS) {
+        log_sector_day_t* d = &info->days[info->num_days++];
+        d->day = r->day;
+        d->num_samples = r->num_samples;
+        d->records = 1;
+    } else {
+        info->overflow = true;
+    }
+}
+
+/**
+ * @brief Giorno nell'indice del settore, NULL se assente o non indicizzato
+ */
+static const log_sector_day_t* find_sector_day(const log_sector_info_t* info, uint16_t day)
+{
+    for (uint8_t i = 0; i < info->num_days; i++) {
+        if (info->days[i].day == day) {
+            return &info->days[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Legge header e record di un settore e ne compila la voce d'indice
+ *
+ * @param buf Buffer di LOG_SECTOR_SIZE byte
+ */
+static void mount_sector(uint32_t sector, uint8_t* buf)
+{
+    log_sector_info_t* info = &s_sectors[sector];
+    memset(info, 0, sizeof(*info));
+
+    if (esp_partition_read(s_part, sector * LOG_SECTOR_SIZE, buf, LOG_SECTOR_SIZE) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read sector %u", (unsigned int)sector);
+        return;
+    }
+
+    const log_sector_header_t* h = (const log_sector_header_t*)buf;
+    if (h->magic != LOG_MAGIC || h->version != LOG_VERSION || h->crc != header_crc(h) ||
+        h->seq == 0) {
+        return;     // Libero o mai completato: verrà cancellato prima dell'uso
+    }
+
+    info->seq = h->seq;
+    info->first_day = LOG_DAY_EMPTY;
+    info->last_day = 0;
+
+    const log_record_t* records = (const log_record_t*)(buf + sizeof(log_sector_header_t));
+    for (uint32_t i = 0; i < LOG_RECORDS_PER_SECTOR; i++) {
+        const log_record_t* r = &records[i];
+        if (record_is_erased(r)) {
+            break;  // Scrittura sempre in ordine: il primo record libero chiude il settore
+        }
+
+        info->used = i + 1;
+        if (r->crc != record_crc(r)) {
+            metrics_counter_inc(&s_corrupted_records);
+            continue;
+        }
+        index_record(info, r);
+    }
+}
+
+/**
+ * @brief Cancella il settore successivo alla testa e ne scrive l'header
+ */
+static esp_err_t open_next_sector(void)
+{
+    uint32_t next = s_sectors[s_head].seq == 0 ? s_head : (s_head + 1) % s_num_sectors;
+    log_sector_info_t* info = &s_sectors[next];
+
+    if (info->seq != 0 && info->used > 0) {
+        ESP_LOGW(TAG, "Log full, overwriting oldest sector %u (days %u-%u)",
+                 (unsigned int)next, info->first_day, info->last_day);
+    }
+
+    memset(info, 0, sizeof(*info));
+
+    esp_err_t ret = esp_partition_erase_range(s_part, next * LOG_SECTOR_SIZE, LOG_SECTOR_SIZE);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to erase sector %u: %s", (unsigned int)next, esp_err_to_name(ret));
+        return ret;
+    }
+    metrics_counter_inc(&s_sector_erases);
+
+    log_sector_header_t h = {
+        .magic = LOG_MAGIC,
+        .seq = s_next_seq,
+        .version = LOG_VERSION,
+        .reserved = 0xFFFF,
+        .crc = 0,
+    };
+    h.crc = header_crc(&h);
+
+    ret = esp_partition_write(s_part, next * LOG_SECTOR_SIZE, &h, sizeof(h));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write header of sector %u", (unsigned int)next);
+        return ret;
+    }
+
+    info->seq = s_next_seq++;
+    info->first_day = LOG_DAY_EMPTY;
+    info->last_day = 0;
+    s_head = next;
+    return ESP_OK;
+}
+
+/**
+ * @brief Accoda record consecutivi, aprendo nuovi settori se serve (con il mutex)
+ */
+static esp_err_t append_records(const log_record_t* records, uint32_t count)
+{
+    while (count > 0) {
+        log_sector_info_t* info = &s_sectors[s_head];
+        if (info->seq == 0 || info->used >= LOG_RECORDS_PER_SECTOR) {
+            esp_err_t ret = open_next_sector();
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            info = &s_sectors[s_head];
+        }
+
+        uint32_t n = LOG_RECORDS_PER_SECTOR - info->used;
+        if (n > count) {
+            n = count;
+        }
+
+        esp_err_t ret = esp_partition_write(s_part, record_offset(s_head, info->used),
+                                            records, n * sizeof(log_record_t));
+        if (ret != ESP_OK) {
+            // Contenuto incerto: il resto del settore non viene più usato
+            info->used = LOG_RECORDS_PER_SECTOR;
+            ESP_LOGE(TAG, "Failed to write %u records: %s", (unsigned int)n, esp_err_to_name(ret));
+            return ret;
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            index_record(info, &records[i]);
+        }
+        info->used += n;
+        records += n;
+        count -= n;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Ricostruisce un giorno dai settori che lo coprono (con il mutex)
+ *
+ * I settori vengono letti dal più vecchio al più recente, così un minuto
+ * riscritto prende il valore dell'ultimo record. samples ed extremes
+ * possono essere NULL (solo conteggio).
+ *
+ * @param num_samples num_samples dell'ultimo record del giorno
+ * @return Record validi del giorno
+ */
+static uint32_t scan_day(uint16_t day, history_sample_t* samples, history_extremes_t* extremes,
+                         uint16_t* num_samples)
+{
+    log_record_t batch[LOG_READ_BATCH];
+    uint32_t found = 0;
+
+    *num_samples = 0;
+
+    for (uint32_t n = 1; n <= s_num_sectors; n++) {
+        uint32_t sector = (s_head + n) % s_num_sectors;     // Termina con la testa
+        const log_sector_info_t* info = &s_sectors[sector];
+        if (info->seq == 0 || info->used == 0 ||
+            day < info->first_day || day > info->last_day) {
+            continue;
+        }
+
+        for (uint32_t first = 0; first < info->used; first += LOG_READ_BATCH) {
+            uint32_t count = info->used - first;
+            if (count > LOG_READ_BATCH) {
+                count = LOG_READ_BATCH;
+            }
+
+            if (esp_partition_read(s_part, record_offset(sector, first), batch,
+                                   count * sizeof(log_record_t)) != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to read sector %u", (unsigned int)sector);
+                break;
+            }
+
+            for (uint32_t i = 0; i < count; i++) {
+                const log_record_t* r = &batch[i];
+                uint16_t minute = r->sample.minute_of_day;
+                if (r->day != day || minute >= HISTORY_SAMPLES_PER_DAY ||
+                    r->crc != record_crc(r)) {
+                    continue;
+                }
+
+                if (samples != NULL) {
+                    samples[minute] = r->sample;
+                }
+                if (extremes != NULL) {
+                    extremes[minute] = r->extremes;
+                }
+                *num_samples = r->num_samples;
+                found++;
+            }
+        }
+    }
+
+    if (*num_samples > HISTORY_SAMPLES_PER_DAY) {
+        *num_samples = HISTORY_SAMPLES_PER_DAY;
+    }
+    return found;
+}
+
+static esp_err_t log_init(void)
+{
+    if (s_part != NULL) {
+        return ESP_OK;
+    }
+
+    const esp_partition_t* part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_ANY,
+                                                           HISTORY_LOG_PARTITION);
+    if (part == NULL) {
+        ESP_LOGE(TAG, "Partition '%s' not found (flash partitions_tslog.csv)",
+                 HISTORY_LOG_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    s_num_sectors = part->size / LOG_SECTOR_SIZE;
+    if (s_num_sectors < 2) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    s_mutex = xSemaphoreCreateMutex();
+    s_sectors = (log_sector_info_t*)heap_caps_calloc(s_num_sectors, sizeof(log_sector_info_t),
+                                                     MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    // Buffer di lettura in RAM interna (lettura della flash)
+    uint8_t* buf = (uint8_t*)heap_caps_malloc(LOG_SECTOR_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+
+    if (s_mutex == NULL || s_sectors == NULL || buf == NULL) {
+        heap_caps_free(buf);
+        heap_caps_free(s_sectors);
+        s_sectors = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_part = part;
+
+    // Indice in RAM: una lettura completa della partizione
+    int64_t start_us = esp_timer_get_time();
+    uint32_t max_seq = 0;
+    uint32_t records = 0;
+
+    for (uint32_t i = 0; i < s_num_sectors; i++) {
+        mount_sector(i, buf);
+        if (s_sectors[i].seq > max_seq) {
+            max_seq = s_sectors[i].seq;
+            s_head = i;
+        }
+        records += s_sectors[i].used;
+    }
+    s_next_seq = max_seq + 1;
+
+    heap_caps_free(buf);
+
+    metrics_register("history_log_sector_erases_total", "Log partition sectors erased for reuse",
+                     NULL, METRIC_COUNTER, &s_sector_erases);
+    metrics_register("history_log_corrupted_records_total", "Log records with a bad CRC at mount",
+                     NULL, METRIC_COUNTER, &s_corrupted_records);
+
+    ESP_LOGI(TAG, "Mounted '%s': %u sectors, %u records, head %u in %lld us",
+             HISTORY_LOG_PARTITION, (unsigned int)s_num_sectors, (unsigned int)records,
+             (unsigned int)s_head, (long long)(esp_timer_get_time() - start_us));
+    return ESP_OK;
+}
+
+/**
+ * @brief Accoda i minuti [from, num_samples) di b
+ *
+ * Senza append parte dal primo minuto modificato (dirty_from) invece che
+ * da zero: i record precedenti restano validi. Anche i minuti vuoti
+ * vengono scritti, perché annullano un record più vecchio dello stesso
+ * minuto (minuto invalidato dopo il caricamento). Almeno l'ultimo minuto
+ * viene sempre scritto, così il log registra anche un num_samples ridotto.
+ */
+static esp_err_t log_write_day(history_buffer_t* b, tlog2_state_t* codec, bool append,
+                               size_t* bytes_written)
+{
+    uint16_t day;
+    if (!day_number(b->header.year, b->header.month, b->header.day, &day)) {
+        ESP_LOGW(TAG, "Date %04d-%02d-%02d not storable (time not synced?)",
+                 b->header.year, b->header.month, b->header.day);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t to = b->header.num_samples;
+    uint16_t from = b->persisted_samples;
+    if (!append && b->dirty_from < from) {
+        from = b->dirty_from;
+    }
+    if (from >= to) {
+        from = to > 0 ? to - 1 : 0;
+    }
+
+    log_record_t batch[LOG_WRITE_BATCH];
+    uint32_t count = 0;
+    size_t bytes = 0;
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    for (uint16_t m = from; m < to && ret == ESP_OK; m++) {
+        log_record_t* r = &batch[count++];
+        r->day = day;
+        r->num_samples = to;
+        r->sample = b->samples[m];
+        r->extremes = b->extremes[m];
+        r->reserved = 0xFFFF;
+        r->crc = record_crc(r);
+
+        if (count == LOG_WRITE_BATCH || m + 1 == to) {
+            ret = append_records(batch, count);
+            bytes += count * sizeof(log_record_t);
+            count = 0;
+        }
+    }
+
+    xSemaphoreGive(s_mutex);
+
+    if (ret != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    b->persisted_bytes += bytes;
+    *bytes_written = bytes;
+    return ESP_OK;
+}
+
+static esp_err_t log_write_extremes(const history_buffer_t* b, uint16_t from)
+{
+    return ESP_OK;      // Gli estremi sono nei record di log_write_day()
+}
+
+static void log_read_extremes(uint16_t year, uint8_t month, uint8_t day,
+                              history_extremes_t* extremes)
+{
+    uint16_t number, num_samples;
+    if (s_part == NULL || !day_number(year, month, day, &number)) {
+        return;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    scan_day(number, NULL, extremes, &num_samples);
+    xSemaphoreGive(s_mutex);
+}
+
+static void log_reader_close(history_reader_t* reader)
+{
+    if (reader->day != NULL) {
+        heap_caps_free(reader->day);
+        reader->day = NULL;
+    }
+}
+
+static esp_err_t log_reader_open(history_reader_t* reader,
+                                 uint16_t year, uint8_t month, uint8_t day)
+{
+    uint16_t number;
+    if (s_part == NULL || !day_number(year, month, day, &number)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    reader->day = (history_sample_t*)heap_caps_malloc(
+        HISTORY_SAMPLES_PER_DAY * sizeof(history_sample_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (reader->day == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < HISTORY_SAMPLES_PER_DAY; i++) {
+        tlog2_make_empty(&reader->day[i], i);
+    }
+
+    uint16_t num_samples;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint32_t found = scan_day(number, reader->day, NULL, &num_samples);
+    xSemaphoreGive(s_mutex);
+
+    if (found == 0) {
+        log_reader_close(reader);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    memcpy(reader->header.magic, HISTORY_MAGIC, 4);
+    reader->header.version = HISTORY_VERSION;
+    reader->header.year = year;
+    reader->header.month = month;
+    reader->header.day = day;
+    reader->header.num_samples = num_samples;
+    reader->header.reserved = 0;
+
+    tlog2_init(&reader->codec);
+    reader->offset = found * sizeof(log_record_t);
+    return ESP_OK;
+}
+
+static esp_err_t log_reader_next(history_reader_t* reader, history_sample_t* sample)
+{
+    if (reader->day == NULL || reader->next_minute >= reader->header.num_samples) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    *sample = reader->day[reader->next_minute++];
+    return ESP_OK;
+}
+
+/**
+ * @brief Presenza di un giorno dall'indice in RAM (con il mutex)
+ *
+ * Solo i settori in overflow che coprono il giorno vengono riletti.
+ */
+static bool index_has_day(uint16_t day)
+{
+    for (uint32_t sector = 0; sector < s_num_sectors; sector++) {
+        const log_sector_info_t* info = &s_sectors[sector];
+        if (info->seq == 0 || info->used == 0 ||
+            day < info->first_day || day > info->last_day) {
+            continue;
+        }
+        if (find_sector_day(info, day) != NULL) {
+            return true;
+        }
+        if (info->overflow) {
+            uint16_t num_samples;
+            return scan_day(day, NULL, NULL, &num_samples) > 0;
+        }
+    }
+    return false;
+}
+
+static bool log_day_exists(uint16_t year, uint8_t month, uint8_t day)
+{
+    uint16_t number;
+    if (s_part == NULL || !day_number(year, month, day, &number)) {
+        return false;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool found = index_has_day(number);
+    xSemaphoreGive(s_mutex);
+    return found;
+}
+
+/**
+ * @brief Riassunto di un giorno accumulato dall'indice
+ */
+typedef struct {
+    uint32_t records;
+    uint16_t num_samples;
+    bool scan;                                      // Coperto da un settore in overflow
+} log_day_summary_t;
+
+/**
+ * @brief Elenca i giorni di un anno dall'indice in RAM
+ *
+ * I settori vengono visitati dal più vecchio alla testa: num_samples è
+ * quello del record più recente. Solo i giorni coperti da un settore in
+ * overflow vengono ricostruiti leggendo la flash. year = 0 elenca gli
+ * anni coperti da almeno un settore.
+ */
+static void log_foreach_day(uint16_t year, history_backend_day_cb_t cb, void* arg)
+{
+    if (s_part == NULL) {
+        return;
+    }
+
+    if (year == 0) {
+        uint16_t min_day = UINT16_MAX, max_day = 0;
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        for (uint32_t i = 0; i < s_num_sectors; i++) {
+            const log_sector_info_t* info = &s_sectors[i];
+            if (info->seq == 0 || info->used == 0) {
+                continue;
+            }
+            if (info->first_day < min_day) min_day = info->first_day;
+            if (info->last_day > max_day) max_day = info->last_day;
+        }
+        xSemaphoreGive(s_mutex);
+
+        uint16_t y = 2000;
+        uint16_t start = 0;
+        while (min_day <= max_day) {
+            uint16_t days = is_leap(y) ? 366 : 365;
+            if (min_day < start + days) {
+                log_foreach_day(y, cb, arg);
+            }
+            if ((uint32_t)start + days > max_day) {
+                break;
+            }
+            start += days;
+            y++;
+        }
+        return;
+    }
+
+    uint16_t first;
+    if (!day_number(year, 1, 1, &first)) {
+        return;
+    }
+    uint16_t days = is_leap(year) ? 366 : 365;
+    uint16_t last = first + days - 1;
+
+    log_day_summary_t* summary = (log_day_summary_t*)heap_caps_calloc(
+        days, sizeof(log_day_summary_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (summary == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    for (uint32_t n = 1; n <= s_num_sectors; n++) {
+        const log_sector_info_t* info = &s_sectors[(s_head + n) % s_num_sectors];
+        if (info->seq == 0 || info->used == 0 ||
+            info->last_day < first || info->first_day > last) {
+            continue;
+        }
+
+        for (uint8_t i = 0; i < info->num_days; i++) {
+            const log_sector_day_t* d = &info->days[i];
+            if (d->day >= first && d->day <= last) {
+                summary[d->day - first].records += d->records;
+                summary[d->day - first].num_samples = d->num_samples;
+            }
+        }
+
+        if (info->overflow) {
+            uint16_t from = info->first_day > first ? info->first_day : first;
+            uint16_t to = info->last_day < last ? info->last_day : last;
+            for (uint32_t day = from; day <= to; day++) {
+                summary[day - first].scan = true;
+            }
+        }
+    }
+
+    for (uint16_t i = 0; i < days; i++) {
+        if (summary[i].scan) {
+            summary[i].records = scan_day(first + i, NULL, NULL, &summary[i].num_samples);
+        }
+    }
+
+    xSemaphoreGive(s_mutex);
+
+    uint16_t i = 0;
+    for (uint8_t m = 1; m <= 12; m++) {
+        for (uint8_t d = 1; d <= days_in_month(year, m); d++, i++) {
+            if (summary[i].records > 0) {
+                cb(year, m, d, summary[i].num_samples,
+                   summary[i].records * sizeof(log_record_t), arg);
+            }
+        }
+    }
+
+    heap_caps_free(summary);
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+const history_backend_t history_backend_log = {
+    .name = "log",
+    .init = log_init,
+    .write_day = log_write_day,
+    .write_extremes = log_write_extremes,
+    .read_extremes = log_read_extremes,
+    .reader_open = log_reader_open,
+    .reader_next = log_reader_next,
+    .reader_close = log_reader_close,
+    .day_exists = log_day_exists,
+    .foreach_day = log_foreach_day,
+    .raw_files = false,
+};
@@ -0,0 +1,458 @@
+/**
+ * @file history_backend_spiffs.cpp
+ * @brief Backend storico su SPIFFS: un file per giorno
+ */
+
+#include "history_backend.h"
+
+#include "esp_log.h"
+#include <string.h>
+#include <stdio.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+static const char* TAG = "HIST_SPIFFS";
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+/**
+ * @brief Nome del file temporaneo di rewrite_file()
+ */
+static void get_temp_filename(const char* filename, char* buffer, size_t buffer_size)
+{
+    snprintf(buffer, buffer_size, "%s.tmp", filename);
+}
+
+/**
+ * @brief Completa o scarta le riscritture interrotte da un reset
+ *
+ * Un .tmp rimasto accanto al file del giorno è una riscrittura mai
+ * completata: si scarta. Se il file del giorno manca, il reset è avvenuto
+ * tra la rimozione e il rename e il .tmp è completo: si rinomina.
+ * Filesystem montato da storage_init().
+ */
+static esp_err_t spiffs_init(void)
+{
+    DIR* dir = opendir("/spiffs");
+    if (dir == NULL) {
+        return ESP_OK;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len < 8 || strncmp(entry->d_name, "log_", 4) != 0 ||
+            strcmp(entry->d_name + len - 8, ".bin.tmp") != 0) {
+            continue;
+        }
+
+        char temp[300];
+        char path[300];
+        snprintf(temp, sizeof(temp), "/spiffs/%s", entry->d_name);
+        snprintf(path, sizeof(path), "/spiffs/%.*s", (int)(len - 4), entry->d_name);
+
+        struct stat st;
+        if (stat(path, &st) == 0) {
+            ESP_LOGW(TAG, "Discarding interrupted rewrite %s", temp);
+            remove(temp);
+        } else if (rename(temp, path) == 0) {
+            ESP_LOGW(TAG, "Completed interrupted rewrite of %s", path);
+        }
+    }
+
+    closedir(dir);
+    return ESP_OK;
+}
+
+/**
+ * @brief Codifica i sample [from, to) in formato v2 alla posizione corrente
+ *
+ * I record passano da un piccolo buffer su stack, senza copia della giornata.
+ *
+ * @param codec Predittore (aggiornato)
+ * @param bytes Byte scritti
+ */
+static bool write_samples(FILE* f, const history_buffer_t* b, tlog2_state_t* codec,
+                          uint16_t from, uint16_t to, size_t* bytes)
+{
+    uint8_t out[256];
+    size_t used = 0;
+
+    *bytes = 0;
+
+    for (uint16_t i = from; i < to; i++) {
+        used += tlog2_encode(codec, &b->samples[i], &out[used]);
+
+        if (used > sizeof(out) - TLOG2_MAX_RECORD_SIZE || i + 1 == to) {
+            if (fwrite(out, 1, used, f) != used) {
+                return false;
+            }
+            *bytes += used;
+            used = 0;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Scrive l'header all'inizio del file (commit dei record già scritti)
+ */
+static bool write_header(FILE* f, const history_buffer_t* b)
+{
+    if (fseek(f, 0, SEEK_SET) != 0) {
+        return false;
+    }
+    return fwrite(&b->header, 1, sizeof(history_header_t), f) == sizeof(history_header_t);
+}
+
+/**
+ * @brief Accoda i sample [persisted_samples, num_samples) al file esistente
+ *
+ * I record vengono scritti dopo l'ultimo record committato, poi l'header
+ * viene aggiornato in place con il nuovo num_samples.
+ *
+ * @return ESP_OK se successo, ESP_ERR_NOT_FOUND se il file non è apribile
+ */
+static esp_err_t append_to_file(history_buffer_t* b, tlog2_state_t* b_codec,
+                                const char* filename, size_t* bytes_written)
+{
+    FILE* f = fopen(filename, "r+b");
+    if (f == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint16_t from = b->persisted_samples;
+    uint16_t to = b->header.num_samples;
+    tlog2_state_t codec = *b_codec;
+    size_t bytes = 0;
+
+    if (fseek(f, b->persisted_bytes, SEEK_SET) != 0 ||
+        !write_samples(f, b, &codec, from, to, &bytes)) {
+        ESP_LOGE(TAG, "Failed to append samples %d-%d", from, to);
+        fclose(f);
+        return ESP_FAIL;
+    }
+
+    // I record devono arrivare su flash prima dell'header che li committa
+    fflush(f);
+
+    if (!write_header(f, b)) {
+        ESP_LOGE(TAG, "Failed to commit header");
+        fclose(f);
+        return ESP_FAIL;
+    }
+
+    fclose(f);
+
+    *b_codec = codec;
+    b->persisted_bytes += bytes;
+    *bytes_written = bytes + sizeof(history_header_t);
+    return ESP_OK;
+}
+
+/**
+ * @brief Riscrive l'intero file con i sample [0, num_samples)
+ *
+ * Il giorno viene scritto in un file temporaneo che poi sostituisce
+ * quello attivo: il file servito da /api/log/raw o letto da un altro task
+ * non è mai troncato o a metà. SPIFFS non rinomina sopra un file
+ * esistente, quindi il vecchio va rimosso prima del rename; un reset tra
+ * i due passi viene completato da spiffs_init().
+ *
+ * Nel temporaneo l'header viene scritto prima con num_samples = 0 e
+ * aggiornato dopo i record, così anche un temporaneo troncato risulta vuoto.
+ */
+static esp_err_t rewrite_file(history_buffer_t* b, tlog2_state_t* b_codec,
+                              const char* filename, size_t* bytes_written)
+{
+    char temp[40];
+    get_temp_filename(filename, temp, sizeof(temp));
+
+    FILE* f = fopen(temp, "wb");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Failed to open %s for writing", temp);
+        return ESP_FAIL;
+    }
+
+    history_header_t placeholder = b->header;
+    placeholder.num_samples = 0;
+
+    uint16_t count = b->header.num_samples;
+    tlog2_state_t codec;
+    size_t bytes = 0;
+    tlog2_init(&codec);
+
+    bool ok = fwrite(&placeholder, 1, sizeof(history_header_t), f) == sizeof(history_header_t);
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to write header");
+    } else if (!(ok = write_samples(f, b, &codec, 0, count, &bytes))) {
+        ESP_LOGE(TAG, "Failed to write samples (%d)", count);
+    } else {
+        fflush(f);
+        if (!(ok = write_header(f, b))) {
+            ESP_LOGE(TAG, "Failed to commit header");
+        }
+    }
+
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+
+    if (!ok) {
+        remove(temp);
+        return ESP_FAIL;
+    }
+
+    // Sostituzione: il vecchio file resta valido fino a qui
+    remove(filename);
+    if (rename(temp, filename) != 0) {
+        ESP_LOGE(TAG, "Failed to rename %s", temp);
+        return ESP_FAIL;
+    }
+
+    *b_codec = codec;
+    b->persisted_bytes = sizeof(history_header_t) + bytes;
+    *bytes_written = bytes + 2 * sizeof(history_header_t);
+    return ESP_OK;
+}
+
+static esp_err_t spiffs_write_day(history_buffer_t* b, tlog2_state_t* codec, bool append,
+                                  size_t* bytes_written)
+{
+    char filename[32];
+    history_get_filename(b->header.year, b->header.month, b->header.day,
+                         filename, sizeof(filename));
+
+    if (append) {
+        return append_to_file(b, codec, filename, bytes_written);
+    }
+    return rewrite_file(b, codec, filename, bytes_written);
+}
+
+/**
+ * @brief Scrive gli estremi dei minuti [from, num_samples) nel file .ext
+ *
+ * Posizione fissa per minuto: basta sovrascrivere la coda. Se il file
+ * non esiste viene ricreato da zero. Gli estremi sono un complemento del
+ * file principale, già committato: un errore qui lascia solo minuti con
+ * estremi sconosciuti al prossimo caricamento.
+ */
+static esp_err_t spiffs_write_extremes(const history_buffer_t* b, uint16_t from)
+{
+    char filename[32];
+    history_get_extremes_filename(b->header.year, b->header.month,
+                                  b->header.day, filename, sizeof(filename));
+
+    FILE* f = (from > 0) ? fopen(filename, "r+b") : NULL;
+    if (f == NULL || fseek(f, from * sizeof(history_extremes_t), SEEK_SET) != 0) {
+        if (f != NULL) {
+            fclose(f);
+        }
+        from = 0;
+        f = fopen(filename, "wb");
+        if (f == NULL) {
+            ESP_LOGE(TAG, "Failed to open %s for writing", filename);
+            return ESP_FAIL;
+        }
+    }
+
+    uint16_t to = b->header.num_samples;
+    size_t count = (to > from) ? to - from : 0;
+    bool ok = fwrite(&b->extremes[from], sizeof(history_extremes_t), count, f) == count;
+    fclose(f);
+
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to write %s", filename);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Carica gli estremi dal file .ext (se presente)
+ *
+ * File assente o più corto del giorno: i minuti mancanti restano
+ * HISTORY_EXT_UNKNOWN.
+ */
+static void spiffs_read_extremes(uint16_t year, uint8_t month, uint8_t day,
+                                 history_extremes_t* extremes)
+{
+    char filename[32];
+    history_get_extremes_filename(year, month, day, filename, sizeof(filename));
+
+    FILE* f = fopen(filename, "rb");
+    if (f == NULL) {
+        return;
+    }
+
+    size_t read = fread(extremes, sizeof(history_extremes_t), HISTORY_SAMPLES_PER_DAY, f);
+    fclose(f);
+
+    ESP_LOGD(TAG, "Loaded %s: %u minutes", filename, (unsigned int)read);
+}
+
+static void spiffs_reader_close(history_reader_t* reader)
+{
+    if (reader->file != NULL) {
+        fclose(reader->file);
+        reader->file = NULL;
+    }
+}
+
+static esp_err_t spiffs_reader_open(history_reader_t* reader,
+                                    uint16_t year, uint8_t month, uint8_t day)
+{
+    char filename[32];
+    history_get_filename(year, month, day, filename, sizeof(filename));
+
+    reader->file = fopen(filename, "rb");
+    if (reader->file == NULL) {
+        ESP_LOGD(TAG, "File %s not found", filename);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (fread(&reader->header, 1, sizeof(history_header_t), reader->file) !=
+        sizeof(history_header_t)) {
+        ESP_LOGE(TAG, "Failed to read header of %s", filename);
+        spiffs_reader_close(reader);
+        return ESP_FAIL;
+    }
+
+    if (memcmp(reader->header.magic, HISTORY_MAGIC, 4) != 0) {
+        ESP_LOGE(TAG, "Invalid magic number in %s", filename);
+        spiffs_reader_close(reader);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    if (reader->header.version != HISTORY_VERSION &&
+        reader->header.version != HISTORY_VERSION_V1) {
+        ESP_LOGE(TAG, "Unsupported version %d in %s", reader->header.version, filename);
+        spiffs_reader_close(reader);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    if (reader->header.num_samples > HISTORY_SAMPLES_PER_DAY) {
+        reader->header.num_samples = HISTORY_SAMPLES_PER_DAY;
+    }
+
+    tlog2_init(&reader->codec);
+    reader->offset = sizeof(history_header_t);
+    return ESP_OK;
+}
+
+static esp_err_t spiffs_reader_next(history_reader_t* reader, history_sample_t* sample)
+{
+    if (reader->file == NULL || reader->next_minute >= reader->header.num_samples) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (reader->header.version == HISTORY_VERSION_V1) {
+        if (fread(sample, sizeof(history_sample_t), 1, reader->file) != 1) {
+            return ESP_FAIL;
+        }
+        reader->offset += sizeof(history_sample_t);
+        reader->next_minute++;
+        return ESP_OK;
+    }
+
+    // Ricarica il buffer se potrebbe non contenere un record intero
+    size_t avail = reader->buf_len - reader->buf_pos;
+    if (avail < TLOG2_MAX_RECORD_SIZE) {
+        memmove(reader->buf, &reader->buf[reader->buf_pos], avail);
+        avail += fread(&reader->buf[avail], 1, sizeof(reader->buf) - avail, reader->file);
+        reader->buf_len = avail;
+        reader->buf_pos = 0;
+    }
+
+    int used = tlog2_decode(&reader->codec, reader->next_minute,
+                            &reader->buf[reader->buf_pos], avail, sample);
+    if (used <= 0) {
+        ESP_LOGW(TAG, "Corrupted or truncated record at minute %d", reader->next_minute);
+        return ESP_FAIL;
+    }
+
+    reader->buf_pos += used;
+    reader->offset += used;
+    reader->next_minute++;
+    return ESP_OK;
+}
+
+static bool spiffs_day_exists(uint16_t year, uint8_t month, uint8_t day)
+{
+    char filename[32];
+    history_get_filename(year, month, day, filename, sizeof(filename));
+
+    struct stat st;
+    return (stat(filename, &st) == 0);
+}
+
+/**
+ * @brief Scansione della directory: dimensione dal file, num_samples dall'header
+ */
+static void spiffs_foreach_day(uint16_t year, history_backend_day_cb_t cb, void* arg)
+{
+    DIR* dir = opendir("/spiffs");
+    if (dir == NULL) {
+        ESP_LOGE(TAG, "Failed to open /spiffs directory");
+        return;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        // Solo log_YYYYMMDD.bin: il letterale dopo l'ultima conversione non
+        // viene verificato da sscanf (accetterebbe anche .ext e .tmp) e le
+        // cifre vanno contate (end = 12) per scartare date troncate
+        unsigned int y, m, d;
+        int end = 0;
+        if (sscanf(entry->d_name, "log_%4u%2u%2u%n", &y, &m, &d, &end) != 3 ||
+            strcmp(entry->d_name + end, ".bin") != 0 || end != 12 ||
+            (year != 0 && y != year)) {
+            continue;
+        }
+
+        char path[300];
+        snprintf(path, sizeof(path), "/spiffs/%s", entry->d_name);
+
+        uint32_t size = 0;
+        struct stat st;
+        if (stat(path, &st) == 0) {
+            size = st.st_size;
+        }
+
+        uint16_t num_samples = 0;
+        FILE* f = fopen(path, "rb");
+        if (f != NULL) {
+            history_header_t header;
+            if (fread(&header, sizeof(header), 1, f) == 1 &&
+                memcmp(header.magic, HISTORY_MAGIC, 4) == 0) {
+                num_samples = header.num_samples;
+            }
+            fclose(f);
+        }
+
+        cb(y, m, d, num_samples, size, arg);
+    }
+
+    closedir(dir);
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+const history_backend_t history_backend_spiffs = {
+    .name = "spiffs",
+    .init = spiffs_init,
+    .write_day = spiffs_write_day,
+    .write_extremes = spiffs_write_extremes,
+    .read_extremes = spiffs_read_extremes,
+    .reader_open = spiffs_reader_open,
+    .reader_next = spiffs_reader_next,
+    .reader_close = spiffs_reader_close,
+    .day_exists = spiffs_day_exists,
+    .foreach_day = spiffs_foreach_day,
+    .raw_files = true,
+};
@@ -0,0 +1,200 @@
+/**
+ * @file history_codec.cpp
+ * @brief Implementazione codifica TLOG v2 (delta zig-zag + varint)
+ */
+
+#include "history_codec.h"
+
+#include <string.h>
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static inline uint32_t zigzag_encode(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+/**
+ * @brief Scrive un delta come varint zig-zag
+ */
+static size_t put_delta(uint8_t* out, int32_t delta)
+{
+    uint32_t v = zigzag_encode(delta);
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+/**
+ * @brief Legge un delta varint zig-zag
+ *
+ * @return Byte consumati, 0 se incompleto, -1 se troppo lungo
+ */
+static int get_delta(const uint8_t* in, size_t len, int32_t* delta)
+{
+    uint32_t v = 0;
+
+    for (size_t i = 0; i < 3; i++) {
+        if (i >= len) {
+            return 0;
+        }
+        v |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+        if ((in[i] & 0x80) == 0) {
+            *delta = zigzag_decode(v);
+            return (int)(i + 1);
+        }
+    }
+    return -1;  // Nessun canale richiede più di 3 byte
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+void tlog2_init(tlog2_state_t* state)
+{
+    memset(&state->prev, 0, sizeof(history_sample_t));
+}
+
+bool tlog2_sample_is_empty(const history_sample_t* sample)
+{
+    return sample->temperature == -32768 &&
+           sample->humidity == 255 &&
+           sample->setpoint == -32768 &&
+           sample->pressure == 0 &&
+           sample->flags == 0 &&
+           sample->active_bank == 0;
+}
+
+void tlog2_make_empty(history_sample_t* sample, uint16_t minute_of_day)
+{
+    sample->minute_of_day = minute_of_day;
+    sample->temperature = -32768;
+    sample->humidity = 255;
+    sample->flags = 0;
+    sample->setpoint = -32768;
+    sample->active_bank = 0;
+    sample->reserved = 0;
+    sample->pressure = 0;
+}
+
+size_t tlog2_encode(tlog2_state_t* state, const history_sample_t* sample, uint8_t* out)
+{
+    if (tlog2_sample_is_empty(sample)) {
+        out[0] = TLOG2_F_EMPTY;
+        return 1;   // Il predittore resta sull'ultimo sample valido
+    }
+
+    const history_sample_t* prev = &state->prev;
+    int32_t d_temp = (int32_t)sample->temperature - prev->temperature;
+    int32_t d_hum = (int32_t)sample->humidity - prev->humidity;
+    int32_t d_setpoint = (int32_t)sample->setpoint - prev->setpoint;
+    int32_t d_pressure = (int32_t)sample->pressure - prev->pressure;
+
+    uint8_t mask = 0;
+    size_t n = 1;
+
+    if (d_temp != 0) {
+        mask |= TLOG2_F_TEMP;
+        n += put_delta(&out[n], d_temp);
+    }
+    if (d_hum != 0) {
+        mask |= TLOG2_F_HUM;
+        n += put_delta(&out[n], d_hum);
+    }
+    if (d_setpoint != 0) {
+        mask |= TLOG2_F_SETPOINT;
+        n += put_delta(&out[n], d_setpoint);
+    }
+    if (d_pressure != 0) {
+        mask |= TLOG2_F_PRESSURE;
+        n += put_delta(&out[n], d_pressure);
+    }
+    if (sample->flags != prev->flags) {
+        mask |= TLOG2_F_FLAGS;
+        out[n++] = sample->flags;
+    }
+    if (sample->active_bank != prev->active_bank) {
+        mask |= TLOG2_F_BANK;
+        out[n++] = sample->active_bank;
+    }
+
+    out[0] = mask;
+    state->prev = *sample;
+    return n;
+}
+
+int tlog2_decode(tlog2_state_t* state, uint16_t minute_of_day,
+                 const uint8_t* in, size_t len, history_sample_t* sample)
+{
+    if (len == 0) {
+        return 0;
+    }
+
+    uint8_t mask = in[0];
+    if (mask & TLOG2_F_RESERVED) {
+        return -1;
+    }
+
+    if (mask & TLOG2_F_EMPTY) {
+        if (mask != TLOG2_F_EMPTY) {
+            return -1;
+        }
+        tlog2_make_empty(sample, minute_of_day);
+        return 1;
+    }
+
+    // Decodifica su una copia: il predittore cambia solo a record completo
+    history_sample_t cur = state->prev;
+    size_t pos = 1;
+    int32_t delta;
+    int r;
+
+    if (mask & TLOG2_F_TEMP) {
+        if ((r = get_delta(&in[pos], len - pos, &delta)) <= 0) return r;
+        cur.temperature = (int16_t)(cur.temperature + delta);
+        pos += r;
+    }
+    if (mask & TLOG2_F_HUM) {
+        if ((r = get_delta(&in[pos], len - pos, &delta)) <= 0) return r;
+        cur.humidity = (uint8_t)(cur.humidity + delta);
+        pos += r;
+    }
+    if (mask & TLOG2_F_SETPOINT) {
+        if ((r = get_delta(&in[pos], len - pos, &delta)) <= 0) return r;
+        cur.setpoint = (int16_t)(cur.setpoint + delta);
+        pos += r;
+    }
+    if (mask & TLOG2_F_PRESSURE) {
+        if ((r = get_delta(&in[pos], len - pos, &delta)) <= 0) return r;
+        cur.pressure = (uint16_t)(cur.pressure + delta);
+        pos += r;
+    }
+    if (mask & TLOG2_F_FLAGS) {
+        if (pos >= len) return 0;
+        cur.flags = in[pos++];
+    }
+    if (mask & TLOG2_F_BANK) {
+        if (pos >= len) return 0;
+        cur.active_bank = in[pos++];
+    }
+
+    cur.minute_of_day = minute_of_day;
+    cur.reserved = 0;
+
+    state->prev = cur;
+    *sample = cur;
+    return (int)pos;
+}
@@ -0,0 +1,647 @@
+/**
+ * @file history_index.cpp
+ * @brief Implementazione indice annuale dei file log giornalieri
+ */
+
+#include "history_index.h"
+#include "history_manager.h"
+#include "history_rollup.h"
+#include "history_backend.h"
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <time.h>
+
+static const char* TAG = "HIST_IDX";
+
+#define INDEX_FIRST_YEAR        2000    // Anni elencati da history_index_foreach()
+#define INDEX_NUM_YEARS         100
+
+// ============================================================================
+// VARIABILI STATICHE
+// ============================================================================
+
+static history_index_t* s_cache[HISTORY_INDEX_YEARS];   // Indici in PSRAM (year = 0 se slot libero)
+static SemaphoreHandle_t s_mutex = NULL;
+static uint8_t s_years[(INDEX_NUM_YEARS + 7) / 8];      // Bit n = anno INDEX_FIRST_YEAR + n con dati
+static bool s_years_scanned = false;                    // s_years letto dal backend
+
+static const uint16_t s_days_before_month[12] = {
+    0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+};
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static bool is_leap(uint16_t year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static uint8_t days_in_month(uint16_t year, uint8_t month)
+{
+    static const uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return (month == 2 && is_leap(year)) ? 29 : days[month - 1];
+}
+
+/**
+ * @brief Giorno dell'anno (0-365) o -1 se la data non è valida
+ */
+static int day_of_year(uint16_t year, uint8_t month, uint8_t day)
+{
+    if (month < 1 || month > 12 || day < 1 || day > days_in_month(year, month)) {
+        return -1;
+    }
+    return s_days_before_month[month - 1] + (day - 1) + ((month > 2 && is_leap(year)) ? 1 : 0);
+}
+
+static void get_filename(uint16_t year, char* buffer, size_t buffer_size)
+{
+    snprintf(buffer, buffer_size, "/spiffs/idx_%04d.bin", year);
+}
+
+static inline bool bit_get(const history_index_t* idx, int doy)
+{
+    return (idx->bitmap[doy / 8] >> (doy % 8)) & 1;
+}
+
+static inline void bit_set(history_index_t* idx, int doy)
+{
+    idx->bitmap[doy / 8] |= (uint8_t)(1 << (doy % 8));
+}
+
+static void init_empty(history_index_t* idx, uint16_t year)
+{
+    memset(idx, 0, sizeof(history_index_t));
+    memcpy(idx->magic, HISTORY_INDEX_MAGIC, 4);
+    idx->version = HISTORY_INDEX_VERSION;
+    idx->year = year;
+}
+
+static bool is_empty(const history_index_t* idx)
+{
+    for (size_t i = 0; i < sizeof(idx->bitmap); i++) {
+        if (idx->bitmap[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static esp_err_t write_file(const history_index_t* idx)
+{
+    char filename[32];
+    get_filename(idx->year, filename, sizeof(filename));
+
+    FILE* f = fopen(filename, "wb");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Failed to create %s", filename);
+        return ESP_FAIL;
+    }
+
+    bool ok = fwrite(idx, sizeof(history_index_t), 1, f) == 1;
+    fclose(f);
+
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+static bool load_file(history_index_t* idx, uint16_t year)
+{
+    char filename[32];
+    get_filename(year, filename, sizeof(filename));
+
+    FILE* f = fopen(filename, "rb");
+    if (f == NULL) {
+        return false;
+    }
+
+    bool ok = fread(idx, sizeof(history_index_t), 1, f) == 1 &&
+              memcmp(idx->magic, HISTORY_INDEX_MAGIC, 4) == 0 &&
+              idx->version == HISTORY_INDEX_VERSION &&
+              idx->year == year;
+    fclose(f);
+
+    if (!ok) {
+        ESP_LOGW(TAG, "Invalid index %s, rebuilding", filename);
+    }
+    return ok;
+}
+
+typedef struct {
+    history_index_t* idx;
+    uint16_t found;
+    uint16_t month_mask;
+} rebuild_ctx_t;
+
+/**
+ * @brief Aggiunge all'indice un giorno trovato dal backend
+ */
+static void rebuild_day_cb(uint16_t year, uint8_t month, uint8_t day,
+                           uint16_t num_samples, uint32_t size, void* arg)
+{
+    rebuild_ctx_t* ctx = (rebuild_ctx_t*)arg;
+
+    int doy = day_of_year(year, month, day);
+    if (doy < 0) {
+        return;
+    }
+
+    history_index_entry_t* e = &ctx->idx->days[doy];
+    e->t_min = -32768;
+    e->t_max = -32768;
+    e->file_size = size;
+    e->num_samples = num_samples;
+
+    bit_set(ctx->idx, doy);
+    ctx->month_mask |= 1 << (month - 1);
+    ctx->found++;
+}
+
+/**
+ * @brief Ricostruisce l'indice di un anno elencando i giorni del backend
+ *
+ * Dimensione e num_samples arrivano dal backend (file giornaliero o log),
+ * min/max e minuti caldaia dagli aggregati mensili (un file per mese, se
+ * presente).
+ */
+static void rebuild(history_index_t* idx, uint16_t year)
+{
+    init_empty(idx, year);
+
+    rebuild_ctx_t ctx = { .idx = idx, .found = 0, .month_mask = 0 };
+    history_backend_get()->foreach_day(year, rebuild_day_cb, &ctx);
+
+    uint16_t found = ctx.found;
+    uint16_t month_mask = ctx.month_mask;
+
+    // Statistiche dai rollup mensili
+    rollup_record_t days[ROLLUP_DAYS_PER_MONTH];
+    for (uint8_t m = 1; m <= 12; m++) {
+        if ((month_mask & (1 << (m - 1))) == 0 ||
+            history_rollup_read(year, m, false, 0, days) != ESP_OK) {
+            continue;
+        }
+
+        for (uint8_t d = 1; d <= days_in_month(year, m); d++) {
+            int doy = day_of_year(year, m, d);
+            const rollup_record_t* r = &days[d - 1];
+            if (!bit_get(idx, doy) || r->count == 0) {
+                continue;
+            }
+            idx->days[doy].t_min = r->t_min;
+            idx->days[doy].t_max = r->t_max;
+            idx->days[doy].heater_on = r->heater_on;
+        }
+    }
+
+    ESP_LOGI(TAG, "Rebuilt index %04d from %s backend: %d days", year,
+             history_backend_get()->name, found);
+}
+
+/**
+ * @brief Cerca l'indice di un anno già in cache (chiamare sotto lock)
+ */
+static history_index_t* find_slot(uint16_t year)
+{
+    for (int i = 0; i < HISTORY_INDEX_YEARS; i++) {
+        if (s_cache[i] != NULL && s_cache[i]->year == year) {
+            return s_cache[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief true se l'anno rientra negli anni tenuti in cache (corrente e precedenti)
+ *
+ * Con l'ora non ancora sincronizzata qualsiasi anno è ammesso.
+ */
+static bool in_window(uint16_t year)
+{
+    time_t now;
+    struct tm timeinfo;
+    time(&now);
+    localtime_r(&now, &timeinfo);
+    uint16_t current_year = timeinfo.tm_year + 1900;
+
+    if (current_year < 2020) {
+        return true;
+    }
+    return year <= current_year && year + HISTORY_INDEX_YEARS > current_year;
+}
+
+/**
+ * @brief Restituisce l'indice di un anno, caricandolo o ricostruendolo
+ *
+ * Solo per gli anni della finestra in cache: lo slot sostituito è sempre
+ * libero o di un anno uscito dalla finestra. Per gli altri anni ritorna
+ * NULL senza toccare la cache (chiamare sotto lock).
+ */
+static history_index_t* get_slot(uint16_t year)
+{
+    history_index_t* idx = find_slot(year);
+    if (idx != NULL) {
+        return idx;
+    }
+
+    if (!in_window(year)) {
+        return NULL;
+    }
+
+    int victim = 0;
+    for (int i = 0; i < HISTORY_INDEX_YEARS; i++) {
+        if (s_cache[i] == NULL) {
+            return NULL;
+        }
+        if (s_cache[i]->year < s_cache[victim]->year) {
+            victim = i;
+        }
+    }
+
+    idx = s_cache[victim];
+    if (!load_file(idx, year)) {
+        rebuild(idx, year);
+        // Anni senza log restano solo in RAM: niente file vuoti su flash
+        if (!is_empty(idx)) {
+            write_file(idx);
+        }
+    }
+
+    return idx;
+}
+
+/**
+ * @brief Apre il file indice di un anno fuori cache e ne verifica l'header
+ */
+static FILE* open_uncached(uint16_t year, const char* mode)
+{
+    char filename[32];
+    get_filename(year, filename, sizeof(filename));
+
+    FILE* f = fopen(filename, mode);
+    if (f == NULL) {
+        return NULL;
+    }
+
+    char magic[4];
+    uint8_t version;
+    uint16_t file_year;
+    bool ok = fread(magic, 4, 1, f) == 1 &&
+              fread(&version, 1, 1, f) == 1 &&
+              fseek(f, offsetof(history_index_t, year), SEEK_SET) == 0 &&
+              fread(&file_year, sizeof(file_year), 1, f) == 1 &&
+              memcmp(magic, HISTORY_INDEX_MAGIC, 4) == 0 &&
+              version == HISTORY_INDEX_VERSION && file_year == year;
+    if (!ok) {
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+/**
+ * @brief Legge un giorno dal file di un anno fuori cache (lettura diretta)
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND se il giorno manca nel file,
+ *         ESP_ERR_INVALID_STATE se il file non c'è (presenza sconosciuta)
+ */
+static esp_err_t read_uncached(uint16_t year, int doy, history_index_entry_t* entry)
+{
+    FILE* f = open_uncached(year, "rb");
+    if (f == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t bits = 0;
+    bool ok = fseek(f, offsetof(history_index_t, bitmap) + doy / 8, SEEK_SET) == 0 &&
+              fread(&bits, 1, 1, f) == 1;
+    bool present = ok && ((bits >> (doy % 8)) & 1);
+    if (present) {
+        present = fseek(f, offsetof(history_index_t, days) + doy * sizeof(history_index_entry_t),
+                        SEEK_SET) == 0 &&
+                  fread(entry, sizeof(history_index_entry_t), 1, f) == 1;
+    }
+    fclose(f);
+
+    if (!ok) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return present ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * @brief Aggiorna un giorno nel file di un anno fuori cache, se esiste
+ *
+ * Senza file non scrive nulla: l'indice verrà ricostruito al prossimo
+ * history_index_foreach().
+ */
+static esp_err_t update_uncached(uint16_t year, int doy, const history_index_entry_t* entry)
+{
+    FILE* f = open_uncached(year, "r+b");
+    if (f == NULL) {
+        return ESP_OK;
+    }
+
+    size_t bitmap_off = offsetof(history_index_t, bitmap) + doy / 8;
+    size_t entry_off = offsetof(history_index_t, days) + doy * sizeof(history_index_entry_t);
+    uint8_t bits = 0;
+
+    bool ok = fseek(f, bitmap_off, SEEK_SET) == 0 &&
+              fread(&bits, 1, 1, f) == 1;
+    bits |= (uint8_t)(1 << (doy % 8));
+    ok = ok && fseek(f, bitmap_off, SEEK_SET) == 0 &&
+         fwrite(&bits, 1, 1, f) == 1 &&
+         fseek(f, entry_off, SEEK_SET) == 0 &&
+         fwrite(entry, sizeof(history_index_entry_t), 1, f) == 1;
+    fclose(f);
+
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief Segna un anno come presente nell'elenco (chiamare sotto lock)
+ */
+static void year_mark(uint8_t* years, uint16_t year)
+{
+    if (year >= INDEX_FIRST_YEAR && year < INDEX_FIRST_YEAR + INDEX_NUM_YEARS) {
+        uint16_t n = year - INDEX_FIRST_YEAR;
+        years[n / 8] |= (uint8_t)(1 << (n % 8));
+    }
+}
+
+static void scan_year_cb(uint16_t year, uint8_t month, uint8_t day,
+                         uint16_t num_samples, uint32_t size, void* arg)
+{
+    (void)month; (void)day; (void)num_samples; (void)size;
+    year_mark((uint8_t*)arg, year);
+}
+
+/**
+ * @brief Anni con dati su flash, una sola passata sul backend al primo elenco
+ *
+ * In seguito history_index_update() e history_index_invalidate() tengono
+ * aggiornata la maschera.
+ */
+static void scan_years(void)
+{
+    uint8_t years[sizeof(s_years)] = {0};
+    history_backend_get()->foreach_day(0, scan_year_cb, years);
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < sizeof(s_years); i++) {
+        s_years[i] |= years[i];
+    }
+    s_years_scanned = true;
+    xSemaphoreGive(s_mutex);
+}
+
+/**
+ * @brief Enumera i giorni di un anno in cache (lock per singolo giorno)
+ *
+ * @return false se l'anno non è in cache
+ */
+static bool foreach_cached(uint16_t year, history_index_cb_t cb, void* ctx)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool loaded = get_slot(year) != NULL;
+    xSemaphoreGive(s_mutex);
+
+    if (!loaded) {
+        return false;
+    }
+
+    for (uint8_t month = 1; month <= 12; month++) {
+        for (uint8_t day = 1; day <= days_in_month(year, month); day++) {
+            int doy = day_of_year(year, month, day);
+            history_index_entry_t entry;
+            bool present = false;
+
+            // Lock per singolo giorno: la callback può inviare dati sulla rete
+            xSemaphoreTake(s_mutex, portMAX_DELAY);
+            const history_index_t* idx = find_slot(year);
+            if (idx != NULL && bit_get(idx, doy)) {
+                entry = idx->days[doy];
+                present = true;
+            }
+            xSemaphoreGive(s_mutex);
+
+            if (present) {
+                cb(year, month, day, &entry, ctx);
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Enumera i giorni di un anno fuori cache da una copia temporanea
+ *
+ * Il file idx_YYYY.bin viene letto intero; se manca è ricostruito dal
+ * backend e salvato, senza sostituire un anno in cache.
+ */
+static void foreach_uncached(uint16_t year, history_index_cb_t cb, void* ctx)
+{
+    history_index_t* idx = (history_index_t*)heap_caps_malloc(
+        sizeof(history_index_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (idx == NULL) {
+        ESP_LOGE(TAG, "No memory to list %04d", year);
+        return;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (!load_file(idx, year)) {
+        rebuild(idx, year);
+        if (!is_empty(idx)) {
+            write_file(idx);
+        }
+    }
+    xSemaphoreGive(s_mutex);
+
+    for (uint8_t month = 1; month <= 12; month++) {
+        for (uint8_t day = 1; day <= days_in_month(year, month); day++) {
+            int doy = day_of_year(year, month, day);
+            if (bit_get(idx, doy)) {
+                cb(year, month, day, &idx->days[doy], ctx);
+            }
+        }
+    }
+
+    heap_caps_free(idx);
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+esp_err_t history_index_init(void)
+{
+    if (s_mutex != NULL) {
+        return ESP_OK;
+    }
+
+    for (int i = 0; i < HISTORY_INDEX_YEARS; i++) {
+        s_cache[i] = (history_index_t*)heap_caps_malloc(
+            sizeof(history_index_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (s_cache[i] == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate index cache");
+            return ESP_ERR_NO_MEM;
+        }
+        s_cache[i]->year = 0;
+    }
+
+    s_mutex = xSemaphoreCreateMutex();
+    if (s_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Index cache: %d years, %u bytes in PSRAM",
+             HISTORY_INDEX_YEARS, (unsigned int)(HISTORY_INDEX_YEARS * sizeof(history_index_t)));
+    return ESP_OK;
+}
+
+esp_err_t history_index_update(uint16_t year, uint8_t month, uint8_t day,
+                               const history_index_entry_t* entry)
+{
+    int doy = day_of_year(year, month, day);
+    if (doy < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    history_index_t* idx = get_slot(year);
+    if (idx == NULL) {
+        // Anno fuori dalla cache (giorno vecchio riscritto): solo il file
+        year_mark(s_years, year);
+        esp_err_t ret = update_uncached(year, doy, entry);
+        xSemaphoreGive(s_mutex);
+        return ret;
+    }
+
+    year_mark(s_years, year);
+    idx->days[doy] = *entry;
+    bit_set(idx, doy);
+
+    // Aggiornamento in place: byte di bitmap e record del giorno
+    char filename[32];
+    get_filename(year, filename, sizeof(filename));
+
+    esp_err_t ret = ESP_OK;
+    FILE* f = fopen(filename, "r+b");
+    if (f == NULL) {
+        ret = write_file(idx);
+    } else {
+        size_t bitmap_off = offsetof(history_index_t, bitmap) + doy / 8;
+        size_t entry_off = offsetof(history_index_t, days) + doy * sizeof(history_index_entry_t);
+
+        bool ok = fseek(f, bitmap_off, SEEK_SET) == 0 &&
+                  fwrite(&idx->bitmap[doy / 8], 1, 1, f) == 1 &&
+                  fseek(f, entry_off, SEEK_SET) == 0 &&
+                  fwrite(&idx->days[doy], sizeof(history_index_entry_t), 1, f) == 1;
+        fclose(f);
+        ret = ok ? ESP_OK : ESP_FAIL;
+    }
+
+    xSemaphoreGive(s_mutex);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to update index for %04d-%02d-%02d", year, month, day);
+    }
+    return ret;
+}
+
+bool history_index_has_day(uint16_t year, uint8_t month, uint8_t day)
+{
+    history_index_entry_t entry;
+    esp_err_t ret = history_index_get_entry(year, month, day, &entry);
+
+    // Anno senza indice fuori dalla cache: lo sa il backend
+    if (ret == ESP_ERR_INVALID_STATE) {
+        return history_backend_get()->day_exists(year, month, day);
+    }
+    return ret == ESP_OK;
+}
+
+esp_err_t history_index_get_entry(uint16_t year, uint8_t month, uint8_t day,
+                                  history_index_entry_t* entry)
+{
+    int doy = day_of_year(year, month, day);
+    if (doy < 0 || s_mutex == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    history_index_t* idx = get_slot(year);
+    if (idx == NULL) {
+        // Fuori dalla cache: lettura diretta dal file, senza sostituire anni
+        ret = read_uncached(year, doy, entry);
+    } else if (bit_get(idx, doy)) {
+        *entry = idx->days[doy];
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(s_mutex);
+
+    return ret;
+}
+
+void history_index_foreach(history_index_cb_t cb, void* ctx)
+{
+    if (s_mutex == NULL) {
+        return;
+    }
+
+    if (!s_years_scanned) {
+        scan_years();
+    }
+
+    uint8_t years[sizeof(s_years)];
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    memcpy(years, s_years, sizeof(years));
+    xSemaphoreGive(s_mutex);
+
+    // Anche con l'ora non sincronizzata e per gli anni fuori dalla cache:
+    // i loro file sono ancora su flash
+    for (uint16_t n = 0; n < INDEX_NUM_YEARS; n++) {
+        if ((years[n / 8] & (1 << (n % 8))) == 0) {
+            continue;
+        }
+        uint16_t year = INDEX_FIRST_YEAR + n;
+        if (!foreach_cached(year, cb, ctx)) {
+            foreach_uncached(year, cb, ctx);
+        }
+    }
+}
+
+void history_index_invalidate(uint16_t year)
+{
+    if (s_mutex == NULL) {
+        return;
+    }
+
+    char filename[32];
+    get_filename(year, filename, sizeof(filename));
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    history_index_t* idx = find_slot(year);
+    if (idx != NULL) {
+        idx->year = 0;
+    }
+    remove(filename);
+    year_mark(s_years, year);    // File scritto dall'esterno: l'anno ha dati
+
+    xSemaphoreGive(s_mutex);
+
+    ESP_LOGI(TAG, "Index %04d invalidated", year);
+}
@@ -0,0 +1,141 @@
+/**
+ * @file history_journal.cpp
+ * @brief Implementazione journal dei sample in memoria RTC
+ */
+
+#include "history_journal.h"
+
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_rom_crc.h"
+#include <stddef.h>
+#include <string.h>
+
+static const char* TAG = "JOURNAL";
+
+#define JOURNAL_MAGIC       0x4C4E524A  // "JRNL"
+
+// ============================================================================
+// STRUTTURE PRIVATE
+// ============================================================================
+
+/**
+ * @brief Record del ring (24 bytes)
+ */
+typedef struct {
+    history_sample_t sample;                        // 12 bytes
+    history_extremes_t extremes;                    // 2 bytes
+    uint16_t year;                                  // Data del sample
+    uint8_t month;
+    uint8_t day;
+    uint16_t reserved;
+    uint32_t crc;                                   // CRC32 dei byte precedenti
+} journal_entry_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t head;                                  // Prossimo record da scrivere
+    journal_entry_t entries[HISTORY_JOURNAL_ENTRIES];
+} journal_t;
+
+static_assert(sizeof(journal_entry_t) == 24, "journal_entry_t must be 24 bytes");
+
+// ============================================================================
+// VARIABILI STATICHE
+// ============================================================================
+
+static RTC_NOINIT_ATTR journal_t s_journal;
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static uint32_t entry_crc(const journal_entry_t* e)
+{
+    return esp_rom_crc32_le(0, (const uint8_t*)e, offsetof(journal_entry_t, crc));
+}
+
+static void journal_clear(void)
+{
+    memset(&s_journal, 0, sizeof(s_journal));
+    s_journal.magic = JOURNAL_MAGIC;
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+void history_journal_init(void)
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+
+    if (reason == ESP_RST_POWERON || s_journal.magic != JOURNAL_MAGIC ||
+        s_journal.head >= HISTORY_JOURNAL_ENTRIES) {
+        ESP_LOGI(TAG, "Journal cleared (reset reason %d)", (int)reason);
+        journal_clear();
+        return;
+    }
+
+    ESP_LOGI(TAG, "Journal kept across reset (reason %d)", (int)reason);
+}
+
+void history_journal_append(uint16_t year, uint8_t month, uint8_t day,
+                            const history_sample_t* sample,
+                            const history_extremes_t* extremes)
+{
+    uint32_t head = s_journal.head;
+    if (s_journal.magic != JOURNAL_MAGIC || head >= HISTORY_JOURNAL_ENTRIES) {
+        journal_clear();
+        head = 0;
+    }
+
+    journal_entry_t* e = &s_journal.entries[head];
+    e->sample = *sample;
+    e->extremes = *extremes;
+    e->year = year;
+    e->month = month;
+    e->day = day;
+    e->reserved = 0;
+    e->crc = entry_crc(e);
+
+    // Il record è completo prima di avanzare la testa
+    s_journal.head = (head + 1) % HISTORY_JOURNAL_ENTRIES;
+}
+
+uint16_t history_journal_replay(uint16_t year, uint8_t month, uint8_t day,
+                                history_journal_cb_t cb, void* arg)
+{
+    if (s_journal.magic != JOURNAL_MAGIC) {
+        return 0;
+    }
+
+    uint16_t replayed = 0;
+    uint16_t corrupted = 0;
+
+    // Dal record più vecchio al più recente
+    for (uint32_t n = 0; n < HISTORY_JOURNAL_ENTRIES; n++) {
+        const journal_entry_t* e =
+            &s_journal.entries[(s_journal.head + n) % HISTORY_JOURNAL_ENTRIES];
+
+        if (e->year == 0) {
+            continue;       // Mai scritto
+        }
+        if (e->crc != entry_crc(e)) {
+            corrupted++;
+            continue;
+        }
+        if (e->year != year || e->month != month || e->day != day) {
+            continue;
+        }
+
+        cb(&e->sample, &e->extremes, arg);
+        replayed++;
+    }
+
+    if (corrupted > 0) {
+        ESP_LOGW(TAG, "%u corrupted journal entries ignored", corrupted);
+    }
+
+    return replayed;
+}
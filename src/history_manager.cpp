@@ -4,15 +4,27 @@
  */
 
 #include "history_manager.h"
+#include "history_rollup.h"
+#include "history_index.h"
+#include "history_journal.h"
+#include "history_stats.h"
+#include "history_backend.h"
 #include "storage_manager.h"
 #include "time_sync.h"
+#include "metrics.h"
+#include "storage_writer.h"
+#include "seqlock.h"
+#include "minute_aggregator.h"
 
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include <string.h>
 #include <stdio.h>
 #include <time.h>
-#include <sys/stat.h>
 
 static const char* TAG = "HISTORY";
 
@@ -21,11 +33,77 @@ static const char* TAG = "HISTORY";
 // ============================================================================
 
 static history_buffer_t s_buffer = {0};
+static tlog2_state_t s_codec;   // Predittore v2 dopo l'ultimo sample committato
+static history_stats_t s_stats; // Aggregati della giornata
+static bool s_stats_extremes_stale = false;  // Min/max da ricalcolare
+
+// Lock del buffer: tenuto solo per aggiornamenti in RAM e copie, mai
+// durante l'I/O su file (che avviene nel task writer)
+static SemaphoreHandle_t s_mutex = NULL;
+static SemaphoreHandle_t s_io_mutex = NULL;    // Serializza le scritture su file
+
+// Versione di header e array del buffer attivo: i lettori (HTTP, display)
+// copiano i sample senza lock e ripetono la copia se nel frattempo è
+// cambiata. Gli scrittori la incrementano tenendo s_mutex.
+static seqlock_t s_buffer_seq = SEQLOCK_INIT;
+
+// Secondo buffer di giorno: al cambio giorno i suoi array (già vuoti)
+// vengono scambiati con quelli del buffer attivo e il giorno concluso resta
+// leggibile qui finché il task writer non lo ha scritto
+typedef enum {
+    CLOSING_CLEAN = 0,      // Array vuoti, pronti per lo scambio
+    CLOSING_PENDING,        // Giorno concluso in attesa del writer (leggibile)
+    CLOSING_WRITTEN,        // Scritto su file, array da svuotare (leggibile)
+    CLOSING_CLEARING        // Il writer sta svuotando gli array
+} closing_state_t;
+
+static history_buffer_t s_closing = {0};
+static tlog2_state_t s_closing_codec;
+static uint32_t s_closing_dirty_hours;
+static closing_state_t s_closing_state = CLOSING_CLEAN;
+
+// history_acquire_day() attivi per ciascun set di array: al cambio giorno
+// i lettori di oggi seguono i loro array in s_closing
+static uint8_t s_today_readers = 0;
+static uint8_t s_closing_readers = 0;
+
+// Minuti consecutivi in cui il cambio giorno è stato rimandato perché
+// s_closing non era ancora libero (writer in ritardo o lettori di ieri)
+static uint16_t s_swap_deferred = 0;
+
+// Copia del buffer attivo su cui il task writer esegue il flush
+static history_buffer_t s_snap = {0};
+static tlog2_state_t s_snap_codec;
+
+// Metriche /metrics: durata dei flush su SPIFFS e flush falliti
+static metrics_histogram_t s_flush_latency = METRICS_HISTOGRAM_LATENCY_INIT;
+static metrics_counter_t s_flush_errors;
+static metrics_counter_t s_backfilled_minutes;  // Minuti interpolati
+static metrics_counter_t s_missed_minutes;      // Minuti lasciati vuoti
+static metrics_counter_t s_swap_deferrals;      // Minuti di cambio giorno rimandato
 
 // ============================================================================
 // FUNZIONI PRIVATE
 // ============================================================================
 
+static esp_err_t add_sample(const history_sample_t* sample);
+static esp_err_t day_end_job(void);
+static esp_err_t clear_closing_job(void);
+
+static void lock(void)
+{
+    if (s_mutex != NULL) {
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+    }
+}
+
+static void unlock(void)
+{
+    if (s_mutex != NULL) {
+        xSemaphoreGive(s_mutex);
+    }
+}
+
 /**
  * @brief Ottiene la data corrente dal sistema
  */
@@ -71,36 +149,336 @@ static void init_header_for_date(uint16_t year, uint8_t month, uint8_t day)
 }
 
 /**
- * @brief Inizializza tutti i sample con valori invalidi
+ * @brief Azzera gli aggregati della giornata
  */
-static void clear_samples(void)
+static void stats_reset(void)
+{
+    history_stats_reset(&s_stats);
+    s_stats_extremes_stale = false;
+}
+
+/**
+ * @brief Riempie un set di array con minuti vuoti
+ */
+static void clear_arrays(history_sample_t* samples, history_extremes_t* extremes)
 {
     for (int i = 0; i < HISTORY_SAMPLES_PER_DAY; i++) {
-        s_buffer.samples[i].minute_of_day = i;
-        s_buffer.samples[i].temperature = -32768;  // Valore invalido
-        s_buffer.samples[i].humidity = 255;        // Valore invalido
-        s_buffer.samples[i].flags = 0;
-        s_buffer.samples[i].setpoint = -32768;
-        s_buffer.samples[i].active_bank = 0;
-        s_buffer.samples[i].reserved = 0;
-        s_buffer.samples[i].pressure = 0;          // Valore invalido
+        tlog2_make_empty(&samples[i], i);  // Valori invalidi
     }
+    memset(extremes, HISTORY_EXT_UNKNOWN, HISTORY_SAMPLES_PER_DAY * sizeof(history_extremes_t));
+}
+
+/**
+ * @brief Azzera stato e aggregati del giorno, array esclusi (O(1))
+ */
+static void reset_day_state(void)
+{
+    tlog2_init(&s_codec);
     s_buffer.current_minute = 0;
+    s_buffer.persisted_samples = 0;
+    s_buffer.persisted_bytes = 0;
+    s_buffer.dirty_from = HISTORY_SAMPLES_PER_DAY;
     s_buffer.dirty = false;
+    stats_reset();
+    history_rollup_reset();
 }
 
 /**
- * @brief Verifica se la data nel buffer corrisponde a oggi
+ * @brief Inizializza tutti i sample con valori invalidi
  */
-static bool is_buffer_for_today(void)
+static void clear_samples(void)
 {
-    uint16_t year;
-    uint8_t month, day;
-    get_current_date(&year, &month, &day);
+    clear_arrays(s_buffer.samples, s_buffer.extremes);
+    reset_day_state();
+}
+
+/**
+ * @brief Copia nel journal RTC il sample di un minuto del buffer
+ */
+static void journal_minute(uint16_t minute)
+{
+    history_journal_append(s_buffer.header.year, s_buffer.header.month, s_buffer.header.day,
+                           &s_buffer.samples[minute], &s_buffer.extremes[minute]);
+}
+
+/**
+ * @brief Reinserisce un sample del journal se il minuto è ancora vuoto
+ */
+static void replay_sample(const history_sample_t* sample,
+                          const history_extremes_t* extremes, void* arg)
+{
+    uint16_t current_minute = *(const uint16_t*)arg;
+    uint16_t minute = sample->minute_of_day;
+
+    if (minute > current_minute || s_buffer.samples[minute].temperature != -32768) {
+        return;     // Minuto futuro o già nel file
+    }
+
+    if (add_sample(sample) == ESP_OK) {
+        s_buffer.extremes[minute] = *extremes;
+    }
+}
+
+/**
+ * @brief Recupera dal journal i minuti del giorno non ancora su file
+ *
+ * Restano solo in PSRAM (dirty) fino al prossimo flush orario: il
+ * recupero non scrive su flash. Chiamata con il lock.
+ */
+static void replay_journal(void)
+{
+    uint16_t before = s_buffer.header.num_samples;
+    uint16_t current_minute = get_current_minute_of_day();
+    int64_t start_us = esp_timer_get_time();
+
+    uint16_t count = history_journal_replay(s_buffer.header.year, s_buffer.header.month,
+                                            s_buffer.header.day, replay_sample, &current_minute);
+
+    if (count > 0) {
+        ESP_LOGI(TAG, "Journal replay: %u entries, samples %u -> %u in %lld us",
+                 count, before, s_buffer.header.num_samples,
+                 (long long)(esp_timer_get_time() - start_us));
+    }
+}
+
+/**
+ * @brief Flush prima di un riavvio pianificato (esp_restart)
+ *
+ * Dopo un OTA SPIFFS il filesystem è smontato: i minuti restano solo nel
+ * journal e vengono recuperati al boot.
+ */
+static void shutdown_handler(void)
+{
+    if (!s_buffer.initialized || !storage_is_ready()) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Restart requested, saving history");
+    day_end_job();
+    history_save_to_file();
+}
+
+/**
+ * @brief Confronta la data nel buffer con una data
+ *
+ * @return <0 se il buffer è di un giorno precedente, 0 se è lo stesso, >0 se successivo
+ */
+static int compare_buffer_date(uint16_t year, uint8_t month, uint8_t day)
+{
+    uint32_t buffer = (uint32_t)s_buffer.header.year * 10000 +
+                      s_buffer.header.month * 100 + s_buffer.header.day;
+    uint32_t other = (uint32_t)year * 10000 + month * 100 + day;
+    return (buffer > other) - (buffer < other);
+}
+
+/**
+ * @brief Aggiorna l'indice annuale con il riassunto del giorno di b
+ *
+ * Usa gli aggregati orari in RAM: va chiamata dopo history_rollup_flush()
+ * dello stesso buffer.
+ */
+static void update_index(const history_buffer_t* b)
+{
+    rollup_record_t day;
+    history_rollup_get_day(&day);
+
+    history_index_entry_t entry;
+    entry.file_size = b->persisted_bytes;
+    entry.t_min = day.count > 0 ? day.t_min : -32768;
+    entry.t_max = day.count > 0 ? day.t_max : -32768;
+    entry.heater_on = day.heater_on;
+    entry.num_samples = b->header.num_samples;
 
-    return (s_buffer.header.year == year &&
-            s_buffer.header.month == month &&
-            s_buffer.header.day == day);
+    history_index_update(b->header.year, b->header.month, b->header.day, &entry);
+}
+
+/**
+ * @brief Salva con il backend un buffer non più modificato da altri task
+ *
+ * Giorno (append o riscrittura), estremi, aggregati e indice.
+ * Aggiorna persisted_samples/persisted_bytes di b e il predittore.
+ *
+ * @param dirty_hours Ore da aggiornare negli aggregati
+ * @param rollup_ok Esito dell'aggiornamento degli aggregati
+ */
+static esp_err_t flush_buffer(history_buffer_t* b, tlog2_state_t* codec,
+                              uint32_t dirty_hours, bool* rollup_ok)
+{
+    char filename[32];
+    history_get_filename(b->header.year, b->header.month, b->header.day,
+                         filename, sizeof(filename));
+
+    int64_t start_us = esp_timer_get_time();
+    uint16_t ext_from = b->persisted_samples;
+    size_t bytes_written = 0;
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+    *rollup_ok = false;
+
+    // Append solo se il file contiene già i sample committati e nessuno di
+    // questi è stato modificato dopo l'ultimo flush
+    bool can_append = HISTORY_INCREMENTAL_FLUSH &&
+                      b->persisted_samples > 0 &&
+                      b->dirty_from >= b->persisted_samples &&
+                      b->header.num_samples >= b->persisted_samples;
+
+    const history_backend_t* backend = history_backend_get();
+    if (can_append) {
+        ret = backend->write_day(b, codec, true, &bytes_written);
+        if (ret == ESP_ERR_NOT_FOUND) {
+            ESP_LOGW(TAG, "%s missing, rewriting whole file", filename);
+        }
+    }
+
+    bool appended = (ret == ESP_OK);
+    if (!appended) {
+        ret = backend->write_day(b, codec, false, &bytes_written);
+    }
+
+    metrics_histogram_observe(&s_flush_latency, (uint32_t)(esp_timer_get_time() - start_us));
+    if (ret != ESP_OK) {
+        metrics_counter_inc(&s_flush_errors);
+        return ret;
+    }
+
+    b->persisted_samples = b->header.num_samples;
+
+    ESP_LOGI(TAG, "Saved %s: %d samples, %u bytes %s in %lld us",
+             filename, b->header.num_samples, (unsigned int)bytes_written,
+             appended ? "appended" : "rewritten",
+             (long long)(esp_timer_get_time() - start_us));
+
+    if (backend->write_extremes(b, appended ? ext_from : 0) != ESP_OK) {
+        ESP_LOGW(TAG, "Minute extremes not saved");
+    }
+
+    // Aggregati orari/giornalieri: un errore qui non invalida il file del giorno
+    *rollup_ok = (history_rollup_flush(&b->header, b->samples, dirty_hours) == ESP_OK);
+    if (!*rollup_ok) {
+        ESP_LOGW(TAG, "Rollup update failed, will retry at next save");
+    }
+
+    // Il giorno compare nell'indice al primo salvataggio
+    if (!history_index_has_day(b->header.year, b->header.month, b->header.day)) {
+        update_index(b);
+    }
+
+    return ESP_OK;
+}
+
+static bool same_date(const history_header_t* a, const history_header_t* b)
+{
+    return a->year == b->year && a->month == b->month && a->day == b->day;
+}
+
+static bool same_day(const history_buffer_t* a, const history_buffer_t* b)
+{
+    return same_date(&a->header, &b->header);
+}
+
+/**
+ * @brief Riporta su target (stesso giorno) l'esito di un flush della sua copia
+ *
+ * Chiamata con il lock. Se nel frattempo target ha modificato minuti già
+ * scritti, dirty_from < persisted_samples e il flush successivo riscrive.
+ */
+static void commit_flush(history_buffer_t* target, tlog2_state_t* target_codec,
+                         const history_buffer_t* copy, const tlog2_state_t* copy_codec,
+                         esp_err_t ret)
+{
+    if (ret == ESP_OK) {
+        target->persisted_samples = copy->persisted_samples;
+        target->persisted_bytes = copy->persisted_bytes;
+        *target_codec = *copy_codec;
+    } else {
+        target->dirty = true;
+        if (copy->dirty_from < target->dirty_from) {
+            target->dirty_from = copy->dirty_from;
+        }
+    }
+}
+
+/**
+ * @brief Job del task writer: scrive il giorno concluso e lo mette nell'indice
+ */
+static esp_err_t day_end_job(void)
+{
+    xSemaphoreTake(s_io_mutex, portMAX_DELAY);
+
+    // s_closing non viene modificato da altri task finché è pending
+    lock();
+    bool pending = (s_closing_state == CLOSING_PENDING);
+    unlock();
+
+    esp_err_t ret = ESP_OK;
+    if (pending) {
+        ESP_LOGI(TAG, "Saving previous day %04d-%02d-%02d (%d samples)...",
+                 s_closing.header.year, s_closing.header.month, s_closing.header.day,
+                 s_closing.header.num_samples);
+
+        bool rollup_ok;
+        if (s_closing.dirty || s_closing.persisted_samples != s_closing.header.num_samples) {
+            ret = flush_buffer(&s_closing, &s_closing_codec, s_closing_dirty_hours, &rollup_ok);
+        } else {
+            rollup_ok = (history_rollup_flush(&s_closing.header, s_closing.samples,
+                                              s_closing_dirty_hours) == ESP_OK);
+        }
+
+        if (ret != ESP_OK) {
+            // Resta pending (e leggibile): history_record() riaccoda il job.
+            // Un append interrotto può aver già avanzato il predittore: si
+            // riprova riscrivendo il file intero
+            ESP_LOGW(TAG, "Previous day save failed, will retry: %s", esp_err_to_name(ret));
+            lock();
+            s_closing.dirty = true;
+            s_closing.dirty_from = 0;
+            unlock();
+            xSemaphoreGive(s_io_mutex);
+            return ret;
+        }
+
+        // Riassunto definitivo del giorno concluso
+        if (rollup_ok) {
+            update_index(&s_closing);
+        }
+
+        lock();
+        s_closing_state = CLOSING_WRITTEN;
+        unlock();
+
+        // Il giorno ora si legge dal file: array svuotati per il prossimo scambio
+        clear_closing_job();
+    }
+
+    xSemaphoreGive(s_io_mutex);
+    return ret;
+}
+
+/**
+ * @brief Job del task writer: svuota gli array del giorno già scritto
+ *
+ * Fuori dal lock (scansione di 1440 minuti): lo stato CLEARING impedisce
+ * nuovi lettori e lo scambio al cambio giorno. Con lettori attivi non fa
+ * nulla; lo riaccoda l'ultimo history_release_day().
+ */
+static esp_err_t clear_closing_job(void)
+{
+    lock();
+    bool clear = (s_closing_state == CLOSING_WRITTEN && s_closing_readers == 0);
+    if (clear) {
+        s_closing_state = CLOSING_CLEARING;
+    }
+    unlock();
+
+    if (clear) {
+        clear_arrays(s_closing.samples, s_closing.extremes);
+
+        lock();
+        s_closing_state = CLOSING_CLEAN;
+        unlock();
+    }
+
+    return ESP_OK;
 }
 
 // ============================================================================
@@ -111,9 +489,20 @@ esp_err_t history_init(void)
 {
     ESP_LOGI(TAG, "Initializing history manager...");
 
-    // Verifica PSRAM disponibile
+    // Backend dei giorni salvati: serve a indice e caricamento di oggi
+    const history_backend_t* backend = history_backend_get();
+    esp_err_t ret = backend->init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "History backend %s not available: %s",
+                 backend->name, esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Verifica PSRAM disponibile: buffer attivo, giorno concluso e copia del writer
     size_t psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-    size_t required = HISTORY_SAMPLES_PER_DAY * sizeof(history_sample_t);
+    size_t set_size = HISTORY_SAMPLES_PER_DAY *
+                      (sizeof(history_sample_t) + sizeof(history_extremes_t));
+    size_t required = 3 * set_size;
 
     ESP_LOGI(TAG, "PSRAM free: %u bytes, required: %u bytes", psram_free, required);
 
@@ -122,16 +511,50 @@ esp_err_t history_init(void)
         return ESP_ERR_NO_MEM;
     }
 
+    s_mutex = xSemaphoreCreateMutex();
+    s_io_mutex = xSemaphoreCreateMutex();
+    if (s_mutex == NULL || s_io_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
     // Alloca buffer in PSRAM
-    s_buffer.samples = (history_sample_t*)heap_caps_malloc(
-        required, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    uint8_t* mem = (uint8_t*)heap_caps_malloc(required, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
 
-    if (s_buffer.samples == NULL) {
+    if (mem == NULL) {
         ESP_LOGE(TAG, "Failed to allocate PSRAM buffer!");
         return ESP_ERR_NO_MEM;
     }
 
-    ESP_LOGI(TAG, "Allocated %u bytes in PSRAM at %p", required, s_buffer.samples);
+    // Per ogni buffer gli estremi seguono i sample
+    history_buffer_t* sets[3] = { &s_buffer, &s_closing, &s_snap };
+    for (int i = 0; i < 3; i++) {
+        sets[i]->samples = (history_sample_t*)(mem + i * set_size);
+        sets[i]->extremes = (history_extremes_t*)&sets[i]->samples[HISTORY_SAMPLES_PER_DAY];
+    }
+
+    ESP_LOGI(TAG, "Allocated %u bytes in PSRAM at %p", required, mem);
+
+    clear_arrays(s_closing.samples, s_closing.extremes);
+    s_closing_state = CLOSING_CLEAN;
+
+    metrics_register("history_flush_duration_seconds", "Daily log flush to SPIFFS",
+                     NULL, METRIC_HISTOGRAM, &s_flush_latency);
+    metrics_register("history_flush_errors_total", "Failed daily log flushes",
+                     NULL, METRIC_COUNTER, &s_flush_errors);
+    metrics_register("history_backfilled_minutes_total", "Missed minutes filled by interpolation",
+                     NULL, METRIC_COUNTER, &s_backfilled_minutes);
+    metrics_register("history_missed_minutes_total", "Missed minutes left without a sample",
+                     NULL, METRIC_COUNTER, &s_missed_minutes);
+    metrics_register("history_day_swap_deferred_total", "Minutes a day change waited for the previous day buffer",
+                     NULL, METRIC_COUNTER, &s_swap_deferrals);
+
+    // Journal RTC: va verificato prima di qualsiasi history_record()
+    history_journal_init();
+
+    // Indice annuale dei giorni (non bloccante: senza indice /api/log/list è vuota)
+    if (history_index_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Day index not available");
+    }
 
     // Inizializza per la data corrente
     uint16_t year;
@@ -139,7 +562,7 @@ esp_err_t history_init(void)
     get_current_date(&year, &month, &day);
 
     // Prova a caricare dati esistenti per oggi
-    esp_err_t ret = history_load_from_file(year, month, day);
+    ret = history_load_from_file(year, month, day);
 
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "Loaded existing data for %04d-%02d-%02d (%d samples)",
@@ -154,6 +577,15 @@ esp_err_t history_init(void)
 
     s_buffer.initialized = true;
 
+    // Minuti registrati prima di un reset e non ancora salvati
+    seqlock_write_begin(&s_buffer_seq);
+    replay_journal();
+    seqlock_write_end(&s_buffer_seq);
+
+    if (esp_register_shutdown_handler(shutdown_handler) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to register shutdown handler");
+    }
+
     ESP_LOGI(TAG, "History manager initialized successfully");
     return ESP_OK;
 }
@@ -162,19 +594,31 @@ void history_deinit(void)
 {
     if (s_buffer.samples != NULL) {
         // Salva eventuali dati non salvati
-        if (s_buffer.dirty) {
-            history_save_to_file();
-        }
+        day_end_job();
+        history_save_to_file();
+
+        // Unica allocazione: la inizia il set con l'indirizzo più basso
+        history_sample_t* base = s_buffer.samples;
+        if (s_closing.samples < base) base = s_closing.samples;
+        if (s_snap.samples < base) base = s_snap.samples;
+        heap_caps_free(base);
 
-        heap_caps_free(s_buffer.samples);
         s_buffer.samples = NULL;
+        s_buffer.extremes = NULL;
+        s_closing.samples = NULL;
+        s_closing.extremes = NULL;
+        s_snap.samples = NULL;
+        s_snap.extremes = NULL;
     }
 
     s_buffer.initialized = false;
     ESP_LOGI(TAG, "History manager deinitialized");
 }
 
-esp_err_t history_add_sample(const history_sample_t* sample)
+/**
+ * @brief Corpo di history_add_sample(), chiamato con il lock
+ */
+static esp_err_t add_sample(const history_sample_t* sample)
 {
     if (!s_buffer.initialized || s_buffer.samples == NULL) {
         return ESP_ERR_INVALID_STATE;
@@ -184,8 +628,16 @@ esp_err_t history_add_sample(const history_sample_t* sample)
         return ESP_ERR_INVALID_ARG;
     }
 
-    // Copia sample nel buffer
-    memcpy(&s_buffer.samples[sample->minute_of_day], sample, sizeof(history_sample_t));
+    // Aggregati: togli il valore sovrascritto e aggiungi il nuovo
+    history_sample_t* slot = &s_buffer.samples[sample->minute_of_day];
+    if (history_stats_replace(&s_stats, slot, sample)) {
+        s_stats_extremes_stale = true;  // Il minuto deteneva un estremo
+    }
+
+    // Copia sample nel buffer; estremi sconosciuti salvo history_record()
+    memcpy(slot, sample, sizeof(history_sample_t));
+    s_buffer.extremes[sample->minute_of_day].below = HISTORY_EXT_UNKNOWN;
+    s_buffer.extremes[sample->minute_of_day].above = HISTORY_EXT_UNKNOWN;
 
     // Aggiorna contatore sample
     if (sample->minute_of_day >= s_buffer.header.num_samples) {
@@ -193,112 +645,358 @@ esp_err_t history_add_sample(const history_sample_t* sample)
     }
 
     s_buffer.current_minute = sample->minute_of_day;
+
+    // Traccia il primo minuto modificato per decidere append vs riscrittura
+    if (sample->minute_of_day < s_buffer.dirty_from) {
+        s_buffer.dirty_from = sample->minute_of_day;
+    }
     s_buffer.dirty = true;
+    history_rollup_mark(sample->minute_of_day);
 
     return ESP_OK;
 }
 
-esp_err_t history_record(float temperature, uint8_t humidity, uint16_t pressure,
-                         float setpoint, bool relay_on, bool manual_mode,
-                         uint8_t active_bank)
+esp_err_t history_add_sample(const history_sample_t* sample)
+{
+    lock();
+    seqlock_write_begin(&s_buffer_seq);
+    esp_err_t ret = add_sample(sample);
+    seqlock_write_end(&s_buffer_seq);
+    unlock();
+    return ret;
+}
+
+/**
+ * @brief Colma i minuti mancati tra l'ultimo sample del giorno e next
+ *
+ * Interpolazione lineare di temperatura, umidità e pressione; setpoint,
+ * banco e flag dal sample precedente, più HISTORY_FLAG_BACKFILLED.
+ */
+static void backfill_gap(const history_sample_t* next)
 {
-    // Controlla cambio giorno prima di registrare
-    history_check_day_change();
+    uint16_t first = s_buffer.header.num_samples;      // Primo minuto mancante
+    if (first == 0 || next->minute_of_day <= first) {
+        return;
+    }
 
-    uint16_t minute = get_current_minute_of_day();
+    uint16_t missing = next->minute_of_day - first;
+    history_sample_t prev = s_buffer.samples[first - 1];
 
-    history_sample_t sample;
-    sample.minute_of_day = minute;
-    sample.temperature = (int16_t)(temperature * 100);
-    sample.humidity = humidity;
-    sample.pressure = pressure;
-    sample.setpoint = (int16_t)(setpoint * 100);
-    sample.active_bank = active_bank;
-    sample.reserved = 0;
+    if (missing > HISTORY_MAX_BACKFILL || prev.temperature == -32768) {
+        ESP_LOGW(TAG, "%u minutes missing before %02u:%02u, left empty",
+                 missing, next->minute_of_day / 60, next->minute_of_day % 60);
+        metrics_counter_add(&s_missed_minutes, missing);
+        return;
+    }
 
-    // Costruisci flags
-    sample.flags = 0;
-    if (relay_on) sample.flags |= HISTORY_FLAG_RELAY_ON;
-    if (manual_mode) sample.flags |= HISTORY_FLAG_MANUAL_MODE;
+    int32_t span = missing + 1;
+    for (int32_t i = 1; i <= missing; i++) {
+        history_sample_t fill = prev;
+        fill.minute_of_day = first - 1 + i;
+        fill.temperature = prev.temperature + (next->temperature - prev.temperature) * i / span;
+        fill.humidity = prev.humidity + (next->humidity - prev.humidity) * i / span;
+        fill.pressure = prev.pressure + ((int32_t)next->pressure - prev.pressure) * i / span;
+        fill.flags = prev.flags | HISTORY_FLAG_BACKFILLED;
+        if (add_sample(&fill) == ESP_OK) {
+            journal_minute(fill.minute_of_day);
+        }
+    }
 
-    return history_add_sample(&sample);
+    metrics_counter_add(&s_backfilled_minutes, missing);
+    ESP_LOGW(TAG, "Backfilled %u missed minutes before %02u:%02u",
+             missing, next->minute_of_day / 60, next->minute_of_day % 60);
 }
 
-bool history_check_day_change(void)
+/**
+ * @brief Distanza di un estremo dalla media, saturata a HISTORY_EXT_MAX_DELTA
+ */
+static uint8_t extreme_delta(int32_t delta)
+{
+    if (delta < 0) {
+        return 0;
+    }
+    return delta > HISTORY_EXT_MAX_DELTA ? HISTORY_EXT_MAX_DELTA : (uint8_t)delta;
+}
+
+/**
+ * @brief Passa al giorno indicato se il buffer è di un giorno precedente
+ *        (con il lock, senza I/O)
+ *
+ * Gli array del giorno concluso vengono scambiati con quelli di s_closing,
+ * già svuotati dal writer: O(1). Il giorno concluso viene scritto dal task
+ * writer e resta leggibile con history_acquire_day(true).
+ *
+ * Se s_closing non è ancora libero (il writer non ha scritto il giorno
+ * prima, o qualcuno lo sta leggendo) il cambio viene rimandato: il buffer
+ * resta sul giorno concluso e history_record() mette i minuti del nuovo
+ * giorno solo nel journal, da cui vengono recuperati al cambio effettivo.
+ * Dopo HISTORY_DAY_SWAP_MAX_DEFER minuti il giorno concluso viene perso.
+ *
+ * @param year, month, day Giorno del minuto da registrare
+ * @param post_day_end Impostato se va accodato day_end_job()
+ * @return true se è avvenuto un cambio giorno
+ */
+static bool check_day_change(uint16_t year, uint8_t month, uint8_t day, bool* post_day_end)
 {
+    *post_day_end = false;
+
     if (!s_buffer.initialized) {
         return false;
     }
 
-    if (is_buffer_for_today()) {
+    if (compare_buffer_date(year, month, day) >= 0) {
+        return false;
+    }
+
+    // Array di s_closing riutilizzabili: vuoti, oppure scritti e senza lettori
+    bool swappable = s_closing_readers == 0 &&
+                     (s_closing_state == CLOSING_CLEAN || s_closing_state == CLOSING_WRITTEN);
+    bool cleared = true;
+
+    if (s_buffer.header.num_samples > 0 && !swappable &&
+        s_swap_deferred < HISTORY_DAY_SWAP_MAX_DEFER) {
+        if (s_swap_deferred == 0) {
+            ESP_LOGW(TAG, "Previous day buffer busy, day change of %04d-%02d-%02d deferred",
+                     s_buffer.header.year, s_buffer.header.month, s_buffer.header.day);
+        }
+        s_swap_deferred++;
+        metrics_counter_inc(&s_swap_deferrals);
         return false;
     }
 
     // Il giorno è cambiato!
     ESP_LOGI(TAG, "Day change detected!");
 
-    // Salva buffer corrente
-    if (s_buffer.dirty && s_buffer.header.num_samples > 0) {
-        ESP_LOGI(TAG, "Saving previous day data (%d samples)...",
-                 s_buffer.header.num_samples);
-        history_save_to_file();
+    if (s_buffer.header.num_samples == 0) {
+        cleared = false;        // Nessun dato: si riusa il buffer attivo
+    } else if (!swappable) {
+        // Il writer è bloccato da troppo tempo (flash guasta) o il giorno
+        // prima è ancora in lettura: il giorno appena concluso va perso
+        ESP_LOGE(TAG, "Previous day buffer busy for %u minutes, %04d-%02d-%02d not saved",
+                 s_swap_deferred, s_buffer.header.year, s_buffer.header.month,
+                 s_buffer.header.day);
+        metrics_counter_inc(&s_flush_errors);
+        cleared = false;
+    } else {
+        history_sample_t* samples = s_closing.samples;
+        history_extremes_t* extremes = s_closing.extremes;
+        cleared = (s_closing_state == CLOSING_CLEAN);
+
+        s_closing = s_buffer;
+        s_closing_codec = s_codec;
+        s_closing_dirty_hours = history_rollup_take_dirty();
+        s_closing_state = CLOSING_PENDING;
+
+        // Chi stava leggendo oggi ora legge il giorno concluso
+        s_closing_readers = s_today_readers;
+        s_today_readers = 0;
+
+        s_buffer.samples = samples;
+        s_buffer.extremes = extremes;
+        *post_day_end = true;
     }
 
-    // Inizializza per il nuovo giorno
-    uint16_t year;
-    uint8_t month, day;
-    get_current_date(&year, &month, &day);
+    if (s_swap_deferred > 0) {
+        ESP_LOGI(TAG, "Day change completed after %u deferred minutes", s_swap_deferred);
+        s_swap_deferred = 0;
+    }
 
+    // Inizializza per il nuovo giorno
     ESP_LOGI(TAG, "Initializing buffer for new day: %04d-%02d-%02d",
              year, month, day);
 
     init_header_for_date(year, month, day);
-    clear_samples();
+    if (cleared) {
+        reset_day_state();
+    } else {
+        clear_samples();
+    }
+
+    // Data arrivata con l'NTP dopo il boot, o minuti registrati mentre il
+    // cambio era rimandato: il journal può avere minuti di oggi
+    replay_journal();
 
     return true;
 }
 
-esp_err_t history_save_to_file(void)
+/**
+ * @brief Accoda il salvataggio del giorno concluso
+ *
+ * Chiamata a ogni minuto finché il giorno è pending: riprova dopo una coda
+ * piena o un flush fallito; se il job è già in coda la richiesta si fonde.
+ */
+static void post_day_end(void)
+{
+    if (storage_writer_post(day_end_job, "history_day_end") != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to queue previous day save, retrying next minute");
+    }
+}
+
+esp_err_t history_record(const history_minute_t* minute_values, float setpoint,
+                         bool relay_on, bool manual_mode, uint8_t active_bank)
 {
     if (!s_buffer.initialized || s_buffer.samples == NULL) {
         return ESP_ERR_INVALID_STATE;
     }
 
-    char filename[32];
-    history_get_filename(s_buffer.header.year, s_buffer.header.month,
-                         s_buffer.header.day, filename, sizeof(filename));
+    lock();
+    // Cambio giorno, minuti colmati e nuovo sample in un'unica versione
+    seqlock_write_begin(&s_buffer_seq);
+
+    // Giorno e posizione dal minuto aggregato, non dall'ora corrente:
+    // il sample delle 23:59 arriva alle 00:00 e va ancora nel giorno concluso
+    uint16_t year, minute;
+    uint8_t month, day;
+    minute_aggregator_slot(minute_values->epoch_minute, &year, &month, &day, &minute);
+
+    // Cambio giorno solo con il primo minuto del giorno nuovo
+    bool day_end;
+    check_day_change(year, month, day, &day_end);
+
+    // Giorno concluso non ancora scritto (coda piena, flush fallito): riprova
+    day_end = day_end || s_closing_state == CLOSING_PENDING;
+
+    // Cambio giorno rimandato: il buffer è ancora quello di ieri
+    int order = compare_buffer_date(year, month, day);
+    bool deferred = order < 0;
+
+    // Orologio tornato indietro (salto NTP): il minuto ha già il suo sample,
+    // oppure è di un giorno già chiuso
+    if (order > 0 ||
+        (!deferred && minute < s_buffer.header.num_samples &&
+         s_buffer.samples[minute].temperature != -32768)) {
+        seqlock_write_end(&s_buffer_seq);
+        unlock();
+        if (day_end) {
+            post_day_end();
+        }
+        ESP_LOGW(TAG, "Minute %04u-%02u-%02u %02u:%02u already recorded, skipped",
+                 year, month, day, minute / 60, minute % 60);
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    ESP_LOGI(TAG, "Saving to %s (%d samples)...", filename, s_buffer.header.num_samples);
+    history_sample_t sample;
+    sample.minute_of_day = minute;
+    sample.temperature = minute_values->temperature;
+    sample.humidity = minute_values->humidity;
+    sample.pressure = minute_values->pressure;
+    sample.setpoint = (int16_t)(setpoint * 100);
+    sample.active_bank = active_bank;
+    sample.reserved = 0;
 
-    FILE* f = fopen(filename, "wb");
-    if (f == NULL) {
-        ESP_LOGE(TAG, "Failed to open %s for writing", filename);
-        return ESP_FAIL;
+    // Costruisci flags
+    sample.flags = 0;
+    if (relay_on) sample.flags |= HISTORY_FLAG_RELAY_ON;
+    if (manual_mode) sample.flags |= HISTORY_FLAG_MANUAL_MODE;
+
+    history_extremes_t extremes;
+    extremes.below = extreme_delta(sample.temperature - minute_values->t_min);
+    extremes.above = extreme_delta(minute_values->t_max - sample.temperature);
+
+    esp_err_t ret;
+    if (deferred) {
+        // Solo nel journal: replay_journal() lo recupera al cambio giorno
+        history_journal_append(year, month, day, &sample, &extremes);
+        ret = ESP_ERR_NOT_FINISHED;
+    } else {
+        backfill_gap(&sample);
+
+        ret = add_sample(&sample);
+        if (ret == ESP_OK) {
+            s_buffer.extremes[minute] = extremes;
+            journal_minute(minute);
+        }
+    }
+
+    seqlock_write_end(&s_buffer_seq);
+    unlock();
+
+    // Accodato fuori dal lock: senza task writer il job gira qui
+    if (day_end) {
+        post_day_end();
+    }
+    return ret;
+}
+
+bool history_check_day_change(void)
+{
+    bool day_end;
+
+    uint16_t year;
+    uint8_t month, day;
+    get_current_date(&year, &month, &day);
+
+    lock();
+    seqlock_write_begin(&s_buffer_seq);
+    bool changed = check_day_change(year, month, day, &day_end);
+    seqlock_write_end(&s_buffer_seq);
+    unlock();
+
+    if (day_end) {
+        post_day_end();
     }
+    return changed;
+}
 
-    // Scrivi header
-    size_t written = fwrite(&s_buffer.header, 1, sizeof(history_header_t), f);
-    if (written != sizeof(history_header_t)) {
-        ESP_LOGE(TAG, "Failed to write header");
-        fclose(f);
-        return ESP_FAIL;
+esp_err_t history_save_to_file(void)
+{
+    if (!s_buffer.initialized || s_buffer.samples == NULL) {
+        return ESP_ERR_INVALID_STATE;
     }
 
-    // Scrivi tutti i sample (anche quelli vuoti, per mantenere offset fissi)
-    written = fwrite(s_buffer.samples, sizeof(history_sample_t),
-                     HISTORY_SAMPLES_PER_DAY, f);
-    if (written != HISTORY_SAMPLES_PER_DAY) {
-        ESP_LOGE(TAG, "Failed to write samples (wrote %d of %d)",
-                 written, HISTORY_SAMPLES_PER_DAY);
-        fclose(f);
-        return ESP_FAIL;
+    xSemaphoreTake(s_io_mutex, portMAX_DELAY);
+
+    // Copia del buffer sotto lock (pochi µs), scrittura senza lock
+    lock();
+
+    if (!s_buffer.dirty && s_buffer.persisted_samples == s_buffer.header.num_samples) {
+        unlock();
+        xSemaphoreGive(s_io_mutex);
+        ESP_LOGD(TAG, "Nothing to save");
+        return ESP_OK;
     }
 
-    fclose(f);
+    history_sample_t* samples = s_snap.samples;
+    history_extremes_t* extremes = s_snap.extremes;
+    s_snap = s_buffer;
+    s_snap.samples = samples;
+    s_snap.extremes = extremes;
+    memcpy(s_snap.samples, s_buffer.samples, HISTORY_SAMPLES_PER_DAY * sizeof(history_sample_t));
+    memcpy(s_snap.extremes, s_buffer.extremes, HISTORY_SAMPLES_PER_DAY * sizeof(history_extremes_t));
+    s_snap_codec = s_codec;
+    uint32_t dirty_hours = history_rollup_take_dirty();
+
+    // Le modifiche da qui in poi finiscono nel flush successivo
+    s_buffer.dirty_from = HISTORY_SAMPLES_PER_DAY;
     s_buffer.dirty = false;
 
-    ESP_LOGI(TAG, "Saved %d bytes to %s", HISTORY_FILE_SIZE, filename);
-    return ESP_OK;
+    unlock();
+
+    bool rollup_ok;
+    esp_err_t ret = flush_buffer(&s_snap, &s_snap_codec, dirty_hours, &rollup_ok);
+
+    lock();
+    if (same_day(&s_buffer, &s_snap)) {
+        commit_flush(&s_buffer, &s_codec, &s_snap, &s_snap_codec, ret);
+        if (!rollup_ok) {
+            history_rollup_restore_dirty(dirty_hours);
+        }
+    } else if (s_closing_state == CLOSING_PENDING && same_day(&s_closing, &s_snap)) {
+        // Giorno cambiato durante la scrittura: il flush vale per s_closing
+        commit_flush(&s_closing, &s_closing_codec, &s_snap, &s_snap_codec, ret);
+        if (!rollup_ok) {
+            s_closing_dirty_hours |= dirty_hours;
+        }
+    }
+    unlock();
+
+    xSemaphoreGive(s_io_mutex);
+    return ret;
+}
+
+esp_err_t history_request_save(void)
+{
+    return storage_writer_post(history_save_to_file, "history_save");
 }
 
 esp_err_t history_load_from_file(uint16_t year, uint8_t month, uint8_t day)
@@ -310,45 +1008,50 @@ esp_err_t history_load_from_file(uint16_t year, uint8_t month, uint8_t day)
     char filename[32];
     history_get_filename(year, month, day, filename, sizeof(filename));
 
-    FILE* f = fopen(filename, "rb");
-    if (f == NULL) {
-        ESP_LOGD(TAG, "File %s not found", filename);
-        return ESP_ERR_NOT_FOUND;
+    history_reader_t reader;
+    esp_err_t ret = history_reader_open(&reader, year, month, day);
+    if (ret != ESP_OK) {
+        return ret;
     }
 
-    // Leggi header
-    size_t read = fread(&s_buffer.header, 1, sizeof(history_header_t), f);
-    if (read != sizeof(history_header_t)) {
-        ESP_LOGE(TAG, "Failed to read header");
-        fclose(f);
-        return ESP_FAIL;
+    clear_samples();
+    s_buffer.header = reader.header;
+
+    // Leggi solo i sample committati (num_samples): eventuali record oltre
+    // sono residui di un append interrotto
+    uint16_t read = 0;
+    while (read < HISTORY_SAMPLES_PER_DAY &&
+           (ret = history_reader_next(&reader, &s_buffer.samples[read])) == ESP_OK) {
+        read++;
     }
 
-    // Verifica magic
-    if (memcmp(s_buffer.header.magic, HISTORY_MAGIC, 4) != 0) {
-        ESP_LOGE(TAG, "Invalid magic number in %s", filename);
-        fclose(f);
-        return ESP_ERR_INVALID_VERSION;
+    if (ret == ESP_FAIL) {
+        ESP_LOGW(TAG, "Partial file: read %d of %d samples", read, reader.header.num_samples);
+        // Non è un errore fatale, i sample mancanti restano invalidi
     }
 
-    // Verifica versione
-    if (s_buffer.header.version != HISTORY_VERSION) {
-        ESP_LOGW(TAG, "Version mismatch: file=%d, expected=%d",
-                 s_buffer.header.version, HISTORY_VERSION);
-    }
+    s_buffer.persisted_samples = read;
+    s_buffer.persisted_bytes = reader.offset;
+    s_codec = reader.codec;
+    s_buffer.dirty = false;
 
-    // Leggi sample
-    read = fread(s_buffer.samples, sizeof(history_sample_t),
-                 HISTORY_SAMPLES_PER_DAY, f);
+    history_reader_close(&reader);
 
-    fclose(f);
+    history_backend_get()->read_extremes(year, month, day, s_buffer.extremes);
 
-    if (read != HISTORY_SAMPLES_PER_DAY) {
-        ESP_LOGW(TAG, "Partial file: read %d of %d samples", read, HISTORY_SAMPLES_PER_DAY);
-        // Non è un errore fatale, potrebbe essere un file parziale
+    // Ricalcola tutti gli aggregati del giorno al prossimo salvataggio
+    for (int h = 0; h < ROLLUP_HOURS_PER_DAY; h++) {
+        history_rollup_mark(h * 60);
     }
 
-    s_buffer.dirty = false;
+    // I file v1 vengono convertiti al primo salvataggio
+    if (s_buffer.header.version != HISTORY_VERSION) {
+        ESP_LOGI(TAG, "Converting %s from v%d to v%d on next save",
+                 filename, s_buffer.header.version, HISTORY_VERSION);
+        s_buffer.header.version = HISTORY_VERSION;
+        s_buffer.persisted_samples = 0;
+        s_buffer.dirty = true;
+    }
 
     // Ottieni minuto corrente del giorno
     uint16_t current_minute = get_current_minute_of_day();
@@ -358,11 +1061,9 @@ esp_err_t history_load_from_file(uint16_t year, uint8_t month, uint8_t day)
     uint16_t invalidated = 0;
     for (int i = current_minute + 1; i < HISTORY_SAMPLES_PER_DAY; i++) {
         if (s_buffer.samples[i].temperature != -32768) {
-            s_buffer.samples[i].temperature = -32768;
-            s_buffer.samples[i].humidity = 255;
-            s_buffer.samples[i].setpoint = -32768;
-            s_buffer.samples[i].pressure = 0;
-            s_buffer.samples[i].flags = 0;
+            tlog2_make_empty(&s_buffer.samples[i], i);
+            s_buffer.extremes[i].below = HISTORY_EXT_UNKNOWN;
+            s_buffer.extremes[i].above = HISTORY_EXT_UNKNOWN;
             invalidated++;
         }
     }
@@ -371,8 +1072,12 @@ esp_err_t history_load_from_file(uint16_t year, uint8_t month, uint8_t day)
         ESP_LOGW(TAG, "Invalidated %d future samples (after minute %d)",
                  invalidated, current_minute);
         s_buffer.dirty = true;  // Marcato per salvataggio
+        s_buffer.dirty_from = current_minute + 1;  // Forza riscrittura completa
     }
 
+    history_stats_rebuild(&s_stats, s_buffer.samples, HISTORY_SAMPLES_PER_DAY);
+    s_stats_extremes_stale = false;
+
     // Ricalcola num_samples basandosi sui dati validi fino a current_minute
     s_buffer.header.num_samples = 0;
     for (int i = 0; i <= current_minute; i++) {
@@ -396,6 +1101,23 @@ esp_err_t history_load_from_file(uint16_t year, uint8_t month, uint8_t day)
     return ESP_OK;
 }
 
+esp_err_t history_reader_open(history_reader_t* reader,
+                              uint16_t year, uint8_t month, uint8_t day)
+{
+    memset(reader, 0, sizeof(history_reader_t));
+    return history_backend_get()->reader_open(reader, year, month, day);
+}
+
+esp_err_t history_reader_next(history_reader_t* reader, history_sample_t* sample)
+{
+    return history_backend_get()->reader_next(reader, sample);
+}
+
+void history_reader_close(history_reader_t* reader)
+{
+    history_backend_get()->reader_close(reader);
+}
+
 const history_buffer_t* history_get_buffer(void)
 {
     if (!s_buffer.initialized) {
@@ -404,6 +1126,55 @@ const history_buffer_t* history_get_buffer(void)
     return &s_buffer;
 }
 
+esp_err_t history_acquire_day(bool previous, history_buffer_t* view)
+{
+    const history_buffer_t* b = NULL;
+
+    lock();
+    if (!s_buffer.initialized) {
+        b = NULL;
+    } else if (!previous) {
+        b = &s_buffer;
+    } else if (s_closing_state == CLOSING_PENDING || s_closing_state == CLOSING_WRITTEN) {
+        b = &s_closing;
+    }
+    if (b != NULL) {
+        *view = *b;
+        if (b == &s_buffer) {
+            s_today_readers++;
+        } else {
+            s_closing_readers++;
+        }
+    }
+    unlock();
+
+    if (b == NULL) {
+        return s_buffer.initialized ? ESP_ERR_NOT_FOUND : ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+void history_release_day(const history_buffer_t* view)
+{
+    bool clear = false;
+
+    lock();
+    // Gli array dicono quale giorno è: oggi può essere diventato ieri nel frattempo
+    if (view->samples == s_closing.samples) {
+        if (s_closing_readers > 0 && --s_closing_readers == 0) {
+            clear = (s_closing_state == CLOSING_WRITTEN);
+        }
+    } else if (s_today_readers > 0) {
+        s_today_readers--;
+    }
+    unlock();
+
+    // Svuotamento rimandato perché il giorno era in lettura
+    if (clear) {
+        storage_writer_post(clear_closing_job, "history_clear_day");
+    }
+}
+
 esp_err_t history_get_sample(uint16_t minute_of_day, history_sample_t* sample)
 {
     if (!s_buffer.initialized || s_buffer.samples == NULL) {
@@ -418,7 +1189,11 @@ esp_err_t history_get_sample(uint16_t minute_of_day, history_sample_t* sample)
         return ESP_ERR_INVALID_ARG;
     }
 
-    memcpy(sample, &s_buffer.samples[minute_of_day], sizeof(history_sample_t));
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&s_buffer_seq);
+        memcpy(sample, &s_buffer.samples[minute_of_day], sizeof(history_sample_t));
+    } while (seqlock_read_retry(&s_buffer_seq, seq));
 
     // Verifica se il sample è valido
     if (sample->temperature == -32768) {
@@ -428,6 +1203,60 @@ esp_err_t history_get_sample(uint16_t minute_of_day, history_sample_t* sample)
     return ESP_OK;
 }
 
+esp_err_t history_get_extremes(uint16_t minute_of_day, int16_t* t_min, int16_t* t_max)
+{
+    if (!s_buffer.initialized || s_buffer.samples == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (minute_of_day >= HISTORY_SAMPLES_PER_DAY) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int16_t t;
+    history_extremes_t e;
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&s_buffer_seq);
+        t = s_buffer.samples[minute_of_day].temperature;
+        e = s_buffer.extremes[minute_of_day];
+    } while (seqlock_read_retry(&s_buffer_seq, seq));
+
+    if (t == -32768 || e.below == HISTORY_EXT_UNKNOWN || e.above == HISTORY_EXT_UNKNOWN) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (t_min) *t_min = t - e.below;
+    if (t_max) *t_max = t + e.above;
+    return ESP_OK;
+}
+
+esp_err_t history_read_samples(uint16_t from, uint16_t count,
+                               history_sample_t* samples, history_header_t* header)
+{
+    if (!s_buffer.initialized || s_buffer.samples == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (from > HISTORY_SAMPLES_PER_DAY || count > HISTORY_SAMPLES_PER_DAY - from ||
+        (count > 0 && samples == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&s_buffer_seq);
+        if (header != NULL) {
+            *header = s_buffer.header;
+        }
+        if (count > 0) {
+            memcpy(samples, &s_buffer.samples[from], count * sizeof(history_sample_t));
+        }
+    } while (seqlock_read_retry(&s_buffer_seq, seq));
+
+    return ESP_OK;
+}
+
 uint16_t history_get_sample_count(void)
 {
     if (!s_buffer.initialized) {
@@ -443,47 +1272,80 @@ void history_get_filename(uint16_t year, uint8_t month, uint8_t day,
              year, month, day);
 }
 
+void history_get_extremes_filename(uint16_t year, uint8_t month, uint8_t day,
+                                   char* buffer, size_t buffer_size)
+{
+    snprintf(buffer, buffer_size, "/spiffs/log_%04d%02d%02d.ext",
+             year, month, day);
+}
+
 bool history_file_exists(uint16_t year, uint8_t month, uint8_t day)
 {
-    char filename[32];
-    history_get_filename(year, month, day, filename, sizeof(filename));
+    return history_backend_get()->day_exists(year, month, day);
+}
+
+bool history_day_is_open(uint16_t year, uint8_t month, uint8_t day)
+{
+    uint16_t cur_year;
+    uint8_t cur_month, cur_day;
+    get_current_date(&cur_year, &cur_month, &cur_day);
+
+    uint32_t date = (uint32_t)year * 10000 + month * 100 + day;
+    if (date >= (uint32_t)cur_year * 10000 + cur_month * 100 + cur_day) {
+        return true;
+    }
+
+    history_header_t key = {};
+    key.year = year;
+    key.month = month;
+    key.day = day;
+
+    lock();
+    bool open = (s_buffer.initialized && same_date(&s_buffer.header, &key)) ||
+                (s_closing_state == CLOSING_PENDING && same_date(&s_closing.header, &key));
+    unlock();
+
+    return open;
+}
 
-    struct stat st;
-    return (stat(filename, &st) == 0);
+const history_backend_t* history_backend_get(void)
+{
+#if HISTORY_BACKEND_LOG
+    return &history_backend_log;
+#else
+    return &history_backend_spiffs;
+#endif
 }
 
 void history_get_stats(float* min_temp, float* max_temp, float* avg_temp,
                        uint16_t* heater_on_minutes)
 {
-    if (!s_buffer.initialized || s_buffer.samples == NULL) {
+    history_stats_t stats;
+    if (history_get_stats_ex(&stats) != ESP_OK) {
         return;
     }
 
-    float t_min = 100.0f;
-    float t_max = -100.0f;
-    float t_sum = 0.0f;
-    int t_count = 0;
-    uint16_t heater_count = 0;
-
-    for (int i = 0; i < HISTORY_SAMPLES_PER_DAY; i++) {
-        const history_sample_t* s = &s_buffer.samples[i];
+    bool valid = stats.count > 0;
 
-        if (s->temperature != -32768) {
-            float temp = s->temperature / 100.0f;
+    if (min_temp) *min_temp = valid ? stats.t_min / 100.0f : 0.0f;
+    if (max_temp) *max_temp = valid ? stats.t_max / 100.0f : 0.0f;
+    if (avg_temp) *avg_temp = valid ? (float)stats.t_sum / stats.count / 100.0f : 0.0f;
+    if (heater_on_minutes) *heater_on_minutes = stats.heater_on;
+}
 
-            if (temp < t_min) t_min = temp;
-            if (temp > t_max) t_max = temp;
-            t_sum += temp;
-            t_count++;
+esp_err_t history_get_stats_ex(history_stats_t* stats)
+{
+    if (!s_buffer.initialized || s_buffer.samples == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-            if (s->flags & HISTORY_FLAG_RELAY_ON) {
-                heater_count++;
-            }
-        }
+    lock();
+    if (s_stats_extremes_stale) {
+        history_stats_rescan_extremes(&s_stats, s_buffer.samples, HISTORY_SAMPLES_PER_DAY);
+        s_stats_extremes_stale = false;
     }
 
-    if (min_temp) *min_temp = (t_count > 0) ? t_min : 0.0f;
-    if (max_temp) *max_temp = (t_count > 0) ? t_max : 0.0f;
-    if (avg_temp) *avg_temp = (t_count > 0) ? (t_sum / t_count) : 0.0f;
-    if (heater_on_minutes) *heater_on_minutes = heater_count;
+    *stats = s_stats;
+    unlock();
+    return ESP_OK;
 }
@@ -0,0 +1,287 @@
+/**
+ * @file history_rollup.cpp
+ * @brief Implementazione aggregati orari/giornalieri in file mensili
+ */
+
+#include "history_rollup.h"
+
+#include "esp_log.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char* TAG = "ROLLUP";
+
+// Offset dei blocchi nel file mensile
+#define ROLLUP_DAILY_OFFSET     sizeof(rollup_header_t)
+#define ROLLUP_HOURLY_OFFSET    (ROLLUP_DAILY_OFFSET + ROLLUP_DAYS_PER_MONTH * sizeof(rollup_record_t))
+#define ROLLUP_FILE_SIZE        (ROLLUP_HOURLY_OFFSET + \
+                                 ROLLUP_DAYS_PER_MONTH * ROLLUP_HOURS_PER_DAY * sizeof(rollup_record_t))
+
+// ============================================================================
+// VARIABILI STATICHE
+// ============================================================================
+
+// Aggregati orari dell'ultimo giorno passato a history_rollup_flush() (task
+// writer); s_dirty_hours è aggiornata sotto il lock di history_manager
+static rollup_record_t s_hours[ROLLUP_HOURS_PER_DAY];
+static uint16_t s_hours_year = 0;                       // Giorno di s_hours
+static uint8_t s_hours_month = 0;
+static uint8_t s_hours_day = 0;
+static uint32_t s_dirty_hours = 0;                      // Bitmask ore da aggiornare
+
+#define ROLLUP_ALL_HOURS        ((1UL << ROLLUP_HOURS_PER_DAY) - 1)
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static void get_filename(uint16_t year, uint8_t month, char* buffer, size_t buffer_size)
+{
+    snprintf(buffer, buffer_size, "/spiffs/rollup_%04d%02d.bin", year, month);
+}
+
+/**
+ * @brief Calcola l'aggregato di un'ora dai sample del buffer
+ */
+static void compute_hour(const history_sample_t* samples, int hour, rollup_record_t* rec)
+{
+    history_rollup_clear(rec);
+
+    for (int i = hour * 60; i < (hour + 1) * 60; i++) {
+        const history_sample_t* s = &samples[i];
+
+        if (s->temperature == -32768) {
+            continue;
+        }
+
+        if (s->temperature < rec->t_min) rec->t_min = s->temperature;
+        if (s->temperature > rec->t_max) rec->t_max = s->temperature;
+        rec->t_sum += s->temperature;
+        rec->count++;
+
+        if (s->flags & HISTORY_FLAG_RELAY_ON) {
+            rec->heater_on++;
+        }
+        if (s->setpoint != -32768) {
+            rec->sp_err_sum += abs(s->temperature - s->setpoint);
+        }
+    }
+}
+
+/**
+ * @brief Apre il file del mese, creandolo vuoto se non esiste
+ */
+static FILE* open_month_file(uint16_t year, uint8_t month)
+{
+    char filename[40];
+    get_filename(year, month, filename, sizeof(filename));
+
+    FILE* f = fopen(filename, "r+b");
+    if (f != NULL) {
+        return f;
+    }
+
+    ESP_LOGI(TAG, "Creating %s (%u bytes)", filename, (unsigned int)ROLLUP_FILE_SIZE);
+
+    f = fopen(filename, "w+b");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Failed to create %s", filename);
+        return NULL;
+    }
+
+    rollup_header_t header;
+    memcpy(header.magic, ROLLUP_MAGIC, 4);
+    header.version = ROLLUP_VERSION;
+    header.month = month;
+    header.year = year;
+
+    rollup_record_t empty;
+    history_rollup_clear(&empty);
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    for (int i = 0; ok && i < ROLLUP_DAYS_PER_MONTH * (1 + ROLLUP_HOURS_PER_DAY); i++) {
+        ok = fwrite(&empty, sizeof(empty), 1, f) == 1;
+    }
+
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to initialize %s", filename);
+        fclose(f);
+        return NULL;
+    }
+
+    return f;
+}
+
+static bool write_record(FILE* f, size_t offset, const rollup_record_t* rec)
+{
+    return fseek(f, offset, SEEK_SET) == 0 &&
+           fwrite(rec, sizeof(rollup_record_t), 1, f) == 1;
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+void history_rollup_clear(rollup_record_t* rec)
+{
+    rec->t_min = INT16_MAX;
+    rec->t_max = INT16_MIN;
+    rec->t_sum = 0;
+    rec->count = 0;
+    rec->heater_on = 0;
+    rec->sp_err_sum = 0;
+}
+
+void history_rollup_combine(rollup_record_t* acc, const rollup_record_t* rec)
+{
+    if (rec->count == 0) {
+        return;
+    }
+
+    if (rec->t_min < acc->t_min) acc->t_min = rec->t_min;
+    if (rec->t_max > acc->t_max) acc->t_max = rec->t_max;
+    acc->t_sum += rec->t_sum;
+    acc->count += rec->count;
+    acc->heater_on += rec->heater_on;
+    acc->sp_err_sum += rec->sp_err_sum;
+}
+
+void history_rollup_reset(void)
+{
+    s_dirty_hours = 0;
+}
+
+void history_rollup_mark(uint16_t minute_of_day)
+{
+    if (minute_of_day < HISTORY_SAMPLES_PER_DAY) {
+        s_dirty_hours |= 1UL << (minute_of_day / 60);
+    }
+}
+
+uint32_t history_rollup_take_dirty(void)
+{
+    uint32_t dirty = s_dirty_hours;
+    s_dirty_hours = 0;
+    return dirty;
+}
+
+void history_rollup_restore_dirty(uint32_t dirty_hours)
+{
+    s_dirty_hours |= dirty_hours;
+}
+
+void history_rollup_get_day(rollup_record_t* day)
+{
+    history_rollup_clear(day);
+    for (int h = 0; h < ROLLUP_HOURS_PER_DAY; h++) {
+        history_rollup_combine(day, &s_hours[h]);
+    }
+}
+
+esp_err_t history_rollup_flush(const history_header_t* header, const history_sample_t* samples,
+                               uint32_t dirty_hours)
+{
+    if (header->day < 1 || header->day > ROLLUP_DAYS_PER_MONTH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Altro giorno rispetto alle ore in RAM: si ricalcolano tutte
+    if (header->year != s_hours_year || header->month != s_hours_month ||
+        header->day != s_hours_day) {
+        for (int h = 0; h < ROLLUP_HOURS_PER_DAY; h++) {
+            history_rollup_clear(&s_hours[h]);
+        }
+        s_hours_year = header->year;
+        s_hours_month = header->month;
+        s_hours_day = header->day;
+        dirty_hours = ROLLUP_ALL_HOURS;
+    }
+
+    if (dirty_hours == 0) {
+        return ESP_OK;
+    }
+
+    FILE* f = open_month_file(header->year, header->month);
+    if (f == NULL) {
+        return ESP_FAIL;
+    }
+
+    size_t day_idx = header->day - 1;
+    bool ok = true;
+    int written = 0;
+
+    for (int h = 0; ok && h < ROLLUP_HOURS_PER_DAY; h++) {
+        if ((dirty_hours & (1UL << h)) == 0) {
+            continue;
+        }
+
+        compute_hour(samples, h, &s_hours[h]);
+
+        size_t offset = ROLLUP_HOURLY_OFFSET +
+                        (day_idx * ROLLUP_HOURS_PER_DAY + h) * sizeof(rollup_record_t);
+        ok = write_record(f, offset, &s_hours[h]);
+        written++;
+    }
+
+    // Aggregato del giorno dalle 24 ore in RAM
+    rollup_record_t day;
+    history_rollup_get_day(&day);
+
+    if (ok) {
+        ok = write_record(f, ROLLUP_DAILY_OFFSET + day_idx * sizeof(rollup_record_t), &day);
+    }
+
+    fclose(f);
+
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to update rollup for %04d-%02d-%02d",
+                 header->year, header->month, header->day);
+        s_hours_year = 0;   // Al prossimo flush si ricalcola tutto
+        return ESP_FAIL;
+    }
+
+    ESP_LOGD(TAG, "Updated %d hours for %04d-%02d-%02d",
+             written, header->year, header->month, header->day);
+    return ESP_OK;
+}
+
+esp_err_t history_rollup_read(uint16_t year, uint8_t month, bool hourly, uint8_t day,
+                              rollup_record_t* records)
+{
+    if (hourly && (day < 1 || day > ROLLUP_DAYS_PER_MONTH)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char filename[40];
+    get_filename(year, month, filename, sizeof(filename));
+
+    FILE* f = fopen(filename, "rb");
+    if (f == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    rollup_header_t header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        memcmp(header.magic, ROLLUP_MAGIC, 4) != 0 ||
+        header.version != ROLLUP_VERSION) {
+        ESP_LOGE(TAG, "Invalid rollup file %s", filename);
+        fclose(f);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    size_t offset, count;
+    if (hourly) {
+        offset = ROLLUP_HOURLY_OFFSET + (day - 1) * ROLLUP_HOURS_PER_DAY * sizeof(rollup_record_t);
+        count = ROLLUP_HOURS_PER_DAY;
+    } else {
+        offset = ROLLUP_DAILY_OFFSET;
+        count = ROLLUP_DAYS_PER_MONTH;
+    }
+
+    bool ok = fseek(f, offset, SEEK_SET) == 0 &&
+              fread(records, sizeof(rollup_record_t), count, f) == count;
+    fclose(f);
+
+    return ok ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file history_stats.cpp
+ * @brief Implementazione aggregati incrementali della giornata
+ */
+
+#include "history_stats.h"
+
+#include <string.h>
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+void history_stats_reset(history_stats_t* stats)
+{
+    memset(stats, 0, sizeof(history_stats_t));
+    stats->t_min = INT16_MAX;
+    stats->t_max = INT16_MIN;
+}
+
+void history_stats_apply(history_stats_t* stats, const history_sample_t* sample, int sign)
+{
+    if (sample->temperature == -32768) {
+        return;
+    }
+
+    stats->count += sign;
+    stats->t_sum += sign * sample->temperature;
+
+    if (sample->flags & HISTORY_FLAG_RELAY_ON) {
+        stats->heater_on += sign;
+    }
+
+    if (sample->setpoint != -32768) {
+        int32_t err = sample->temperature - sample->setpoint;
+        stats->sp_count += sign;
+        stats->sp_err_sq_sum += sign * (int64_t)err * err;
+    }
+
+    if (sign > 0) {
+        if (sample->temperature < stats->t_min) stats->t_min = sample->temperature;
+        if (sample->temperature > stats->t_max) stats->t_max = sample->temperature;
+    }
+}
+
+bool history_stats_replace(history_stats_t* stats, const history_sample_t* old,
+                           const history_sample_t* sample)
+{
+    bool stale = old->temperature != -32768 && old->temperature != sample->temperature &&
+                 (old->temperature == stats->t_min || old->temperature == stats->t_max);
+
+    history_stats_apply(stats, old, -1);
+    history_stats_apply(stats, sample, 1);
+    return stale;
+}
+
+void history_stats_rescan_extremes(history_stats_t* stats, const history_sample_t* samples,
+                                   uint16_t count)
+{
+    stats->t_min = INT16_MAX;
+    stats->t_max = INT16_MIN;
+
+    for (uint16_t i = 0; i < count; i++) {
+        int16_t t = samples[i].temperature;
+        if (t == -32768) {
+            continue;
+        }
+        if (t < stats->t_min) stats->t_min = t;
+        if (t > stats->t_max) stats->t_max = t;
+    }
+}
+
+void history_stats_rebuild(history_stats_t* stats, const history_sample_t* samples,
+                           uint16_t count)
+{
+    history_stats_reset(stats);
+    for (uint16_t i = 0; i < count; i++) {
+        history_stats_apply(stats, &samples[i], 1);
+    }
+}
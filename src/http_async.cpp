@@ -0,0 +1,199 @@
+/**
+ * @file http_async.cpp
+ * @brief Implementazione pool di worker per handler HTTP lunghi
+ */
+
+#include "http_async.h"
+#include "http_server.h"
+#include "storage_manager.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <stdio.h>
+
+static const char* TAG = "HTTP_ASYNC";
+
+// ============================================================================
+// STRUTTURE PRIVATE
+// ============================================================================
+
+typedef struct {
+    httpd_req_t* req;                       // Copia da httpd_req_async_handler_begin
+    esp_err_t (*handler)(httpd_req_t* req);
+    http_async_storage_t storage;
+    int64_t start_us;                       // Accodamento (latenza in /metrics)
+} async_job_t;
+
+// ============================================================================
+// VARIABILI STATICHE
+// ============================================================================
+
+static QueueHandle_t s_queue = NULL;
+static TaskHandle_t s_workers[HTTP_ASYNC_WORKERS];
+static bool s_submitted = false;            // Solo task httpd: ultimo handler accodato
+static TaskHandle_t s_inline_task = NULL;   // Task httpd mentre esegue un handler senza worker
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+/**
+ * @brief Esegue handler con l'accesso a SPIFFS richiesto, 503 se occupato
+ */
+static esp_err_t run_handler(httpd_req_t* req, esp_err_t (*handler)(httpd_req_t* req),
+                             http_async_storage_t storage)
+{
+    bool acquired = true;
+
+    if (storage == HTTP_ASYNC_STORAGE_SHARED) {
+        acquired = storage_acquire(0);
+    } else if (storage == HTTP_ASYNC_STORAGE_EXCLUSIVE) {
+        acquired = storage_acquire_exclusive(HTTP_ASYNC_EXCLUSIVE_WAIT_MS);
+    }
+
+    if (!acquired) {
+        ESP_LOGW(TAG, "Storage busy, rejecting %s", req->uri);
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "5");
+        httpd_resp_sendstr(req, "Storage busy");
+        return ESP_OK;
+    }
+
+    esp_err_t ret = handler(req);
+
+    if (storage == HTTP_ASYNC_STORAGE_SHARED) {
+        storage_release();
+    } else if (storage == HTTP_ASYNC_STORAGE_EXCLUSIVE) {
+        storage_release_exclusive();
+    }
+    return ret;
+}
+
+/**
+ * @brief Esegue l'handler sul task httpd quando non può andare a un worker
+ *
+ * Durante l'esecuzione http_async_is_worker() risponde true, così l'handler
+ * non prova di nuovo ad accodarsi.
+ */
+static esp_err_t run_inline(httpd_req_t* req, esp_err_t (*handler)(httpd_req_t* req),
+                            http_async_storage_t storage)
+{
+    s_inline_task = xTaskGetCurrentTaskHandle();
+    esp_err_t ret = run_handler(req, handler, storage);
+    s_inline_task = NULL;
+    return ret;
+}
+
+static void worker_task(void* pvParameters)
+{
+    async_job_t job;
+
+    while (1) {
+        if (xQueueReceive(s_queue, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        esp_err_t ret = run_handler(job.req, job.handler, job.storage);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Async handler for %s failed: %s", job.req->uri, esp_err_to_name(ret));
+        }
+
+        http_request_done(job.req, ret, job.start_us);
+
+        // Restituisce il socket a httpd (chiuso se l'handler ha fallito)
+        httpd_req_async_handler_complete(job.req);
+    }
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+esp_err_t http_async_init(void)
+{
+    if (s_queue != NULL) {
+        return ESP_OK;
+    }
+
+    s_queue = xQueueCreate(HTTP_ASYNC_QUEUE_LEN, sizeof(async_job_t));
+    if (s_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < HTTP_ASYNC_WORKERS; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "http_async%d", i);
+
+        // Stack in RAM interna: gli handler accedono a SPIFFS (cache flash disabilitata)
+        if (xTaskCreate(worker_task, name, HTTP_ASYNC_STACK_SIZE, NULL,
+                        HTTP_ASYNC_PRIORITY, &s_workers[i]) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create worker %d", i);
+            s_workers[i] = NULL;
+        }
+    }
+
+    ESP_LOGI(TAG, "%d async workers started", HTTP_ASYNC_WORKERS);
+    return ESP_OK;
+}
+
+bool http_async_is_worker(void)
+{
+    TaskHandle_t current = xTaskGetCurrentTaskHandle();
+
+    if (s_inline_task != NULL && s_inline_task == current) {
+        return true;
+    }
+
+    for (int i = 0; i < HTTP_ASYNC_WORKERS; i++) {
+        if (s_workers[i] != NULL && s_workers[i] == current) {
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t http_async_submit(httpd_req_t *req, esp_err_t (*handler)(httpd_req_t *req))
+{
+    return http_async_submit_storage(req, handler, HTTP_ASYNC_STORAGE_SHARED);
+}
+
+esp_err_t http_async_submit_storage(httpd_req_t *req, esp_err_t (*handler)(httpd_req_t *req),
+                                    http_async_storage_t storage)
+{
+    // Senza worker l'handler gira sul task httpd come prima
+    if (s_queue == NULL) {
+        return run_inline(req, handler, storage);
+    }
+
+    httpd_req_t* copy = NULL;
+    esp_err_t ret = httpd_req_async_handler_begin(req, &copy);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "async_handler_begin failed: %s", esp_err_to_name(ret));
+        return run_inline(req, handler, storage);
+    }
+
+    async_job_t job = { .req = copy, .handler = handler, .storage = storage,
+                        .start_us = esp_timer_get_time() };
+    if (xQueueSend(s_queue, &job, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Workers busy, rejecting %s", req->uri);
+        httpd_req_async_handler_complete(copy);
+
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        httpd_resp_sendstr(req, "Server busy");
+        return ESP_OK;
+    }
+
+    s_submitted = true;
+    return ESP_OK;
+}
+
+bool http_async_take_submitted(void)
+{
+    bool submitted = s_submitted;
+    s_submitted = false;
+    return submitted;
+}
@@ -10,12 +10,24 @@
 #include "ota_handlers.h"
 #include "log_reader.h"
 #include "status_api.h"
+#include "history_index.h"
+#include "static_cache.h"
+#include "ws_session.h"
+#include "http_async.h"
+#include "metrics.h"
+#include "task_profiler.h"
+#include "trace.h"
 
 #include <string.h>
 #include <stdio.h>
+#include "sdkconfig.h"
 #include <esp_log.h>
 #include <esp_system.h>
 #include <esp_http_server.h>
+#include <esp_timer.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/select.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -23,6 +35,14 @@
 static const char *TAG = "HTTP_SERVER";
 static httpd_handle_t server = NULL;
 
+#define HTTP_MAX_ENDPOINTS  24      // Also the httpd max_uri_handlers
+#define HTTP_MAX_SOCKETS    (WS_MAX_SESSIONS + 5)   // Client WebSocket + richieste HTTP
+
+// httpd_start() fallisce se max_open_sockets supera i socket lwIP meno i 3
+// che usa internamente (ascolto, controllo e uno di riserva)
+static_assert(HTTP_MAX_SOCKETS <= CONFIG_LWIP_MAX_SOCKETS - 3,
+              "WS_MAX_SESSIONS too large for CONFIG_LWIP_MAX_SOCKETS");
+
 // ============================================================================
 // Helper Functions
 // ============================================================================
@@ -39,32 +59,366 @@ static inline const char* mime_from_path(const char* path) {
     return "application/octet-stream";
 }
 
+bool http_etag_matches(httpd_req_t *req, const char *etag) {
+    size_t len = httpd_req_get_hdr_value_len(req, "If-None-Match");
+    if (len == 0 || len >= 256) {
+        return false;
+    }
+
+    char value[256];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", value, len + 1) != ESP_OK) {
+        return false;
+    }
+
+    if (strcmp(value, "*") == 0) {
+        return true;
+    }
+
+    // Lista di ETag separati da virgola; per If-None-Match il prefisso W/ si ignora
+    size_t etag_len = strlen(etag);
+    const char *p = value;
+    while (p != NULL && *p != '\0') {
+        while (*p == ' ' || *p == ',') p++;
+        if (strncmp(p, "W/", 2) == 0) p += 2;
+
+        if (strncmp(p, etag, etag_len) == 0 &&
+            (p[etag_len] == '\0' || p[etag_len] == ',' || p[etag_len] == ' ')) {
+            return true;
+        }
+        p = strchr(p, ',');
+    }
+
+    return false;
+}
+
+esp_err_t http_send_not_modified(httpd_req_t *req, const char *etag, const char *cache_control) {
+    httpd_resp_set_status(req, "304 Not Modified");
+    httpd_resp_set_hdr(req, "ETag", etag);
+    if (cache_control != NULL) {
+        httpd_resp_set_hdr(req, "Cache-Control", cache_control);
+    }
+    return httpd_resp_send(req, NULL, 0);
+}
+
+// ============================================================================
+// Request Metrics
+// ============================================================================
+
+/**
+ * @brief Registered URI handler with its counters
+ *
+ * Endpoints are never freed: after a server restart the same URI and
+ * method find their previous slot, so /metrics keeps one series each.
+ */
+typedef struct {
+    char uri[32];
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *req);
+    void *user_ctx;
+    char labels[64];
+    metrics_counter_t requests;
+    metrics_counter_t errors;
+    metrics_counter_t bytes;
+    metrics_histogram_t latency;
+} http_endpoint_t;
+
+static http_endpoint_t endpoints[HTTP_MAX_ENDPOINTS];
+static int num_endpoints = 0;
+
+// Endpoint of the last request on each socket (for response bytes)
+static http_endpoint_t *fd_endpoint[FD_SETSIZE];
+
+static inline void set_fd_endpoint(int fd, http_endpoint_t *ep) {
+    if (fd >= 0 && fd < FD_SETSIZE) {
+        __atomic_store_n(&fd_endpoint[fd], ep, __ATOMIC_RELAXED);
+    }
+}
+
+static inline http_endpoint_t *get_fd_endpoint(int fd) {
+    if (fd < 0 || fd >= FD_SETSIZE) {
+        return NULL;
+    }
+    return __atomic_load_n(&fd_endpoint[fd], __ATOMIC_RELAXED);
+}
+
+static const char *method_name(httpd_method_t method) {
+    switch (method) {
+        case HTTP_GET:    return "GET";
+        case HTTP_POST:   return "POST";
+        case HTTP_PUT:    return "PUT";
+        case HTTP_DELETE: return "DELETE";
+        default:          return "OTHER";
+    }
+}
+
+static http_endpoint_t *find_or_add_endpoint(const httpd_uri_t *uri) {
+    for (int i = 0; i < num_endpoints; i++) {
+        if (endpoints[i].method == uri->method && strcmp(endpoints[i].uri, uri->uri) == 0) {
+            return &endpoints[i];
+        }
+    }
+
+    if (num_endpoints >= HTTP_MAX_ENDPOINTS) {
+        return NULL;
+    }
+
+    http_endpoint_t *ep = &endpoints[num_endpoints++];
+    snprintf(ep->uri, sizeof(ep->uri), "%s", uri->uri);
+    ep->method = uri->method;
+    snprintf(ep->labels, sizeof(ep->labels), "uri=\"%s\",method=\"%s\"",
+             ep->uri, method_name(ep->method));
+    ep->latency.bounds = metrics_latency_bounds_us;
+    ep->latency.num_bounds = METRICS_LATENCY_NUM_BOUNDS;
+
+    metrics_register("http_requests_total", "HTTP requests per handler",
+                     ep->labels, METRIC_COUNTER, &ep->requests);
+    metrics_register("http_request_errors_total", "HTTP handlers that returned an error",
+                     ep->labels, METRIC_COUNTER, &ep->errors);
+    metrics_register("http_response_bytes_total", "Bytes sent per handler",
+                     ep->labels, METRIC_COUNTER, &ep->bytes);
+    metrics_register("http_request_duration_seconds", "HTTP handler latency",
+                     ep->labels, METRIC_HISTOGRAM, &ep->latency);
+    return ep;
+}
+
+static void endpoint_done(http_endpoint_t *ep, esp_err_t ret, int64_t start_us) {
+    metrics_counter_inc(&ep->requests);
+    if (ret != ESP_OK) {
+        metrics_counter_inc(&ep->errors);
+    }
+    metrics_histogram_observe(&ep->latency, (uint32_t)(esp_timer_get_time() - start_us));
+}
+
+/**
+ * @brief Handler registered with httpd: times the real handler
+ */
+static esp_err_t instrumented_handler(httpd_req_t *req) {
+    http_endpoint_t *ep = (http_endpoint_t *)req->user_ctx;
+
+    set_fd_endpoint(httpd_req_to_sockfd(req), ep);
+    req->user_ctx = ep->user_ctx;
+
+    int64_t start_us = esp_timer_get_time();
+    TRACE_BEGIN(TRACE_HTTP_HANDLER, ep->uri);
+    esp_err_t ret = ep->handler(req);
+    TRACE_END(TRACE_HTTP_HANDLER, ep->uri);
+
+    // Request passed to a worker: recorded by http_request_done()
+    if (!http_async_take_submitted()) {
+        endpoint_done(ep, ret, start_us);
+    }
+    return ret;
+}
+
+/**
+ * @brief Socket send that counts response bytes per endpoint
+ *
+ * Same behaviour as the httpd default send function.
+ */
+static int counting_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags) {
+    (void)hd;
+    if (buf == NULL) {
+        return HTTPD_SOCK_ERR_INVALID;
+    }
+
+    int ret = send(sockfd, buf, buf_len, flags);
+    if (ret < 0) {
+        if (errno == EAGAIN || errno == EINTR) {
+            return HTTPD_SOCK_ERR_TIMEOUT;
+        }
+        if (errno == EINVAL || errno == EBADF || errno == EFAULT || errno == ENOTSOCK) {
+            return HTTPD_SOCK_ERR_INVALID;
+        }
+        return HTTPD_SOCK_ERR_FAIL;
+    }
+
+    http_endpoint_t *ep = get_fd_endpoint(sockfd);
+    if (ep != NULL) {
+        metrics_counter_add(&ep->bytes, (uint32_t)ret);
+    }
+    return ret;
+}
+
+static esp_err_t session_open(httpd_handle_t hd, int sockfd) {
+    set_fd_endpoint(sockfd, NULL);
+    httpd_sess_set_send_override(hd, sockfd, counting_send);
+    return ws_session_on_open(hd, sockfd);
+}
+
+static void session_close(httpd_handle_t hd, int sockfd) {
+    set_fd_endpoint(sockfd, NULL);
+    ws_session_on_close(hd, sockfd);
+}
+
+esp_err_t http_register_uri(httpd_handle_t hd, const httpd_uri_t *uri) {
+    http_endpoint_t *ep = find_or_add_endpoint(uri);
+    if (ep == NULL) {
+        ESP_LOGW(TAG, "No metrics slot for %s", uri->uri);
+        return httpd_register_uri_handler(hd, uri);
+    }
+
+    ep->handler = uri->handler;
+    ep->user_ctx = uri->user_ctx;
+
+    httpd_uri_t wrapped = *uri;
+    wrapped.handler = instrumented_handler;
+    wrapped.user_ctx = ep;
+    return httpd_register_uri_handler(hd, &wrapped);
+}
+
+void http_request_done(httpd_req_t *req, esp_err_t ret, int64_t start_us) {
+    http_endpoint_t *ep = get_fd_endpoint(httpd_req_to_sockfd(req));
+    if (ep != NULL) {
+        endpoint_done(ep, ret, start_us);
+    }
+}
+
 // ============================================================================
 // HTTP Handlers
 // ============================================================================
 
+/**
+ * @brief Check if the client accepts gzip content encoding
+ */
+static bool client_accepts_gzip(httpd_req_t *req) {
+    char value[128];
+    size_t len = httpd_req_get_hdr_value_len(req, "Accept-Encoding");
+    if (len == 0 || len >= sizeof(value)) {
+        return len >= sizeof(value);    // Header lungo: i browser includono sempre gzip
+    }
+    if (httpd_req_get_hdr_value_str(req, "Accept-Encoding", value, sizeof(value)) != ESP_OK) {
+        return false;
+    }
+    return strstr(value, "gzip") != NULL;
+}
+
+/**
+ * @brief Cache-Control for a static file
+ *
+ * Le pagine HTML si rivalidano sempre (cambiano con /api/upload),
+ * gli altri asset restano in cache una settimana.
+ */
+static const char* cache_control_for(const char* filepath) {
+    return strstr(filepath, ".html") ? "no-cache" : "public, max-age=604800";
+}
+
+/**
+ * @brief Send a file from the PSRAM cache with a single send call
+ */
+static esp_err_t send_cached_file(httpd_req_t *req, const char* filepath,
+                                  const static_cache_entry_t* entry, bool gzip, bool has_gz) {
+    if (!entry->present) {
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+
+    const char* cache_control = cache_control_for(filepath);
+
+    if (has_gz) {
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    }
+
+    if (http_etag_matches(req, entry->etag)) {
+        return http_send_not_modified(req, entry->etag, cache_control);
+    }
+
+    httpd_resp_set_type(req, mime_from_path(filepath));
+    httpd_resp_set_hdr(req, "ETag", entry->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", cache_control);
+    if (gzip) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    }
+
+    esp_err_t ret = httpd_resp_send(req, (const char*)entry->data, entry->size);
+    ESP_LOGD(TAG, "Served %s from cache (%u bytes%s)", filepath,
+             (unsigned int)entry->size, gzip ? ", gzip" : "");
+    return ret;
+}
+
 /**
  * @brief Serve file from SPIFFS
+ *
+ * If a precompressed "<file>.gz" exists (see compress_assets.py) and the
+ * client accepts gzip, the compressed variant is sent as-is. Files are
+ * served from the PSRAM cache when possible; files that cannot be cached
+ * are streamed from SPIFFS.
  */
-static esp_err_t serve_spiffs_file(httpd_req_t *req, const char* filepath) {
-    FILE *fd = fopen(filepath, "r");
-    if (!fd) {
+static esp_err_t send_spiffs_file(httpd_req_t *req, const char* filepath) {
+    char gz_path[528];
+    struct stat st;
+
+    snprintf(gz_path, sizeof(gz_path), "%s.gz", filepath);
+
+    // Prima la cache in PSRAM: nessun accesso a SPIFFS per i file già letti.
+    // Solo asset web: i file binari (log, indici) cambiano senza passare da qui
+    bool cacheable = strcmp(mime_from_path(filepath), "application/octet-stream") != 0;
+    static_cache_entry_t* gz_entry = cacheable ? static_cache_get(gz_path) : NULL;
+    if (gz_entry != NULL) {
+        bool has_gz = gz_entry->present;
+        bool gzip = has_gz && client_accepts_gzip(req);
+        static_cache_entry_t* entry = gzip ? gz_entry : static_cache_get(filepath);
+
+        if (entry != NULL) {
+            esp_err_t ret = send_cached_file(req, filepath, entry, gzip, has_gz);
+            if (entry != gz_entry) {
+                static_cache_release(entry);
+            }
+            static_cache_release(gz_entry);
+            return ret;
+        }
+        static_cache_release(gz_entry);
+    }
+
+    bool has_gz = (stat(gz_path, &st) == 0);
+    bool gzip = has_gz && client_accepts_gzip(req);
+    const char* path = gzip ? gz_path : filepath;
+
+    FILE *fd = fopen(path, "r");
+    if (!fd || (!gzip && stat(path, &st) != 0)) {
         ESP_LOGE(TAG, "Failed to open file: %s", filepath);
+        if (fd) fclose(fd);
         httpd_resp_send_404(req);
         return ESP_FAIL;
     }
 
-    // Get file size
-    fseek(fd, 0, SEEK_END);
-    long file_size = ftell(fd);
+    long file_size = st.st_size;
+
+    // ETag: per .gz CRC32 e dimensione originale dal trailer gzip (contenuto),
+    // altrimenti dimensione e data di modifica
+    char etag[32];
+    uint32_t trailer[2];
+    if (gzip && fseek(fd, -8, SEEK_END) == 0 && fread(trailer, 1, 8, fd) == 8) {
+        snprintf(etag, sizeof(etag), "\"gz-%08lx-%lx\"",
+                 (unsigned long)trailer[0], (unsigned long)trailer[1]);
+    } else {
+        snprintf(etag, sizeof(etag), "\"%lx-%lx\"",
+                 (unsigned long)file_size, (unsigned long)st.st_mtime);
+    }
     fseek(fd, 0, SEEK_SET);
 
-    // Set content type
+    const char* cache_control = cache_control_for(filepath);
+
+    if (has_gz) {
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    }
+
+    if (http_etag_matches(req, etag)) {
+        fclose(fd);
+        ESP_LOGD(TAG, "Not modified: %s", filepath);
+        return http_send_not_modified(req, etag, cache_control);
+    }
+
+    // Set content type (dal nome originale, non dal .gz)
     const char* mime_type = mime_from_path(filepath);
     httpd_resp_set_type(req, mime_type);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", cache_control);
+    if (gzip) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    }
 
     // Read and send file in chunks
-    char *chunk = (char*)malloc(1024);
+    char *chunk = (char*)malloc(FILE_CHUNK_SIZE);
     if (!chunk) {
         ESP_LOGE(TAG, "Failed to allocate memory for file chunk");
         fclose(fd);
@@ -74,7 +428,7 @@ static esp_err_t serve_spiffs_file(httpd_req_t *req, const char* filepath) {
 
     size_t read_bytes;
     do {
-        read_bytes = fread(chunk, 1, 1024, fd);
+        read_bytes = fread(chunk, 1, FILE_CHUNK_SIZE, fd);
         if (read_bytes > 0) {
             if (httpd_resp_send_chunk(req, chunk, read_bytes) != ESP_OK) {
                 ESP_LOGE(TAG, "Failed to send chunk");
@@ -91,10 +445,30 @@ static esp_err_t serve_spiffs_file(httpd_req_t *req, const char* filepath) {
     free(chunk);
     fclose(fd);
 
-    ESP_LOGI(TAG, "Served %s (%ld bytes, %s)", filepath, file_size, mime_type);
+    ESP_LOGI(TAG, "Served %s (%ld bytes, %s%s)", filepath, file_size, mime_type,
+             gzip ? ", gzip" : "");
     return ESP_OK;
 }
 
+/**
+ * @brief Serve file from SPIFFS with shared storage access
+ *
+ * While a SPIFFS OTA or an upload holds exclusive access the client gets
+ * 503 instead of a file that may be unmounted or half written.
+ */
+static esp_err_t serve_spiffs_file(httpd_req_t *req, const char* filepath) {
+    if (!storage_acquire(0)) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "5");
+        httpd_resp_sendstr(req, "Storage busy");
+        return ESP_OK;
+    }
+
+    esp_err_t ret = send_spiffs_file(req, filepath);
+    storage_release();
+    return ret;
+}
+
 /**
  * @brief Root handler - Serve index.html from SPIFFS
  */
@@ -140,9 +514,34 @@ static esp_err_t file_handler(httpd_req_t *req) {
     return serve_spiffs_file(req, filepath);
 }
 
+/**
+ * @brief Static cache counters - GET /api/cache
+ */
+static esp_err_t cache_stats_handler(httpd_req_t *req) {
+    static_cache_stats_t stats;
+    static_cache_get_stats(&stats);
+
+    char json[160];
+    int len = snprintf(json, sizeof(json),
+        "{\"hits\":%lu,\"misses\":%lu,\"bypass\":%lu,\"invalidations\":%lu,"
+        "\"entries\":%u,\"bytes\":%u}",
+        (unsigned long)stats.hits, (unsigned long)stats.misses,
+        (unsigned long)stats.bypass, (unsigned long)stats.invalidations,
+        stats.entries, (unsigned int)stats.bytes);
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
 // Handler per upload di singoli file
 static esp_err_t file_upload_handler(httpd_req_t *req)
 {
+    // Upload lungo: eseguito da un worker, il task httpd resta libero
+    if (!http_async_is_worker()) {
+        // Esclusivo: nessun download sta leggendo il file che viene riscritto
+        return http_async_submit_storage(req, file_upload_handler, HTTP_ASYNC_STORAGE_EXCLUSIVE);
+    }
+
     char filepath[128];
     char filename[64] = {0};
 
@@ -215,6 +614,24 @@ static esp_err_t file_upload_handler(httpd_req_t *req)
 
     ESP_LOGI(TAG, "File uploaded successfully: %s", filename);
 
+    // Una variante .gz precedente non corrisponde più al file caricato
+    static_cache_invalidate(filepath);
+    size_t name_len = strlen(filename);
+    if (name_len < 3 || strcmp(filename + name_len - 3, ".gz") != 0) {
+        char gz_path[136];
+        snprintf(gz_path, sizeof(gz_path), "%s.gz", filepath);
+        if (unlink(gz_path) == 0) {
+            ESP_LOGI(TAG, "Removed stale %s", gz_path);
+        }
+        static_cache_invalidate(gz_path);
+    }
+
+    // Log giornaliero caricato a mano: l'indice dell'anno va ricostruito
+    unsigned int log_year;
+    if (sscanf(filename, "log_%4u", &log_year) == 1) {
+        history_index_invalidate(log_year);
+    }
+
     // Invia risposta di successo
     httpd_resp_set_type(req, "text/plain");
     httpd_resp_sendstr(req, "File uploaded successfully");
@@ -230,6 +647,10 @@ bool is_webserver_running(void) {
     return (server != NULL);
 }
 
+httpd_handle_t get_webserver_handle(void) {
+    return server;
+}
+
 void start_webserver_if_not_running(void) {
     if (server != NULL) {
         ESP_LOGI(TAG, "Web server already running");
@@ -242,14 +663,22 @@ void start_webserver_if_not_running(void) {
     config.stack_size = 8192;
     config.server_port = 80;
     config.ctrl_port = 32768;
-    config.max_open_sockets = 7;
-    config.max_uri_handlers = 16;
+    config.max_open_sockets = HTTP_MAX_SOCKETS;
+    config.max_uri_handlers = HTTP_MAX_ENDPOINTS;
     config.max_resp_headers = 8;
     config.backlog_conn = 5;
     config.lru_purge_enable = true;
     config.recv_wait_timeout = 60;
     config.send_wait_timeout = 60;
     config.uri_match_fn = httpd_uri_match_wildcard;  // Abilita wildcard matching
+    config.open_fn = session_open;      // Sessioni WebSocket e byte inviati per socket
+    config.close_fn = session_close;
+
+    // Cache PSRAM dei file statici (caricati al primo accesso)
+    static_cache_init();
+
+    // Worker per download di log e upload (il task httpd resta per le GET leggere)
+    http_async_init();
 
     ESP_LOGI(TAG, "Starting HTTP server on port %d", config.server_port);
 
@@ -265,7 +694,7 @@ void start_webserver_if_not_running(void) {
             .handler   = root_handler,
             .user_ctx  = NULL
         };
-        httpd_register_uri_handler(server, &root_uri);
+        http_register_uri(server, &root_uri);
 
         // 2. WebSocket handler
         httpd_uri_t ws_uri = {
@@ -275,7 +704,7 @@ void start_webserver_if_not_running(void) {
             .user_ctx  = NULL,
             .is_websocket = true
         };
-        httpd_register_uri_handler(server, &ws_uri);
+        http_register_uri(server, &ws_uri);
 
         // 3. Handler /update
         httpd_uri_t update_uri = {
@@ -284,7 +713,7 @@ void start_webserver_if_not_running(void) {
             .handler   = file_handler,
             .user_ctx  = NULL
         };
-        httpd_register_uri_handler(server, &update_uri);
+        http_register_uri(server, &update_uri);
 
         // 4. OTA handlers (POST)
         register_ota_handlers(server);
@@ -296,7 +725,7 @@ void start_webserver_if_not_running(void) {
             .handler   = file_upload_handler,
             .user_ctx  = NULL
         };
-        httpd_register_uri_handler(server, &upload_file_uri);
+        http_register_uri(server, &upload_file_uri);
 
         // 6. Log API handlers (GET)
         register_log_handlers(server);
@@ -304,16 +733,54 @@ void start_webserver_if_not_running(void) {
         // 7. Status API handler (GET)
         register_status_handler(server);
 
-        // 8. Wildcard handler per file statici (DEVE essere ultimo!)
+        // 8. Contatori cache file statici (GET)
+        httpd_uri_t cache_uri = {
+            .uri       = "/api/cache",
+            .method    = HTTP_GET,
+            .handler   = cache_stats_handler,
+            .user_ctx  = NULL
+        };
+        http_register_uri(server, &cache_uri);
+
+        // 9. Metriche in formato Prometheus (GET)
+        httpd_uri_t metrics_uri = {
+            .uri       = "/metrics",
+            .method    = HTTP_GET,
+            .handler   = metrics_handler,
+            .user_ctx  = NULL
+        };
+        http_register_uri(server, &metrics_uri);
+
+        // 10. Profilo CPU e stack dei task (GET)
+        httpd_uri_t tasks_uri = {
+            .uri       = "/api/debug/tasks",
+            .method    = HTTP_GET,
+            .handler   = task_profiler_handler,
+            .user_ctx  = NULL
+        };
+        http_register_uri(server, &tasks_uri);
+
+#if TRACE_ENABLE
+        // 11. Traccia dei percorsi caldi, formato Chrome trace-event (GET)
+        httpd_uri_t trace_uri = {
+            .uri       = "/api/debug/trace",
+            .method    = HTTP_GET,
+            .handler   = trace_handler,
+            .user_ctx  = NULL
+        };
+        http_register_uri(server, &trace_uri);
+#endif
+
+        // 12. Wildcard handler per file statici (DEVE essere ultimo!)
         httpd_uri_t file_uri = {
             .uri       = "/*",
             .method    = HTTP_GET,
             .handler   = file_handler,
             .user_ctx  = NULL
         };
-        httpd_register_uri_handler(server, &file_uri);
+        http_register_uri(server, &file_uri);
 
-        ESP_LOGI(TAG, "Registered handlers: / /ws /update /ota_* /api/upload /api/log /api/status /* (wildcard)");
+        ESP_LOGI(TAG, "Registered handlers: / /ws /update /ota_* /api/upload /api/log /api/status /api/cache /metrics /api/debug/tasks /api/debug/trace /* (wildcard)");
     } else {
         ESP_LOGE(TAG, "Failed to start HTTP server");
     }
@@ -324,5 +791,6 @@ void stop_webserver(void) {
         ESP_LOGI(TAG, "Stopping HTTP server");
         httpd_stop(server);
         server = NULL;
+        ws_session_close_all();
     }
 }
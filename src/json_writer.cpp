@@ -0,0 +1,161 @@
+/**
+ * @file json_writer.cpp
+ * @brief Implementazione writer JSON con buffer di accumulo
+ */
+
+#include "json_writer.h"
+
+#include <string.h>
+
+// Spazio massimo richiesto da un numero: segno + 10 cifre + punto
+#define JSON_NUMBER_MAX_LEN     12
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+/**
+ * @brief Garantisce almeno n byte liberi nel buffer
+ */
+static inline bool reserve(json_writer_t* w, size_t n)
+{
+    if (w->err != ESP_OK) {
+        return false;
+    }
+    if (w->len + n > w->cap) {
+        json_writer_flush(w);
+    }
+    return w->err == ESP_OK;
+}
+
+/**
+ * @brief Scrive le cifre di un intero senza segno (buffer già riservato)
+ */
+static inline void put_uint(json_writer_t* w, uint32_t v, uint8_t min_digits)
+{
+    char digits[10];
+    uint8_t n = 0;
+
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v != 0 || n < min_digits);
+
+    while (n > 0) {
+        w->buf[w->len++] = digits[--n];
+    }
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+void json_writer_init(json_writer_t* w, httpd_req_t* req, char* buf, size_t cap)
+{
+    w->req = req;
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->err = ESP_OK;
+    w->bytes_sent = 0;
+    w->chunks_sent = 0;
+}
+
+void json_writer_raw(json_writer_t* w, const char* data, size_t len)
+{
+    while (len > 0 && w->err == ESP_OK) {
+        if (w->len == w->cap) {
+            json_writer_flush(w);
+            continue;
+        }
+
+        size_t n = w->cap - w->len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(&w->buf[w->len], data, n);
+        w->len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void json_writer_str(json_writer_t* w, const char* s)
+{
+    json_writer_raw(w, s, strlen(s));
+}
+
+void json_writer_char(json_writer_t* w, char c)
+{
+    if (reserve(w, 1)) {
+        w->buf[w->len++] = c;
+    }
+}
+
+void json_writer_int(json_writer_t* w, int32_t value)
+{
+    if (!reserve(w, JSON_NUMBER_MAX_LEN)) {
+        return;
+    }
+
+    uint32_t v = (uint32_t)value;
+    if (value < 0) {
+        w->buf[w->len++] = '-';
+        v = 0U - v;
+    }
+    put_uint(w, v, 1);
+}
+
+void json_writer_fixed(json_writer_t* w, int32_t value, uint8_t decimals)
+{
+    static const uint32_t pow10[] = {1, 10, 100, 1000, 10000};
+
+    if (decimals == 0 || decimals > 4) {
+        json_writer_int(w, value);
+        return;
+    }
+    if (!reserve(w, JSON_NUMBER_MAX_LEN)) {
+        return;
+    }
+
+    uint32_t v = (uint32_t)value;
+    if (value < 0) {
+        w->buf[w->len++] = '-';
+        v = 0U - v;
+    }
+
+    put_uint(w, v / pow10[decimals], 1);
+    w->buf[w->len++] = '.';
+    put_uint(w, v % pow10[decimals], decimals);
+}
+
+void json_writer_2digits(json_writer_t* w, uint8_t value)
+{
+    if (reserve(w, 3)) {
+        put_uint(w, value, 2);
+    }
+}
+
+esp_err_t json_writer_flush(json_writer_t* w)
+{
+    if (w->err != ESP_OK || w->len == 0) {
+        return w->err;
+    }
+
+    w->err = httpd_resp_send_chunk(w->req, w->buf, w->len);
+    if (w->err == ESP_OK) {
+        w->bytes_sent += w->len;
+        w->chunks_sent++;
+    }
+    w->len = 0;
+    return w->err;
+}
+
+esp_err_t json_writer_finish(json_writer_t* w)
+{
+    json_writer_flush(w);
+    if (w->err == ESP_OK) {
+        w->err = httpd_resp_send_chunk(w->req, NULL, 0);
+    }
+    return w->err;
+}
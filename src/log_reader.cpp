@@ -6,20 +6,99 @@
 #include "log_reader.h"
 #include "storage_manager.h"
 #include "history_manager.h"
+#include "history_rollup.h"
+#include "history_index.h"
+#include "history_backend.h"
+#include "http_server.h"
+#include "json_writer.h"
+#include "http_async.h"
 #include "comune.h"
 #include <esp_log.h>
+#include <esp_rom_crc.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
-#include <dirent.h>
 #include <time.h>
 
 static const char *TAG = "LOG_READER";
 
+// Stato dell'enumerazione per /api/log/list
+typedef struct {
+    json_writer_t *w;
+    bool first;
+} list_ctx_t;
+
+/**
+ * @brief Converte una data "YYYYMMDD" nei suoi componenti
+ */
+static bool parse_date_str(const char* date_str, uint16_t* year, uint8_t* month, uint8_t* day)
+{
+    unsigned int y, m, d;
+    if (strlen(date_str) != 8 || sscanf(date_str, "%4u%2u%2u", &y, &m, &d) != 3) {
+        return false;
+    }
+    if (m < 1 || m > 12 || d < 1 || d > 31) {
+        return false;
+    }
+
+    *year = y;
+    *month = m;
+    *day = d;
+    return true;
+}
+
+// Campi selezionabili con ?fields= in /api/log ("t" è sempre incluso)
+#define LOG_FIELD_TEMP      0x01
+#define LOG_FIELD_HUM       0x02
+#define LOG_FIELD_HEAT      0x04
+#define LOG_FIELD_SETPOINT  0x08
+#define LOG_FIELD_PRESS     0x10
+#define LOG_FIELD_ALL       0x1F
+
+/**
+ * @brief Converte "temp,heat,..." nella maschera dei campi
+ */
+static uint8_t parse_fields(const char* fields)
+{
+    static const struct {
+        const char* name;
+        uint8_t bit;
+    } names[] = {
+        {"temp", LOG_FIELD_TEMP}, {"hum", LOG_FIELD_HUM}, {"heat", LOG_FIELD_HEAT},
+        {"setpoint", LOG_FIELD_SETPOINT}, {"press", LOG_FIELD_PRESS},
+    };
+
+    uint8_t mask = 0;
+    const char* p = fields;
+
+    while (*p != '\0') {
+        const char* end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (strlen(names[i].name) == len && strncmp(p, names[i].name, len) == 0) {
+                mask |= names[i].bit;
+            }
+        }
+
+        p += len;
+        if (*p == ',') p++;
+    }
+
+    return mask;
+}
+
 esp_err_t log_data_handler(httpd_req_t *req)
 {
-    // Estrai parametro data dalla query string (?date=20231221)
+    // Trasferimento lungo: eseguito da un worker, il task httpd resta libero
+    if (!http_async_is_worker()) {
+        return http_async_submit(req, log_data_handler);
+    }
+
+    // Estrai parametri dalla query string (?date=20231221[&fields=temp,heat])
     char date_str[16] = {0};
+    char fields_str[48] = {0};
     size_t buf_len = httpd_req_get_url_query_len(req) + 1;
 
     if (buf_len > 1) {
@@ -28,139 +107,234 @@ esp_err_t log_data_handler(httpd_req_t *req)
             if (httpd_query_key_value(buf, "date", date_str, sizeof(date_str)) != ESP_OK) {
                 strcpy(date_str, "20251221");  // Default today
             }
+            httpd_query_key_value(buf, "fields", fields_str, sizeof(fields_str));
         }
         free(buf);
     } else {
         strcpy(date_str, "20251221");  // Default
     }
 
-    // Costruisci percorso file
-    char filepath[64];
-    snprintf(filepath, sizeof(filepath), "/spiffs/log_%s.bin", date_str);
-
-    ESP_LOGI(TAG, "Reading log file: %s", filepath);
-
-    // Verifica esistenza file
-    struct stat st;
-    if (stat(filepath, &st) != 0) {
-        ESP_LOGW(TAG, "Log file not found: %s", filepath);
-        httpd_resp_send_404(req);
+    uint16_t year;
+    uint8_t month, day;
+    if (!parse_date_str(date_str, &year, &month, &day)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid date");
         return ESP_FAIL;
     }
 
-    // Apri file
-    FILE *f = fopen(filepath, "rb");
-    if (!f) {
-        ESP_LOGE(TAG, "Failed to open log file");
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Cannot open log file");
+    uint8_t fields = fields_str[0] != '\0' ? parse_fields(fields_str) : LOG_FIELD_ALL;
+
+    ESP_LOGI(TAG, "Reading log file for %s (fields 0x%02x)", date_str, fields);
+
+    // Apri file (v1 o v2)
+    history_reader_t reader;
+    esp_err_t ret = history_reader_open(&reader, year, month, day);
+    if (ret == ESP_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "Log file not found: %s", date_str);
+        httpd_resp_send_404(req);
         return ESP_FAIL;
     }
-
-    // Leggi header
-    log_header_t header;
-    if (fread(&header, sizeof(header), 1, f) != 1) {
-        ESP_LOGE(TAG, "Failed to read header");
-        fclose(f);
+    if (ret != ESP_OK) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Invalid log file");
         return ESP_FAIL;
     }
 
-    // Verifica magic number
-    if (header.magic != LOG_MAGIC) {
-        ESP_LOGE(TAG, "Invalid magic number: 0x%08X", (unsigned int)header.magic);
-        fclose(f);
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Invalid log format");
+    char *out = (char*)malloc(JSON_WRITER_BUF_SIZE);
+    if (out == NULL) {
+        history_reader_close(&reader);
+        httpd_resp_send_500(req);
         return ESP_FAIL;
     }
 
-    ESP_LOGI(TAG, "Log file: %04d-%02d-%02d, %d samples",
-             header.year, header.month, header.day, header.num_samples);
+    const history_header_t* header = &reader.header;
 
-    // Invia header HTTP JSON
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr_chunk(req, "{");
+    ESP_LOGI(TAG, "Log file: %04d-%02d-%02d, v%d, %d samples",
+             header->year, header->month, header->day, header->version, header->num_samples);
 
-    // Metadata
-    char json_buf[256];
-    snprintf(json_buf, sizeof(json_buf),
-             "\"date\":\"%04d-%02d-%02d\",\"samples\":%d,\"data\":[",
-             header.year, header.month, header.day, header.num_samples);
-    httpd_resp_sendstr_chunk(req, json_buf);
+    httpd_resp_set_type(req, "application/json");
 
-    // Leggi e invia tutti i records (formato history_sample_t - 12 bytes con pressione)
-    uint8_t record[12];
+    // Record accumulati nel buffer e inviati in chunk da 4 KB
+    json_writer_t w;
+    json_writer_init(&w, req, out, JSON_WRITER_BUF_SIZE);
+
+    json_writer_str(&w, "{\"date\":\"");
+    json_writer_int(&w, header->year);
+    json_writer_char(&w, '-');
+    json_writer_2digits(&w, header->month);
+    json_writer_char(&w, '-');
+    json_writer_2digits(&w, header->day);
+    json_writer_str(&w, "\",\"samples\":");
+    json_writer_int(&w, header->num_samples);
+    json_writer_str(&w, ",\"data\":[");
+
+    history_sample_t sample;
     bool first_record = true;
 
-    for (int i = 0; i < header.num_samples; i++) {
-        if (fread(record, 12, 1, f) != 1) {
-            ESP_LOGW(TAG, "Failed to read record %d", i);
-            break;
+    while (w.err == ESP_OK && (ret = history_reader_next(&reader, &sample)) == ESP_OK) {
+        json_writer_str(&w, first_record ? "{\"t\":\"" : ",{\"t\":\"");
+        json_writer_2digits(&w, sample.minute_of_day / 60);
+        json_writer_char(&w, ':');
+        json_writer_2digits(&w, sample.minute_of_day % 60);
+        json_writer_char(&w, '"');
+
+        // Valori sentinella → null
+        if (fields & LOG_FIELD_TEMP) {
+            json_writer_str(&w, ",\"temp\":");
+            if (sample.temperature == -32768) json_writer_str(&w, "null");
+            else json_writer_fixed(&w, sample.temperature, 2);
+        }
+        if (fields & LOG_FIELD_HUM) {
+            json_writer_str(&w, ",\"hum\":");
+            if (sample.humidity == 255) json_writer_str(&w, "null");
+            else json_writer_int(&w, sample.humidity);
+        }
+        if (fields & LOG_FIELD_HEAT) {
+            json_writer_str(&w, ",\"heat\":");
+            json_writer_int(&w, sample.flags & HISTORY_FLAG_RELAY_ON);
+        }
+        if (fields & LOG_FIELD_SETPOINT) {
+            json_writer_str(&w, ",\"setpoint\":");
+            if (sample.setpoint == -32768) json_writer_str(&w, "null");
+            else json_writer_fixed(&w, sample.setpoint, 2);
+        }
+        if (fields & LOG_FIELD_PRESS) {
+            json_writer_str(&w, ",\"press\":");
+            if (sample.pressure == 0) json_writer_str(&w, "null");
+            else json_writer_int(&w, sample.pressure);
         }
 
-        // Parse record (history_sample_t format - 12 bytes)
-        uint16_t minute_of_day = record[0] | (record[1] << 8);
-        int16_t temp = (int16_t)(record[2] | (record[3] << 8));
-        uint8_t hum = record[4];
-        uint8_t flags = record[5];
-        int16_t setpoint = (int16_t)(record[6] | (record[7] << 8));
-        uint16_t pressure = record[10] | (record[11] << 8);
+        json_writer_char(&w, '}');
+        first_record = false;
+    }
 
-        // Calcola ora/minuto
-        int hour = minute_of_day / 60;
-        int minute = minute_of_day % 60;
+    if (ret == ESP_FAIL) {
+        ESP_LOGW(TAG, "Stopped at record %d", reader.next_minute);
+    }
 
-        // Estrai stato caldaia (bit 0 dei flags)
-        uint8_t heat = flags & 0x01;
+    history_reader_close(&reader);
 
-        // Gestisci sentinel values per dati mancanti
-        char temp_str[16], setpoint_str[16], hum_str[8], press_str[8];
+    // Chiudi JSON e risposta chunked
+    json_writer_str(&w, "]}");
+    ret = json_writer_finish(&w);
+    free(out);
 
-        if (temp == -32768) {
-            strcpy(temp_str, "null");
-        } else {
-            snprintf(temp_str, sizeof(temp_str), "%.2f", temp / 100.0f);
-        }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send log JSON");
+        return ESP_FAIL;
+    }
 
-        if (setpoint == -32768) {
-            strcpy(setpoint_str, "null");
-        } else {
-            snprintf(setpoint_str, sizeof(setpoint_str), "%.2f", setpoint / 100.0f);
-        }
+    ESP_LOGI(TAG, "Sent %lu bytes in %u chunks", (unsigned long)w.bytes_sent, w.chunks_sent);
+    return ESP_OK;
+}
 
-        if (hum == 255) {
-            strcpy(hum_str, "null");
-        } else {
-            snprintf(hum_str, sizeof(hum_str), "%d", hum);
-        }
+/**
+ * @brief Invia un file giornaliero convertito in formato v1 (record fissi)
+ */
+static esp_err_t send_log_as_v1(httpd_req_t *req, uint16_t year, uint8_t month, uint8_t day)
+{
+    history_reader_t reader;
+    esp_err_t ret = history_reader_open(&reader, year, month, day);
+    if (ret == ESP_ERR_NOT_FOUND) {
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+    if (ret != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Invalid log file");
+        return ESP_FAIL;
+    }
 
-        if (pressure == 0) {
-            strcpy(press_str, "null");
-        } else {
-            snprintf(press_str, sizeof(press_str), "%d", pressure);
-        }
+    httpd_resp_set_type(req, "application/octet-stream");
 
-        snprintf(json_buf, sizeof(json_buf),
-                 "%s{\"t\":\"%02d:%02d\",\"temp\":%s,\"hum\":%s,\"heat\":%d,\"setpoint\":%s,\"press\":%s}",
-                 first_record ? "" : ",",
-                 hour, minute, temp_str, hum_str, heat, setpoint_str, press_str);
+    char content_disp[128];
+    snprintf(content_disp, sizeof(content_disp), "inline; filename=\"log_%04d%02d%02d.bin\"",
+             year, month, day);
+    httpd_resp_set_hdr(req, "Content-Disposition", content_disp);
 
-        httpd_resp_sendstr_chunk(req, json_buf);
-        first_record = false;
+    history_header_t header = reader.header;
+    header.version = HISTORY_VERSION_V1;
+    if (httpd_resp_send_chunk(req, (const char*)&header, sizeof(header)) != ESP_OK) {
+        history_reader_close(&reader);
+        return ESP_FAIL;
     }
 
-    fclose(f);
+    // 100 sample × 12 bytes = 1200 bytes per chunk
+    history_sample_t samples[100];
+    size_t count = 0;
+
+    do {
+        ret = history_reader_next(&reader, &samples[count]);
+        if (ret == ESP_OK) {
+            count++;
+        }
+        if (count == sizeof(samples) / sizeof(samples[0]) || (ret != ESP_OK && count > 0)) {
+            if (httpd_resp_send_chunk(req, (const char*)samples,
+                                      count * sizeof(history_sample_t)) != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to send samples chunk");
+                history_reader_close(&reader);
+                return ESP_FAIL;
+            }
+            count = 0;
+        }
+    } while (ret == ESP_OK);
 
-    // Chiudi JSON
-    httpd_resp_sendstr_chunk(req, "]}");
-    httpd_resp_sendstr_chunk(req, NULL);  // Fine chunked response
+    history_reader_close(&reader);
 
+    httpd_resp_send_chunk(req, NULL, 0);
     return ESP_OK;
 }
 
+/**
+ * @brief CRC32 e dimensione del contenuto salvato di un giorno (per l'ETag)
+ *
+ * @param filepath File da leggere così com'è, NULL per leggere i sample
+ *                 con history_reader (backend senza file)
+ */
+static bool day_content_crc(uint16_t year, uint8_t month, uint8_t day,
+                            const char* filepath, uint32_t* size, uint32_t* crc)
+{
+    *size = 0;
+    *crc = 0;
+
+    if (filepath != NULL) {
+        FILE* f = fopen(filepath, "rb");
+        if (f == NULL) {
+            return false;
+        }
+
+        uint8_t buffer[512];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+            *crc = esp_rom_crc32_le(*crc, buffer, n);
+            *size += n;
+        }
+        fclose(f);
+        return true;
+    }
+
+    history_reader_t reader;
+    if (history_reader_open(&reader, year, month, day) != ESP_OK) {
+        return false;
+    }
+
+    *crc = esp_rom_crc32_le(*crc, (const uint8_t*)&reader.header, sizeof(reader.header));
+    history_sample_t sample;
+    while (history_reader_next(&reader, &sample) == ESP_OK) {
+        *crc = esp_rom_crc32_le(*crc, (const uint8_t*)&sample, sizeof(sample));
+        *size += sizeof(sample);
+    }
+    history_reader_close(&reader);
+    return true;
+}
+
 esp_err_t log_raw_handler(httpd_req_t *req)
 {
-    // Estrai parametro data dalla query string (?date=20231221)
+    // Trasferimento lungo: eseguito da un worker, il task httpd resta libero
+    if (!http_async_is_worker()) {
+        return http_async_submit(req, log_raw_handler);
+    }
+
+    // Estrai parametri dalla query string (?date=20231221[&format=v1])
     char date_str[16] = {0};
+    char format_str[8] = {0};
     size_t buf_len = httpd_req_get_url_query_len(req) + 1;
 
     if (buf_len > 1) {
@@ -169,26 +343,72 @@ esp_err_t log_raw_handler(httpd_req_t *req)
             if (httpd_query_key_value(buf, "date", date_str, sizeof(date_str)) != ESP_OK) {
                 strcpy(date_str, "20251221");  // Default today
             }
+            httpd_query_key_value(buf, "format", format_str, sizeof(format_str));
         }
         free(buf);
     } else {
         strcpy(date_str, "20251221");  // Default
     }
 
+    uint16_t year;
+    uint8_t month, day;
+    if (!parse_date_str(date_str, &year, &month, &day)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid date");
+        return ESP_FAIL;
+    }
+    // Senza file giornalieri (backend log) il giorno si invia sempre in v1
+    bool raw_files = history_backend_get()->raw_files;
+    bool as_v1 = !raw_files || (strcmp(format_str, "v1") == 0);
+
     // Costruisci percorso file
     char filepath[64];
     snprintf(filepath, sizeof(filepath), "/spiffs/log_%s.bin", date_str);
 
-    ESP_LOGI(TAG, "Reading raw log file: %s", filepath);
-
-    // Verifica esistenza file
-    struct stat st;
-    if (stat(filepath, &st) != 0) {
-        ESP_LOGW(TAG, "Log file not found: %s", filepath);
+    if (raw_files) {
+        struct stat st;
+        if (stat(filepath, &st) != 0) {
+            ESP_LOGW(TAG, "Log file not found: %s", filepath);
+            httpd_resp_send_404(req);
+            return ESP_FAIL;
+        }
+    } else if (!history_file_exists(year, month, day)) {
+        ESP_LOGW(TAG, "Log %s not found", date_str);
         httpd_resp_send_404(req);
         return ESP_FAIL;
     }
 
+    // ETag dal contenuto: una riscrittura della stessa dimensione
+    // (minuti corretti) cambia comunque il CRC
+    uint32_t size = 0;
+    uint32_t crc = 0;
+    if (!day_content_crc(year, month, day, raw_files ? filepath : NULL, &size, &crc)) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Cannot read log");
+        return ESP_FAIL;
+    }
+
+    // Giorni definitivi (già scritti dal task writer): cache senza rivalidazione.
+    // Il giorno concluso resta no-cache finché il salvataggio è in sospeso
+    bool open = history_day_is_open(year, month, day);
+    char etag[48];
+    snprintf(etag, sizeof(etag), "\"%s-%lx-%08lx%s\"", date_str, (unsigned long)size,
+             (unsigned long)crc, as_v1 ? "-v1" : "");
+    const char* cache_control = open ? "no-cache" : "public, max-age=31536000, immutable";
+
+    if (http_etag_matches(req, etag)) {
+        ESP_LOGD(TAG, "Log %s not modified", date_str);
+        return http_send_not_modified(req, etag, cache_control);
+    }
+
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", cache_control);
+
+    // Client che comprendono solo record fissi: decodifica v2 al volo
+    if (as_v1) {
+        return send_log_as_v1(req, year, month, day);
+    }
+
+    ESP_LOGI(TAG, "Reading raw log file: %s", filepath);
+
     // Apri file
     FILE *f = fopen(filepath, "rb");
     if (!f) {
@@ -205,7 +425,7 @@ esp_err_t log_raw_handler(httpd_req_t *req)
     snprintf(content_disp, sizeof(content_disp), "inline; filename=\"log_%s.bin\"", date_str);
     httpd_resp_set_hdr(req, "Content-Disposition", content_disp);
 
-    // Stream diretto del file in chunk da 1KB
+    // Stream diretto del file in chunk da 1KB (v1 o v2, il client legge la versione)
     uint8_t buffer[1024];
     size_t bytes_read;
 
@@ -226,41 +446,92 @@ esp_err_t log_raw_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-esp_err_t log_current_handler(httpd_req_t *req)
+/**
+ * @brief Data di ieri (ora locale)
+ */
+static void get_yesterday(uint16_t* year, uint8_t* month, uint8_t* day)
 {
-    ESP_LOGI(TAG, "Serving current day log from PSRAM");
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+
+    // Mezzogiorno per evitare problemi con l'ora legale
+    tm.tm_mday -= 1;
+    tm.tm_hour = 12;
+    tm.tm_isdst = -1;
+    time_t t = mktime(&tm);
+    localtime_r(&t, &tm);
+
+    *year = tm.tm_year + 1900;
+    *month = tm.tm_mon + 1;
+    *day = tm.tm_mday;
+}
 
-    const history_buffer_t* buffer = history_get_buffer();
-    if (buffer == NULL || !buffer->initialized || buffer->samples == NULL) {
-        ESP_LOGW(TAG, "History buffer not initialized");
+/**
+ * @brief Invia header e record [first, last) di un giorno in PSRAM
+ */
+static esp_err_t send_day_buffer(httpd_req_t *req, const history_buffer_t* buffer, int since,
+                                 bool live)
+{
+    // Snapshot di data e conteggio: il buffer può avanzare durante l'invio
+    history_header_t header = buffer->header;
+    if (live && history_read_samples(0, 0, NULL, &header) != ESP_OK) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "History not initialized");
         return ESP_FAIL;
     }
+    header.version = HISTORY_VERSION_V1;  // Il buffer in PSRAM contiene record fissi (v1)
+
+    // Il client confronta la generazione con quella già in suo possesso:
+    // se cambia (nuovo giorno) deve ricaricare tutto senza cursore
+    char generation[12];
+    snprintf(generation, sizeof(generation), "%04d%02d%02d",
+             header.year, header.month, header.day);
 
-    // Imposta header HTTP per binario
     httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "X-Log-Generation", generation);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
 
-    // Costruisci nome file dalla data nel buffer
-    char content_disp[128];
-    snprintf(content_disp, sizeof(content_disp), "inline; filename=\"log_%04d%02d%02d.bin\"",
-             buffer->header.year, buffer->header.month, buffer->header.day);
-    httpd_resp_set_hdr(req, "Content-Disposition", content_disp);
+    size_t first, last;
+    if (since >= 0) {
+        first = since + 1;
+        last = header.num_samples;
+    } else {
+        first = 0;
+        last = HISTORY_SAMPLES_PER_DAY;
 
-    // Invia header (12 bytes)
-    if (httpd_resp_send_chunk(req, (const char*)&buffer->header, sizeof(history_header_t)) != ESP_OK) {
+        char content_disp[128];
+        snprintf(content_disp, sizeof(content_disp), "inline; filename=\"log_%s.bin\"", generation);
+        httpd_resp_set_hdr(req, "Content-Disposition", content_disp);
+    }
+
+    if (httpd_resp_send_chunk(req, (const char*)&header, sizeof(history_header_t)) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to send header");
         return ESP_FAIL;
     }
 
-    // Invia tutti i sample in chunk (per evitare timeout)
+    // Invia i sample in chunk (per evitare timeout)
     const size_t chunk_samples = 100;  // 100 sample × 12 bytes = 1200 bytes per chunk
     const history_sample_t* samples = buffer->samples;
+    history_sample_t copy[chunk_samples];
 
-    for (size_t i = 0; i < HISTORY_SAMPLES_PER_DAY; i += chunk_samples) {
-        size_t remaining = HISTORY_SAMPLES_PER_DAY - i;
+    for (size_t i = first; i < last; i += chunk_samples) {
+        size_t remaining = last - i;
         size_t count = (remaining < chunk_samples) ? remaining : chunk_samples;
+        const history_sample_t* chunk = &samples[i];
+
+        // Giorno corrente: ogni chunk è una copia coerente (status_task può
+        // scrivere il minuto in corso); se il giorno cambia l'invio si ferma
+        // e il client ricarica vedendo la nuova generazione
+        if (live) {
+            history_header_t now;
+            if (history_read_samples(i, count, copy, &now) != ESP_OK ||
+                now.day != header.day || now.month != header.month) {
+                break;
+            }
+            chunk = copy;
+        }
 
-        if (httpd_resp_send_chunk(req, (const char*)&samples[i],
+        if (httpd_resp_send_chunk(req, (const char*)chunk,
                                   count * sizeof(history_sample_t)) != ESP_OK) {
             ESP_LOGE(TAG, "Failed to send samples chunk at %d", i);
             return ESP_FAIL;
@@ -270,54 +541,535 @@ esp_err_t log_current_handler(httpd_req_t *req)
     // Fine chunked response
     httpd_resp_send_chunk(req, NULL, 0);
 
-    ESP_LOGI(TAG, "Sent current log: %04d-%02d-%02d (%d valid samples)",
-             buffer->header.year, buffer->header.month, buffer->header.day,
-             buffer->header.num_samples);
+    ESP_LOGD(TAG, "Sent current log %s: records %u-%u (%d valid samples)",
+             generation, (unsigned int)first, (unsigned int)last, header.num_samples);
 
     return ESP_OK;
 }
 
+esp_err_t log_current_handler(httpd_req_t *req)
+{
+    // Cursore opzionale (?since=<minuto>): solo i record successivi
+    // Giorno opzionale (?day=yesterday): il giorno appena concluso
+    int since = -1;
+    bool yesterday = false;
+    size_t buf_len = httpd_req_get_url_query_len(req) + 1;
+    if (buf_len > 1) {
+        char *buf = (char*)malloc(buf_len);
+        char since_str[8];
+        char day_str[12];
+        if (httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
+            if (httpd_query_key_value(buf, "since", since_str, sizeof(since_str)) == ESP_OK) {
+                since = atoi(since_str);
+            }
+            if (httpd_query_key_value(buf, "day", day_str, sizeof(day_str)) == ESP_OK) {
+                if (strcmp(day_str, "yesterday") == 0) {
+                    yesterday = true;
+                } else if (strcmp(day_str, "today") != 0) {
+                    free(buf);
+                    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid day");
+                    return ESP_FAIL;
+                }
+            }
+        }
+        free(buf);
+    }
+
+    // Giorno bloccato in PSRAM per tutto l'invio (non svuotato al cambio giorno)
+    history_buffer_t buffer;
+    esp_err_t ret = history_acquire_day(yesterday, &buffer);
+
+    if (ret == ESP_ERR_NOT_FOUND) {
+        // Ieri già scritto dal task writer: si legge dal file
+        uint16_t year;
+        uint8_t month, day;
+        get_yesterday(&year, &month, &day);
+        httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+        return send_log_as_v1(req, year, month, day);
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "History buffer not initialized");
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "History not initialized");
+        return ESP_FAIL;
+    }
+
+    ret = send_day_buffer(req, &buffer, since, !yesterday);
+    history_release_day(&buffer);
+    return ret;
+}
+
+/**
+ * @brief Invia una data dell'indice come elemento dell'array JSON
+ */
+static void list_day_cb(uint16_t year, uint8_t month, uint8_t day,
+                        const history_index_entry_t* entry, void* ctx)
+{
+    list_ctx_t* list = (list_ctx_t*)ctx;
+
+    json_writer_str(list->w, list->first ? "\"" : ",\"");
+    json_writer_int(list->w, year);
+    json_writer_2digits(list->w, month);
+    json_writer_2digits(list->w, day);
+    json_writer_char(list->w, '"');
+    list->first = false;
+}
+
 esp_err_t log_list_handler(httpd_req_t *req)
 {
     ESP_LOGI(TAG, "Listing available log files");
 
+    char *out = (char*)malloc(JSON_WRITER_BUF_SIZE);
+    if (out == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
     httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr_chunk(req, "[");
 
-    DIR *dir = opendir("/spiffs");
-    if (dir == NULL) {
-        ESP_LOGE(TAG, "Failed to open /spiffs directory");
-        httpd_resp_sendstr_chunk(req, "]");
-        httpd_resp_sendstr_chunk(req, NULL);
-        return ESP_OK;
+    json_writer_t w;
+    json_writer_init(&w, req, out, JSON_WRITER_BUF_SIZE);
+    json_writer_char(&w, '[');
+
+    // Date dall'indice annuale in PSRAM, senza scansione della directory
+    list_ctx_t list = { .w = &w, .first = true };
+    history_index_foreach(list_day_cb, &list);
+
+    json_writer_char(&w, ']');
+    esp_err_t ret = json_writer_finish(&w);
+    free(out);
+
+    return (ret == ESP_OK) ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief Divisione intera arrotondata al più vicino (den > 0)
+ */
+static int32_t div_round(int32_t num, uint32_t den)
+{
+    if (num < 0) {
+        return -(int32_t)(((uint32_t)-num + den / 2) / den);
+    }
+    return (int32_t)(((uint32_t)num + den / 2) / den);
+}
+
+/**
+ * @brief Scrive un aggregato come oggetto JSON
+ *
+ * Etichetta "YYYY-MM" se day = 0, "YYYY-MM-DD" se hour < 0, altrimenti
+ * "YYYY-MM-DD HH:00". Medie in centesimi arrotondati, come "%.2f".
+ */
+static void write_rollup_json(json_writer_t* w, bool first, uint16_t year, uint8_t month,
+                              uint8_t day, int hour, const rollup_record_t* r)
+{
+    json_writer_str(w, first ? "{\"t\":\"" : ",{\"t\":\"");
+    json_writer_int(w, year);
+    json_writer_char(w, '-');
+    json_writer_2digits(w, month);
+    if (day > 0) {
+        json_writer_char(w, '-');
+        json_writer_2digits(w, day);
+    }
+    if (hour >= 0) {
+        json_writer_char(w, ' ');
+        json_writer_2digits(w, hour);
+        json_writer_str(w, ":00");
+    }
+
+    json_writer_str(w, "\",\"min\":");
+    json_writer_fixed(w, r->t_min, 2);
+    json_writer_str(w, ",\"max\":");
+    json_writer_fixed(w, r->t_max, 2);
+    json_writer_str(w, ",\"avg\":");
+    json_writer_fixed(w, div_round(r->t_sum, r->count), 2);
+    json_writer_str(w, ",\"heat\":");
+    json_writer_int(w, r->heater_on);
+    json_writer_str(w, ",\"sp_err\":");
+    json_writer_fixed(w, (int32_t)((r->sp_err_sum + r->count / 2) / r->count), 2);
+    json_writer_str(w, ",\"n\":");
+    json_writer_int(w, r->count);
+    json_writer_char(w, '}');
+}
+
+esp_err_t log_rollup_handler(httpd_req_t *req)
+{
+    // Trasferimento lungo: eseguito da un worker, il task httpd resta libero
+    if (!http_async_is_worker()) {
+        return http_async_submit(req, log_rollup_handler);
     }
 
-    struct dirent *entry;
+    // Parametri: ?from=YYYYMMDD&to=YYYYMMDD&res=hour|day|month
+    char from_str[16] = {0};
+    char to_str[16] = {0};
+    char res_str[8] = "day";
+    size_t buf_len = httpd_req_get_url_query_len(req) + 1;
+
+    if (buf_len > 1) {
+        char *buf = (char*)malloc(buf_len);
+        if (httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
+            httpd_query_key_value(buf, "from", from_str, sizeof(from_str));
+            httpd_query_key_value(buf, "to", to_str, sizeof(to_str));
+            httpd_query_key_value(buf, "res", res_str, sizeof(res_str));
+        }
+        free(buf);
+    }
+
+    uint16_t from_y, to_y;
+    uint8_t from_m, from_d, to_m, to_d;
+    if (!parse_date_str(from_str, &from_y, &from_m, &from_d) ||
+        !parse_date_str(to_str, &to_y, &to_m, &to_d)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid from/to date");
+        return ESP_FAIL;
+    }
+
+    rollup_resolution_t res;
+    if (strcmp(res_str, "hour") == 0) {
+        res = ROLLUP_RES_HOUR;
+    } else if (strcmp(res_str, "day") == 0) {
+        res = ROLLUP_RES_DAY;
+    } else if (strcmp(res_str, "month") == 0) {
+        res = ROLLUP_RES_MONTH;
+    } else {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid res (hour|day|month)");
+        return ESP_FAIL;
+    }
+
+    uint32_t from_key = from_y * 10000 + from_m * 100 + from_d;
+    uint32_t to_key = to_y * 10000 + to_m * 100 + to_d;
+    if (from_key > to_key) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "from > to");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Rollup %s from %s to %s", res_str, from_str, to_str);
+
+    char *out = (char*)malloc(JSON_WRITER_BUF_SIZE);
+    if (out == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+
+    json_writer_t w;
+    json_writer_init(&w, req, out, JSON_WRITER_BUF_SIZE);
+    json_writer_str(&w, "{\"res\":\"");
+    json_writer_str(&w, res_str);
+    json_writer_str(&w, "\",\"data\":[");
+
+    rollup_record_t days[ROLLUP_DAYS_PER_MONTH];
+    rollup_record_t hours[ROLLUP_HOURS_PER_DAY];
     bool first = true;
-    char json_buf[64];
-
-    while ((entry = readdir(dir)) != NULL) {
-        // Cerca file con pattern log_YYYYMMDD.bin
-        if (strncmp(entry->d_name, "log_", 4) == 0 &&
-            strstr(entry->d_name, ".bin") != NULL) {
-
-            // Estrai la data dal nome file
-            char date_str[9] = {0};
-            strncpy(date_str, entry->d_name + 4, 8);
-
-            // Formatta come JSON entry
-            snprintf(json_buf, sizeof(json_buf), "%s\"%s\"",
-                     first ? "" : ",", date_str);
-            httpd_resp_sendstr_chunk(req, json_buf);
-            first = false;
+    uint16_t y = from_y;
+    uint8_t m = from_m;
+
+    // Un file per mese: si legge il blocco giornaliero e, solo per
+    // risoluzione oraria, il blocco delle ore dei giorni con dati
+    while (y * 100 + m <= to_y * 100 + to_m && w.err == ESP_OK) {
+        if (history_rollup_read(y, m, false, 0, days) == ESP_OK) {
+            rollup_record_t month;
+            history_rollup_clear(&month);
+
+            for (int d = 1; d <= ROLLUP_DAYS_PER_MONTH; d++) {
+                uint32_t key = y * 10000 + m * 100 + d;
+                const rollup_record_t* day = &days[d - 1];
+
+                if (key < from_key || key > to_key || day->count == 0) {
+                    continue;
+                }
+
+                if (res == ROLLUP_RES_DAY) {
+                    write_rollup_json(&w, first, y, m, d, -1, day);
+                    first = false;
+                } else if (res == ROLLUP_RES_HOUR) {
+                    if (history_rollup_read(y, m, true, d, hours) != ESP_OK) {
+                        continue;
+                    }
+                    for (int h = 0; h < ROLLUP_HOURS_PER_DAY; h++) {
+                        if (hours[h].count == 0) {
+                            continue;
+                        }
+                        write_rollup_json(&w, first, y, m, d, h, &hours[h]);
+                        first = false;
+                    }
+                } else {
+                    history_rollup_combine(&month, day);
+                }
+            }
+
+            if (res == ROLLUP_RES_MONTH && month.count > 0) {
+                write_rollup_json(&w, first, y, m, 0, -1, &month);
+                first = false;
+            }
+        }
+
+        if (++m > 12) {
+            m = 1;
+            y++;
+        }
+    }
+
+    json_writer_str(&w, "]}");
+    esp_err_t ret = json_writer_finish(&w);
+    free(out);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send rollup JSON");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Range query (più giorni, sottocampionata)
+// ============================================================================
+
+#define RANGE_DEFAULT_POINTS    500     // Punti restituiti se ?points manca
+#define RANGE_MAX_POINTS        2000
+#define RANGE_MAX_DAYS          366
+
+/**
+ * @brief Bucket min/max corrente della range query
+ *
+ * Per ogni bucket si inviano il sample minimo e quello massimo in ordine
+ * temporale: i picchi restano visibili e la memoria usata è costante.
+ */
+typedef struct {
+    json_writer_t *w;
+    uint32_t bucket_minutes;    // Ampiezza bucket in minuti
+    uint32_t bucket_start;      // Minuto (da from) di inizio bucket
+    uint32_t count;             // Sample validi nel bucket (fino a 366 × 1440 con points=2)
+    uint32_t heat;              // Minuti caldaia accesa nel bucket
+    int16_t min_t, max_t;       // Estremi temperatura × 100
+    uint32_t min_at, max_at;    // Minuto degli estremi
+    int16_t setpoint;           // Ultimo setpoint valido
+    bool first;                 // Primo punto JSON
+} range_bucket_t;
+
+static void range_send_point(range_bucket_t *b, uint32_t minute, int16_t temp)
+{
+    json_writer_t *w = b->w;
+
+    json_writer_str(w, b->first ? "[" : ",[");
+    json_writer_int(w, (int32_t)minute);
+    json_writer_char(w, ',');
+    json_writer_fixed(w, temp, 2);
+    json_writer_char(w, ',');
+    if (b->setpoint == -32768) json_writer_str(w, "null");
+    else json_writer_fixed(w, b->setpoint, 2);
+    json_writer_char(w, ',');
+    json_writer_int(w, (int32_t)(b->heat * 100 / b->count));
+    json_writer_char(w, ']');
+    b->first = false;
+}
+
+static void range_flush(range_bucket_t *b)
+{
+    if (b->count > 0) {
+        if (b->min_at == b->max_at) {
+            range_send_point(b, b->min_at, b->min_t);
+        } else if (b->min_at < b->max_at) {
+            range_send_point(b, b->min_at, b->min_t);
+            range_send_point(b, b->max_at, b->max_t);
+        } else {
+            range_send_point(b, b->max_at, b->max_t);
+            range_send_point(b, b->min_at, b->min_t);
+        }
+    }
+
+    b->count = 0;
+    b->heat = 0;
+    b->min_t = INT16_MAX;
+    b->max_t = INT16_MIN;
+    b->setpoint = -32768;
+}
+
+static void range_add(range_bucket_t *b, uint32_t minute, const history_sample_t *s)
+{
+    if (s->temperature == -32768) {
+        return;
+    }
+
+    if (minute >= b->bucket_start + b->bucket_minutes) {
+        range_flush(b);
+        b->bucket_start = minute - minute % b->bucket_minutes;
+    }
+
+    if (s->temperature < b->min_t) {
+        b->min_t = s->temperature;
+        b->min_at = minute;
+    }
+    if (s->temperature > b->max_t) {
+        b->max_t = s->temperature;
+        b->max_at = minute;
+    }
+    if (s->flags & HISTORY_FLAG_RELAY_ON) {
+        b->heat++;
+    }
+    if (s->setpoint != -32768) {
+        b->setpoint = s->setpoint;
+    }
+    b->count++;
+}
+
+/**
+ * @brief Accoda al bucket i sample di un giorno (da PSRAM se è il giorno corrente)
+ */
+static void range_add_day(range_bucket_t *b, uint32_t day_offset,
+                          uint16_t year, uint8_t month, uint8_t day)
+{
+    uint32_t base = day_offset * HISTORY_SAMPLES_PER_DAY;
+
+    // Giorno corrente: copie coerenti a blocchi, senza fermare status_task
+    history_header_t header;
+    if (history_read_samples(0, 0, NULL, &header) == ESP_OK &&
+        header.year == year && header.month == month && header.day == day) {
+        history_sample_t block[60];
+        for (uint16_t first = 0; first < header.num_samples; first += 60) {
+            history_header_t now;
+            if (history_read_samples(first, 60, block, &now) != ESP_OK ||
+                now.day != day || now.month != month) {
+                break;      // Cambio giorno durante la lettura
+            }
+            uint16_t count = header.num_samples - first;
+            if (count > 60) {
+                count = 60;
+            }
+            for (uint16_t j = 0; j < count; j++) {
+                range_add(b, base + first + j, &block[j]);
+            }
         }
+        return;
     }
 
-    closedir(dir);
+    history_reader_t reader;
+    if (history_reader_open(&reader, year, month, day) != ESP_OK) {
+        return;     // Giorno mancante: buco nella serie
+    }
+
+    history_sample_t sample;
+    while (history_reader_next(&reader, &sample) == ESP_OK) {
+        range_add(b, base + sample.minute_of_day, &sample);
+    }
+
+    history_reader_close(&reader);
+}
+
+esp_err_t log_range_handler(httpd_req_t *req)
+{
+    // Trasferimento lungo: eseguito da un worker, il task httpd resta libero
+    if (!http_async_is_worker()) {
+        return http_async_submit(req, log_range_handler);
+    }
 
-    httpd_resp_sendstr_chunk(req, "]");
-    httpd_resp_sendstr_chunk(req, NULL);
+    // Parametri: ?from=YYYYMMDD&to=YYYYMMDD[&points=N]
+    char from_str[16] = {0};
+    char to_str[16] = {0};
+    char points_str[8] = {0};
+    size_t buf_len = httpd_req_get_url_query_len(req) + 1;
 
+    if (buf_len > 1) {
+        char *buf = (char*)malloc(buf_len);
+        if (httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
+            httpd_query_key_value(buf, "from", from_str, sizeof(from_str));
+            httpd_query_key_value(buf, "to", to_str, sizeof(to_str));
+            httpd_query_key_value(buf, "points", points_str, sizeof(points_str));
+        }
+        free(buf);
+    }
+
+    uint16_t from_y, to_y;
+    uint8_t from_m, from_d, to_m, to_d;
+    if (!parse_date_str(from_str, &from_y, &from_m, &from_d) ||
+        !parse_date_str(to_str, &to_y, &to_m, &to_d)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid from/to date");
+        return ESP_FAIL;
+    }
+
+    int points = RANGE_DEFAULT_POINTS;
+    if (points_str[0] != '\0') {
+        points = atoi(points_str);
+        if (points < 2) points = 2;
+        if (points > RANGE_MAX_POINTS) points = RANGE_MAX_POINTS;
+    }
+
+    // Numero di giorni (mezzogiorno locale per evitare problemi con l'ora legale)
+    struct tm from_tm = {};
+    from_tm.tm_year = from_y - 1900;
+    from_tm.tm_mon = from_m - 1;
+    from_tm.tm_mday = from_d;
+    from_tm.tm_hour = 12;
+    from_tm.tm_isdst = -1;
+
+    struct tm to_tm = from_tm;
+    to_tm.tm_year = to_y - 1900;
+    to_tm.tm_mon = to_m - 1;
+    to_tm.tm_mday = to_d;
+
+    time_t from_t = mktime(&from_tm);
+    time_t to_t = mktime(&to_tm);
+    long num_days = (long)((to_t - from_t + 43200) / 86400) + 1;
+
+    if (to_t < from_t || num_days > RANGE_MAX_DAYS) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid range");
+        return ESP_FAIL;
+    }
+
+    // Ogni bucket produce al più 2 punti (min e max)
+    uint32_t total_minutes = num_days * HISTORY_SAMPLES_PER_DAY;
+    uint32_t buckets = points / 2;
+    uint32_t bucket_minutes = (total_minutes + buckets - 1) / buckets;
+
+    ESP_LOGI(TAG, "Range %s-%s: %ld days, %d points, bucket %lu min",
+             from_str, to_str, num_days, points, (unsigned long)bucket_minutes);
+
+    char *out = (char*)malloc(JSON_WRITER_BUF_SIZE);
+    if (out == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+
+    json_writer_t w;
+    json_writer_init(&w, req, out, JSON_WRITER_BUF_SIZE);
+    json_writer_str(&w, "{\"from\":\"");
+    json_writer_int(&w, from_y);
+    json_writer_char(&w, '-');
+    json_writer_2digits(&w, from_m);
+    json_writer_char(&w, '-');
+    json_writer_2digits(&w, from_d);
+    json_writer_str(&w, "\",\"days\":");
+    json_writer_int(&w, (int32_t)num_days);
+    json_writer_str(&w, ",\"bucket\":");
+    json_writer_int(&w, (int32_t)bucket_minutes);
+    json_writer_str(&w, ",\"data\":[");
+
+    range_bucket_t bucket = {};
+    bucket.w = &w;
+    bucket.bucket_minutes = bucket_minutes;
+    bucket.first = true;
+    range_flush(&bucket);   // Inizializza estremi
+
+    for (long i = 0; i < num_days && w.err == ESP_OK; i++) {
+        struct tm day_tm = from_tm;
+        day_tm.tm_mday += i;
+        mktime(&day_tm);
+
+        range_add_day(&bucket, i, day_tm.tm_year + 1900, day_tm.tm_mon + 1, day_tm.tm_mday);
+    }
+    range_flush(&bucket);
+
+    json_writer_str(&w, "]}");
+    esp_err_t ret = json_writer_finish(&w);
+    free(out);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send range JSON");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Sent %lu bytes in %u chunks", (unsigned long)w.bytes_sent, w.chunks_sent);
     return ESP_OK;
 }
 
@@ -336,7 +1088,7 @@ esp_err_t register_log_handlers(httpd_handle_t server)
         .user_ctx = NULL
     };
 
-    esp_err_t ret = httpd_register_uri_handler(server, &log_data_uri);
+    esp_err_t ret = http_register_uri(server, &log_data_uri);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to register /api/log handler: %s", esp_err_to_name(ret));
         return ret;
@@ -350,7 +1102,7 @@ esp_err_t register_log_handlers(httpd_handle_t server)
         .user_ctx = NULL
     };
 
-    ret = httpd_register_uri_handler(server, &log_raw_uri);
+    ret = http_register_uri(server, &log_raw_uri);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to register /api/log/raw handler: %s", esp_err_to_name(ret));
         return ret;
@@ -364,7 +1116,7 @@ esp_err_t register_log_handlers(httpd_handle_t server)
         .user_ctx = NULL
     };
 
-    ret = httpd_register_uri_handler(server, &log_current_uri);
+    ret = http_register_uri(server, &log_current_uri);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to register /api/log/current handler: %s", esp_err_to_name(ret));
         return ret;
@@ -378,12 +1130,40 @@ esp_err_t register_log_handlers(httpd_handle_t server)
         .user_ctx = NULL
     };
 
-    ret = httpd_register_uri_handler(server, &log_list_uri);
+    ret = http_register_uri(server, &log_list_uri);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to register /api/log/list handler: %s", esp_err_to_name(ret));
         return ret;
     }
 
-    ESP_LOGI(TAG, "Log API handlers registered (JSON + Binary + Current + List)");
+    // Registra handler aggregati orari/giornalieri/mensili
+    httpd_uri_t rollup_uri = {
+        .uri = "/api/history/rollup",
+        .method = HTTP_GET,
+        .handler = log_rollup_handler,
+        .user_ctx = NULL
+    };
+
+    ret = http_register_uri(server, &rollup_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register /api/history/rollup handler: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Registra handler serie multi-giorno sottocampionata
+    httpd_uri_t range_uri = {
+        .uri = "/api/log/range",
+        .method = HTTP_GET,
+        .handler = log_range_handler,
+        .user_ctx = NULL
+    };
+
+    ret = http_register_uri(server, &range_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register /api/log/range handler: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Log API handlers registered (JSON + Binary + Current + List + Rollup + Range)");
     return ESP_OK;
 }
@@ -17,6 +17,8 @@
 #include "esp_lcd_panel_interface.h"
 
 #include "lv_port.h"
+#include "metrics.h"
+#include "trace.h"
 #include "lvgl.h"
 
 #ifdef ESP_LVGL_PORT_TOUCH_COMPONENT
@@ -70,6 +72,7 @@ typedef struct {
 *******************************************************************************/
 static lvgl_port_ctx_t lvgl_port_ctx;
 static int lvgl_port_timer_period_ms = 5;
+static metrics_histogram_t lvgl_port_flush_latency = METRICS_HISTOGRAM_LATENCY_INIT;  /* Exported on /metrics */
 
 /*******************************************************************************
 * Function definitions
@@ -119,6 +122,9 @@ esp_err_t lvgl_port_init(const lvgl_port_cfg_t *cfg)
     }
     ESP_GOTO_ON_FALSE(res == pdPASS, ESP_FAIL, err, TAG, "Create LVGL task fail!");
 
+    metrics_register("lvgl_flush_duration_seconds", "LVGL flush callback time (rotation and panel transfer)",
+                     NULL, METRIC_HISTOGRAM, &lvgl_port_flush_latency);
+
 err:
     if (ret != ESP_OK) {
         lvgl_port_deinit();
@@ -417,6 +423,7 @@ static bool lvgl_port_flush_ready_callback(esp_lcd_panel_io_handle_t panel_io, e
     lvgl_port_display_ctx_t *disp_ctx = disp_drv->user_data;
     assert(disp_ctx != NULL);
 
+    TRACE_INSTANT(TRACE_LCD_DMA_DONE, 0);
     if (disp_ctx->trans_done_sem) {
         xSemaphoreGiveFromISR(disp_ctx->trans_done_sem, &taskAwake);
     }
@@ -431,6 +438,8 @@ static void lvgl_port_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area,
     lvgl_port_display_ctx_t *disp_ctx = (lvgl_port_display_ctx_t *)drv->user_data;
     assert(disp_ctx != NULL);
 
+    const int64_t flush_start = esp_timer_get_time();
+    TRACE_BEGIN(TRACE_LVGL_FLUSH, 0);
     const int x_start = area->x1;
     const int x_end = area->x2;
     const int y_start = area->y1;
@@ -478,6 +487,7 @@ static void lvgl_port_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area,
         }
 
         for (int i = 0; i < trans_count; i++) {
+            TRACE_BEGIN(TRACE_LVGL_CHUNK, i);
 
             if (LV_DISP_ROT_90 == rotate) {
                 trans_width = (x_end - x_start_tmp + 1) > max_width ? max_width : (x_end - x_start_tmp + 1);
@@ -554,6 +564,7 @@ static void lvgl_port_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area,
 
             xSemaphoreTake(disp_ctx->trans_done_sem, portMAX_DELAY);
             esp_lcd_panel_draw_bitmap(disp_ctx->panel_handle, x_draw_start, y_draw_start, x_draw_end + 1, y_draw_end + 1, to);
+            TRACE_END(TRACE_LVGL_CHUNK, i);
 
             if (LV_DISP_ROT_90 == rotate) {
                 x_start_tmp += max_width;
@@ -568,6 +579,8 @@ static void lvgl_port_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area,
     } else {
         esp_lcd_panel_draw_bitmap(disp_ctx->panel_handle, x_start, y_start, x_end + 1, y_end + 1, color_map);
     }
+    metrics_histogram_observe(&lvgl_port_flush_latency, (uint32_t)(esp_timer_get_time() - flush_start));
+    TRACE_END(TRACE_LVGL_FLUSH, 0);
     lv_disp_flush_ready(drv);
 }
 
@@ -7,6 +7,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_system.h"
@@ -18,13 +19,21 @@
 #include "comune.h"
 #include "wifi.h"
 #include "storage_manager.h"
+#include "storage_writer.h"
 #include "time_sync.h"
 #include "history_manager.h"
+#include "minute_aggregator.h"
+#include "status_push.h"
 #include "sensor_simulator.h"
 #include "bme280_sensor.h"
 #include "esp_wifi.h"
 #include "display_manager.h"
 #include "esp_task_wdt.h"
+#include "esp_timer.h"
+#include "metrics.h"
+#include "task_profiler.h"
+#include "console.h"
+#include "trace.h"
 
 static const char *TAG = "MAIN";
 
@@ -33,10 +42,22 @@ static const char *TAG = "MAIN";
 // ============================================================================
 
 thermostat_config_t g_config;   // Non-static per accesso da status_api.cpp
-thermostat_state_t g_state;     // Non-static per accesso da status_api.cpp
+static thermostat_state_t g_state;  // Solo status_task; gli altri task leggono status_push_get_current()
 
 static bool use_real_sensor = false;  // true se BME280 disponibile
 
+// Metriche /metrics della lettura BME280
+static metrics_histogram_t s_sensor_latency = METRICS_HISTOGRAM_LATENCY_INIT;
+static metrics_counter_t s_sensor_errors;
+
+// Ritardo del risveglio di status_task rispetto al secondo dell'orologio
+static const uint32_t s_jitter_bounds_us[] = {
+    1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000
+};
+static metrics_histogram_t s_tick_jitter = {
+    s_jitter_bounds_us, sizeof(s_jitter_bounds_us) / sizeof(s_jitter_bounds_us[0])
+};
+
 // ============================================================================
 // Tasks
 // ============================================================================
@@ -70,6 +91,9 @@ static float get_current_setpoint(void)
  * @brief Task di status (ogni secondo)
  *
  * Aggiorna simulazione sensore, display e registra sample allo scoccare del minuto.
+ * Il risveglio è allineato al secondo dell'orologio (non 1000 ms dopo la
+ * fine del giro precedente), quindi il ritardo non si accumula; un minuto
+ * saltato per un giro lento viene colmato da history_record().
  */
 static void status_task(void *pvParameters)
 {
@@ -82,9 +106,22 @@ static void status_task(void *pvParameters)
     // Wait for WiFi to be ready
     vTaskDelay(pdMS_TO_TICKS(2000));
 
-    static int last_minute = -1;  // Per rilevare cambio minuto
+    metrics_register("status_tick_jitter_seconds", "Status loop wake-up delay after the wall-clock second",
+                     NULL, METRIC_HISTOGRAM, &s_tick_jitter);
+
+    static int64_t last_minute = -1;  // Minuti dall'epoch dell'ultimo giro
+    static minute_aggregator_t minute_agg;  // Letture del minuto in corso
+    minute_aggregator_reset(&minute_agg);
 
     while (1) {
+        TRACE_BEGIN(TRACE_STATUS_LOOP, 0);
+
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        if (last_minute >= 0) {
+            metrics_histogram_observe(&s_tick_jitter, (uint32_t)tv.tv_usec);
+        }
+
         // Ottieni ora corrente
         time_t now;
         struct tm timeinfo;
@@ -102,11 +139,17 @@ static void status_task(void *pvParameters)
         uint8_t humidity;
         uint16_t pressure;
         bool heater_on;
+        bool reading_valid = true;      // false = valori in cache, fuori dalla media
 
+        TRACE_BEGIN(TRACE_SENSOR_READ, 0);
         if (use_real_sensor) {
             // Leggi dal BME280
             bme280_data_t sensor_data;
-            if (bme280_read(&sensor_data) == ESP_OK && sensor_data.valid) {
+            int64_t read_start = esp_timer_get_time();
+            esp_err_t read_ret = bme280_read(&sensor_data);
+            metrics_histogram_observe(&s_sensor_latency, (uint32_t)(esp_timer_get_time() - read_start));
+
+            if (read_ret == ESP_OK && sensor_data.valid) {
                 temperature = sensor_data.temperature + g_config.temp_correction;
                 humidity = (uint8_t)sensor_data.humidity;
                 pressure = (uint16_t)(sensor_data.pressure * 10.0f);  // Decimi di hPa
@@ -133,6 +176,8 @@ static void status_task(void *pvParameters)
                 humidity = g_state.current_humidity;
                 pressure = g_state.current_pressure;
                 heater_on = g_state.relay_state;
+                reading_valid = false;
+                metrics_counter_inc(&s_sensor_errors);
                 ESP_LOGW(TAG, "BME280 read failed, using cached values");
             }
         } else {
@@ -145,6 +190,7 @@ static void status_task(void *pvParameters)
             pressure = sensor_sim_get_pressure();
             heater_on = sensor_sim_get_heater_state();
         }
+        TRACE_END(TRACE_SENSOR_READ, 0);
 
         // Aggiorna stato globale
         g_state.current_temperature = temperature;
@@ -154,25 +200,66 @@ static void status_task(void *pvParameters)
         g_state.active_setpoint = setpoint;
         g_state.active_bank = 0;  // Programma 0 (Standard)
 
-        // Rileva cambio minuto - registra sample esattamente allo scoccare
-        int current_minute = timeinfo.tm_min;
+        // Rileva cambio minuto - registra sample esattamente allo scoccare.
+        // Minuti dall'epoch invece di tm_min: un giro che salta un minuto intero
+        // viene comunque visto come cambio
+        int64_t current_minute = now / 60;
         if (current_minute != last_minute && last_minute >= 0) {
-            // Nuovo minuto! Registra sample
-            esp_err_t ret = history_record(temperature, humidity, pressure,
-                                           setpoint, heater_on, g_config.manual_mode, 0);
-            if (ret == ESP_OK) {
-                ESP_LOGI(TAG, "Sample recorded at %02d:%02d - T=%.1f°C H=%d%% P=%d hPa",
-                         timeinfo.tm_hour, timeinfo.tm_min,
-                         temperature, humidity, pressure);
+            // Nuovo minuto! Registra la media delle letture del minuto concluso,
+            // con la sua data: alle 00:00 è il 23:59 del giorno prima
+            history_minute_t minute_values;
+            if (minute_aggregator_finish(&minute_agg, last_minute, &minute_values)) {
+                TRACE_BEGIN(TRACE_HISTORY_RECORD, 0);
+                esp_err_t ret = history_record(&minute_values, setpoint, heater_on,
+                                               g_config.manual_mode, 0);
+                TRACE_END(TRACE_HISTORY_RECORD, 0);
+                if (ret == ESP_OK) {
+                    uint16_t rec_year, recorded;
+                    uint8_t rec_month, rec_day;
+                    minute_aggregator_slot(last_minute, &rec_year, &rec_month, &rec_day, &recorded);
+                    ESP_LOGI(TAG, "Sample recorded at %02d:%02d - T=%.2f°C (%.2f..%.2f) H=%d%% P=%d hPa",
+                             recorded / 60, recorded % 60,
+                             minute_values.temperature / 100.0f,
+                             minute_values.t_min / 100.0f, minute_values.t_max / 100.0f,
+                             minute_values.humidity, minute_values.pressure);
+                }
+            } else {
+                ESP_LOGW(TAG, "No valid readings in the last minute, sample skipped");
             }
 
-            // Salva su flash alle ore intere (minuto 0)
-            if (timeinfo.tm_min == 0) {
-                history_save_to_file();
+            // Salva su flash al cambio d'ora, anche se il minuto 0 è stato saltato
+            // (fusi orari a ore intere: l'ora UTC cambia insieme a quella locale)
+            // Scrittura nel task writer: una pausa di SPIFFS non ferma questo loop
+            if (current_minute / 60 != last_minute / 60) {
+                history_request_save();
             }
         }
         last_minute = current_minute;
 
+        // La lettura del secondo :00 apre il nuovo minuto
+        if (reading_valid) {
+            minute_aggregator_add(&minute_agg, (int16_t)(temperature * 100), humidity, pressure);
+        }
+
+        // Invia lo stato ai client WebSocket (solo se cambiato)
+        status_snapshot_t snap;
+        snap.timestamp = now;
+        snap.temperature = (int16_t)(temperature * 100);
+        snap.humidity = humidity;
+        snap.pressure = pressure;
+        snap.setpoint = (int16_t)(setpoint * 100);
+        snap.heater_on = heater_on;
+        snap.samples = history_get_sample_count();
+        status_push_publish(&snap);
+
+        status_config_t cfg;
+        cfg.hysteresis = (int16_t)(g_config.hysteresis * 100);
+        cfg.temp_correction = (int16_t)(g_config.temp_correction * 100);
+        cfg.manual_mode = g_config.manual_mode;
+        cfg.manual_setpoint = (int16_t)(g_config.manual_setpoint * 100);
+        cfg.active_bank = g_state.active_bank;
+        status_push_publish_config(&cfg);
+
         // Get WiFi RSSI
         wifi_ap_record_t ap_info;
         int8_t rssi = 0;
@@ -184,17 +271,25 @@ static void status_task(void *pvParameters)
         uint32_t free_heap = esp_get_free_heap_size();
 
         // Update display with current status
+        TRACE_BEGIN(TRACE_DISPLAY_UPDATE, 0);
         display_update_status(temperature, timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, heater_on);
+        TRACE_END(TRACE_DISPLAY_UPDATE, 0);
 
         // Print status line
+        TRACE_BEGIN(TRACE_STATUS_PRINTF, 0);
         printf("[%s] WiFi:%ddBm T:%.2f°C H:%d%% P:%dhPa Set:%.1f°C %s Heap:%lu\n",
                time_str, rssi, temperature, humidity, pressure, setpoint,
                heater_on ? "ON" : "OFF", free_heap);
+        TRACE_END(TRACE_STATUS_PRINTF, 0);
 
         // Reset Task Watchdog - dimostra che il task è vivo
         esp_task_wdt_reset();
 
-        vTaskDelay(pdMS_TO_TICKS(1000));  // Ogni secondo
+        TRACE_END(TRACE_STATUS_LOOP, 0);
+
+        // Attesa fino al prossimo secondo dell'orologio (+1 tick: mai prima del confine)
+        gettimeofday(&tv, NULL);
+        vTaskDelay(pdMS_TO_TICKS(1000 - tv.tv_usec / 1000) + 1);
     }
 }
 
@@ -346,9 +441,17 @@ extern "C" void app_main(void)
     ESP_LOGI(TAG, "Initializing SPIFFS...");
     ESP_ERROR_CHECK(storage_init());
 
+    // Task per le scritture su SPIFFS (flush dello storico)
+    if (storage_writer_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Storage writer not started, history saved inline");
+    }
+
     // TODO: Carica configurazione salvata
     // config_load(&g_config);
 
+    // Stato per i client WebSocket (usato dal web server)
+    status_push_init();
+
     // Inizializza WiFi
     ESP_LOGI(TAG, "Initializing WiFi...");
     setup_wifi();
@@ -369,9 +472,12 @@ extern "C" void app_main(void)
         ESP_LOGW(TAG, "History manager init failed: %s", esp_err_to_name(hist_ret));
     }
 
-    // TODO: Inizializza console/telnet
-    // console_start();
-    // telnet_start();
+    // Profilo CPU dei task (/api/debug/tasks, comando 't' della console)
+    task_profiler_init();
+
+    // Console seriale di diagnostica
+    console_start();
+    // TODO: telnet_start();
 
     // TODO: Inizializza web server
     // http_server_start();
@@ -381,6 +487,11 @@ extern "C" void app_main(void)
     if (bme280_init() == ESP_OK) {
         ESP_LOGI(TAG, "BME280 sensor initialized - using real sensor");
         use_real_sensor = true;
+
+        metrics_register("sensor_read_duration_seconds", "BME280 read time",
+                         NULL, METRIC_HISTOGRAM, &s_sensor_latency);
+        metrics_register("sensor_read_errors_total", "Failed BME280 reads",
+                         NULL, METRIC_COUNTER, &s_sensor_errors);
     } else {
         ESP_LOGW(TAG, "BME280 not found - using sensor simulator");
         use_real_sensor = false;
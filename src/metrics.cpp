@@ -0,0 +1,365 @@
+/**
+ * @file metrics.cpp
+ * @brief Implementazione registro metriche e handler /metrics
+ */
+
+#include "metrics.h"
+#include "json_writer.h"
+#include "wifi.h"
+#include "ws_session.h"
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char* TAG = "METRICS";
+
+// ============================================================================
+// STRUTTURE PRIVATE
+// ============================================================================
+
+typedef struct {
+    const char* name;
+    const char* help;
+    const char* labels;
+    metric_type_t type;
+    void* metric;
+    bool ready;                 // Scritto per ultimo: l'entry è completa
+} metrics_entry_t;
+
+// ============================================================================
+// VARIABILI STATICHE
+// ============================================================================
+
+const uint32_t metrics_latency_bounds_us[METRICS_LATENCY_NUM_BOUNDS] = {
+    1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 10000000
+};
+
+static metrics_entry_t s_entries[METRICS_MAX_ENTRIES];
+static uint32_t s_num_entries = 0;      // Slot assegnati (può superare il massimo)
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static inline int shard(void)
+{
+    return xPortGetCoreID();
+}
+
+/**
+ * @brief Somma a 64 bit su due parole: riporto in hi se lo trabocca
+ */
+static inline void add64(uint32_t* lo, uint32_t* hi, uint32_t n)
+{
+    uint32_t old = __atomic_fetch_add(lo, n, __ATOMIC_RELAXED);
+    if (old > UINT32_MAX - n) {
+        __atomic_fetch_add(hi, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void write_u64(json_writer_t* w, uint64_t v)
+{
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%llu", (unsigned long long)v);
+    json_writer_str(w, buf);
+}
+
+/**
+ * @brief Scrive µs come secondi (es. 2500 → 0.0025)
+ */
+static void write_seconds(json_writer_t* w, uint64_t us)
+{
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%llu.%06llu",
+                     (unsigned long long)(us / 1000000), (unsigned long long)(us % 1000000));
+
+    // Zeri finali e punto superflui
+    while (n > 0 && buf[n - 1] == '0') {
+        n--;
+    }
+    if (n > 0 && buf[n - 1] == '.') {
+        n--;
+    }
+    json_writer_raw(w, buf, n);
+}
+
+/**
+ * @brief Scrive nome{etichette[,extra]}
+ */
+static void write_series(json_writer_t* w, const char* name, const char* suffix,
+                         const char* labels, const char* extra)
+{
+    json_writer_str(w, name);
+    if (suffix != NULL) {
+        json_writer_str(w, suffix);
+    }
+
+    bool has_labels = labels != NULL && labels[0] != '\0';
+    if (has_labels || extra != NULL) {
+        json_writer_char(w, '{');
+        if (has_labels) {
+            json_writer_str(w, labels);
+        }
+        if (extra != NULL) {
+            if (has_labels) {
+                json_writer_char(w, ',');
+            }
+            json_writer_str(w, extra);
+        }
+        json_writer_char(w, '}');
+    }
+    json_writer_char(w, ' ');
+}
+
+static void write_header(json_writer_t* w, const char* name, const char* help, const char* type)
+{
+    json_writer_str(w, "# HELP ");
+    json_writer_str(w, name);
+    json_writer_char(w, ' ');
+    json_writer_str(w, help);
+    json_writer_str(w, "\n# TYPE ");
+    json_writer_str(w, name);
+    json_writer_char(w, ' ');
+    json_writer_str(w, type);
+    json_writer_char(w, '\n');
+}
+
+static void write_histogram(json_writer_t* w, const metrics_entry_t* e)
+{
+    const metrics_histogram_t* h = (const metrics_histogram_t*)e->metric;
+    uint64_t cumulative = 0;
+    char le[40];
+
+    for (int b = 0; b <= h->num_bounds; b++) {
+        for (int s = 0; s < METRICS_SHARDS; s++) {
+            cumulative += h->buckets[s][b];
+        }
+
+        if (b < h->num_bounds) {
+            uint32_t us = h->bounds[b];
+            int n = snprintf(le, sizeof(le), "le=\"%lu.%06lu", (unsigned long)(us / 1000000),
+                             (unsigned long)(us % 1000000));
+            while (le[n - 1] == '0') {
+                n--;
+            }
+            if (le[n - 1] == '.') {
+                n--;
+            }
+            le[n++] = '"';
+            le[n] = '\0';
+        } else {
+            strcpy(le, "le=\"+Inf\"");
+        }
+
+        write_series(w, e->name, "_bucket", e->labels, le);
+        write_u64(w, cumulative);
+        json_writer_char(w, '\n');
+    }
+
+    write_series(w, e->name, "_sum", e->labels, NULL);
+    write_seconds(w, metrics_counter_read(&h->sum));
+    json_writer_char(w, '\n');
+
+    write_series(w, e->name, "_count", e->labels, NULL);
+    write_u64(w, cumulative);
+    json_writer_char(w, '\n');
+}
+
+static void write_entry(json_writer_t* w, const metrics_entry_t* e)
+{
+    switch (e->type) {
+    case METRIC_COUNTER:
+        write_series(w, e->name, NULL, e->labels, NULL);
+        write_u64(w, metrics_counter_read((const metrics_counter_t*)e->metric));
+        json_writer_char(w, '\n');
+        break;
+
+    case METRIC_GAUGE: {
+        const metrics_gauge_t* g = (const metrics_gauge_t*)e->metric;
+        write_series(w, e->name, NULL, e->labels, NULL);
+        json_writer_int(w, g->read != NULL ? g->read() : __atomic_load_n(&g->value, __ATOMIC_RELAXED));
+        json_writer_char(w, '\n');
+        break;
+    }
+
+    case METRIC_HISTOGRAM:
+        write_histogram(w, e);
+        break;
+    }
+}
+
+/**
+ * @brief Metriche registrate, raggruppate per famiglia
+ */
+static void write_registry(json_writer_t* w)
+{
+    static const char* type_names[] = { "counter", "gauge", "histogram" };
+
+    uint32_t count = __atomic_load_n(&s_num_entries, __ATOMIC_ACQUIRE);
+    if (count > METRICS_MAX_ENTRIES) {
+        count = METRICS_MAX_ENTRIES;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        const metrics_entry_t* e = &s_entries[i];
+        if (!__atomic_load_n(&e->ready, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+
+        // Famiglia già scritta con un'entry precedente?
+        bool seen = false;
+        for (uint32_t j = 0; j < i && !seen; j++) {
+            seen = s_entries[j].ready && strcmp(s_entries[j].name, e->name) == 0;
+        }
+        if (seen) {
+            continue;
+        }
+
+        write_header(w, e->name, e->help, type_names[e->type]);
+        for (uint32_t k = i; k < count; k++) {
+            if (s_entries[k].ready && strcmp(s_entries[k].name, e->name) == 0) {
+                write_entry(w, &s_entries[k]);
+            }
+        }
+    }
+}
+
+static void write_gauge_line(json_writer_t* w, const char* name, const char* help, uint64_t value)
+{
+    write_header(w, name, help, "gauge");
+    write_series(w, name, NULL, NULL, NULL);
+    write_u64(w, value);
+    json_writer_char(w, '\n');
+}
+
+/**
+ * @brief Metriche di sistema lette al momento della richiesta
+ */
+static void write_system(json_writer_t* w)
+{
+    write_gauge_line(w, "esp_heap_free_bytes", "Free internal heap",
+                     heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    write_gauge_line(w, "esp_heap_min_free_bytes", "Minimum free internal heap since boot",
+                     heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+    write_gauge_line(w, "esp_psram_free_bytes", "Free PSRAM",
+                     heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    write_gauge_line(w, "esp_psram_min_free_bytes", "Minimum free PSRAM since boot",
+                     heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM));
+    write_gauge_line(w, "esp_uptime_seconds", "Time since boot",
+                     (uint64_t)(esp_timer_get_time() / 1000000));
+    write_gauge_line(w, "ws_sessions", "Connected WebSocket clients", ws_session_count());
+
+    write_header(w, "wifi_reconnects_total", "WiFi reconnection attempts", "counter");
+    write_series(w, "wifi_reconnects_total", NULL, NULL, NULL);
+    write_u64(w, wifi_get_reconnect_count());
+    json_writer_char(w, '\n');
+
+    write_header(w, "wifi_disconnects_total", "WiFi disconnections", "counter");
+    write_series(w, "wifi_disconnects_total", NULL, NULL, NULL);
+    write_u64(w, wifi_get_disconnect_count());
+    json_writer_char(w, '\n');
+
+    // Stack libero minimo (high-water mark) di ogni task, in byte
+    UBaseType_t num_tasks = uxTaskGetNumberOfTasks() + 2;
+    TaskStatus_t* tasks = (TaskStatus_t*)malloc(num_tasks * sizeof(TaskStatus_t));
+    if (tasks == NULL) {
+        return;
+    }
+
+    num_tasks = uxTaskGetSystemState(tasks, num_tasks, NULL);
+    write_header(w, "freertos_task_stack_free_min_bytes", "Task stack high-water mark", "gauge");
+    for (UBaseType_t i = 0; i < num_tasks; i++) {
+        char label[48];
+        snprintf(label, sizeof(label), "task=\"%s\"", tasks[i].pcTaskName);
+        write_series(w, "freertos_task_stack_free_min_bytes", NULL, label, NULL);
+        write_u64(w, tasks[i].usStackHighWaterMark);
+        json_writer_char(w, '\n');
+    }
+
+    free(tasks);
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+void metrics_counter_add(metrics_counter_t* c, uint32_t n)
+{
+    int s = shard();
+    add64(&c->lo[s], &c->hi[s], n);
+}
+
+void metrics_gauge_set(metrics_gauge_t* g, int32_t value)
+{
+    __atomic_store_n(&g->value, value, __ATOMIC_RELAXED);
+}
+
+void metrics_histogram_observe(metrics_histogram_t* h, uint32_t value_us)
+{
+    int b = 0;
+    while (b < h->num_bounds && value_us > h->bounds[b]) {
+        b++;
+    }
+
+    int s = shard();
+    __atomic_fetch_add(&h->buckets[s][b], 1, __ATOMIC_RELAXED);
+    add64(&h->sum.lo[s], &h->sum.hi[s], value_us);
+}
+
+uint64_t metrics_counter_read(const metrics_counter_t* c)
+{
+    uint64_t total = 0;
+    for (int s = 0; s < METRICS_SHARDS; s++) {
+        uint32_t hi = __atomic_load_n(&c->hi[s], __ATOMIC_RELAXED);
+        uint32_t lo = __atomic_load_n(&c->lo[s], __ATOMIC_RELAXED);
+        total += ((uint64_t)hi << 32) | lo;
+    }
+    return total;
+}
+
+esp_err_t metrics_register(const char* name, const char* help, const char* labels,
+                           metric_type_t type, void* metric)
+{
+    uint32_t i = __atomic_fetch_add(&s_num_entries, 1, __ATOMIC_RELAXED);
+    if (i >= METRICS_MAX_ENTRIES) {
+        ESP_LOGE(TAG, "Registry full, %s not registered", name);
+        return ESP_ERR_NO_MEM;
+    }
+
+    metrics_entry_t* e = &s_entries[i];
+    e->name = name;
+    e->help = help;
+    e->labels = labels;
+    e->type = type;
+    e->metric = metric;
+    __atomic_store_n(&e->ready, true, __ATOMIC_RELEASE);
+
+    return ESP_OK;
+}
+
+esp_err_t metrics_handler(httpd_req_t *req)
+{
+    char* buf = (char*)malloc(JSON_WRITER_BUF_SIZE);
+    if (buf == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_ERR_NO_MEM;
+    }
+
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    json_writer_t w;
+    json_writer_init(&w, req, buf, JSON_WRITER_BUF_SIZE);
+    write_registry(&w);
+    write_system(&w);
+    esp_err_t ret = json_writer_finish(&w);
+
+    free(buf);
+    return ret;
+}
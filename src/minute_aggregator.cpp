@@ -0,0 +1,77 @@
+/**
+ * @file minute_aggregator.cpp
+ * @brief Implementazione aggregazione delle letture al minuto
+ */
+
+#include "minute_aggregator.h"
+
+#include <string.h>
+#include <time.h>
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+/**
+ * @brief Divisione intera arrotondata al più vicino (anche per valori negativi)
+ */
+static inline int32_t div_round(int32_t sum, int32_t count)
+{
+    return (sum >= 0 ? sum + count / 2 : sum - count / 2) / count;
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+void minute_aggregator_reset(minute_aggregator_t* agg)
+{
+    memset(agg, 0, sizeof(minute_aggregator_t));
+}
+
+void minute_aggregator_add(minute_aggregator_t* agg, int16_t temperature,
+                           uint8_t humidity, uint16_t pressure)
+{
+    if (agg->count == 0 || temperature < agg->t_min) {
+        agg->t_min = temperature;
+    }
+    if (agg->count == 0 || temperature > agg->t_max) {
+        agg->t_max = temperature;
+    }
+
+    agg->t_sum += temperature;
+    agg->h_sum += humidity;
+    agg->p_sum += pressure;
+    agg->count++;
+}
+
+bool minute_aggregator_finish(minute_aggregator_t* agg, int64_t epoch_minute,
+                              history_minute_t* out)
+{
+    if (agg->count == 0) {
+        return false;
+    }
+
+    out->epoch_minute = epoch_minute;
+    out->temperature = (int16_t)div_round(agg->t_sum, agg->count);
+    out->t_min = agg->t_min;
+    out->t_max = agg->t_max;
+    out->humidity = (uint8_t)div_round((int32_t)agg->h_sum, agg->count);
+    out->pressure = (uint16_t)div_round((int32_t)agg->p_sum, agg->count);
+
+    minute_aggregator_reset(agg);
+    return true;
+}
+
+void minute_aggregator_slot(int64_t epoch_minute, uint16_t* year, uint8_t* month,
+                            uint8_t* day, uint16_t* minute_of_day)
+{
+    time_t t = (time_t)(epoch_minute * 60);
+    struct tm timeinfo;
+    localtime_r(&t, &timeinfo);
+
+    *year = timeinfo.tm_year + 1900;
+    *month = timeinfo.tm_mon + 1;
+    *day = timeinfo.tm_mday;
+    *minute_of_day = timeinfo.tm_hour * 60 + timeinfo.tm_min;
+}
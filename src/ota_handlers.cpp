@@ -1,5 +1,8 @@
 #include "ota_handlers.h"
 #include "storage_manager.h"
+#include "static_cache.h"
+#include "http_async.h"
+#include "http_server.h"
 
 #include <esp_log.h>
 #include <esp_system.h>
@@ -7,19 +10,63 @@
 #include <esp_ota_ops.h>
 #include <esp_partition.h>
 #include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
 
 static const char *TAG = "OTA_HANDLERS";
 
+// Un solo aggiornamento alla volta (firmware o SPIFFS): due esp_ota_begin
+// sulla stessa partizione si cancellerebbero a vicenda
+static portMUX_TYPE s_ota_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_ota_active = false;
+
+static bool ota_try_begin(httpd_req_t* req) {
+    taskENTER_CRITICAL(&s_ota_lock);
+    bool ok = !s_ota_active;
+    s_ota_active = true;
+    taskEXIT_CRITICAL(&s_ota_lock);
+
+    if (!ok) {
+        ESP_LOGW(TAG, "OTA già in corso, rifiuto %s", req->uri);
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "30");
+        httpd_resp_sendstr(req, "OTA gia' in corso");
+    }
+    return ok;
+}
+
+static void ota_finish(void) {
+    taskENTER_CRITICAL(&s_ota_lock);
+    s_ota_active = false;
+    taskEXIT_CRITICAL(&s_ota_lock);
+}
+
 // =====================================
 // OTA Firmware Handler
 // =====================================
 
+static esp_err_t ota_firmware_receive(httpd_req_t* req);
+
 esp_err_t ota_firmware_handler(httpd_req_t* req) {
+    // Upload lungo: eseguito da un worker, il task httpd resta libero
+    if (!http_async_is_worker()) {
+        return http_async_submit_storage(req, ota_firmware_handler, HTTP_ASYNC_STORAGE_NONE);
+    }
+
     if (req->method != HTTP_POST) {
         httpd_resp_send_err(req, HTTPD_405_METHOD_NOT_ALLOWED, "Metodo non permesso");
         return ESP_FAIL;
     }
 
+    if (!ota_try_begin(req)) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = ota_firmware_receive(req);
+    ota_finish();
+    return ret;
+}
+
+static esp_err_t ota_firmware_receive(httpd_req_t* req) {
     // Partizione di destinazione
     const esp_partition_t* update_part = esp_ota_get_next_update_partition(nullptr);
     if (!update_part) {
@@ -132,12 +179,30 @@ esp_err_t ota_firmware_handler(httpd_req_t* req) {
 // OTA SPIFFS Handler
 // =====================================
 
+static esp_err_t ota_spiffs_receive(httpd_req_t* req);
+
 esp_err_t ota_spiffs_handler(httpd_req_t* req) {
+    // Upload lungo: eseguito da un worker, il task httpd resta libero
+    if (!http_async_is_worker()) {
+        // Accesso esclusivo: nessun download o job di scrittura ha file aperti
+        return http_async_submit_storage(req, ota_spiffs_handler, HTTP_ASYNC_STORAGE_EXCLUSIVE);
+    }
+
     if (req->method != HTTP_POST) {
         httpd_resp_send_err(req, HTTPD_405_METHOD_NOT_ALLOWED, "Metodo non permesso");
         return ESP_FAIL;
     }
 
+    if (!ota_try_begin(req)) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = ota_spiffs_receive(req);
+    ota_finish();
+    return ret;
+}
+
+static esp_err_t ota_spiffs_receive(httpd_req_t* req) {
     // Trova partizione SPIFFS
     const esp_partition_t* part = esp_partition_find_first(
         ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, "storage");
@@ -155,8 +220,10 @@ esp_err_t ota_spiffs_handler(httpd_req_t* req) {
     ESP_LOGI(TAG, "Inizio OTA SPIFFS, dimensione: %d bytes, partizione: %u bytes",
              req->content_len, (unsigned int)part->size);
 
-    // 1) Smonta il filesystem per evitare accessi concorrenti
+    // 1) Smonta il filesystem: con l'accesso esclusivo nessun altro task
+    //    ha file aperti (la cache dei file statici si riferisce alla vecchia immagine)
     ESP_LOGI(TAG, "Smonto SPIFFS...");
+    static_cache_invalidate(NULL);
     storage_unmount();
 
     // 2) Preparazione buffer
@@ -315,7 +382,7 @@ esp_err_t register_ota_handlers(httpd_handle_t server) {
         .handle_ws_control_frames = NULL,
         .supported_subprotocol = NULL
     };
-    ret = httpd_register_uri_handler(server, &ota_fw_post);
+    ret = http_register_uri(server, &ota_fw_post);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Registrazione /ota_firmware fallita: %s", esp_err_to_name(ret));
         return ret;
@@ -332,7 +399,7 @@ esp_err_t register_ota_handlers(httpd_handle_t server) {
         .handle_ws_control_frames = NULL,
         .supported_subprotocol = NULL
     };
-    ret = httpd_register_uri_handler(server, &ota_fs_post);
+    ret = http_register_uri(server, &ota_fs_post);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Registrazione /ota_spiffs fallita: %s", esp_err_to_name(ret));
         return ret;
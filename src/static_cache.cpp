@@ -0,0 +1,263 @@
+/**
+ * @file static_cache.cpp
+ * @brief Implementazione cache PSRAM dei file statici
+ */
+
+#include "static_cache.h"
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+static const char* TAG = "STATIC_CACHE";
+
+// ============================================================================
+// VARIABILI STATICHE
+// ============================================================================
+
+static static_cache_entry_t* s_entries[STATIC_CACHE_MAX_ENTRIES];
+static static_cache_stats_t s_stats = {0};
+static SemaphoreHandle_t s_mutex = NULL;
+static uint32_t s_clock = 0;                // Contatore accessi per last_used
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static void free_entry(int slot)
+{
+    static_cache_entry_t* e = s_entries[slot];
+
+    if (e->data != NULL) {
+        s_stats.bytes -= e->size;
+        heap_caps_free(e->data);
+    }
+    heap_caps_free(e);
+
+    s_entries[slot] = NULL;
+    s_stats.entries--;
+}
+
+/**
+ * @brief Calcola l'ETag dal contenuto
+ *
+ * Per i .gz si usano CRC32 e dimensione originale dal trailer gzip,
+ * come in serve_spiffs_file(); per gli altri il CRC32 del contenuto.
+ */
+static void compute_etag(static_cache_entry_t* e)
+{
+    size_t len = strlen(e->path);
+    bool gzip = len > 3 && strcmp(e->path + len - 3, ".gz") == 0;
+
+    if (gzip && e->size >= 18) {
+        uint32_t trailer[2];
+        memcpy(trailer, e->data + e->size - 8, 8);
+        snprintf(e->etag, sizeof(e->etag), "\"gz-%08lx-%lx\"",
+                 (unsigned long)trailer[0], (unsigned long)trailer[1]);
+    } else {
+        uint32_t crc = esp_rom_crc32_le(0, e->data, e->size);
+        snprintf(e->etag, sizeof(e->etag), "\"%08lx-%lx\"",
+                 (unsigned long)crc, (unsigned long)e->size);
+    }
+}
+
+/**
+ * @brief Carica un file da SPIFFS in una nuova entry (chiamare sotto lock)
+ *
+ * @return Entry, o NULL se il file non è cacheabile
+ */
+static static_cache_entry_t* load_entry(const char* path)
+{
+    if (strlen(path) >= sizeof(((static_cache_entry_t*)0)->path)) {
+        return NULL;
+    }
+
+    struct stat st;
+    bool present = (stat(path, &st) == 0);
+
+    if (present && (st.st_size > STATIC_CACHE_MAX_FILE ||
+                    s_stats.bytes + st.st_size > STATIC_CACHE_BUDGET)) {
+        ESP_LOGW(TAG, "%s not cacheable (%ld bytes)", path, (long)st.st_size);
+        return NULL;
+    }
+
+    // Slot libero, altrimenti l'assenza usata meno di recente: i file
+    // presenti non vengono mai sostituiti da altri file o assenze
+    int slot = -1;
+    int lru_miss = -1;
+    for (int i = 0; i < STATIC_CACHE_MAX_ENTRIES; i++) {
+        static_cache_entry_t* e = s_entries[i];
+        if (e == NULL) {
+            slot = i;
+            break;
+        }
+        if (!e->present && e->refs == 0 &&
+            (lru_miss < 0 || e->last_used < s_entries[lru_miss]->last_used)) {
+            lru_miss = i;
+        }
+    }
+
+    if (slot < 0 && lru_miss >= 0) {
+        ESP_LOGD(TAG, "Evicting %s (not present)", s_entries[lru_miss]->path);
+        free_entry(lru_miss);
+        slot = lru_miss;
+    }
+
+    if (slot < 0) {
+        return NULL;
+    }
+
+    static_cache_entry_t* e = (static_cache_entry_t*)heap_caps_calloc(
+        1, sizeof(static_cache_entry_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (e == NULL) {
+        return NULL;
+    }
+
+    strcpy(e->path, path);
+    e->present = present;
+
+    if (present && st.st_size > 0) {
+        e->data = (uint8_t*)heap_caps_malloc(st.st_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        FILE* f = fopen(path, "rb");
+        bool ok = e->data != NULL && f != NULL &&
+                  fread(e->data, 1, st.st_size, f) == (size_t)st.st_size;
+        if (f != NULL) {
+            fclose(f);
+        }
+
+        if (!ok) {
+            ESP_LOGE(TAG, "Failed to load %s", path);
+            heap_caps_free(e->data);
+            heap_caps_free(e);
+            return NULL;
+        }
+
+        e->size = st.st_size;
+        compute_etag(e);
+    }
+
+    s_entries[slot] = e;
+    s_stats.entries++;
+    s_stats.bytes += e->size;
+
+    ESP_LOGI(TAG, "Cached %s (%u bytes%s)", path, (unsigned int)e->size,
+             present ? "" : ", not present");
+    return e;
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+esp_err_t static_cache_init(void)
+{
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
+        if (s_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+static_cache_entry_t* static_cache_get(const char* path)
+{
+    if (s_mutex == NULL) {
+        return NULL;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    static_cache_entry_t* e = NULL;
+    for (int i = 0; i < STATIC_CACHE_MAX_ENTRIES; i++) {
+        if (s_entries[i] != NULL && !s_entries[i]->stale &&
+            strcmp(s_entries[i]->path, path) == 0) {
+            e = s_entries[i];
+            break;
+        }
+    }
+
+    if (e != NULL) {
+        s_stats.hits++;
+    } else {
+        e = load_entry(path);
+        if (e != NULL) {
+            s_stats.misses++;
+        } else {
+            s_stats.bypass++;
+        }
+    }
+
+    if (e != NULL) {
+        e->refs++;
+        e->last_used = ++s_clock;
+    }
+
+    xSemaphoreGive(s_mutex);
+    return e;
+}
+
+void static_cache_release(static_cache_entry_t* entry)
+{
+    if (entry == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    entry->refs--;
+    if (entry->stale && entry->refs == 0) {
+        for (int i = 0; i < STATIC_CACHE_MAX_ENTRIES; i++) {
+            if (s_entries[i] == entry) {
+                free_entry(i);
+                break;
+            }
+        }
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+void static_cache_invalidate(const char* path)
+{
+    if (s_mutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    for (int i = 0; i < STATIC_CACHE_MAX_ENTRIES; i++) {
+        static_cache_entry_t* e = s_entries[i];
+        if (e == NULL || (path != NULL && strcmp(e->path, path) != 0)) {
+            continue;
+        }
+
+        if (e->refs > 0) {
+            e->stale = true;    // Liberata dall'ultimo static_cache_release()
+        } else {
+            free_entry(i);
+        }
+        s_stats.invalidations++;
+    }
+
+    xSemaphoreGive(s_mutex);
+
+    ESP_LOGI(TAG, "Invalidated %s", path != NULL ? path : "all entries");
+}
+
+void static_cache_get_stats(static_cache_stats_t* stats)
+{
+    if (s_mutex == NULL) {
+        memset(stats, 0, sizeof(static_cache_stats_t));
+        return;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    *stats = s_stats;
+    xSemaphoreGive(s_mutex);
+}
@@ -6,46 +6,31 @@
 #include "status_api.h"
 #include "comune.h"
 #include "history_manager.h"
+#include "status_push.h"
+#include "http_server.h"
 #include <esp_log.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 
 static const char *TAG = "STATUS_API";
 
-// Riferimento a stato e config globali definiti in main.cpp
-extern thermostat_state_t g_state;
+// Riferimento alla config globale definita in main.cpp
 extern thermostat_config_t g_config;
 
 esp_err_t status_handler(httpd_req_t *req)
 {
-    // Ottieni contatore sample dal buffer history
-    uint16_t sample_count = history_get_sample_count();
-
-    // Ottieni data/ora corrente
-    time_t now;
-    struct tm timeinfo;
-    time(&now);
-    localtime_r(&now, &timeinfo);
-
-    // Costruisci risposta JSON con data/ora
-    char json[192];
-    int len = snprintf(json, sizeof(json),
-        "{\"temp\":%.2f,\"hum\":%d,\"press\":%.1f,\"setpoint\":%.1f,\"heat\":%d,\"samples\":%d,"
-        "\"year\":%d,\"month\":%d,\"day\":%d,\"hour\":%d,\"min\":%d,\"sec\":%d,\"wday\":%d}",
-        g_state.current_temperature,
-        g_state.current_humidity,
-        g_state.current_pressure / 10.0f,  // Converti da decimi a hPa
-        g_state.active_setpoint,
-        g_state.relay_state ? 1 : 0,
-        sample_count,
-        timeinfo.tm_year + 1900,
-        timeinfo.tm_mon + 1,
-        timeinfo.tm_mday,
-        timeinfo.tm_hour,
-        timeinfo.tm_min,
-        timeinfo.tm_sec,
-        timeinfo.tm_wday
-    );
+    // Ultimo snapshot pubblicato da status_task, stesso formato dei frame
+    // WebSocket: copia coerente senza lock
+    status_snapshot_t snap;
+    if (!status_push_get_current(&snap)) {
+        memset(&snap, 0, sizeof(snap));     // Prima lettura non ancora fatta
+        time(&snap.timestamp);
+        snap.samples = history_get_sample_count();
+    }
+
+    char json[STATUS_JSON_MAX_LEN];
+    int len = status_format_json(&snap, json, sizeof(json));
 
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json, len);
@@ -98,7 +83,7 @@ esp_err_t register_status_handler(httpd_handle_t server)
         .user_ctx = NULL
     };
 
-    esp_err_t ret = httpd_register_uri_handler(server, &status_uri);
+    esp_err_t ret = http_register_uri(server, &status_uri);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to register /api/status: %s", esp_err_to_name(ret));
         return ret;
@@ -112,7 +97,7 @@ esp_err_t register_status_handler(httpd_handle_t server)
         .user_ctx = NULL
     };
 
-    ret = httpd_register_uri_handler(server, &program_uri);
+    ret = http_register_uri(server, &program_uri);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to register /api/program: %s", esp_err_to_name(ret));
         return ret;
@@ -0,0 +1,192 @@
+/**
+ * @file status_push.cpp
+ * @brief Implementazione invio stato ai client WebSocket
+ */
+
+#include "status_push.h"
+#include "ws_session.h"
+#include "ws_protocol.h"
+#include "history_manager.h"
+#include "seqlock.h"
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <stdio.h>
+
+static const char* TAG = "STATUS_PUSH";
+
+// ============================================================================
+// VARIABILI STATICHE
+// ============================================================================
+
+static status_snapshot_t s_last;            // Ultimo stato inviato (solo status_task)
+static bool s_has_last = false;
+
+// Ultimo stato letto (scritto da status_task a ogni giro, letto da httpd e
+// dalle risincronizzazioni senza lock)
+static status_snapshot_t s_current;
+static seqlock_t s_current_seq = SEQLOCK_INIT;
+
+static status_config_t s_config;
+static bool s_has_config = false;
+static SemaphoreHandle_t s_mutex = NULL;
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+/**
+ * @brief Stato completo per un client nuovo o in ritardo (vedi ws_resync_fn_t)
+ *
+ * Frame 0 = STATUS completo, frame 1 = CONFIG completo.
+ */
+static size_t encode_full_state(uint8_t* buf, size_t cap, uint8_t index)
+{
+    size_t len = 0;
+    status_snapshot_t snap;
+
+    if (index == 0 && status_push_get_current(&snap)) {
+        return ws_encode_status(buf, cap, &snap, WS_STATUS_ALL);
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (index <= 1 && s_has_config) {
+        len = ws_encode_config(buf, cap, &s_config, WS_CONFIG_ALL);
+    }
+    xSemaphoreGive(s_mutex);
+
+    return len;
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+esp_err_t status_push_init(void)
+{
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
+        if (s_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ws_session_init(encode_full_state);
+}
+
+int status_format_json(const status_snapshot_t* snap, char* buf, size_t len)
+{
+    struct tm timeinfo;
+    localtime_r(&snap->timestamp, &timeinfo);
+
+    int n = snprintf(buf, len,
+        "{\"temp\":%.2f,\"hum\":%d,\"press\":%.1f,\"setpoint\":%.1f,\"heat\":%d,\"samples\":%d,"
+        "\"year\":%d,\"month\":%d,\"day\":%d,\"hour\":%d,\"min\":%d,\"sec\":%d,\"wday\":%d}",
+        snap->temperature / 100.0f,
+        snap->humidity,
+        snap->pressure / 10.0f,  // Converti da decimi a hPa
+        snap->setpoint / 100.0f,
+        snap->heater_on ? 1 : 0,
+        snap->samples,
+        timeinfo.tm_year + 1900,
+        timeinfo.tm_mon + 1,
+        timeinfo.tm_mday,
+        timeinfo.tm_hour,
+        timeinfo.tm_min,
+        timeinfo.tm_sec,
+        timeinfo.tm_wday
+    );
+
+    if (n < 0) {
+        n = 0;
+    } else if ((size_t)n >= len) {
+        n = len - 1;
+    }
+    return n;
+}
+
+void status_push_publish(const status_snapshot_t* snap)
+{
+    if (s_mutex == NULL) {
+        return;
+    }
+
+    // Sempre, anche senza differenze visibili: /api/status mostra i centesimi
+    seqlock_write_begin(&s_current_seq);
+    s_current = *snap;
+    seqlock_write_end(&s_current_seq);
+
+    uint8_t mask = s_has_last ? ws_status_diff(snap, &s_last) : WS_STATUS_ALL;
+    if (mask == 0) {
+        return;
+    }
+
+    bool first = !s_has_last;
+    s_last = *snap;
+    s_has_last = true;
+
+    if (first || ws_session_count() == 0) {
+        return;
+    }
+
+    ESP_LOGD(TAG, "Status changed, mask 0x%02x, %d clients", mask, ws_session_count());
+
+    uint8_t frame[WS_PROTO_MAX_FRAME];
+
+    // Cambio caldaia come evento con il suo orario
+    if (mask & WS_STATUS_HEAT) {
+        ws_session_broadcast(frame, ws_encode_relay(frame, sizeof(frame),
+                                                    snap->timestamp, snap->heater_on));
+        mask &= ~WS_STATUS_HEAT;
+    }
+
+    // Nuovo sample: la pagina lo aggiunge al grafico senza scaricare il log
+    history_sample_t sample;
+    if ((mask & WS_STATUS_SAMPLES) && snap->samples > 0 &&
+        history_get_sample(snap->samples - 1, &sample) == ESP_OK) {
+        uint32_t now_local = ws_local_time(snap->timestamp);
+        ws_session_broadcast(frame, ws_encode_sample(frame, sizeof(frame),
+                                                     now_local - now_local % 86400U, &sample));
+    }
+
+    if (mask != 0) {
+        ws_session_broadcast(frame, ws_encode_status(frame, sizeof(frame), snap, mask));
+    }
+}
+
+bool status_push_get_current(status_snapshot_t* snap)
+{
+    if (!seqlock_published(&s_current_seq)) {
+        return false;
+    }
+
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&s_current_seq);
+        *snap = s_current;
+    } while (seqlock_read_retry(&s_current_seq, seq));
+
+    return true;
+}
+
+void status_push_publish_config(const status_config_t* config)
+{
+    if (s_mutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    // Prima pubblicazione: nessun client ha ancora una configurazione da aggiornare
+    uint8_t mask = s_has_config ? ws_config_diff(config, &s_config) : 0;
+    s_config = *config;
+    s_has_config = true;
+    xSemaphoreGive(s_mutex);
+
+    if (mask == 0 || ws_session_count() == 0) {
+        return;
+    }
+
+    uint8_t frame[WS_PROTO_MAX_FRAME];
+    ws_session_broadcast(frame, ws_encode_config(frame, sizeof(frame), config, mask));
+}
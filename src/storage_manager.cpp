@@ -6,11 +6,20 @@
 #include "storage_manager.h"
 #include "esp_log.h"
 #include "esp_spiffs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include <sys/stat.h>
 
 static const char *TAG = "STORAGE";
 static bool spiffs_mounted = false;
 
+// Access lock: shared holders and exclusive owner (see storage_acquire)
+static portMUX_TYPE s_access_lock = portMUX_INITIALIZER_UNLOCKED;
+static int s_shared_holders = 0;
+static bool s_exclusive = false;
+
+#define STORAGE_POLL_MS     10
+
 /**
  * @brief Initialize SPIFFS filesystem
  */
@@ -116,3 +125,87 @@ esp_err_t storage_remount(void)
     ESP_LOGI(TAG, "Remounting SPIFFS...");
     return storage_init();
 }
+
+/**
+ * @brief Take shared access to SPIFFS
+ */
+bool storage_acquire(uint32_t wait_ms)
+{
+    uint32_t waited = 0;
+
+    while (1) {
+        taskENTER_CRITICAL(&s_access_lock);
+        bool ok = !s_exclusive;
+        if (ok) {
+            s_shared_holders++;
+        }
+        taskEXIT_CRITICAL(&s_access_lock);
+
+        if (ok) {
+            return true;
+        }
+        if (wait_ms != STORAGE_WAIT_FOREVER && waited >= wait_ms) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(STORAGE_POLL_MS));
+        waited += STORAGE_POLL_MS;
+    }
+}
+
+/**
+ * @brief Release shared access
+ */
+void storage_release(void)
+{
+    taskENTER_CRITICAL(&s_access_lock);
+    if (s_shared_holders > 0) {
+        s_shared_holders--;
+    }
+    taskEXIT_CRITICAL(&s_access_lock);
+}
+
+/**
+ * @brief Take exclusive access to SPIFFS
+ */
+bool storage_acquire_exclusive(uint32_t wait_ms)
+{
+    taskENTER_CRITICAL(&s_access_lock);
+    bool ok = !s_exclusive;
+    if (ok) {
+        s_exclusive = true;             // From now on storage_acquire() waits
+    }
+    taskEXIT_CRITICAL(&s_access_lock);
+
+    if (!ok) {
+        ESP_LOGW(TAG, "Exclusive access already taken");
+        return false;
+    }
+
+    uint32_t waited = 0;
+    while (1) {
+        taskENTER_CRITICAL(&s_access_lock);
+        int holders = s_shared_holders;
+        taskEXIT_CRITICAL(&s_access_lock);
+
+        if (holders == 0) {
+            return true;
+        }
+        if (wait_ms != STORAGE_WAIT_FOREVER && waited >= wait_ms) {
+            ESP_LOGW(TAG, "Exclusive access timed out, %d shared holders", holders);
+            storage_release_exclusive();
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(STORAGE_POLL_MS));
+        waited += STORAGE_POLL_MS;
+    }
+}
+
+/**
+ * @brief Release exclusive access
+ */
+void storage_release_exclusive(void)
+{
+    taskENTER_CRITICAL(&s_access_lock);
+    s_exclusive = false;
+    taskEXIT_CRITICAL(&s_access_lock);
+}
@@ -0,0 +1,198 @@
+/**
+ * @file storage_writer.cpp
+ * @brief Implementazione task di scrittura su SPIFFS
+ */
+
+#include "storage_writer.h"
+#include "metrics.h"
+#include "storage_manager.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+static const char* TAG = "STORAGE_WR";
+
+// ============================================================================
+// STRUTTURE PRIVATE
+// ============================================================================
+
+typedef struct {
+    storage_job_fn_t fn;
+    const char* name;
+    int64_t queued_us;                      // Accodamento (attesa nei log)
+} storage_job_t;
+
+// ============================================================================
+// VARIABILI STATICHE
+// ============================================================================
+
+static QueueHandle_t s_queue = NULL;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static storage_job_fn_t s_pending[STORAGE_WRITER_QUEUE_LEN];   // Job in coda (per la fusione)
+
+static int32_t read_depth(void);
+
+static metrics_gauge_t s_depth_gauge = { 0, read_depth };
+static metrics_histogram_t s_job_latency = METRICS_HISTOGRAM_LATENCY_INIT;
+static metrics_counter_t s_jobs_coalesced;
+static metrics_counter_t s_jobs_dropped;
+static metrics_counter_t s_jobs_failed;
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+/**
+ * @brief Segna fn come in coda; false se lo era già o il registro è pieno
+ *
+ * @param full Impostato se non c'è posto per fn
+ */
+static bool pending_add(storage_job_fn_t fn, bool* full)
+{
+    int free_slot = -1;
+    *full = false;
+
+    for (int i = 0; i < STORAGE_WRITER_QUEUE_LEN; i++) {
+        if (s_pending[i] == fn) {
+            return false;
+        }
+        if (s_pending[i] == NULL && free_slot < 0) {
+            free_slot = i;
+        }
+    }
+
+    if (free_slot < 0) {
+        *full = true;
+        return false;
+    }
+
+    s_pending[free_slot] = fn;
+    return true;
+}
+
+static int32_t read_depth(void)
+{
+    return storage_writer_queue_depth();
+}
+
+static void pending_remove(storage_job_fn_t fn)
+{
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < STORAGE_WRITER_QUEUE_LEN; i++) {
+        if (s_pending[i] == fn) {
+            s_pending[i] = NULL;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+static void writer_task(void* pvParameters)
+{
+    storage_job_t job;
+
+    while (1) {
+        if (xQueueReceive(s_queue, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        // Tolto prima dell'esecuzione: una richiesta arrivata durante la
+        // scrittura riguarda dati più recenti e va eseguita di nuovo
+        pending_remove(job.fn);
+
+        // Attende la fine di un OTA SPIFFS o di un upload (accesso esclusivo)
+        storage_acquire(STORAGE_WAIT_FOREVER);
+
+        int64_t start_us = esp_timer_get_time();
+        esp_err_t ret = job.fn();
+        int64_t end_us = esp_timer_get_time();
+
+        storage_release();
+
+        metrics_histogram_observe(&s_job_latency, (uint32_t)(end_us - start_us));
+        if (ret != ESP_OK) {
+            metrics_counter_inc(&s_jobs_failed);
+            ESP_LOGW(TAG, "Job %s failed: %s", job.name, esp_err_to_name(ret));
+        }
+
+        ESP_LOGD(TAG, "Job %s: waited %lld us, ran %lld us", job.name,
+                 (long long)(start_us - job.queued_us), (long long)(end_us - start_us));
+    }
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+esp_err_t storage_writer_init(void)
+{
+    if (s_queue != NULL) {
+        return ESP_OK;
+    }
+
+    s_queue = xQueueCreate(STORAGE_WRITER_QUEUE_LEN, sizeof(storage_job_t));
+    if (s_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Stack in RAM interna: il task accede a SPIFFS (cache flash disabilitata)
+    if (xTaskCreate(writer_task, "storage_wr", STORAGE_WRITER_STACK_SIZE, NULL,
+                    STORAGE_WRITER_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create writer task");
+        vQueueDelete(s_queue);
+        s_queue = NULL;
+        return ESP_FAIL;
+    }
+
+    metrics_register("storage_writer_queue_depth", "Storage jobs waiting for the writer task",
+                     NULL, METRIC_GAUGE, &s_depth_gauge);
+    metrics_register("storage_writer_job_duration_seconds", "Storage job execution time",
+                     NULL, METRIC_HISTOGRAM, &s_job_latency);
+    metrics_register("storage_writer_coalesced_total", "Storage requests merged into a queued job",
+                     NULL, METRIC_COUNTER, &s_jobs_coalesced);
+    metrics_register("storage_writer_dropped_total", "Storage requests rejected with a full queue",
+                     NULL, METRIC_COUNTER, &s_jobs_dropped);
+    metrics_register("storage_writer_failed_total", "Storage jobs that returned an error",
+                     NULL, METRIC_COUNTER, &s_jobs_failed);
+
+    ESP_LOGI(TAG, "Storage writer started (queue %d)", STORAGE_WRITER_QUEUE_LEN);
+    return ESP_OK;
+}
+
+esp_err_t storage_writer_post(storage_job_fn_t fn, const char* name)
+{
+    // Senza task writer il job gira nel chiamante come prima
+    if (s_queue == NULL) {
+        return fn();
+    }
+
+    bool full;
+    taskENTER_CRITICAL(&s_lock);
+    bool added = pending_add(fn, &full);
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (!added && !full) {
+        metrics_counter_inc(&s_jobs_coalesced);
+        return ESP_OK;
+    }
+
+    storage_job_t job = { .fn = fn, .name = name, .queued_us = esp_timer_get_time() };
+    if (full || xQueueSend(s_queue, &job, 0) != pdTRUE) {
+        if (added) {
+            pending_remove(fn);
+        }
+        metrics_counter_inc(&s_jobs_dropped);
+        ESP_LOGW(TAG, "Queue full, job %s dropped", name);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    return ESP_OK;
+}
+
+int storage_writer_queue_depth(void)
+{
+    return s_queue != NULL ? (int)uxQueueMessagesWaiting(s_queue) : 0;
+}
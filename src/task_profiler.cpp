@@ -0,0 +1,401 @@
+/**
+ * @file task_profiler.cpp
+ * @brief Implementazione profilo CPU e stack dei task FreeRTOS
+ */
+
+#include "task_profiler.h"
+#include "json_writer.h"
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char* TAG = "TASK_PROF";
+
+// ============================================================================
+// STRUTTURE PRIVATE
+// ============================================================================
+
+/**
+ * @brief Task tracciato con i delta di run-time degli ultimi periodi
+ */
+typedef struct {
+    TaskHandle_t handle;                    // NULL = slot libero
+    UBaseType_t number;
+    uint32_t last_counter;                  // ulRunTimeCounter all'ultimo campione
+    bool seen;                              // Presente nell'ultimo campione
+    task_profile_t info;                    // Stato, priorità, stack (ultimo campione)
+    uint32_t delta[TASK_PROFILER_HISTORY];  // µs di CPU per periodo
+} task_slot_t;
+
+// ============================================================================
+// VARIABILI STATICHE
+// ============================================================================
+
+static const uint8_t s_windows[TASK_PROFILER_NUM_WINDOWS] = { 1, 10, 60 };
+
+static task_slot_t* s_slots = NULL;         // PSRAM: ~10 KB
+static TaskStatus_t* s_status = NULL;       // Buffer per uxTaskGetSystemState
+static uint32_t s_elapsed[TASK_PROFILER_HISTORY];   // Durata di ogni periodo (µs)
+static uint8_t s_head = 0;                  // Periodo più recente
+static uint8_t s_filled = 0;                // Periodi validi
+static int64_t s_last_us = 0;
+static TaskHandle_t s_idle[portNUM_PROCESSORS];
+static SemaphoreHandle_t s_mutex = NULL;
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static char state_char(eTaskState state)
+{
+    switch (state) {
+    case eRunning:   return 'X';
+    case eReady:     return 'R';
+    case eBlocked:   return 'B';
+    case eSuspended: return 'S';
+    case eDeleted:   return 'D';
+    default:         return '?';
+    }
+}
+
+static task_slot_t* find_slot(const TaskStatus_t* st)
+{
+    task_slot_t* free_slot = NULL;
+
+    for (int i = 0; i < TASK_PROFILER_MAX_TASKS; i++) {
+        task_slot_t* slot = &s_slots[i];
+        if (slot->handle == st->xHandle && slot->number == st->xTaskNumber) {
+            return slot;
+        }
+        if (slot->handle == NULL && free_slot == NULL) {
+            free_slot = slot;
+        }
+    }
+
+    if (free_slot != NULL) {
+        // Task nuovo: il primo periodo parte da questo campione
+        memset(free_slot, 0, sizeof(task_slot_t));
+        free_slot->handle = st->xHandle;
+        free_slot->number = st->xTaskNumber;
+        free_slot->last_counter = st->ulRunTimeCounter;
+    }
+    return free_slot;
+}
+
+/**
+ * @brief Legge i contatori di tutti i task e chiude un periodo
+ */
+static void take_sample(void)
+{
+    UBaseType_t count = uxTaskGetSystemState(s_status, TASK_PROFILER_MAX_TASKS, NULL);
+    int64_t now = esp_timer_get_time();
+
+    if (count == 0) {
+        ESP_LOGW(TAG, "More than %d tasks, sample skipped", TASK_PROFILER_MAX_TASKS);
+        return;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    s_head = (s_head + 1) % TASK_PROFILER_HISTORY;
+    s_elapsed[s_head] = (uint32_t)(now - s_last_us);
+    s_last_us = now;
+    if (s_filled < TASK_PROFILER_HISTORY) {
+        s_filled++;
+    }
+
+    for (int i = 0; i < TASK_PROFILER_MAX_TASKS; i++) {
+        s_slots[i].seen = false;
+    }
+
+    for (UBaseType_t t = 0; t < count; t++) {
+        const TaskStatus_t* st = &s_status[t];
+        task_slot_t* slot = find_slot(st);
+        if (slot == NULL) {
+            continue;
+        }
+
+        // Differenza senza segno: corretta anche dopo il wrap del contatore
+        slot->delta[s_head] = st->ulRunTimeCounter - slot->last_counter;
+        slot->last_counter = st->ulRunTimeCounter;
+        slot->seen = true;
+
+        task_profile_t* info = &slot->info;
+        strncpy(info->name, st->pcTaskName, sizeof(info->name) - 1);
+        info->number = st->xTaskNumber;
+        info->core = (st->xCoreID == tskNO_AFFINITY) ? -1 : (int8_t)st->xCoreID;
+        info->priority = (uint8_t)st->uxCurrentPriority;
+        info->base_priority = (uint8_t)st->uxBasePriority;
+        info->state = state_char(st->eCurrentState);
+        info->stack_free_min = st->usStackHighWaterMark;   // Byte su ESP-IDF
+    }
+
+    // Task terminati
+    for (int i = 0; i < TASK_PROFILER_MAX_TASKS; i++) {
+        if (s_slots[i].handle != NULL && !s_slots[i].seen) {
+            s_slots[i].handle = NULL;
+        }
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+/**
+ * @brief CPU in centesimi di % sugli ultimi periods periodi (sotto lock)
+ */
+static uint16_t window_cpu(const task_slot_t* slot, uint8_t periods)
+{
+    uint64_t busy = 0;
+    uint64_t elapsed = 0;
+
+    for (uint8_t p = 0; p < periods && p < s_filled; p++) {
+        uint8_t i = (s_head + TASK_PROFILER_HISTORY - p) % TASK_PROFILER_HISTORY;
+        busy += slot->delta[i];
+        elapsed += s_elapsed[i];
+    }
+
+    if (elapsed == 0) {
+        return 0;
+    }
+    uint64_t cpu = busy * 10000 / elapsed;
+    return cpu > 10000 ? 10000 : (uint16_t)cpu;
+}
+
+static void profiler_task(void* pvParameters)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(TASK_PROFILER_PERIOD_MS));
+        take_sample();
+    }
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+esp_err_t task_profiler_init(void)
+{
+    if (s_mutex != NULL) {
+        return ESP_OK;
+    }
+
+    s_slots = (task_slot_t*)heap_caps_calloc(TASK_PROFILER_MAX_TASKS, sizeof(task_slot_t),
+                                             MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_status = (TaskStatus_t*)heap_caps_malloc(TASK_PROFILER_MAX_TASKS * sizeof(TaskStatus_t),
+                                               MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_mutex = xSemaphoreCreateMutex();
+    if (s_slots == NULL || s_status == NULL || s_mutex == NULL) {
+        ESP_LOGE(TAG, "Out of memory");
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        s_idle[c] = xTaskGetIdleTaskHandleForCPU(c);
+    }
+
+    // Primo campione: i contatori di partenza, nessun periodo ancora
+    UBaseType_t count = uxTaskGetSystemState(s_status, TASK_PROFILER_MAX_TASKS, NULL);
+    s_last_us = esp_timer_get_time();
+    for (UBaseType_t t = 0; t < count; t++) {
+        find_slot(&s_status[t]);
+    }
+
+    if (xTaskCreate(profiler_task, "task_prof", TASK_PROFILER_STACK_SIZE, NULL,
+                    TASK_PROFILER_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create profiler task");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Task profiler started (%d ms period)", TASK_PROFILER_PERIOD_MS);
+    return ESP_OK;
+}
+
+int task_profiler_get(task_profile_t* tasks, int max, task_profiler_summary_t* summary)
+{
+    if (s_mutex == NULL) {
+        return 0;
+    }
+
+    int count = 0;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    if (summary != NULL) {
+        memset(summary, 0, sizeof(task_profiler_summary_t));
+        for (int w = 0; w < TASK_PROFILER_NUM_WINDOWS; w++) {
+            summary->window_s[w] = (s_windows[w] < s_filled ? s_windows[w] : s_filled) *
+                                   TASK_PROFILER_PERIOD_MS / 1000;
+        }
+    }
+
+    for (int i = 0; i < TASK_PROFILER_MAX_TASKS && s_filled > 0; i++) {
+        const task_slot_t* slot = &s_slots[i];
+        if (slot->handle == NULL || !slot->seen) {
+            continue;
+        }
+
+        uint16_t cpu[TASK_PROFILER_NUM_WINDOWS];
+        for (int w = 0; w < TASK_PROFILER_NUM_WINDOWS; w++) {
+            cpu[w] = window_cpu(slot, s_windows[w]);
+        }
+
+        // Carico del core = tempo non passato nel suo task IDLE
+        for (int c = 0; summary != NULL && c < portNUM_PROCESSORS; c++) {
+            if (slot->handle == s_idle[c]) {
+                for (int w = 0; w < TASK_PROFILER_NUM_WINDOWS; w++) {
+                    summary->core_load[c][w] = 10000 - cpu[w];
+                }
+            }
+        }
+
+        if (count >= max) {
+            continue;
+        }
+
+        // Inserimento ordinato per CPU decrescente sulla finestra di 10 s
+        int pos = count;
+        while (pos > 0 && tasks[pos - 1].cpu[1] < cpu[1]) {
+            tasks[pos] = tasks[pos - 1];
+            pos--;
+        }
+        tasks[pos] = slot->info;
+        memcpy(tasks[pos].cpu, cpu, sizeof(cpu));
+        count++;
+    }
+
+    xSemaphoreGive(s_mutex);
+    return count;
+}
+
+void task_profiler_print(void)
+{
+    task_profile_t* tasks = (task_profile_t*)malloc(TASK_PROFILER_MAX_TASKS * sizeof(task_profile_t));
+    if (tasks == NULL) {
+        printf("Out of memory\n");
+        return;
+    }
+
+    task_profiler_summary_t summary;
+    int count = task_profiler_get(tasks, TASK_PROFILER_MAX_TASKS, &summary);
+    if (count == 0) {
+        printf("Task profiler not ready\n");
+        free(tasks);
+        return;
+    }
+
+    printf("\n=== Tasks (CPU %% of one core over %us / %us / %us) ===\n",
+           summary.window_s[0], summary.window_s[1], summary.window_s[2]);
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        printf("Core %d load: %3u.%02u%% %3u.%02u%% %3u.%02u%%\n", c,
+               summary.core_load[c][0] / 100, summary.core_load[c][0] % 100,
+               summary.core_load[c][1] / 100, summary.core_load[c][1] % 100,
+               summary.core_load[c][2] / 100, summary.core_load[c][2] % 100);
+    }
+
+    printf("%-16s %4s %4s %8s %8s %8s %3s %6s\n",
+           "Task", "Core", "Prio", "1s", "10s", "60s", "St", "Stack");
+    for (int i = 0; i < count; i++) {
+        const task_profile_t* t = &tasks[i];
+        char core[4];
+        char prio[8];
+        snprintf(core, sizeof(core), t->core < 0 ? "-" : "%d", t->core);
+        if (t->priority != t->base_priority) {
+            snprintf(prio, sizeof(prio), "%u/%u", t->priority, t->base_priority);
+        } else {
+            snprintf(prio, sizeof(prio), "%u", t->priority);
+        }
+
+        printf("%-16s %4s %4s %4u.%02u%% %4u.%02u%% %4u.%02u%% %3c %6lu\n",
+               t->name, core, prio,
+               t->cpu[0] / 100, t->cpu[0] % 100,
+               t->cpu[1] / 100, t->cpu[1] % 100,
+               t->cpu[2] / 100, t->cpu[2] % 100,
+               t->state, (unsigned long)t->stack_free_min);
+    }
+
+    free(tasks);
+}
+
+esp_err_t task_profiler_handler(httpd_req_t *req)
+{
+    task_profile_t* tasks = (task_profile_t*)malloc(TASK_PROFILER_MAX_TASKS * sizeof(task_profile_t));
+    char* buf = (char*)malloc(JSON_WRITER_BUF_SIZE);
+    if (tasks == NULL || buf == NULL) {
+        free(tasks);
+        free(buf);
+        httpd_resp_send_500(req);
+        return ESP_ERR_NO_MEM;
+    }
+
+    task_profiler_summary_t summary;
+    int count = task_profiler_get(tasks, TASK_PROFILER_MAX_TASKS, &summary);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    json_writer_t w;
+    json_writer_init(&w, req, buf, JSON_WRITER_BUF_SIZE);
+
+    json_writer_str(&w, "{\"windows_s\":[");
+    for (int i = 0; i < TASK_PROFILER_NUM_WINDOWS; i++) {
+        if (i > 0) {
+            json_writer_char(&w, ',');
+        }
+        json_writer_int(&w, summary.window_s[i]);
+    }
+
+    json_writer_str(&w, "],\"cores\":[");
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        json_writer_str(&w, c > 0 ? ",[" : "[");
+        for (int i = 0; i < TASK_PROFILER_NUM_WINDOWS; i++) {
+            if (i > 0) {
+                json_writer_char(&w, ',');
+            }
+            json_writer_fixed(&w, summary.core_load[c][i], 2);
+        }
+        json_writer_char(&w, ']');
+    }
+
+    json_writer_str(&w, "],\"tasks\":[");
+    for (int t = 0; t < count; t++) {
+        const task_profile_t* p = &tasks[t];
+
+        json_writer_str(&w, t > 0 ? ",{\"name\":\"" : "{\"name\":\"");
+        json_writer_str(&w, p->name);
+        json_writer_str(&w, "\",\"id\":");
+        json_writer_int(&w, (int32_t)p->number);
+        json_writer_str(&w, ",\"core\":");
+        json_writer_int(&w, p->core);
+        json_writer_str(&w, ",\"prio\":");
+        json_writer_int(&w, p->priority);
+        json_writer_str(&w, ",\"base_prio\":");
+        json_writer_int(&w, p->base_priority);
+        json_writer_str(&w, ",\"state\":\"");
+        json_writer_char(&w, p->state);
+        json_writer_str(&w, "\",\"cpu\":[");
+        for (int i = 0; i < TASK_PROFILER_NUM_WINDOWS; i++) {
+            if (i > 0) {
+                json_writer_char(&w, ',');
+            }
+            json_writer_fixed(&w, p->cpu[i], 2);
+        }
+        json_writer_str(&w, "],\"stack_free\":");
+        json_writer_int(&w, (int32_t)p->stack_free_min);
+        json_writer_char(&w, '}');
+    }
+    json_writer_str(&w, "]}");
+
+    esp_err_t ret = json_writer_finish(&w);
+
+    free(buf);
+    free(tasks);
+    return ret;
+}
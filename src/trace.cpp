@@ -0,0 +1,284 @@
+/**
+ * @file trace.cpp
+ * @brief Implementazione ring di traccia per core e dump Chrome trace-event
+ */
+
+#include "trace.h"
+
+#if TRACE_ENABLE
+
+#include "json_writer.h"
+
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_ipc.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char* TAG = "TRACE";
+
+static_assert((TRACE_RING_EVENTS & (TRACE_RING_EVENTS - 1)) == 0,
+              "TRACE_RING_EVENTS must be a power of 2");
+static_assert(sizeof(trace_event_t) == 16, "trace_event_t must be 16 bytes");
+
+// Un solo processo: un task non pinnato migra tra i core e le sue coppie
+// B/E devono restare sulla stessa traccia
+#define TRACE_PID_STR           "1"
+
+// ============================================================================
+// STRUTTURE PRIVATE
+// ============================================================================
+
+typedef struct {
+    uint32_t head;                          // Eventi scritti dal boot
+    trace_event_t events[TRACE_RING_EVENTS];
+} trace_ring_t;
+
+/**
+ * @brief Riferimento tra contatore di cicli di un core ed esp_timer
+ */
+typedef struct {
+    uint32_t cycles;
+    int64_t time_us;
+} trace_anchor_t;
+
+typedef struct {
+    const char* name;
+    const char* cat;
+    bool arg_is_name;                       // arg è il nome dell'evento (const char*)
+} trace_id_info_t;
+
+// ============================================================================
+// VARIABILI STATICHE
+// ============================================================================
+
+static const trace_id_info_t s_ids[TRACE_NUM_IDS] = {
+    { "status_loop",    "status", false },
+    { "sensor_read",    "status", false },
+    { "history_record", "status", false },
+    { "display_update", "status", false },
+    { "status_printf",  "status", false },
+    { "lvgl_flush",     "lvgl",   false },
+    { "lvgl_chunk",     "lvgl",   false },
+    { "lcd_dma_done",   "lvgl",   false },
+    { "http",           "http",   true  },
+};
+
+static DRAM_ATTR trace_ring_t s_rings[portNUM_PROCESSORS];
+static volatile bool s_paused = false;     // Dump in corso: eventi ignorati
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static void take_anchor(void* arg)
+{
+    trace_anchor_t* anchor = (trace_anchor_t*)arg;
+    anchor->cycles = esp_cpu_get_cycle_count();
+    anchor->time_us = esp_timer_get_time();
+}
+
+static void write_u32(json_writer_t* w, uint32_t value)
+{
+    char buf[12];
+    int len = snprintf(buf, sizeof(buf), "%lu", (unsigned long)value);
+    json_writer_raw(w, buf, len);
+}
+
+/**
+ * @brief Scrive un timestamp in µs con 3 decimali (da ns)
+ */
+static void write_ts(json_writer_t* w, int64_t ns)
+{
+    char buf[32];
+    if (ns < 0) {
+        ns = 0;
+    }
+    int len = snprintf(buf, sizeof(buf), "%lld.%03d", (long long)(ns / 1000), (int)(ns % 1000));
+    json_writer_raw(w, buf, len);
+}
+
+static void write_event(json_writer_t* w, const trace_event_t* e, int core, int64_t ns, bool* first)
+{
+    if (e->id >= TRACE_NUM_IDS) {
+        return;
+    }
+    const trace_id_info_t* info = &s_ids[e->id];
+
+    json_writer_str(w, *first ? "\n{\"name\":\"" : ",\n{\"name\":\"");
+    *first = false;
+
+    json_writer_str(w, info->arg_is_name && e->arg != 0 ? (const char*)(uintptr_t)e->arg : info->name);
+    json_writer_str(w, "\",\"cat\":\"");
+    json_writer_str(w, info->cat);
+    json_writer_str(w, "\",\"ph\":\"");
+    json_writer_char(w, (char)e->phase);
+    json_writer_str(w, "\",\"pid\":" TRACE_PID_STR ",\"tid\":");
+    write_u32(w, e->task != 0 ? e->task : (uint32_t)core);
+    json_writer_str(w, ",\"ts\":");
+    write_ts(w, ns);
+    if (e->phase == TRACE_PHASE_INSTANT) {
+        json_writer_str(w, ",\"s\":\"t\"");
+    }
+    json_writer_str(w, ",\"args\":{\"core\":");
+    json_writer_int(w, core);
+    if (!info->arg_is_name && e->arg != 0) {
+        json_writer_str(w, ",\"arg\":");
+        json_writer_int(w, (int32_t)e->arg);
+    }
+    json_writer_str(w, "}}");
+}
+
+static void write_metadata(json_writer_t* w, const char* kind, uint32_t tid,
+                           const char* name, bool* first)
+{
+    json_writer_str(w, *first ? "\n{\"name\":\"" : ",\n{\"name\":\"");
+    *first = false;
+
+    json_writer_str(w, kind);
+    json_writer_str(w, "\",\"ph\":\"M\",\"pid\":" TRACE_PID_STR ",\"tid\":");
+    write_u32(w, tid);
+    json_writer_str(w, ",\"args\":{\"name\":\"");
+    json_writer_str(w, name);
+    json_writer_str(w, "\"}}");
+}
+
+/**
+ * @brief Nomi del processo e dei task (traccia = handle del task)
+ *
+ * Gli interrupt di ogni core hanno una traccia propria con tid = core:
+ * gli handle dei task non valgono mai 0 o 1.
+ */
+static void write_names(json_writer_t* w, bool* first)
+{
+    char name[16];
+
+    write_metadata(w, "process_name", 0, "ESP32-S3", first);
+
+    UBaseType_t num_tasks = uxTaskGetNumberOfTasks() + 2;
+    TaskStatus_t* tasks = (TaskStatus_t*)malloc(num_tasks * sizeof(TaskStatus_t));
+    if (tasks != NULL) {
+        num_tasks = uxTaskGetSystemState(tasks, num_tasks, NULL);
+    } else {
+        num_tasks = 0;
+    }
+
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        snprintf(name, sizeof(name), "ISR core %d", c);
+        write_metadata(w, "thread_name", (uint32_t)c, name, first);
+    }
+
+    for (UBaseType_t t = 0; t < num_tasks; t++) {
+        write_metadata(w, "thread_name", (uint32_t)(uintptr_t)tasks[t].xHandle,
+                       tasks[t].pcTaskName, first);
+    }
+
+    free(tasks);
+}
+
+/**
+ * @brief Eventi di un core, datati a ritroso dal suo riferimento
+ *
+ * Le differenze tra cicli consecutivi sono con segno: un evento
+ * interrotto dopo la lettura del contatore può precedere di poco
+ * nel ring quello dell'interrupt.
+ */
+static void write_core(json_writer_t* w, const trace_ring_t* ring, int core,
+                       const trace_anchor_t* anchor, uint32_t ticks_per_us, bool* first)
+{
+    uint32_t count = ring->head < TRACE_RING_EVENTS ? ring->head : TRACE_RING_EVENTS;
+    uint32_t prev_cycles = anchor->cycles;
+    int64_t age_cycles = 0;
+
+    for (uint32_t n = 1; n <= count; n++) {
+        const trace_event_t* e = &ring->events[(ring->head - n) & (TRACE_RING_EVENTS - 1)];
+
+        age_cycles += (int32_t)(prev_cycles - e->cycles);
+        prev_cycles = e->cycles;
+
+        int64_t ns = anchor->time_us * 1000 - age_cycles * 1000 / ticks_per_us;
+        write_event(w, e, core, ns, first);
+    }
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+void IRAM_ATTR trace_record(uint16_t id, uint8_t phase, uint32_t arg)
+{
+    if (s_paused) {
+        return;
+    }
+
+    // Interrupt mascherati solo su questo core: niente preemption né
+    // migrazione del task tra la scelta del ring e la scrittura
+    UBaseType_t state = portSET_INTERRUPT_MASK_FROM_ISR();
+
+    trace_ring_t* ring = &s_rings[xPortGetCoreID()];
+    trace_event_t* e = &ring->events[ring->head & (TRACE_RING_EVENTS - 1)];
+    e->cycles = esp_cpu_get_cycle_count();
+    e->arg = arg;
+    e->task = xPortInIsrContext() ? 0 : (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+    e->id = id;
+    e->phase = phase;
+    ring->head++;
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(state);
+}
+
+esp_err_t trace_handler(httpd_req_t *req)
+{
+    trace_ring_t* rings = (trace_ring_t*)heap_caps_malloc(sizeof(s_rings),
+                                                         MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    char* buf = (char*)malloc(JSON_WRITER_BUF_SIZE);
+    if (rings == NULL || buf == NULL) {
+        heap_caps_free(rings);
+        free(buf);
+        httpd_resp_send_500(req);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Fotografia dei ring: scrittura sospesa, riferimento temporale per core
+    trace_anchor_t anchors[portNUM_PROCESSORS];
+    s_paused = true;
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        // L'IPC gira sul core c dopo che una scrittura in corso lì è terminata
+        esp_ipc_call_blocking(c, take_anchor, &anchors[c]);
+    }
+    memcpy(rings, s_rings, sizeof(s_rings));
+    s_paused = false;
+
+    uint32_t ticks_per_us = esp_rom_get_cpu_ticks_per_us();
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"trace.json\"");
+
+    json_writer_t w;
+    json_writer_init(&w, req, buf, JSON_WRITER_BUF_SIZE);
+
+    bool first = true;
+    json_writer_str(&w, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    write_names(&w, &first);
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        write_core(&w, &rings[c], c, &anchors[c], ticks_per_us, &first);
+    }
+    json_writer_str(&w, "\n]}");
+
+    esp_err_t ret = json_writer_finish(&w);
+    ESP_LOGI(TAG, "Trace dump sent (%lu bytes)", (unsigned long)w.bytes_sent);
+
+    heap_caps_free(rings);
+    free(buf);
+    return ret;
+}
+
+#endif // TRACE_ENABLE
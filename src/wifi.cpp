@@ -1,18 +1,16 @@
 /**
  * @file wifi.cpp
- * @brief WiFi management and WebSocket handling for Cronotermostato
+ * @brief WiFi management for Cronotermostato
  */
 
 #include "wifi.h"
 #include "http_server.h"
 #include "comune.h"
 #include "credentials.h"
+#include "ws_session.h"
 
 #include <string.h>
 #include <time.h>
-#include <sys/socket.h>
-#include <fcntl.h>
-#include <errno.h>
 
 #include <esp_wifi.h>
 #include <esp_event.h>
@@ -30,159 +28,6 @@ static const char *TAG = "WIFI";
 // void time_sync_start(void);       // TODO: implement when we add time_sync
 // void time_sync_stop(void);        // TODO
 
-// ============================================================================
-// WebSocket Client Management
-// ============================================================================
-
-#define MAX_WS_CLIENTS 4
-static int g_ws_client_fds[MAX_WS_CLIENTS] = {-1, -1, -1, -1};
-static int g_ws_client_count = 0;
-
-void register_ws_client(int fd) {
-    if (g_ws_client_count < MAX_WS_CLIENTS) {
-        g_ws_client_fds[g_ws_client_count] = fd;
-        g_ws_client_count++;
-        ESP_LOGI(TAG, "WebSocket client registered, total: %d", g_ws_client_count);
-    } else {
-        ESP_LOGW(TAG, "Max WebSocket clients reached, cannot register fd=%d", fd);
-    }
-}
-
-static int find_ws_client_by_fd(int fd) {
-    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
-        if (g_ws_client_fds[i] == fd) {
-            return i;
-        }
-    }
-    return -1;
-}
-
-void unregister_ws_client(int fd) {
-    int i = find_ws_client_by_fd(fd);
-    if (i != -1) {
-        ESP_LOGI(TAG, "WebSocket client unregistered, fd=%d, total: %d", fd, g_ws_client_count - 1);
-        g_ws_client_fds[i] = -1;
-        g_ws_client_count--;
-    }
-}
-
-// ============================================================================
-// Socket Validation
-// ============================================================================
-
-static bool is_socket_valid(int fd) {
-    if (fd < 0) return false;
-
-    int socket_error = 0;
-    socklen_t len = sizeof(socket_error);
-
-    // Check if socket has errors
-    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &socket_error, &len) != 0) {
-        return false;
-    }
-
-    if (socket_error != 0) {
-        return false;
-    }
-
-    // Additional test: try non-blocking send of 0 bytes
-    int flags = fcntl(fd, F_GETFL, 0);
-    if (flags != -1) {
-        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
-        ssize_t result = send(fd, NULL, 0, MSG_NOSIGNAL);
-        fcntl(fd, F_SETFL, flags); // Restore original flags
-
-        if (result < 0 && (errno == ECONNRESET || errno == EPIPE || errno == ENOTCONN)) {
-            return false;
-        }
-    }
-
-    return true;
-}
-
-void websocket_cleanup_dead_connections(void) {
-    for (int i = 0; i < g_ws_client_count; i++) {
-        if (g_ws_client_fds[i] >= 0 && !is_socket_valid(g_ws_client_fds[i])) {
-            ESP_LOGW(TAG, "Detected invalid WebSocket, fd=%d", g_ws_client_fds[i]);
-
-            struct linger linger = { .l_onoff = 1, .l_linger = 0 };
-            setsockopt(g_ws_client_fds[i], SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
-            shutdown(g_ws_client_fds[i], SHUT_RDWR);
-            close(g_ws_client_fds[i]);
-
-            g_ws_client_fds[i] = -1;
-
-            // Compact array
-            for (int j = i; j < g_ws_client_count - 1; j++) {
-                g_ws_client_fds[j] = g_ws_client_fds[j + 1];
-            }
-            g_ws_client_count--;
-            i--;
-        }
-    }
-}
-
-// Cleanup task - runs every 30 minutes
-static void websocket_cleanup_task(void *pvParameters) {
-    while (1) {
-        vTaskDelay(pdMS_TO_TICKS(1800000)); // 30 minutes
-        ESP_LOGI(TAG, "Running periodic WebSocket cleanup...");
-        websocket_cleanup_dead_connections();
-    }
-}
-
-// ============================================================================
-// WebSocket Handler (to be called by http_server)
-// ============================================================================
-
-esp_err_t ws_handler(httpd_req_t *req) {
-    if (req->method == HTTP_GET) {
-        ESP_LOGI(TAG, "WebSocket handshake initiated");
-        return ESP_OK;
-    }
-
-    // TODO: Implement WebSocket message handling here
-    // For now, just a placeholder
-
-    httpd_ws_frame_t ws_pkt;
-    memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
-
-    // First, receive the frame metadata
-    ws_pkt.type = HTTPD_WS_TYPE_TEXT;
-    esp_err_t ret = httpd_ws_recv_frame(req, &ws_pkt, 0);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "httpd_ws_recv_frame failed: %d", ret);
-        return ret;
-    }
-
-    // Allocate buffer for payload
-    if (ws_pkt.len > 0) {
-        uint8_t *buf = (uint8_t *)malloc(ws_pkt.len + 1);
-        if (buf == NULL) {
-            ESP_LOGE(TAG, "Failed to allocate memory for WebSocket payload");
-            return ESP_ERR_NO_MEM;
-        }
-
-        ws_pkt.payload = buf;
-        ret = httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "httpd_ws_recv_frame payload failed: %d", ret);
-            free(buf);
-            return ret;
-        }
-
-        buf[ws_pkt.len] = '\0'; // Null-terminate
-
-        ESP_LOGI(TAG, "Received WebSocket message: %s", buf);
-
-        // TODO: Process message here (config updates, commands, etc.)
-
-        free(buf);
-    }
-
-    return ESP_OK;
-}
-
 // ============================================================================
 // WiFi Tracking and Diagnostics
 // ============================================================================
@@ -226,9 +71,6 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t e
         wifi_connected = false;
         wifi_rssi = 0;
 
-        // Reset WebSocket client count
-        g_ws_client_count = 0;
-
         // Turn off WiFi LED (active LOW - set to 1)
         #ifdef LED_WIFI
         gpio_set_level(LED_WIFI, 1);
@@ -349,10 +191,6 @@ void setup_wifi(void) {
     wifi_reconnect_count = 0;
 
     ESP_LOGI(TAG, "WiFi initialization complete. SSID: %s", WIFI_SSID);
-
-    // Start WebSocket cleanup task
-    xTaskCreate(websocket_cleanup_task, "ws_cleanup", 3072, NULL, 1, NULL);
-    ESP_LOGI(TAG, "WebSocket cleanup task started (runs every 30 minutes)");
 }
 
 // ============================================================================
@@ -409,6 +247,9 @@ extern "C" void get_wifi_status(char* buffer, size_t buffer_size, const char* su
         uint32_t minutes = (uptime_sec % 3600) / 60;
         uint32_t seconds = uptime_sec % 60;
 
+        ws_session_stats_t ws;
+        ws_session_get_stats(&ws);
+
         // Format output
         snprintf(buffer, buffer_size,
                  "=== WiFi Status (%s) ===\n"
@@ -420,7 +261,7 @@ extern "C" void get_wifi_status(char* buffer, size_t buffer_size, const char* su
                  "Uptime: %luh %lum %lus\n"
                  "Reconnects: %lu\n"
                  "Total disconnects: %lu\n"
-                 "WebSocket clients: %d\n",
+                 "WebSocket clients: %d/%d (dropped %lu, resync %lu, slow %lu)\n",
                  time_str,
                  wifi_connected ? "Connected" : "Disconnected",
                  WIFI_SSID,
@@ -430,8 +271,17 @@ extern "C" void get_wifi_status(char* buffer, size_t buffer_size, const char* su
                  hours, minutes, seconds,
                  wifi_reconnect_count,
                  total_disconnect_count,
-                 g_ws_client_count);
+                 ws.sessions, WS_MAX_SESSIONS,
+                 ws.frames_dropped, ws.resyncs, ws.send_failures);
     } else {
         snprintf(buffer, buffer_size, "Unknown WiFi subcommand: %s\n", subcommand);
     }
 }
+
+extern "C" uint32_t wifi_get_reconnect_count(void) {
+    return wifi_reconnect_count;
+}
+
+extern "C" uint32_t wifi_get_disconnect_count(void) {
+    return total_disconnect_count;
+}
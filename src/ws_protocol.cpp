@@ -0,0 +1,178 @@
+/**
+ * @file ws_protocol.cpp
+ * @brief Implementazione codifica frame binari WebSocket
+ */
+
+#include "ws_protocol.h"
+
+#include <string.h>
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+/**
+ * @brief Cursore di scrittura con controllo di capienza
+ */
+typedef struct {
+    uint8_t* buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+} frame_writer_t;
+
+static void put_u8(frame_writer_t* w, uint8_t v)
+{
+    if (w->len + 1 > w->cap) {
+        w->overflow = true;
+        return;
+    }
+    w->buf[w->len++] = v;
+}
+
+static void put_u16(frame_writer_t* w, uint16_t v)
+{
+    put_u8(w, (uint8_t)v);
+    put_u8(w, (uint8_t)(v >> 8));
+}
+
+static void put_u32(frame_writer_t* w, uint32_t v)
+{
+    put_u16(w, (uint16_t)v);
+    put_u16(w, (uint16_t)(v >> 16));
+}
+
+static void begin(frame_writer_t* w, uint8_t* buf, size_t cap, ws_msg_type_t type, uint8_t mask)
+{
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->overflow = false;
+
+    put_u8(w, WS_PROTO_VERSION);
+    put_u8(w, (uint8_t)type);
+    put_u8(w, mask);
+}
+
+static size_t end(const frame_writer_t* w)
+{
+    return w->overflow ? 0 : w->len;
+}
+
+/**
+ * @brief Giorni dal 1970-01-01 di una data del calendario gregoriano
+ */
+static int32_t days_from_civil(int32_t y, uint32_t m, uint32_t d)
+{
+    y -= m <= 2;
+    const int32_t era = (y >= 0 ? y : y - 399) / 400;
+    const uint32_t yoe = (uint32_t)(y - era * 400);
+    const uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+/**
+ * @brief Temperatura ai decimi, arrotondata come toFixed(1) della pagina
+ */
+static inline int16_t temp_tenths(int16_t t)
+{
+    return (int16_t)((t >= 0 ? t + 5 : t - 5) / 10);
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+uint32_t ws_local_time(time_t t)
+{
+    struct tm tm;
+    localtime_r(&t, &tm);
+
+    int32_t days = days_from_civil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+    return (uint32_t)days * 86400U + tm.tm_hour * 3600U + tm.tm_min * 60U + tm.tm_sec;
+}
+
+uint8_t ws_status_diff(const status_snapshot_t* a, const status_snapshot_t* b)
+{
+    uint8_t mask = 0;
+
+    if (a->timestamp / 60 != b->timestamp / 60)            mask |= WS_STATUS_TIME;
+    if (temp_tenths(a->temperature) != temp_tenths(b->temperature)) mask |= WS_STATUS_TEMP;
+    if (a->humidity != b->humidity)                        mask |= WS_STATUS_HUM;
+    if (a->pressure != b->pressure)                        mask |= WS_STATUS_PRESS;
+    if (a->setpoint != b->setpoint)                        mask |= WS_STATUS_SETPOINT;
+    if (a->heater_on != b->heater_on)                      mask |= WS_STATUS_HEAT;
+    if (a->samples != b->samples)                          mask |= WS_STATUS_SAMPLES;
+
+    return mask;
+}
+
+uint8_t ws_config_diff(const status_config_t* a, const status_config_t* b)
+{
+    uint8_t mask = 0;
+
+    if (a->hysteresis != b->hysteresis)             mask |= WS_CONFIG_HYSTERESIS;
+    if (a->temp_correction != b->temp_correction)   mask |= WS_CONFIG_CORRECTION;
+    if (a->manual_mode != b->manual_mode)           mask |= WS_CONFIG_MANUAL;
+    if (a->manual_setpoint != b->manual_setpoint)   mask |= WS_CONFIG_MANUAL_SP;
+    if (a->active_bank != b->active_bank)           mask |= WS_CONFIG_BANK;
+
+    return mask;
+}
+
+size_t ws_encode_status(uint8_t* buf, size_t cap, const status_snapshot_t* snap, uint8_t mask)
+{
+    frame_writer_t w;
+    begin(&w, buf, cap, WS_MSG_STATUS, mask & WS_STATUS_ALL);
+
+    if (mask & WS_STATUS_TIME)      put_u32(&w, ws_local_time(snap->timestamp));
+    if (mask & WS_STATUS_TEMP)      put_u16(&w, (uint16_t)snap->temperature);
+    if (mask & WS_STATUS_HUM)       put_u8(&w, snap->humidity);
+    if (mask & WS_STATUS_PRESS)     put_u16(&w, snap->pressure);
+    if (mask & WS_STATUS_SETPOINT)  put_u16(&w, (uint16_t)snap->setpoint);
+    if (mask & WS_STATUS_HEAT)      put_u8(&w, snap->heater_on ? 1 : 0);
+    if (mask & WS_STATUS_SAMPLES)   put_u16(&w, snap->samples);
+
+    return end(&w);
+}
+
+size_t ws_encode_sample(uint8_t* buf, size_t cap, uint32_t day_start, const history_sample_t* sample)
+{
+    frame_writer_t w;
+    begin(&w, buf, cap, WS_MSG_SAMPLE, WS_SAMPLE_ALL);
+
+    put_u32(&w, day_start + sample->minute_of_day * 60U);
+    put_u16(&w, (uint16_t)sample->temperature);
+    put_u8(&w, sample->humidity);
+    put_u8(&w, sample->flags);
+    put_u16(&w, (uint16_t)sample->setpoint);
+    put_u16(&w, sample->pressure);
+
+    return end(&w);
+}
+
+size_t ws_encode_relay(uint8_t* buf, size_t cap, time_t when, bool on)
+{
+    frame_writer_t w;
+    begin(&w, buf, cap, WS_MSG_RELAY, WS_RELAY_ALL);
+
+    put_u32(&w, ws_local_time(when));
+    put_u8(&w, on ? 1 : 0);
+
+    return end(&w);
+}
+
+size_t ws_encode_config(uint8_t* buf, size_t cap, const status_config_t* config, uint8_t mask)
+{
+    frame_writer_t w;
+    begin(&w, buf, cap, WS_MSG_CONFIG, mask & WS_CONFIG_ALL);
+
+    if (mask & WS_CONFIG_HYSTERESIS)  put_u16(&w, (uint16_t)config->hysteresis);
+    if (mask & WS_CONFIG_CORRECTION)  put_u16(&w, (uint16_t)config->temp_correction);
+    if (mask & WS_CONFIG_MANUAL)      put_u8(&w, config->manual_mode ? 1 : 0);
+    if (mask & WS_CONFIG_MANUAL_SP)   put_u16(&w, (uint16_t)config->manual_setpoint);
+    if (mask & WS_CONFIG_BANK)        put_u8(&w, config->active_bank);
+
+    return end(&w);
+}
@@ -0,0 +1,421 @@
+/**
+ * @file ws_session.cpp
+ * @brief Implementazione sessioni WebSocket con coda per client
+ */
+
+#include "ws_session.h"
+#include "http_server.h"
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static const char* TAG = "WS_SESSION";
+
+// ============================================================================
+// STRUTTURE PRIVATE
+// ============================================================================
+
+/**
+ * @brief Client WebSocket con la sua coda di frame
+ */
+typedef struct {
+    int fd;                     // -1 = slot libero
+    bool resync;                // Inviare lo stato completo prima della coda
+    uint8_t head;               // Primo frame in coda
+    uint8_t count;              // Frame in coda
+    uint8_t len[WS_SESSION_QUEUE_LEN];
+    uint8_t data[WS_SESSION_QUEUE_LEN][WS_SESSION_FRAME_MAX];
+} ws_session_t;
+
+// ============================================================================
+// VARIABILI STATICHE
+// ============================================================================
+
+static ws_session_t s_sessions[WS_MAX_SESSIONS];
+static ws_session_stats_t s_stats = {0};
+static bool s_drain_pending = false;        // Drain già accodato al task httpd
+static ws_resync_fn_t s_resync = NULL;
+static SemaphoreHandle_t s_mutex = NULL;
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static int find_session(int fd)
+{
+    for (int i = 0; i < WS_MAX_SESSIONS; i++) {
+        if (s_sessions[i].fd == fd) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Libera lo slot di un client (chiamare sotto lock)
+ */
+static void remove_session(int fd)
+{
+    int i = find_session(fd);
+    if (i < 0) {
+        return;
+    }
+
+    s_sessions[i].fd = -1;
+    s_sessions[i].count = 0;
+    s_stats.sessions--;
+    ESP_LOGI(TAG, "WebSocket client removed, fd=%d, total: %d", fd, s_stats.sessions);
+}
+
+static bool send_frame(httpd_handle_t hd, int fd, uint8_t* data, size_t len)
+{
+    httpd_ws_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.type = HTTPD_WS_TYPE_BINARY;
+    frame.final = true;
+    frame.payload = data;
+    frame.len = len;
+
+    return httpd_ws_send_frame_async(hd, fd, &frame) == ESP_OK;
+}
+
+/**
+ * @brief Disconnette un client con invio fallito o troppo lento
+ */
+static void fail_session(httpd_handle_t hd, int fd)
+{
+    ESP_LOGW(TAG, "Send to fd=%d failed, closing", fd);
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    s_stats.send_failures++;
+    remove_session(fd);
+    xSemaphoreGive(s_mutex);
+
+    httpd_sess_trigger_close(hd, fd);
+}
+
+/**
+ * @brief Invia lo stato completo (task httpd)
+ */
+static bool send_resync(httpd_handle_t hd, int fd)
+{
+    uint8_t buf[WS_SESSION_FRAME_MAX];
+
+    for (uint8_t index = 0; s_resync != NULL; index++) {
+        size_t len = s_resync(buf, sizeof(buf), index);
+        if (len == 0) {
+            break;
+        }
+        if (!send_frame(hd, fd, buf, len)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Svuota la coda di un client (task httpd)
+ *
+ * Il lock è tenuto solo per estrarre un frame, mai durante l'invio.
+ */
+static void drain_session(httpd_handle_t hd, int slot)
+{
+    uint8_t buf[WS_SESSION_FRAME_MAX];
+    uint32_t sent = 0;
+
+    while (true) {
+        size_t len = 0;
+        bool resync = false;
+
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        ws_session_t* s = &s_sessions[slot];
+        int fd = s->fd;
+        if (fd >= 0) {
+            if (s->resync) {
+                s->resync = false;
+                resync = true;
+                s_stats.resyncs++;
+            } else if (s->count > 0) {
+                len = s->len[s->head];
+                memcpy(buf, s->data[s->head], len);
+                s->head = (s->head + 1) % WS_SESSION_QUEUE_LEN;
+                s->count--;
+            }
+        }
+        xSemaphoreGive(s_mutex);
+
+        if (fd < 0 || (!resync && len == 0)) {
+            break;
+        }
+
+        bool ok = resync ? send_resync(hd, fd) : send_frame(hd, fd, buf, len);
+        if (!ok) {
+            fail_session(hd, fd);
+            break;
+        }
+        if (!resync) {
+            sent++;
+        }
+    }
+
+    if (sent > 0) {
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        s_stats.frames_sent += sent;
+        xSemaphoreGive(s_mutex);
+    }
+}
+
+static void drain_work(void* arg)
+{
+    httpd_handle_t hd = (httpd_handle_t)arg;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    s_drain_pending = false;
+    xSemaphoreGive(s_mutex);
+
+    for (int i = 0; i < WS_MAX_SESSIONS; i++) {
+        drain_session(hd, i);
+    }
+}
+
+/**
+ * @brief Accoda lo svuotamento delle code al task httpd (se non già accodato)
+ */
+static void schedule_drain(void)
+{
+    bool queue = false;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (!s_drain_pending && s_stats.sessions > 0) {
+        s_drain_pending = true;
+        queue = true;
+    }
+    xSemaphoreGive(s_mutex);
+
+    if (!queue) {
+        return;
+    }
+
+    httpd_handle_t hd = get_webserver_handle();
+    if (hd == NULL || httpd_queue_work(hd, drain_work, hd) != ESP_OK) {
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        s_drain_pending = false;
+        xSemaphoreGive(s_mutex);
+    }
+}
+
+/**
+ * @brief Crea la sessione di un client che ha completato l'handshake
+ */
+static esp_err_t add_session(int fd)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    if (find_session(fd) >= 0) {
+        xSemaphoreGive(s_mutex);
+        return ESP_OK;
+    }
+
+    int i = find_session(-1);
+    if (i < 0) {
+        s_stats.rejected++;
+        xSemaphoreGive(s_mutex);
+        ESP_LOGW(TAG, "Max WebSocket clients (%d) reached, rejecting fd=%d", WS_MAX_SESSIONS, fd);
+        return ESP_FAIL;
+    }
+
+    ws_session_t* s = &s_sessions[i];
+    s->fd = fd;
+    s->head = 0;
+    s->count = 0;
+    s->resync = true;       // Il client riceve subito lo stato completo
+    s_stats.sessions++;
+    s_stats.opened++;
+    int sessions = s_stats.sessions;
+
+    xSemaphoreGive(s_mutex);
+
+    // Invii brevi: un client che non legge viene disconnesso invece di
+    // bloccare il task httpd per send_wait_timeout
+    struct timeval tv = {
+        .tv_sec = WS_SEND_TIMEOUT_MS / 1000,
+        .tv_usec = (WS_SEND_TIMEOUT_MS % 1000) * 1000
+    };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    ESP_LOGI(TAG, "WebSocket client registered, fd=%d, total: %d", fd, sessions);
+    schedule_drain();
+    return ESP_OK;
+}
+
+// ============================================================================
+// API PUBBLICHE
+// ============================================================================
+
+esp_err_t ws_session_init(ws_resync_fn_t resync)
+{
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
+        if (s_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        for (int i = 0; i < WS_MAX_SESSIONS; i++) {
+            s_sessions[i].fd = -1;
+        }
+    }
+    s_resync = resync;
+    return ESP_OK;
+}
+
+esp_err_t ws_session_on_open(httpd_handle_t hd, int sockfd)
+{
+    if (s_mutex != NULL) {
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        remove_session(sockfd);
+        xSemaphoreGive(s_mutex);
+    }
+    return ESP_OK;
+}
+
+void ws_session_on_close(httpd_handle_t hd, int sockfd)
+{
+    if (s_mutex != NULL) {
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        remove_session(sockfd);
+        xSemaphoreGive(s_mutex);
+    }
+
+    // Con close_fn personalizzata la chiusura del socket spetta all'applicazione
+    close(sockfd);
+}
+
+void ws_session_close_all(void)
+{
+    if (s_mutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    for (int i = 0; i < WS_MAX_SESSIONS; i++) {
+        s_sessions[i].fd = -1;
+        s_sessions[i].count = 0;
+    }
+    s_stats.sessions = 0;
+    s_drain_pending = false;
+    xSemaphoreGive(s_mutex);
+}
+
+esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        ESP_LOGI(TAG, "WebSocket handshake initiated");
+        // Errore = httpd chiude la connessione
+        return add_session(httpd_req_to_sockfd(req));
+    }
+
+    httpd_ws_frame_t ws_pkt;
+    memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
+
+    // First, receive the frame metadata
+    ws_pkt.type = HTTPD_WS_TYPE_TEXT;
+    esp_err_t ret = httpd_ws_recv_frame(req, &ws_pkt, 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "httpd_ws_recv_frame failed: %d", ret);
+        return ret;
+    }
+
+    // Allocate buffer for payload
+    if (ws_pkt.len > 0) {
+        uint8_t *buf = (uint8_t *)malloc(ws_pkt.len + 1);
+        if (buf == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate memory for WebSocket payload");
+            return ESP_ERR_NO_MEM;
+        }
+
+        ws_pkt.payload = buf;
+        ret = httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "httpd_ws_recv_frame payload failed: %d", ret);
+            free(buf);
+            return ret;
+        }
+
+        buf[ws_pkt.len] = '\0'; // Null-terminate
+
+        // Il canale è solo in uscita: i messaggi del client vengono letti
+        // per consumare il frame e poi ignorati
+        ESP_LOGD(TAG, "Ignored WebSocket message: %s", buf);
+
+        free(buf);
+    }
+
+    return ESP_OK;
+}
+
+void ws_session_broadcast(const uint8_t* data, size_t len)
+{
+    if (s_mutex == NULL || len == 0) {
+        return;
+    }
+    if (len > WS_SESSION_FRAME_MAX) {
+        ESP_LOGW(TAG, "Frame too long (%u bytes), dropped", (unsigned int)len);
+        return;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    for (int i = 0; i < WS_MAX_SESSIONS; i++) {
+        ws_session_t* s = &s_sessions[i];
+        if (s->fd < 0 || s->resync) {
+            continue;   // Lo stato completo in arrivo include già questo frame
+        }
+
+        if (s->count == WS_SESSION_QUEUE_LEN) {
+            // Client lento: i delta accumulati diventano un unico stato completo
+            s_stats.frames_dropped += s->count;
+            s->count = 0;
+            s->head = 0;
+            s->resync = true;
+            continue;
+        }
+
+        uint8_t tail = (s->head + s->count) % WS_SESSION_QUEUE_LEN;
+        memcpy(s->data[tail], data, len);
+        s->len[tail] = (uint8_t)len;
+        s->count++;
+    }
+
+    xSemaphoreGive(s_mutex);
+
+    schedule_drain();
+}
+
+int ws_session_count(void)
+{
+    if (s_mutex == NULL) {
+        return 0;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    int sessions = s_stats.sessions;
+    xSemaphoreGive(s_mutex);
+    return sessions;
+}
+
+void ws_session_get_stats(ws_session_stats_t* stats)
+{
+    if (s_mutex == NULL) {
+        memset(stats, 0, sizeof(ws_session_stats_t));
+        return;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    *stats = s_stats;
+    xSemaphoreGive(s_mutex);
+}
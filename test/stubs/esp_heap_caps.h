@@ -0,0 +1,33 @@
+/**
+ * @file esp_heap_caps.h
+ * @brief Sostituto host di esp_heap_caps.h: PSRAM e RAM interna sono malloc()
+ */
+
+#ifndef TEST_STUB_ESP_HEAP_CAPS_H
+#define TEST_STUB_ESP_HEAP_CAPS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT         (1 << 2)
+#define MALLOC_CAP_SPIRAM       (1 << 10)
+#define MALLOC_CAP_INTERNAL     (1 << 11)
+
+static inline void* heap_caps_malloc(size_t size, uint32_t caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+static inline void* heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return calloc(n, size);
+}
+
+static inline void heap_caps_free(void* ptr)
+{
+    free(ptr);
+}
+
+#endif // TEST_STUB_ESP_HEAP_CAPS_H
@@ -0,0 +1,32 @@
+/**
+ * @file esp_http_server.h
+ * @brief Sostituto host di esp_http_server.h per i test nativi
+ *
+ * Solo le funzioni di invio usate dai moduli provati; la suite che ne ha
+ * bisogno le definisce (tipicamente contando chunk e byte).
+ */
+
+#ifndef TEST_STUB_ESP_HTTP_SERVER_H
+#define TEST_STUB_ESP_HTTP_SERVER_H
+
+#include "esp_err.h"
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void* httpd_handle_t;
+
+typedef struct httpd_req {
+    void* user_ctx;
+} httpd_req_t;
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t* req, const char* buf, ssize_t buf_len);
+esp_err_t httpd_resp_sendstr_chunk(httpd_req_t* req, const char* str);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TEST_STUB_ESP_HTTP_SERVER_H
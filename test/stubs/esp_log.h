@@ -0,0 +1,17 @@
+/**
+ * @file esp_log.h
+ * @brief Sostituto host di esp_log.h: errori e warning su stderr, il resto muto
+ */
+
+#ifndef TEST_STUB_ESP_LOG_H
+#define TEST_STUB_ESP_LOG_H
+
+#include <stdio.h>
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) do { (void)(tag); } while (0)
+#define ESP_LOGD(tag, fmt, ...) do { (void)(tag); } while (0)
+#define ESP_LOGV(tag, fmt, ...) do { (void)(tag); } while (0)
+
+#endif // TEST_STUB_ESP_LOG_H
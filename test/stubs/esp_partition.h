@@ -0,0 +1,162 @@
+/**
+ * @file esp_partition.h
+ * @brief Sostituto host di esp_partition.h: partizione su file mappato in memoria
+ *
+ * host_partition_open() crea il file, lo mappa con mmap() e lo registra
+ * come unica partizione. Le scritture seguono la flash NOR: possono solo
+ * azzerare bit, la cancellazione riporta a 0xFF settori interi da 4 KB.
+ * I contatori di host_partition_stats servono ai benchmark.
+ */
+
+#ifndef TEST_STUB_ESP_PARTITION_H
+#define TEST_STUB_ESP_PARTITION_H
+
+#include "esp_err.h"
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define HOST_PARTITION_SECTOR_SIZE  4096
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+    ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    uint32_t erase_size;
+    char label[17];
+    bool encrypted;
+} esp_partition_t;
+
+typedef struct {
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t erased_sectors;
+} host_partition_stats_t;
+
+static esp_partition_t s_host_partition;
+static uint8_t* s_host_partition_map = NULL;
+static host_partition_stats_t host_partition_stats;
+
+/**
+ * @brief Mappa path (size byte) come partizione label
+ *
+ * @param erase true = file nuovo tutto a 0xFF (flash cancellata)
+ */
+static inline esp_err_t host_partition_open(const char* path, const char* label,
+                                            uint32_t size, bool erase)
+{
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return ESP_FAIL;
+    }
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        return ESP_FAIL;
+    }
+
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return ESP_FAIL;
+    }
+
+    s_host_partition_map = (uint8_t*)map;
+    if (erase) {
+        memset(s_host_partition_map, 0xFF, size);
+    }
+
+    memset(&s_host_partition, 0, sizeof(s_host_partition));
+    s_host_partition.type = ESP_PARTITION_TYPE_DATA;
+    s_host_partition.subtype = ESP_PARTITION_SUBTYPE_ANY;
+    s_host_partition.size = size;
+    s_host_partition.erase_size = HOST_PARTITION_SECTOR_SIZE;
+    strncpy(s_host_partition.label, label, sizeof(s_host_partition.label) - 1);
+    memset(&host_partition_stats, 0, sizeof(host_partition_stats));
+    return ESP_OK;
+}
+
+static inline void host_partition_close(void)
+{
+    if (s_host_partition_map != NULL) {
+        munmap(s_host_partition_map, s_host_partition.size);
+        s_host_partition_map = NULL;
+    }
+}
+
+static inline const esp_partition_t* esp_partition_find_first(esp_partition_type_t type,
+                                                              esp_partition_subtype_t subtype,
+                                                              const char* label)
+{
+    (void)subtype;
+    if (s_host_partition_map == NULL || type != s_host_partition.type ||
+        (label != NULL && strcmp(label, s_host_partition.label) != 0)) {
+        return NULL;
+    }
+    return &s_host_partition;
+}
+
+static inline bool host_partition_range_ok(const esp_partition_t* part, size_t offset, size_t size)
+{
+    return part == &s_host_partition && s_host_partition_map != NULL &&
+           offset <= part->size && size <= part->size - offset;
+}
+
+static inline esp_err_t esp_partition_read(const esp_partition_t* part, size_t src_offset,
+                                           void* dst, size_t size)
+{
+    if (!host_partition_range_ok(part, src_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, s_host_partition_map + src_offset, size);
+    host_partition_stats.reads++;
+    host_partition_stats.read_bytes += size;
+    return ESP_OK;
+}
+
+static inline esp_err_t esp_partition_write(const esp_partition_t* part, size_t dst_offset,
+                                            const void* src, size_t size)
+{
+    if (!host_partition_range_ok(part, dst_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    const uint8_t* in = (const uint8_t*)src;
+    uint8_t* out = s_host_partition_map + dst_offset;
+    for (size_t i = 0; i < size; i++) {
+        out[i] &= in[i];                    // NOR: 1 → 0 soltanto
+    }
+    host_partition_stats.writes++;
+    host_partition_stats.write_bytes += size;
+    return ESP_OK;
+}
+
+static inline esp_err_t esp_partition_erase_range(const esp_partition_t* part, size_t offset,
+                                                  size_t size)
+{
+    if (!host_partition_range_ok(part, offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (offset % part->erase_size != 0 || size % part->erase_size != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(s_host_partition_map + offset, 0xFF, size);
+    host_partition_stats.erased_sectors += size / part->erase_size;
+    return ESP_OK;
+}
+
+#endif // TEST_STUB_ESP_PARTITION_H
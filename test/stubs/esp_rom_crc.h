@@ -0,0 +1,32 @@
+/**
+ * @file esp_rom_crc.h
+ * @brief Sostituto host di esp_rom_crc.h: CRC32 little-endian come la ROM
+ */
+
+#ifndef TEST_STUB_ESP_ROM_CRC_H
+#define TEST_STUB_ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len)
+{
+    static uint32_t table[256];
+
+    if (table[1] == 0) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1u)));
+            }
+            table[i] = c;
+        }
+    }
+
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc = (crc >> 8) ^ table[(crc ^ buf[i]) & 0xFF];
+    }
+    return ~crc;
+}
+
+#endif // TEST_STUB_ESP_ROM_CRC_H
@@ -0,0 +1,23 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Sostituto host di FreeRTOS.h per i test nativi (tick = 1 ms)
+ */
+
+#ifndef TEST_STUB_FREERTOS_H
+#define TEST_STUB_FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE                 0
+#define pdTRUE                  1
+#define pdPASS                  pdTRUE
+#define portMAX_DELAY           ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS      1
+#define portNUM_PROCESSORS      2
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))
+
+#endif // TEST_STUB_FREERTOS_H
@@ -0,0 +1,46 @@
+/**
+ * @file semphr.h
+ * @brief Sostituto host di freertos/semphr.h: mutex su pthread
+ */
+
+#ifndef TEST_STUB_FREERTOS_SEMPHR_H
+#define TEST_STUB_FREERTOS_SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+typedef pthread_mutex_t* SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t m = (SemaphoreHandle_t)malloc(sizeof(pthread_mutex_t));
+    if (m != NULL) {
+        pthread_mutex_init(m, NULL);
+    }
+    return m;
+}
+
+/**
+ * @brief Timeout 0 = tentativo singolo, altrimenti attesa senza limite
+ */
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t ticks)
+{
+    if (ticks == 0) {
+        return pthread_mutex_trylock(m) == 0 ? pdTRUE : pdFALSE;
+    }
+    return pthread_mutex_lock(m) == 0 ? pdTRUE : pdFALSE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t m)
+{
+    return pthread_mutex_unlock(m) == 0 ? pdTRUE : pdFALSE;
+}
+
+static inline void vSemaphoreDelete(SemaphoreHandle_t m)
+{
+    pthread_mutex_destroy(m);
+    free(m);
+}
+
+#endif // TEST_STUB_FREERTOS_SEMPHR_H
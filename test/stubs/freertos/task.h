@@ -0,0 +1,25 @@
+/**
+ * @file task.h
+ * @brief Sostituto host di freertos/task.h: i task sono thread POSIX
+ */
+
+#ifndef TEST_STUB_FREERTOS_TASK_H
+#define TEST_STUB_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+#include <sched.h>
+#include <unistd.h>
+
+/**
+ * @brief Cede la CPU; un tick o meno diventa un semplice sched_yield()
+ */
+static inline void vTaskDelay(TickType_t ticks)
+{
+    if (ticks <= 1) {
+        sched_yield();
+    } else {
+        usleep(ticks * 1000u * portTICK_PERIOD_MS);
+    }
+}
+
+#endif // TEST_STUB_FREERTOS_TASK_H
@@ -0,0 +1,243 @@
+/**
+ * @file test_codec.cpp
+ * @brief Round-trip e throughput della codifica TLOG v2 su host
+ *
+ * Esecuzione: pio test -e native -f test_codec
+ */
+
+#include <unity.h>
+
+#include "history_codec.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define DAY_V1_SIZE         (12 + SAMPLES_PER_DAY * sizeof(history_sample_t))
+#define BENCH_DAYS          365
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static uint32_t s_rng = 12345;
+
+static uint32_t rng_next(void)
+{
+    s_rng = s_rng * 1103515245u + 12345u;
+    return s_rng >> 8;
+}
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/**
+ * @brief Genera una giornata realistica: derive lente, qualche buco
+ */
+static void make_day(history_sample_t* day, uint32_t seed)
+{
+    s_rng = seed;
+    int temp = 1900 + (int)(rng_next() % 300);
+    int hum = 45 + (int)(rng_next() % 20);
+    int pressure = 10100 + (int)(rng_next() % 200);
+    int setpoint = 2000;
+    uint8_t flags = 0;
+
+    for (int m = 0; m < SAMPLES_PER_DAY; m++) {
+        // Un minuto su 200 mancante (riavvio, sensore assente)
+        if (rng_next() % 200 == 0) {
+            tlog2_make_empty(&day[m], m);
+            continue;
+        }
+
+        temp += (int)(rng_next() % 7) - 3;
+        if (rng_next() % 10 == 0) hum += (int)(rng_next() % 3) - 1;
+        if (rng_next() % 30 == 0) pressure += (int)(rng_next() % 3) - 1;
+        if (m == 6 * 60 || m == 22 * 60) setpoint = (m == 6 * 60) ? 2100 : 1700;
+        if (rng_next() % 60 == 0) flags ^= HISTORY_FLAG_RELAY_ON;
+
+        day[m].minute_of_day = m;
+        day[m].temperature = (int16_t)temp;
+        day[m].humidity = (uint8_t)hum;
+        day[m].flags = flags;
+        day[m].setpoint = (int16_t)setpoint;
+        day[m].active_bank = (m < 12 * 60) ? 0 : 1;
+        day[m].reserved = 0;
+        day[m].pressure = (uint16_t)pressure;
+    }
+}
+
+static size_t encode_day(const history_sample_t* day, uint8_t* out)
+{
+    tlog2_state_t state;
+    tlog2_init(&state);
+
+    size_t len = 0;
+    for (int m = 0; m < SAMPLES_PER_DAY; m++) {
+        len += tlog2_encode(&state, &day[m], &out[len]);
+    }
+    return len;
+}
+
+static void decode_day(const uint8_t* in, size_t len, history_sample_t* day)
+{
+    tlog2_state_t state;
+    tlog2_init(&state);
+
+    size_t pos = 0;
+    for (int m = 0; m < SAMPLES_PER_DAY; m++) {
+        int r = tlog2_decode(&state, m, &in[pos], len - pos, &day[m]);
+        TEST_ASSERT_GREATER_THAN_INT(0, r);
+        pos += r;
+    }
+    TEST_ASSERT_EQUAL_UINT(len, pos);
+}
+
+static void assert_day_equal(const history_sample_t* a, const history_sample_t* b)
+{
+    for (int m = 0; m < SAMPLES_PER_DAY; m++) {
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(&a[m], &b[m], sizeof(history_sample_t), "minuto diverso");
+    }
+}
+
+static history_sample_t s_day[SAMPLES_PER_DAY];
+static history_sample_t s_out[SAMPLES_PER_DAY];
+static uint8_t s_encoded[SAMPLES_PER_DAY * TLOG2_MAX_RECORD_SIZE];
+
+// ============================================================================
+// TEST
+// ============================================================================
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_roundtrip_realistic_day(void)
+{
+    make_day(s_day, 1);
+    size_t len = encode_day(s_day, s_encoded);
+    decode_day(s_encoded, len, s_out);
+    assert_day_equal(s_day, s_out);
+
+    printf("Giornata tipica: %zu byte (v1 %zu byte, rapporto %.1fx)\n",
+           len, (size_t)DAY_V1_SIZE, (double)DAY_V1_SIZE / len);
+    TEST_ASSERT_LESS_THAN(DAY_V1_SIZE / 3, len);
+}
+
+static void test_roundtrip_extreme_values(void)
+{
+    // Valori a caso su tutto il range: delta da 3 byte su ogni canale
+    s_rng = 99;
+    for (int m = 0; m < SAMPLES_PER_DAY; m++) {
+        history_sample_t* s = &s_day[m];
+        s->minute_of_day = m;
+        s->temperature = (int16_t)(m % 2 ? 32767 : -32767);
+        s->humidity = (uint8_t)rng_next();
+        s->flags = (uint8_t)rng_next();
+        s->setpoint = (int16_t)(m % 2 ? -32767 : 32767);
+        s->active_bank = (uint8_t)(rng_next() % 4);
+        s->reserved = 0;
+        s->pressure = (uint16_t)(m % 2 ? 65535 : 1);
+    }
+
+    size_t len = encode_day(s_day, s_encoded);
+    TEST_ASSERT_LESS_OR_EQUAL(SAMPLES_PER_DAY * TLOG2_MAX_RECORD_SIZE, len);
+    decode_day(s_encoded, len, s_out);
+    assert_day_equal(s_day, s_out);
+}
+
+static void test_empty_day(void)
+{
+    for (int m = 0; m < SAMPLES_PER_DAY; m++) {
+        tlog2_make_empty(&s_day[m], m);
+    }
+    size_t len = encode_day(s_day, s_encoded);
+    TEST_ASSERT_EQUAL_UINT(SAMPLES_PER_DAY, len);
+    decode_day(s_encoded, len, s_out);
+    assert_day_equal(s_day, s_out);
+}
+
+static void test_streaming_byte_by_byte(void)
+{
+    // Il decoder riceve i byte uno alla volta, come da un chunk di rete
+    make_day(s_day, 2);
+    size_t len = encode_day(s_day, s_encoded);
+
+    tlog2_state_t state;
+    tlog2_init(&state);
+    size_t pos = 0;
+
+    for (int m = 0; m < SAMPLES_PER_DAY; m++) {
+        int r = 0;
+        for (size_t avail = 1; r == 0; avail++) {
+            TEST_ASSERT_TRUE(pos + avail <= len);
+            r = tlog2_decode(&state, m, &s_encoded[pos], avail, &s_out[m]);
+        }
+        TEST_ASSERT_GREATER_THAN_INT(0, r);
+        pos += r;
+    }
+    TEST_ASSERT_EQUAL_UINT(len, pos);
+    assert_day_equal(s_day, s_out);
+}
+
+static void test_invalid_records(void)
+{
+    tlog2_state_t state;
+    history_sample_t s;
+    const uint8_t reserved[] = { TLOG2_F_RESERVED };
+    const uint8_t empty_with_fields[] = { TLOG2_F_EMPTY | TLOG2_F_TEMP, 0x02 };
+    const uint8_t varint_too_long[] = { TLOG2_F_TEMP, 0x80, 0x80, 0x80, 0x01 };
+
+    tlog2_init(&state);
+    TEST_ASSERT_EQUAL_INT(-1, tlog2_decode(&state, 0, reserved, sizeof(reserved), &s));
+    TEST_ASSERT_EQUAL_INT(-1, tlog2_decode(&state, 0, empty_with_fields, sizeof(empty_with_fields), &s));
+    TEST_ASSERT_EQUAL_INT(-1, tlog2_decode(&state, 0, varint_too_long, sizeof(varint_too_long), &s));
+    TEST_ASSERT_EQUAL_INT(0, tlog2_decode(&state, 0, varint_too_long, 2, &s));
+}
+
+static void test_throughput(void)
+{
+    size_t total_len = 0;
+    double enc_us = 0;
+    double dec_us = 0;
+
+    for (int d = 0; d < BENCH_DAYS; d++) {
+        make_day(s_day, 1000 + d);
+
+        double t0 = now_us();
+        size_t len = encode_day(s_day, s_encoded);
+        double t1 = now_us();
+        decode_day(s_encoded, len, s_out);
+        double t2 = now_us();
+
+        enc_us += t1 - t0;
+        dec_us += t2 - t1;
+        total_len += len;
+    }
+
+    double samples = (double)BENCH_DAYS * SAMPLES_PER_DAY;
+    printf("%d giorni: v2 %.2f MB, v1 %.2f MB\n", BENCH_DAYS,
+           total_len / 1e6, BENCH_DAYS * (double)DAY_V1_SIZE / 1e6);
+    printf("encode: %.1f Msample/s (%.1f us/giorno)\n", samples / enc_us, enc_us / BENCH_DAYS);
+    printf("decode: %.1f Msample/s (%.1f us/giorno)\n", samples / dec_us, dec_us / BENCH_DAYS);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_roundtrip_realistic_day);
+    RUN_TEST(test_roundtrip_extreme_values);
+    RUN_TEST(test_empty_day);
+    RUN_TEST(test_streaming_byte_by_byte);
+    RUN_TEST(test_invalid_records);
+    RUN_TEST(test_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,353 @@
+/**
+ * @file test_flush.cpp
+ * @brief Flush incrementale del giorno: byte scritti e latenza su host
+ *
+ * Ripete una giornata di history_record() (un sample al minuto, flush a
+ * ogni cambio d'ora come status_task) contro il backend spiffs, con i file
+ * in una directory temporanea al posto di /spiffs. Confronta:
+ *   - append incrementale (HISTORY_INCREMENTAL_FLUSH = 1)
+ *   - riscrittura v2 dell'intero giorno a ogni flush
+ *   - riscrittura v1 originale (header + 1440 record da 12 byte, "wb")
+ *
+ * Esecuzione: pio test -e native -f test_flush
+ */
+
+#include <unity.h>
+
+#include "history_codec.cpp"
+#include "history_backend_spiffs.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define TEST_YEAR           2026
+#define TEST_MONTH          2
+#define TEST_DAY            9
+#define FLUSHES_PER_DAY     24
+
+// ============================================================================
+// STATO
+// ============================================================================
+
+static char s_dir[14];                  // "/tmp/tlXXXXXX": i nomi restano entro 32 byte
+
+static history_sample_t s_samples[HISTORY_SAMPLES_PER_DAY];
+static history_extremes_t s_extremes[HISTORY_SAMPLES_PER_DAY];
+static history_buffer_t s_buffer;
+static tlog2_state_t s_codec;
+
+typedef struct {
+    size_t bytes;                       // Byte scritti nella giornata
+    double latency_us[FLUSHES_PER_DAY]; // Latenza di ogni flush
+    int flushes;
+    int appended;
+} flush_report_t;
+
+typedef enum {
+    MODE_INCREMENTAL,
+    MODE_REWRITE_V2,
+    MODE_REWRITE_V1,
+} flush_mode_t;
+
+// ============================================================================
+// SOSTITUTI DI history_manager.cpp
+// ============================================================================
+
+extern "C" void history_get_filename(uint16_t year, uint8_t month, uint8_t day,
+                                     char* buffer, size_t buffer_size)
+{
+    snprintf(buffer, buffer_size, "%s/log_%04d%02d%02d.bin", s_dir, year, month, day);
+}
+
+extern "C" void history_get_extremes_filename(uint16_t year, uint8_t month, uint8_t day,
+                                              char* buffer, size_t buffer_size)
+{
+    snprintf(buffer, buffer_size, "%s/log_%04d%02d%02d.ext", s_dir, year, month, day);
+}
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare_double(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void buffer_reset(void)
+{
+    char filename[32];
+    history_get_filename(TEST_YEAR, TEST_MONTH, TEST_DAY, filename, sizeof(filename));
+    remove(filename);
+    history_get_extremes_filename(TEST_YEAR, TEST_MONTH, TEST_DAY, filename, sizeof(filename));
+    remove(filename);
+
+    memset(&s_buffer, 0, sizeof(s_buffer));
+    memcpy(s_buffer.header.magic, HISTORY_MAGIC, 4);
+    s_buffer.header.version = HISTORY_VERSION;
+    s_buffer.header.year = TEST_YEAR;
+    s_buffer.header.month = TEST_MONTH;
+    s_buffer.header.day = TEST_DAY;
+    s_buffer.samples = s_samples;
+    s_buffer.extremes = s_extremes;
+    s_buffer.dirty_from = HISTORY_SAMPLES_PER_DAY;
+
+    for (int m = 0; m < HISTORY_SAMPLES_PER_DAY; m++) {
+        tlog2_make_empty(&s_samples[m], m);
+        s_extremes[m].below = HISTORY_EXT_UNKNOWN;
+        s_extremes[m].above = HISTORY_EXT_UNKNOWN;
+    }
+    tlog2_init(&s_codec);
+}
+
+/**
+ * @brief Come history_record(): sample nel buffer e range sporco
+ */
+static void record_minute(uint16_t m)
+{
+    history_sample_t* s = &s_samples[m];
+    s->minute_of_day = m;
+    s->temperature = (int16_t)(2000 + (m % 97) - (m % 13));
+    s->humidity = (uint8_t)(50 + (m / 120));
+    s->flags = ((m / 45) % 2) ? HISTORY_FLAG_RELAY_ON : 0;
+    s->setpoint = (m >= 6 * 60 && m < 22 * 60) ? 2100 : 1700;
+    s->active_bank = 0;
+    s->reserved = 0;
+    s->pressure = (uint16_t)(10130 + (m / 60));
+
+    s_extremes[m].below = 3;
+    s_extremes[m].above = 4;
+
+    if (m >= s_buffer.header.num_samples) {
+        s_buffer.header.num_samples = m + 1;
+    }
+    s_buffer.current_minute = m;
+    if (m < s_buffer.dirty_from) {
+        s_buffer.dirty_from = m;
+    }
+    s_buffer.dirty = true;
+}
+
+/**
+ * @brief Formato originale: header + 1440 record v1, file riaperto con "wb"
+ */
+static size_t write_day_v1(void)
+{
+    char filename[32];
+    history_get_filename(TEST_YEAR, TEST_MONTH, TEST_DAY, filename, sizeof(filename));
+
+    history_header_t header = s_buffer.header;
+    header.version = HISTORY_VERSION_V1;
+
+    FILE* f = fopen(filename, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    size_t bytes = fwrite(&header, 1, sizeof(header), f);
+    bytes += fwrite(s_samples, 1, sizeof(s_samples), f);
+    fclose(f);
+    return bytes;
+}
+
+/**
+ * @brief Come flush_buffer(): append se possibile, altrimenti riscrittura
+ */
+static void flush(flush_mode_t mode, flush_report_t* report)
+{
+    uint16_t ext_from = s_buffer.persisted_samples;
+    size_t bytes = 0;
+    bool appended = false;
+
+    double start = now_us();
+
+    if (mode == MODE_REWRITE_V1) {
+        bytes = write_day_v1();
+    } else {
+        bool can_append = mode == MODE_INCREMENTAL &&
+                          s_buffer.persisted_samples > 0 &&
+                          s_buffer.dirty_from >= s_buffer.persisted_samples &&
+                          s_buffer.header.num_samples >= s_buffer.persisted_samples;
+
+        esp_err_t ret = ESP_ERR_NOT_FOUND;
+        if (can_append) {
+            ret = history_backend_spiffs.write_day(&s_buffer, &s_codec, true, &bytes);
+        }
+        appended = (ret == ESP_OK);
+        if (!appended) {
+            ret = history_backend_spiffs.write_day(&s_buffer, &s_codec, false, &bytes);
+        }
+        TEST_ASSERT_EQUAL_INT(ESP_OK, ret);
+
+        uint16_t from = appended ? ext_from : 0;
+        TEST_ASSERT_EQUAL_INT(ESP_OK, history_backend_spiffs.write_extremes(&s_buffer, from));
+        bytes += (s_buffer.header.num_samples - from) * sizeof(history_extremes_t);
+    }
+
+    report->latency_us[report->flushes++] = now_us() - start;
+    report->bytes += bytes;
+    report->appended += appended ? 1 : 0;
+
+    s_buffer.persisted_samples = s_buffer.header.num_samples;
+    s_buffer.dirty_from = HISTORY_SAMPLES_PER_DAY;
+    s_buffer.dirty = false;
+}
+
+static void replay_day(flush_mode_t mode, flush_report_t* report)
+{
+    memset(report, 0, sizeof(*report));
+    buffer_reset();
+
+    for (uint16_t m = 0; m < HISTORY_SAMPLES_PER_DAY; m++) {
+        record_minute(m);
+        if (m % 60 == 59) {
+            flush(mode, report);    // Cambio d'ora
+        }
+    }
+}
+
+static void print_report(const char* label, flush_report_t* report)
+{
+    double sorted[FLUSHES_PER_DAY];
+    memcpy(sorted, report->latency_us, sizeof(sorted));
+    qsort(sorted, report->flushes, sizeof(double), compare_double);
+
+    printf("%-16s %7zu byte/giorno  flush p50 %7.1f us  max %7.1f us  (append %d/%d)\n",
+           label, report->bytes, sorted[report->flushes / 2], sorted[report->flushes - 1],
+           report->appended, report->flushes);
+}
+
+/**
+ * @brief Rilegge il giorno con il reader del backend e lo confronta col buffer
+ */
+static void assert_file_matches_buffer(void)
+{
+    history_reader_t reader;
+    memset(&reader, 0, sizeof(reader));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, history_backend_spiffs.reader_open(&reader, TEST_YEAR,
+                                                                     TEST_MONTH, TEST_DAY));
+    TEST_ASSERT_EQUAL_UINT16(s_buffer.header.num_samples, reader.header.num_samples);
+
+    history_sample_t sample;
+    uint16_t m = 0;
+    while (history_backend_spiffs.reader_next(&reader, &sample) == ESP_OK) {
+        TEST_ASSERT_EQUAL_MEMORY(&s_samples[m], &sample, sizeof(sample));
+        m++;
+    }
+    history_backend_spiffs.reader_close(&reader);
+    TEST_ASSERT_EQUAL_UINT16(s_buffer.header.num_samples, m);
+}
+
+// ============================================================================
+// TEST
+// ============================================================================
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_incremental_day_roundtrip(void)
+{
+    flush_report_t report;
+    replay_day(MODE_INCREMENTAL, &report);
+
+    TEST_ASSERT_EQUAL_INT(FLUSHES_PER_DAY, report.flushes);
+    TEST_ASSERT_EQUAL_INT(FLUSHES_PER_DAY - 1, report.appended);
+    assert_file_matches_buffer();
+}
+
+static void test_rewrite_after_past_minute_changed(void)
+{
+    // Un minuto già committato modificato (backfill): niente append
+    flush_report_t report;
+    memset(&report, 0, sizeof(report));
+    buffer_reset();
+
+    for (uint16_t m = 0; m < 120; m++) {
+        record_minute(m);
+    }
+    flush(MODE_INCREMENTAL, &report);
+    record_minute(10);
+    s_samples[10].temperature = 1234;
+    record_minute(120);
+    flush(MODE_INCREMENTAL, &report);
+
+    TEST_ASSERT_EQUAL_INT(0, report.appended);
+    assert_file_matches_buffer();
+}
+
+static void test_uncommitted_tail_is_ignored(void)
+{
+    // Record accodati senza l'header che li committa (reset a metà flush)
+    flush_report_t report;
+    memset(&report, 0, sizeof(report));
+    buffer_reset();
+
+    for (uint16_t m = 0; m < 180; m++) {
+        record_minute(m);
+        if (m % 60 == 59) {
+            flush(MODE_INCREMENTAL, &report);
+        }
+    }
+
+    char filename[32];
+    history_get_filename(TEST_YEAR, TEST_MONTH, TEST_DAY, filename, sizeof(filename));
+    FILE* f = fopen(filename, "ab");
+    TEST_ASSERT_NOT_NULL(f);
+    const uint8_t tail[] = { TLOG2_F_TEMP, 0x04, TLOG2_F_TEMP, 0x80 };
+    fwrite(tail, 1, sizeof(tail), f);
+    fclose(f);
+
+    assert_file_matches_buffer();
+}
+
+static void test_bytes_and_latency(void)
+{
+    flush_report_t incremental;
+    flush_report_t rewrite_v2;
+    flush_report_t rewrite_v1;
+
+    replay_day(MODE_INCREMENTAL, &incremental);
+    replay_day(MODE_REWRITE_V2, &rewrite_v2);
+    replay_day(MODE_REWRITE_V1, &rewrite_v1);
+
+    print_report("append v2", &incremental);
+    print_report("riscrittura v2", &rewrite_v2);
+    print_report("riscrittura v1", &rewrite_v1);
+    printf("riduzione rispetto a v1: %.1fx\n", (double)rewrite_v1.bytes / incremental.bytes);
+
+    TEST_ASSERT_LESS_THAN(rewrite_v1.bytes / 20, incremental.bytes);
+    TEST_ASSERT_LESS_THAN(rewrite_v2.bytes, incremental.bytes);
+}
+
+int main(void)
+{
+    strcpy(s_dir, "/tmp/tlXXXXXX");
+    if (mkdtemp(s_dir) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_incremental_day_roundtrip);
+    RUN_TEST(test_rewrite_after_past_minute_changed);
+    RUN_TEST(test_uncommitted_tail_is_ignored);
+    RUN_TEST(test_bytes_and_latency);
+    int failures = UNITY_END();
+
+    buffer_reset();
+    rmdir(s_dir);
+    return failures;
+}
@@ -0,0 +1,323 @@
+/**
+ * @file test_json_writer.cpp
+ * @brief json_writer: formattazione e confronto con snprintf + un chunk per record
+ *
+ * Genera il JSON di /api/log/data per una giornata completa nei due modi:
+ *   - come prima di json_writer: snprintf("%.2f") e httpd_resp_sendstr_chunk
+ *     per ogni record
+ *   - con json_writer (buffer da JSON_WRITER_BUF_SIZE)
+ * I due testi devono coincidere; si riportano chunk, byte sul filo
+ * (intestazioni dei chunk HTTP comprese) e tempo di CPU.
+ *
+ * Esecuzione: pio test -e native -f test_json_writer
+ */
+
+#include <unity.h>
+
+#include "history_codec.cpp"
+#include "json_writer.cpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define OUTPUT_MAX          (256 * 1024)
+#define BENCH_ROUNDS        50
+
+// ============================================================================
+// STATO
+// ============================================================================
+
+/**
+ * @brief Destinazione dei chunk: testo ricevuto e contatori
+ */
+typedef struct {
+    char* data;
+    size_t len;
+    uint32_t chunks;
+    uint32_t wire_bytes;    // Byte + "<hex>\r\n...\r\n" di ogni chunk
+    bool fail_after;        // Simula la chiusura della connessione
+    uint32_t fail_at_chunk;
+} sink_t;
+
+static char s_out_a[OUTPUT_MAX];
+static char s_out_b[OUTPUT_MAX];
+static history_sample_t s_day[SAMPLES_PER_DAY];
+
+// ============================================================================
+// SOSTITUTI DI esp_http_server
+// ============================================================================
+
+extern "C" esp_err_t httpd_resp_send_chunk(httpd_req_t* req, const char* buf, ssize_t buf_len)
+{
+    sink_t* sink = (sink_t*)req->user_ctx;
+
+    if (sink->fail_after && sink->chunks >= sink->fail_at_chunk) {
+        return ESP_FAIL;
+    }
+
+    char hex[16];
+    int hex_len = snprintf(hex, sizeof(hex), "%zx", (size_t)buf_len);
+    sink->wire_bytes += hex_len + 4 + (uint32_t)buf_len;
+    sink->chunks++;
+
+    if (buf != NULL && buf_len > 0) {
+        TEST_ASSERT_TRUE(sink->len + buf_len < OUTPUT_MAX);
+        memcpy(&sink->data[sink->len], buf, buf_len);
+        sink->len += buf_len;
+        sink->data[sink->len] = '\0';
+    }
+    return ESP_OK;
+}
+
+extern "C" esp_err_t httpd_resp_sendstr_chunk(httpd_req_t* req, const char* str)
+{
+    return httpd_resp_send_chunk(req, str, (str != NULL) ? (ssize_t)strlen(str) : 0);
+}
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void sink_init(sink_t* sink, httpd_req_t* req, char* data)
+{
+    memset(sink, 0, sizeof(*sink));
+    sink->data = data;
+    data[0] = '\0';
+    req->user_ctx = sink;
+}
+
+static void make_day(void)
+{
+    for (int m = 0; m < SAMPLES_PER_DAY; m++) {
+        history_sample_t* s = &s_day[m];
+        if (m % 150 == 7) {
+            tlog2_make_empty(s, m);
+            continue;
+        }
+        s->minute_of_day = m;
+        s->temperature = (int16_t)(1850 + (m * 37) % 400 - (m % 3 == 0 ? 2000 : 0));
+        s->humidity = (uint8_t)(40 + m % 30);
+        s->flags = (m / 30) % 2;
+        s->setpoint = (m % 500 == 0) ? -32768 : 2050;
+        s->active_bank = 0;
+        s->reserved = 0;
+        s->pressure = (uint16_t)(10000 + m);
+    }
+}
+
+/**
+ * @brief log_data_handler() prima di json_writer
+ */
+static void send_day_legacy(httpd_req_t* req)
+{
+    char json_buf[256];
+
+    httpd_resp_sendstr_chunk(req, "{");
+    snprintf(json_buf, sizeof(json_buf),
+             "\"date\":\"%04d-%02d-%02d\",\"samples\":%d,\"data\":[", 2026, 2, 9, SAMPLES_PER_DAY);
+    httpd_resp_sendstr_chunk(req, json_buf);
+
+    for (int i = 0; i < SAMPLES_PER_DAY; i++) {
+        const history_sample_t* s = &s_day[i];
+        char temp_str[16], setpoint_str[16], hum_str[8], press_str[8];
+
+        if (s->temperature == -32768) strcpy(temp_str, "null");
+        else snprintf(temp_str, sizeof(temp_str), "%.2f", s->temperature / 100.0f);
+        if (s->setpoint == -32768) strcpy(setpoint_str, "null");
+        else snprintf(setpoint_str, sizeof(setpoint_str), "%.2f", s->setpoint / 100.0f);
+        if (s->humidity == 255) strcpy(hum_str, "null");
+        else snprintf(hum_str, sizeof(hum_str), "%d", s->humidity);
+        if (s->pressure == 0) strcpy(press_str, "null");
+        else snprintf(press_str, sizeof(press_str), "%d", s->pressure);
+
+        snprintf(json_buf, sizeof(json_buf),
+                 "%s{\"t\":\"%02d:%02d\",\"temp\":%s,\"hum\":%s,\"heat\":%d,\"setpoint\":%s,\"press\":%s}",
+                 i == 0 ? "" : ",", s->minute_of_day / 60, s->minute_of_day % 60,
+                 temp_str, hum_str, s->flags & HISTORY_FLAG_RELAY_ON, setpoint_str, press_str);
+        httpd_resp_sendstr_chunk(req, json_buf);
+    }
+
+    httpd_resp_sendstr_chunk(req, "]}");
+    httpd_resp_sendstr_chunk(req, NULL);
+}
+
+/**
+ * @brief log_data_handler() con json_writer (tutti i campi)
+ */
+static esp_err_t send_day_writer(httpd_req_t* req, json_writer_t* w)
+{
+    static char buf[JSON_WRITER_BUF_SIZE];
+    json_writer_init(w, req, buf, sizeof(buf));
+
+    json_writer_str(w, "{\"date\":\"");
+    json_writer_int(w, 2026);
+    json_writer_char(w, '-');
+    json_writer_2digits(w, 2);
+    json_writer_char(w, '-');
+    json_writer_2digits(w, 9);
+    json_writer_str(w, "\",\"samples\":");
+    json_writer_int(w, SAMPLES_PER_DAY);
+    json_writer_str(w, ",\"data\":[");
+
+    for (int i = 0; i < SAMPLES_PER_DAY; i++) {
+        const history_sample_t* s = &s_day[i];
+
+        json_writer_str(w, i == 0 ? "{\"t\":\"" : ",{\"t\":\"");
+        json_writer_2digits(w, s->minute_of_day / 60);
+        json_writer_char(w, ':');
+        json_writer_2digits(w, s->minute_of_day % 60);
+        json_writer_str(w, "\",\"temp\":");
+        if (s->temperature == -32768) json_writer_str(w, "null");
+        else json_writer_fixed(w, s->temperature, 2);
+        json_writer_str(w, ",\"hum\":");
+        if (s->humidity == 255) json_writer_str(w, "null");
+        else json_writer_int(w, s->humidity);
+        json_writer_str(w, ",\"heat\":");
+        json_writer_int(w, s->flags & HISTORY_FLAG_RELAY_ON);
+        json_writer_str(w, ",\"setpoint\":");
+        if (s->setpoint == -32768) json_writer_str(w, "null");
+        else json_writer_fixed(w, s->setpoint, 2);
+        json_writer_str(w, ",\"press\":");
+        if (s->pressure == 0) json_writer_str(w, "null");
+        else json_writer_int(w, s->pressure);
+        json_writer_char(w, '}');
+    }
+
+    json_writer_str(w, "]}");
+    return json_writer_finish(w);
+}
+
+// ============================================================================
+// TEST
+// ============================================================================
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_fixed_matches_printf(void)
+{
+    // Tutti i valori int16 × 100 come snprintf("%.2f") e "%d"
+    httpd_req_t req;
+    sink_t sink;
+    char buf[64];
+    char expected[32];
+    json_writer_t w;
+
+    sink_init(&sink, &req, s_out_a);
+    for (int32_t v = -32768; v <= 32767; v++) {
+        json_writer_init(&w, &req, buf, sizeof(buf));
+        json_writer_fixed(&w, v, 2);
+        buf[w.len] = '\0';
+        snprintf(expected, sizeof(expected), "%.2f", v / 100.0);
+        TEST_ASSERT_EQUAL_STRING(expected, buf);
+    }
+
+    const int32_t ints[] = { 0, 1, -1, 9, 10, -10, 99999, INT32_MAX, INT32_MIN };
+    for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+        json_writer_init(&w, &req, buf, sizeof(buf));
+        json_writer_int(&w, ints[i]);
+        buf[w.len] = '\0';
+        snprintf(expected, sizeof(expected), "%ld", (long)ints[i]);
+        TEST_ASSERT_EQUAL_STRING(expected, buf);
+    }
+
+    json_writer_init(&w, &req, buf, sizeof(buf));
+    json_writer_fixed(&w, -5, 3);
+    json_writer_char(&w, ' ');
+    json_writer_2digits(&w, 7);
+    buf[w.len] = '\0';
+    TEST_ASSERT_EQUAL_STRING("-0.005 07", buf);
+    TEST_ASSERT_EQUAL_UINT32(0, sink.chunks);
+}
+
+static void test_small_buffer_splits_chunks(void)
+{
+    // Buffer minimo: ogni scrittura può forzare un flush, il testo non cambia
+    httpd_req_t req;
+    sink_t sink;
+    char buf[JSON_NUMBER_MAX_LEN];
+    json_writer_t w;
+
+    sink_init(&sink, &req, s_out_a);
+    json_writer_init(&w, &req, buf, sizeof(buf));
+    json_writer_str(&w, "{\"a_long_key_longer_than_the_buffer\":[");
+    json_writer_fixed(&w, -12345, 2);
+    json_writer_char(&w, ',');
+    json_writer_int(&w, INT32_MIN);
+    json_writer_str(&w, "]}");
+    TEST_ASSERT_EQUAL_INT(ESP_OK, json_writer_finish(&w));
+
+    TEST_ASSERT_EQUAL_STRING("{\"a_long_key_longer_than_the_buffer\":[-123.45,-2147483648]}", s_out_a);
+    TEST_ASSERT_EQUAL_UINT32(w.bytes_sent, sink.len);
+}
+
+static void test_send_error_stops_writer(void)
+{
+    httpd_req_t req;
+    sink_t sink;
+    json_writer_t w;
+
+    make_day();
+    sink_init(&sink, &req, s_out_a);
+    sink.fail_after = true;
+    sink.fail_at_chunk = 2;
+
+    TEST_ASSERT_EQUAL_INT(ESP_FAIL, send_day_writer(&req, &w));
+    TEST_ASSERT_EQUAL_UINT32(2, sink.chunks);
+    TEST_ASSERT_EQUAL_UINT16(2, w.chunks_sent);
+}
+
+static void test_day_payload_and_cost(void)
+{
+    httpd_req_t req;
+    sink_t legacy;
+    sink_t writer;
+    json_writer_t w;
+
+    make_day();
+
+    double t0 = now_us();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        sink_init(&legacy, &req, s_out_a);
+        send_day_legacy(&req);
+    }
+    double t1 = now_us();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        sink_init(&writer, &req, s_out_b);
+        TEST_ASSERT_EQUAL_INT(ESP_OK, send_day_writer(&req, &w));
+    }
+    double t2 = now_us();
+
+    TEST_ASSERT_EQUAL_UINT(legacy.len, writer.len);
+    TEST_ASSERT_EQUAL_STRING(s_out_a, s_out_b);
+
+    printf("giornata /api/log/data: %zu byte di JSON\n", writer.len);
+    printf("snprintf + chunk/record: %5u chunk, %7u byte sul filo, %7.1f us\n",
+           legacy.chunks, legacy.wire_bytes, (t1 - t0) / BENCH_ROUNDS);
+    printf("json_writer:             %5u chunk, %7u byte sul filo, %7.1f us\n",
+           writer.chunks, writer.wire_bytes, (t2 - t1) / BENCH_ROUNDS);
+
+    TEST_ASSERT_LESS_THAN_UINT32(legacy.chunks / 40, writer.chunks);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fixed_matches_printf);
+    RUN_TEST(test_small_buffer_splits_chunks);
+    RUN_TEST(test_send_error_stops_writer);
+    RUN_TEST(test_day_payload_and_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,477 @@
+/**
+ * @file test_log_backend.cpp
+ * @brief Backend log su partizione: correttezza, throughput di accodamento
+ *        e latenza di lettura su host
+ *
+ * La partizione tslog è un file mappato in memoria (test/stubs/esp_partition.h)
+ * delle stesse dimensioni di partitions_tslog.csv, con la semantica della
+ * flash NOR. Le giornate vengono scritte come da status_task: un flush in
+ * append a ogni cambio d'ora.
+ *
+ * Esecuzione: pio test -e native -f test_log_backend
+ */
+
+#include <unity.h>
+
+#include "history_codec.cpp"
+#include "history_backend_log.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define PARTITION_SECTORS   2032                // partitions_tslog.csv
+#define PARTITION_SIZE      (PARTITION_SECTORS * LOG_SECTOR_SIZE)
+#define FIRST_YEAR          2026
+#define FILL_DAYS           300                 // Oltre la capacità: il ring gira
+#define RANGE_DAYS          7                   // Finestra tipica di /api/range
+#define READ_ITERATIONS     200
+
+// ============================================================================
+// STATO
+// ============================================================================
+
+static char s_path[] = "/tmp/tslogXXXXXX";
+
+static history_sample_t s_samples[HISTORY_SAMPLES_PER_DAY];
+static history_extremes_t s_extremes[HISTORY_SAMPLES_PER_DAY];
+static history_buffer_t s_buffer;
+static tlog2_state_t s_codec;
+
+static const history_backend_t* const s_backend = &history_backend_log;
+
+// ============================================================================
+// SOSTITUTI DI metrics.cpp
+// ============================================================================
+
+esp_err_t metrics_register(const char* name, const char* help, const char* labels,
+                           metric_type_t type, void* metric)
+{
+    return ESP_OK;
+}
+
+void metrics_counter_add(metrics_counter_t* c, uint32_t n)
+{
+    c->lo[0] += n;
+}
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare_double(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief n-esimo giorno a partire dal 1 gennaio di FIRST_YEAR
+ */
+static void date_of(uint32_t n, uint16_t* year, uint8_t* month, uint8_t* day)
+{
+    *year = FIRST_YEAR;
+    *month = 1;
+    while (n >= days_in_month(*year, *month)) {
+        n -= days_in_month(*year, *month);
+        if (++*month > 12) {
+            *month = 1;
+            (*year)++;
+        }
+    }
+    *day = (uint8_t)(n + 1);
+}
+
+static int16_t temperature_of(uint32_t n, uint16_t m)
+{
+    return (int16_t)(1800 + (int)(n % 50) * 10 + (m % 97) - (m % 13));
+}
+
+/**
+ * @brief Smonta e rimonta il backend: indice ricostruito dalla partizione
+ */
+static void backend_remount(void)
+{
+    if (s_mutex != NULL) {
+        vSemaphoreDelete(s_mutex);
+        s_mutex = NULL;
+    }
+    heap_caps_free(s_sectors);
+    s_sectors = NULL;
+    s_part = NULL;
+    s_head = 0;
+    s_next_seq = 1;
+    TEST_ASSERT_EQUAL_INT(ESP_OK, s_backend->init());
+}
+
+static void partition_reset(void)
+{
+    host_partition_close();
+    TEST_ASSERT_EQUAL_INT(ESP_OK, host_partition_open(s_path, HISTORY_LOG_PARTITION,
+                                                      PARTITION_SIZE, true));
+    backend_remount();
+}
+
+static void buffer_reset(uint32_t n)
+{
+    uint16_t year;
+    uint8_t month, day;
+    date_of(n, &year, &month, &day);
+
+    memset(&s_buffer, 0, sizeof(s_buffer));
+    memcpy(s_buffer.header.magic, HISTORY_MAGIC, 4);
+    s_buffer.header.version = HISTORY_VERSION;
+    s_buffer.header.year = year;
+    s_buffer.header.month = month;
+    s_buffer.header.day = day;
+    s_buffer.samples = s_samples;
+    s_buffer.extremes = s_extremes;
+    s_buffer.dirty_from = HISTORY_SAMPLES_PER_DAY;
+
+    for (int m = 0; m < HISTORY_SAMPLES_PER_DAY; m++) {
+        tlog2_make_empty(&s_samples[m], m);
+        s_extremes[m].below = HISTORY_EXT_UNKNOWN;
+        s_extremes[m].above = HISTORY_EXT_UNKNOWN;
+    }
+    tlog2_init(&s_codec);
+}
+
+static void record_minute(uint32_t n, uint16_t m)
+{
+    history_sample_t* s = &s_samples[m];
+    s->minute_of_day = m;
+    s->temperature = temperature_of(n, m);
+    s->humidity = (uint8_t)(50 + (m / 120));
+    s->flags = ((m / 45) % 2) ? HISTORY_FLAG_RELAY_ON : 0;
+    s->setpoint = (m >= 6 * 60 && m < 22 * 60) ? 2100 : 1700;
+    s->active_bank = 0;
+    s->reserved = 0;
+    s->pressure = (uint16_t)(10130 + (m / 60));
+
+    s_extremes[m].below = (uint8_t)(m % 7);
+    s_extremes[m].above = (uint8_t)(m % 5);
+
+    if (m >= s_buffer.header.num_samples) {
+        s_buffer.header.num_samples = m + 1;
+    }
+    if (m < s_buffer.dirty_from) {
+        s_buffer.dirty_from = m;
+    }
+}
+
+/**
+ * @brief Come flush_buffer(): append se nessun minuto già scritto è cambiato
+ */
+static void flush(void)
+{
+    bool append = s_buffer.persisted_samples > 0 &&
+                  s_buffer.dirty_from >= s_buffer.persisted_samples;
+    size_t bytes;
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, s_backend->write_day(&s_buffer, &s_codec, append, &bytes));
+    s_buffer.persisted_samples = s_buffer.header.num_samples;
+    s_buffer.dirty_from = HISTORY_SAMPLES_PER_DAY;
+}
+
+static void write_day(uint32_t n)
+{
+    buffer_reset(n);
+    for (uint16_t m = 0; m < HISTORY_SAMPLES_PER_DAY; m++) {
+        record_minute(n, m);
+        if (m % 60 == 59) {
+            flush();        // Cambio d'ora
+        }
+    }
+}
+
+/**
+ * @brief Legge il giorno n e ne verifica tutti i minuti
+ */
+static void assert_day(uint32_t n)
+{
+    uint16_t year;
+    uint8_t month, day;
+    date_of(n, &year, &month, &day);
+
+    history_reader_t reader;
+    memset(&reader, 0, sizeof(reader));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, s_backend->reader_open(&reader, year, month, day));
+    TEST_ASSERT_EQUAL_UINT16(HISTORY_SAMPLES_PER_DAY, reader.header.num_samples);
+
+    history_sample_t s;
+    uint16_t m = 0;
+    while (s_backend->reader_next(&reader, &s) == ESP_OK) {
+        TEST_ASSERT_EQUAL_UINT16(m, s.minute_of_day);
+        TEST_ASSERT_EQUAL_INT16(temperature_of(n, m), s.temperature);
+        m++;
+    }
+    s_backend->reader_close(&reader);
+    TEST_ASSERT_EQUAL_UINT16(HISTORY_SAMPLES_PER_DAY, m);
+
+    static history_extremes_t extremes[HISTORY_SAMPLES_PER_DAY];
+    memset(extremes, 0xFF, sizeof(extremes));
+    s_backend->read_extremes(year, month, day, extremes);
+    for (m = 0; m < HISTORY_SAMPLES_PER_DAY; m++) {
+        TEST_ASSERT_EQUAL_UINT8(m % 7, extremes[m].below);
+        TEST_ASSERT_EQUAL_UINT8(m % 5, extremes[m].above);
+    }
+}
+
+static bool day_exists(uint32_t n)
+{
+    uint16_t year;
+    uint8_t month, day;
+    date_of(n, &year, &month, &day);
+    return s_backend->day_exists(year, month, day);
+}
+
+static void count_day_cb(uint16_t year, uint8_t month, uint8_t day, uint16_t num_samples,
+                         uint32_t size, void* arg)
+{
+    (*(uint32_t*)arg)++;
+}
+
+static void year_day_cb(uint16_t year, uint8_t month, uint8_t day, uint16_t num_samples,
+                        uint32_t size, void* arg)
+{
+    uint16_t* years = (uint16_t*)arg;
+    years[++years[0]] = year;
+}
+
+// ============================================================================
+// TEST
+// ============================================================================
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_day_round_trip(void)
+{
+    partition_reset();
+    write_day(0);
+    write_day(1);
+    assert_day(0);
+    assert_day(1);
+
+    // L'indice ricostruito al montaggio dà lo stesso risultato
+    backend_remount();
+    assert_day(0);
+    assert_day(1);
+    TEST_ASSERT_FALSE(day_exists(2));
+}
+
+static void test_rewrite_and_invalidate(void)
+{
+    partition_reset();
+    write_day(0);
+
+    // Minuto passato corretto: accodato di nuovo, vince l'ultimo record
+    s_samples[5].temperature = 1234;
+    s_buffer.dirty_from = 5;
+    flush();
+
+    // Minuto invalidato: il record vuoto annulla quello vecchio
+    tlog2_make_empty(&s_samples[10], 10);
+    s_buffer.dirty_from = 10;
+    flush();
+
+    backend_remount();
+
+    history_reader_t reader;
+    memset(&reader, 0, sizeof(reader));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, s_backend->reader_open(&reader, FIRST_YEAR, 1, 1));
+    history_sample_t s;
+    for (uint16_t m = 0; s_backend->reader_next(&reader, &s) == ESP_OK; m++) {
+        if (m == 5) {
+            TEST_ASSERT_EQUAL_INT16(1234, s.temperature);
+        } else if (m == 10) {
+            TEST_ASSERT_EQUAL_INT16(-32768, s.temperature);
+        } else {
+            TEST_ASSERT_EQUAL_INT16(temperature_of(0, m), s.temperature);
+        }
+    }
+    s_backend->reader_close(&reader);
+}
+
+static void test_torn_record_is_ignored(void)
+{
+    // Reset durante una scrittura: il CRC dell'ultimo record resta cancellato
+    partition_reset();
+    write_day(0);
+
+    uint32_t last = s_sectors[s_head].used - 1;
+    uint8_t* rec = s_host_partition_map + record_offset(s_head, last);
+    memset(rec + offsetof(log_record_t, crc), 0xFF, sizeof(uint32_t));
+
+    backend_remount();
+
+    history_reader_t reader;
+    memset(&reader, 0, sizeof(reader));
+    TEST_ASSERT_EQUAL_INT(ESP_OK, s_backend->reader_open(&reader, FIRST_YEAR, 1, 1));
+    TEST_ASSERT_EQUAL_UINT32((HISTORY_SAMPLES_PER_DAY - 1) * sizeof(log_record_t), reader.offset);
+    s_backend->reader_close(&reader);
+    TEST_ASSERT_EQUAL_UINT32(1, s_corrupted_records.lo[0]);
+}
+
+static void test_foreach_all_years(void)
+{
+    // 31 dicembre e 1 gennaio: year = 0 elenca entrambi gli anni, in ordine
+    partition_reset();
+    write_day(364);
+    write_day(365);
+
+    uint16_t years[4] = {0};
+    s_backend->foreach_day(0, year_day_cb, years);
+    TEST_ASSERT_EQUAL_UINT16(2, years[0]);
+    TEST_ASSERT_EQUAL_UINT16(FIRST_YEAR, years[1]);
+    TEST_ASSERT_EQUAL_UINT16(FIRST_YEAR + 1, years[2]);
+
+    uint32_t listed = 0;
+    s_backend->foreach_day(FIRST_YEAR + 1, count_day_cb, &listed);
+    TEST_ASSERT_EQUAL_UINT32(1, listed);
+}
+
+static void test_append_throughput_and_wrap(void)
+{
+    partition_reset();
+
+    double start = now_us();
+    for (uint32_t n = 0; n < FILL_DAYS; n++) {
+        write_day(n);
+    }
+    double elapsed = now_us() - start;
+
+    uint64_t records = (uint64_t)FILL_DAYS * HISTORY_SAMPLES_PER_DAY;
+    uint64_t capacity = (uint64_t)(PARTITION_SECTORS - 1) * LOG_RECORDS_PER_SECTOR;
+    uint32_t kept_days = (uint32_t)(capacity / HISTORY_SAMPLES_PER_DAY);
+
+    printf("accodamento: %llu record in %.0f ms, %.2f Mrecord/s, %.1f MB/s\n",
+           (unsigned long long)records, elapsed / 1000.0, records / elapsed,
+           host_partition_stats.write_bytes / elapsed);
+    printf("per giorno: %.0f byte scritti in %.0f chiamate, %.2f settori cancellati\n",
+           (double)host_partition_stats.write_bytes / FILL_DAYS,
+           (double)host_partition_stats.writes / FILL_DAYS,
+           (double)host_partition_stats.erased_sectors / FILL_DAYS);
+    printf("capacità: %u giorni completi su %u settori\n", kept_days, PARTITION_SECTORS);
+
+    // Ogni settore cancellato una volta per giro
+    uint32_t opened = (uint32_t)((records + LOG_RECORDS_PER_SECTOR - 1) / LOG_RECORDS_PER_SECTOR);
+    TEST_ASSERT_UINT32_WITHIN(FILL_DAYS * HISTORY_SAMPLES_PER_DAY / 1000, opened,
+                              host_partition_stats.erased_sectors);
+
+    // Restano i giorni più recenti, i più vecchi sono stati sovrascritti
+    TEST_ASSERT_FALSE(day_exists(0));
+    TEST_ASSERT_TRUE(day_exists(FILL_DAYS - kept_days + 1));
+    assert_day(FILL_DAYS - 1);
+    assert_day(FILL_DAYS - kept_days + 1);
+
+    uint32_t listed = 0;
+    s_backend->foreach_day(FIRST_YEAR, count_day_cb, &listed);
+    TEST_ASSERT_UINT32_WITHIN(2, kept_days, listed);
+
+    double t0 = now_us();
+    backend_remount();
+    printf("montaggio partizione piena: %.1f ms\n", (now_us() - t0) / 1000.0);
+}
+
+static void test_range_read_latency(void)
+{
+    // Partizione piena dal test precedente
+    static double day_us[READ_ITERATIONS];
+    static double range_us[READ_ITERATIONS];
+    static double exists_us[READ_ITERATIONS];
+    history_sample_t s;
+    volatile int32_t sink = 0;
+
+    uint32_t newest = FILL_DAYS - 1;
+    uint32_t kept = (uint32_t)((PARTITION_SECTORS - 1) * LOG_RECORDS_PER_SECTOR /
+                               HISTORY_SAMPLES_PER_DAY);
+
+    host_partition_stats.read_bytes = 0;
+    for (int i = 0; i < READ_ITERATIONS; i++) {
+        uint32_t n = newest - (uint32_t)i % (kept - RANGE_DAYS);
+        uint16_t year;
+        uint8_t month, day;
+
+        double t0 = now_us();
+        date_of(n, &year, &month, &day);
+        history_reader_t reader;
+        memset(&reader, 0, sizeof(reader));
+        TEST_ASSERT_EQUAL_INT(ESP_OK, s_backend->reader_open(&reader, year, month, day));
+        while (s_backend->reader_next(&reader, &s) == ESP_OK) {
+            sink = sink + s.temperature;
+        }
+        s_backend->reader_close(&reader);
+        day_us[i] = now_us() - t0;
+
+        // Finestra di più giorni come /api/range
+        t0 = now_us();
+        for (uint32_t k = 0; k < RANGE_DAYS; k++) {
+            date_of(n - k, &year, &month, &day);
+            memset(&reader, 0, sizeof(reader));
+            TEST_ASSERT_EQUAL_INT(ESP_OK, s_backend->reader_open(&reader, year, month, day));
+            while (s_backend->reader_next(&reader, &s) == ESP_OK) {
+                sink = sink + s.temperature;
+            }
+            s_backend->reader_close(&reader);
+        }
+        range_us[i] = now_us() - t0;
+
+        t0 = now_us();
+        sink = sink + day_exists(n);
+        exists_us[i] = now_us() - t0;
+    }
+
+    uint64_t per_day = host_partition_stats.read_bytes / (READ_ITERATIONS * (1 + RANGE_DAYS));
+
+    qsort(day_us, READ_ITERATIONS, sizeof(double), compare_double);
+    qsort(range_us, READ_ITERATIONS, sizeof(double), compare_double);
+    qsort(exists_us, READ_ITERATIONS, sizeof(double), compare_double);
+
+    printf("lettura giorno:    p50 %8.1f us  p95 %8.1f us  (%llu byte letti)\n",
+           day_us[READ_ITERATIONS / 2], day_us[READ_ITERATIONS * 95 / 100],
+           (unsigned long long)per_day);
+    printf("lettura %d giorni: p50 %8.1f us  p95 %8.1f us\n", RANGE_DAYS,
+           range_us[READ_ITERATIONS / 2], range_us[READ_ITERATIONS * 95 / 100]);
+    printf("day_exists:        p50 %8.2f us  p95 %8.2f us\n",
+           exists_us[READ_ITERATIONS / 2], exists_us[READ_ITERATIONS * 95 / 100]);
+
+    // Si leggono solo i settori del giorno, non la partizione
+    TEST_ASSERT_TRUE(per_day < 16 * LOG_SECTOR_SIZE);
+}
+
+int main(void)
+{
+    int fd = mkstemp(s_path);
+    if (fd < 0) {
+        return 1;
+    }
+    close(fd);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_day_round_trip);
+    RUN_TEST(test_rewrite_and_invalidate);
+    RUN_TEST(test_torn_record_is_ignored);
+    RUN_TEST(test_foreach_all_years);
+    RUN_TEST(test_append_throughput_and_wrap);
+    RUN_TEST(test_range_read_latency);
+    int failures = UNITY_END();
+
+    host_partition_close();
+    unlink(s_path);
+    return failures;
+}
@@ -0,0 +1,309 @@
+/**
+ * @file test_minute_aggregator.cpp
+ * @brief Aggregazione al minuto: arrotondamento della media, minima e massima,
+ *        minuto e giorno a cui va il sample
+ *
+ * Esecuzione: pio test -e native -f test_minute_aggregator
+ */
+
+#include <unity.h>
+
+#include "minute_aggregator.cpp"
+
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define TEST_MINUTE         29530080    // 2026-02-23 00:00 UTC, minuti dall'epoch
+
+// ============================================================================
+// STATO
+// ============================================================================
+
+/**
+ * @brief Sample consegnato a history_record() dal giro di status_task
+ */
+typedef struct {
+    history_minute_t values;
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint16_t minute_of_day;
+} recorded_t;
+
+static recorded_t s_recorded[8];
+static int s_num_recorded;
+
+static uint32_t s_rng = 2024;
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static uint32_t rng_next(void)
+{
+    s_rng = s_rng * 1103515245u + 12345u;
+    return s_rng >> 8;
+}
+
+static time_t local_time(int year, int month, int day, int hour, int min, int sec)
+{
+    struct tm tm = {};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = min;
+    tm.tm_sec = sec;
+    tm.tm_isdst = -1;
+    return mktime(&tm);
+}
+
+/**
+ * @brief Temperatura letta in un secondo: diversa per ogni minuto locale
+ */
+static int16_t reading_at(time_t now)
+{
+    struct tm tm;
+    localtime_r(&now, &tm);
+    return (int16_t)(1000 + tm.tm_hour * 60 + tm.tm_min);
+}
+
+/**
+ * @brief Come status_task da start a end (esclusi), una lettura al secondo
+ */
+static void run_status_loop(time_t start, time_t end)
+{
+    minute_aggregator_t agg;
+    int64_t last_minute = -1;
+
+    minute_aggregator_reset(&agg);
+    s_num_recorded = 0;
+
+    for (time_t now = start; now < end; now++) {
+        int64_t current_minute = now / 60;
+        if (current_minute != last_minute && last_minute >= 0) {
+            recorded_t* r = &s_recorded[s_num_recorded];
+            if (minute_aggregator_finish(&agg, last_minute, &r->values)) {
+                minute_aggregator_slot(r->values.epoch_minute, &r->year, &r->month,
+                                       &r->day, &r->minute_of_day);
+                s_num_recorded++;
+            }
+        }
+        last_minute = current_minute;
+        minute_aggregator_add(&agg, reading_at(now), 50, 10130);
+    }
+}
+
+static void assert_recorded(int i, int year, int month, int day, int hour, int min)
+{
+    const recorded_t* r = &s_recorded[i];
+    TEST_ASSERT_EQUAL_UINT16(year, r->year);
+    TEST_ASSERT_EQUAL_UINT8(month, r->month);
+    TEST_ASSERT_EQUAL_UINT8(day, r->day);
+    TEST_ASSERT_EQUAL_UINT16(hour * 60 + min, r->minute_of_day);
+    // La media è quella delle letture del minuto etichettato
+    TEST_ASSERT_EQUAL_INT16(1000 + hour * 60 + min, r->values.temperature);
+    TEST_ASSERT_EQUAL_INT16(r->values.t_min, r->values.t_max);
+}
+
+// ============================================================================
+// TEST
+// ============================================================================
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_empty_minute(void)
+{
+    minute_aggregator_t agg;
+    history_minute_t out;
+
+    minute_aggregator_reset(&agg);
+    TEST_ASSERT_FALSE(minute_aggregator_finish(&agg, TEST_MINUTE, &out));
+}
+
+static void test_single_reading(void)
+{
+    minute_aggregator_t agg;
+    history_minute_t out;
+
+    minute_aggregator_reset(&agg);
+    minute_aggregator_add(&agg, -150, 55, 10132);
+    TEST_ASSERT_TRUE(minute_aggregator_finish(&agg, TEST_MINUTE, &out));
+
+    TEST_ASSERT_TRUE(out.epoch_minute == TEST_MINUTE);
+    TEST_ASSERT_EQUAL_INT16(-150, out.temperature);
+    TEST_ASSERT_EQUAL_INT16(-150, out.t_min);
+    TEST_ASSERT_EQUAL_INT16(-150, out.t_max);
+    TEST_ASSERT_EQUAL_UINT8(55, out.humidity);
+    TEST_ASSERT_EQUAL_UINT16(10132, out.pressure);
+}
+
+static void test_rounding_half_away_from_zero(void)
+{
+    minute_aggregator_t agg;
+    history_minute_t out;
+
+    // 2000.5 → 2001
+    minute_aggregator_reset(&agg);
+    minute_aggregator_add(&agg, 2000, 50, 10000);
+    minute_aggregator_add(&agg, 2001, 51, 10001);
+    TEST_ASSERT_TRUE(minute_aggregator_finish(&agg, TEST_MINUTE, &out));
+    TEST_ASSERT_EQUAL_INT16(2001, out.temperature);
+    TEST_ASSERT_EQUAL_UINT8(51, out.humidity);
+    TEST_ASSERT_EQUAL_UINT16(10001, out.pressure);
+
+    // -0.5 → -1, non 0 (troncamento verso zero della divisione C)
+    minute_aggregator_reset(&agg);
+    minute_aggregator_add(&agg, 0, 50, 10000);
+    minute_aggregator_add(&agg, -1, 50, 10000);
+    TEST_ASSERT_TRUE(minute_aggregator_finish(&agg, TEST_MINUTE, &out));
+    TEST_ASSERT_EQUAL_INT16(-1, out.temperature);
+
+    // 1/3 → 0, 2/3 → 1
+    minute_aggregator_reset(&agg);
+    minute_aggregator_add(&agg, 1, 0, 0);
+    minute_aggregator_add(&agg, 0, 0, 0);
+    minute_aggregator_add(&agg, 0, 0, 0);
+    TEST_ASSERT_TRUE(minute_aggregator_finish(&agg, TEST_MINUTE, &out));
+    TEST_ASSERT_EQUAL_INT16(0, out.temperature);
+
+    minute_aggregator_reset(&agg);
+    minute_aggregator_add(&agg, -1, 0, 0);
+    minute_aggregator_add(&agg, -1, 0, 0);
+    minute_aggregator_add(&agg, 0, 0, 0);
+    TEST_ASSERT_TRUE(minute_aggregator_finish(&agg, TEST_MINUTE, &out));
+    TEST_ASSERT_EQUAL_INT16(-1, out.temperature);
+}
+
+static void test_matches_rounded_float_mean(void)
+{
+    // Minuti casuali da 1 a 60 letture, temperature anche sotto zero
+    minute_aggregator_t agg;
+    history_minute_t out;
+
+    for (int iter = 0; iter < 20000; iter++) {
+        int n = 1 + (int)(rng_next() % 60);
+        int base = (int)(rng_next() % 8000) - 3000;
+        int64_t t_sum = 0, h_sum = 0, p_sum = 0;
+        int16_t t_min = INT16_MAX, t_max = INT16_MIN;
+
+        minute_aggregator_reset(&agg);
+        for (int i = 0; i < n; i++) {
+            int16_t t = (int16_t)(base + (int)(rng_next() % 41) - 20);
+            uint8_t h = (uint8_t)(rng_next() % 101);
+            uint16_t p = (uint16_t)(9500 + rng_next() % 1000);
+
+            minute_aggregator_add(&agg, t, h, p);
+            t_sum += t;
+            h_sum += h;
+            p_sum += p;
+            if (t < t_min) t_min = t;
+            if (t > t_max) t_max = t;
+        }
+
+        TEST_ASSERT_TRUE(minute_aggregator_finish(&agg, TEST_MINUTE, &out));
+        TEST_ASSERT_EQUAL_INT16((int16_t)lround((double)t_sum / n), out.temperature);
+        TEST_ASSERT_EQUAL_UINT8((uint8_t)lround((double)h_sum / n), out.humidity);
+        TEST_ASSERT_EQUAL_UINT16((uint16_t)lround((double)p_sum / n), out.pressure);
+        TEST_ASSERT_EQUAL_INT16(t_min, out.t_min);
+        TEST_ASSERT_EQUAL_INT16(t_max, out.t_max);
+        TEST_ASSERT_TRUE(out.t_min <= out.temperature && out.temperature <= out.t_max);
+    }
+}
+
+static void test_finish_resets(void)
+{
+    // Il minuto successivo non eredita estremi né somme
+    minute_aggregator_t agg;
+    history_minute_t out;
+
+    minute_aggregator_reset(&agg);
+    minute_aggregator_add(&agg, 3000, 90, 10500);
+    minute_aggregator_add(&agg, -500, 10, 9500);
+    TEST_ASSERT_TRUE(minute_aggregator_finish(&agg, TEST_MINUTE, &out));
+    TEST_ASSERT_EQUAL_UINT16(0, agg.count);
+
+    minute_aggregator_add(&agg, 2000, 50, 10000);
+    TEST_ASSERT_TRUE(minute_aggregator_finish(&agg, TEST_MINUTE, &out));
+    TEST_ASSERT_EQUAL_INT16(2000, out.t_min);
+    TEST_ASSERT_EQUAL_INT16(2000, out.t_max);
+    TEST_ASSERT_EQUAL_INT16(2000, out.temperature);
+    TEST_ASSERT_FALSE(minute_aggregator_finish(&agg, TEST_MINUTE, &out));
+}
+
+static void test_extreme_values_do_not_overflow(void)
+{
+    // Un'ora intera di letture al limite del range (minuto lungo dopo un blocco)
+    minute_aggregator_t agg;
+    history_minute_t out;
+
+    minute_aggregator_reset(&agg);
+    for (int i = 0; i < 3600; i++) {
+        minute_aggregator_add(&agg, INT16_MAX, 255, UINT16_MAX);
+    }
+    TEST_ASSERT_TRUE(minute_aggregator_finish(&agg, TEST_MINUTE, &out));
+    TEST_ASSERT_EQUAL_INT16(INT16_MAX, out.temperature);
+    TEST_ASSERT_EQUAL_UINT8(255, out.humidity);
+    TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, out.pressure);
+
+    for (int i = 0; i < 3600; i++) {
+        minute_aggregator_add(&agg, INT16_MIN + 1, 0, 0);
+    }
+    TEST_ASSERT_TRUE(minute_aggregator_finish(&agg, TEST_MINUTE, &out));
+    TEST_ASSERT_EQUAL_INT16(INT16_MIN + 1, out.temperature);
+}
+
+static void test_midnight_boundary(void)
+{
+    // 23:58:30 → 00:01:10: il 23:59 chiude il giorno, lo 00:00 apre il nuovo
+    run_status_loop(local_time(2026, 2, 23, 23, 58, 30), local_time(2026, 2, 24, 0, 1, 10));
+
+    TEST_ASSERT_EQUAL_INT(3, s_num_recorded);
+    assert_recorded(0, 2026, 2, 23, 23, 58);
+    assert_recorded(1, 2026, 2, 23, 23, 59);
+    assert_recorded(2, 2026, 2, 24, 0, 0);
+}
+
+static void test_new_year_boundary(void)
+{
+    run_status_loop(local_time(2026, 12, 31, 23, 59, 0), local_time(2027, 1, 1, 0, 1, 10));
+
+    TEST_ASSERT_EQUAL_INT(2, s_num_recorded);
+    assert_recorded(0, 2026, 12, 31, 23, 59);
+    assert_recorded(1, 2027, 1, 1, 0, 0);
+}
+
+static void test_dst_start(void)
+{
+    // Ora legale: dopo le 01:59 locali vengono le 03:00
+    run_status_loop(local_time(2026, 3, 29, 1, 59, 0), local_time(2026, 3, 29, 3, 1, 10));
+
+    TEST_ASSERT_EQUAL_INT(2, s_num_recorded);
+    assert_recorded(0, 2026, 3, 29, 1, 59);
+    assert_recorded(1, 2026, 3, 29, 3, 0);
+}
+
+int main(void)
+{
+    // Fuso del termostato (Europa centrale), come in time_sync
+    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+    tzset();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_minute);
+    RUN_TEST(test_single_reading);
+    RUN_TEST(test_rounding_half_away_from_zero);
+    RUN_TEST(test_matches_rounded_float_mean);
+    RUN_TEST(test_finish_resets);
+    RUN_TEST(test_extreme_values_do_not_overflow);
+    RUN_TEST(test_midnight_boundary);
+    RUN_TEST(test_new_year_boundary);
+    RUN_TEST(test_dst_start);
+    return UNITY_END();
+}
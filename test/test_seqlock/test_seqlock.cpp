@@ -0,0 +1,242 @@
+/**
+ * @file test_seqlock.cpp
+ * @brief Seqlock sotto carico: uno scrittore e più lettori su thread POSIX,
+ *        nessuna copia incoerente deve superare seqlock_read_retry()
+ *
+ * Esecuzione: pio test -e native -f test_seqlock
+ */
+
+#include <unity.h>
+
+#include "seqlock.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define STRESS_READERS      3
+#define STRESS_WRITES       2000000
+#define SNAPSHOT_WORDS      16          // Ordine di grandezza di status_snapshot_t
+#define PREEMPT_EVERY       64          // Cessione forzata a metà copia/scrittura
+
+// ============================================================================
+// STRUTTURE
+// ============================================================================
+
+/**
+ * @brief Snapshot di prova: tutte le parole valgono la stessa generazione
+ */
+typedef struct {
+    uint32_t generation;
+    uint32_t words[SNAPSHOT_WORDS];
+    uint32_t check;                     // generation ^ 0xA5A5A5A5
+} snapshot_t;
+
+typedef struct {
+    uint64_t reads;
+    uint64_t retries;
+    uint64_t torn;                      // Copie incoerenti accettate
+    uint64_t unchecked_torn;            // Copie incoerenti senza il controllo
+    uint32_t last_generation;
+    bool went_backwards;
+} reader_result_t;
+
+// ============================================================================
+// STATO
+// ============================================================================
+
+static seqlock_t s_seq = SEQLOCK_INIT;
+static snapshot_t s_shared;
+static volatile bool s_stop;
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static bool snapshot_consistent(const snapshot_t* s)
+{
+    if (s->check != (s->generation ^ 0xA5A5A5A5u)) {
+        return false;
+    }
+    for (int i = 0; i < SNAPSHOT_WORDS; i++) {
+        if (s->words[i] != s->generation + (uint32_t)i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Copia in due metà; ogni tanto cede la CPU in mezzo
+ *
+ * Con un solo core i thread non si sovrappongono mai da soli: la cessione
+ * riproduce il lettore o lo scrittore interrotto a metà da un altro task.
+ */
+static void split_copy(snapshot_t* dst, const snapshot_t* src, uint64_t n)
+{
+    const size_t half = sizeof(*dst) / 2;
+    memcpy(dst, src, half);
+    if (n % PREEMPT_EVERY == 0) {
+        sched_yield();
+    }
+    memcpy((uint8_t*)dst + half, (const uint8_t*)src + half, sizeof(*dst) - half);
+}
+
+/**
+ * @brief Come status_push_publish(): parola per parola, senza lock
+ */
+static void *writer_task(void* arg)
+{
+    (void)arg;
+    for (uint32_t g = 1; g <= STRESS_WRITES; g++) {
+        seqlock_write_begin(&s_seq);
+        s_shared.generation = g;
+        for (int i = 0; i < SNAPSHOT_WORDS; i++) {
+            s_shared.words[i] = g + (uint32_t)i;
+            if (i == SNAPSHOT_WORDS / 2 && g % PREEMPT_EVERY == 0) {
+                sched_yield();
+            }
+        }
+        s_shared.check = g ^ 0xA5A5A5A5u;
+        seqlock_write_end(&s_seq);
+
+        // Pausa tra due pubblicazioni, come status_task tra un tick e l'altro
+        if (g % PREEMPT_EVERY == PREEMPT_EVERY / 2) {
+            sched_yield();
+        }
+    }
+    s_stop = true;
+    return NULL;
+}
+
+/**
+ * @brief Come status_push_get(): copia e ripete finché il contatore è stabile
+ */
+static void *reader_task(void* arg)
+{
+    reader_result_t* r = (reader_result_t*)arg;
+
+    while (!s_stop) {
+        snapshot_t copy;
+        uint32_t seq;
+        uint32_t attempts = 0;
+
+        do {
+            seq = seqlock_read_begin(&s_seq);
+            split_copy(&copy, &s_shared, r->reads + attempts);
+            attempts++;
+        } while (seqlock_read_retry(&s_seq, seq));
+
+        r->reads++;
+        r->retries += attempts - 1;
+        if (!snapshot_consistent(&copy)) {
+            r->torn++;
+        }
+        if (copy.generation < r->last_generation) {
+            r->went_backwards = true;
+        }
+        r->last_generation = copy.generation;
+
+        // Controprova: stessa copia senza seqlock, per vedere che il carico
+        // produce davvero sovrapposizioni
+        snapshot_t raw;
+        split_copy(&raw, &s_shared, r->reads);
+        if (!snapshot_consistent(&raw) && raw.generation != 0) {
+            r->unchecked_torn++;
+        }
+    }
+    return NULL;
+}
+
+// ============================================================================
+// TEST
+// ============================================================================
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_unpublished(void)
+{
+    seqlock_t sl = SEQLOCK_INIT;
+    TEST_ASSERT_FALSE(seqlock_published(&sl));
+
+    uint32_t seq = seqlock_read_begin(&sl);
+    TEST_ASSERT_FALSE(seqlock_read_retry(&sl, seq));
+
+    seqlock_write_begin(&sl);
+    seqlock_write_end(&sl);
+    TEST_ASSERT_TRUE(seqlock_published(&sl));
+    TEST_ASSERT_TRUE(seqlock_read_retry(&sl, seq));
+}
+
+static void test_no_torn_reads_under_stress(void)
+{
+    pthread_t writer;
+    pthread_t readers[STRESS_READERS];
+    reader_result_t results[STRESS_READERS];
+
+    memset(results, 0, sizeof(results));
+    memset(&s_shared, 0, sizeof(s_shared));
+    s_shared.check = 0xA5A5A5A5u;
+    for (int i = 0; i < SNAPSHOT_WORDS; i++) {
+        s_shared.words[i] = (uint32_t)i;
+    }
+    s_stop = false;
+
+    double t0 = now_us();
+    for (int i = 0; i < STRESS_READERS; i++) {
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&readers[i], NULL, reader_task, &results[i]));
+    }
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&writer, NULL, writer_task, NULL));
+
+    pthread_join(writer, NULL);
+    for (int i = 0; i < STRESS_READERS; i++) {
+        pthread_join(readers[i], NULL);
+    }
+    double elapsed = now_us() - t0;
+
+    uint64_t reads = 0, retries = 0, torn = 0, unchecked = 0;
+    for (int i = 0; i < STRESS_READERS; i++) {
+        reads += results[i].reads;
+        retries += results[i].retries;
+        torn += results[i].torn;
+        unchecked += results[i].unchecked_torn;
+        TEST_ASSERT_FALSE(results[i].went_backwards);
+    }
+
+    printf("%d scritture, %d lettori in %.0f ms\n", STRESS_WRITES, STRESS_READERS, elapsed / 1000.0);
+    printf("letture: %llu, ripetute: %llu (%.2f%%)\n",
+           (unsigned long long)reads, (unsigned long long)retries,
+           reads ? 100.0 * retries / reads : 0.0);
+    printf("copie incoerenti: %llu con seqlock, %llu senza\n",
+           (unsigned long long)torn, (unsigned long long)unchecked);
+
+    // Senza sovrapposizioni reali la prova non dimostrerebbe nulla
+    TEST_ASSERT_TRUE(reads > 0);
+    TEST_ASSERT_TRUE(unchecked > 0);
+    TEST_ASSERT_EQUAL_UINT64(0, torn);
+    TEST_ASSERT_TRUE(snapshot_consistent(&s_shared));
+    TEST_ASSERT_EQUAL_UINT32(STRESS_WRITES, s_shared.generation);
+    TEST_ASSERT_EQUAL_UINT32(2u * STRESS_WRITES, s_seq.seq);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_unpublished);
+    RUN_TEST(test_no_torn_reads_under_stress);
+    return UNITY_END();
+}
@@ -0,0 +1,285 @@
+/**
+ * @file test_stats.cpp
+ * @brief Aggregati incrementali della giornata: correttezza e confronto
+ *        con la scansione dei 1440 sample
+ *
+ * Esecuzione: pio test -e native -f test_stats
+ */
+
+#include <unity.h>
+
+#include "history_codec.cpp"
+#include "history_stats.cpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define BENCH_QUERIES       20000
+#define RANDOM_WRITES       20000
+
+// ============================================================================
+// STATO
+// ============================================================================
+
+static history_sample_t s_samples[HISTORY_SAMPLES_PER_DAY];
+static history_stats_t s_stats;
+static bool s_stale;
+
+static uint32_t s_rng = 777;
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static uint32_t rng_next(void)
+{
+    s_rng = s_rng * 1103515245u + 12345u;
+    return s_rng >> 8;
+}
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/**
+ * @brief history_get_stats() prima degli aggregati: scansione in float
+ */
+static void legacy_get_stats(float* min_temp, float* max_temp, float* avg_temp,
+                             uint16_t* heater_on_minutes)
+{
+    float t_min = 100.0f;
+    float t_max = -100.0f;
+    float t_sum = 0.0f;
+    int t_count = 0;
+    uint16_t heater_count = 0;
+
+    for (int i = 0; i < HISTORY_SAMPLES_PER_DAY; i++) {
+        const history_sample_t* s = &s_samples[i];
+        if (s->temperature != -32768) {
+            float temp = s->temperature / 100.0f;
+            if (temp < t_min) t_min = temp;
+            if (temp > t_max) t_max = temp;
+            t_sum += temp;
+            t_count++;
+
+            if (s->flags & HISTORY_FLAG_RELAY_ON) {
+                heater_count++;
+            }
+        }
+    }
+
+    *min_temp = (t_count > 0) ? t_min : 0.0f;
+    *max_temp = (t_count > 0) ? t_max : 0.0f;
+    *avg_temp = (t_count > 0) ? (t_sum / t_count) : 0.0f;
+    *heater_on_minutes = heater_count;
+}
+
+/**
+ * @brief history_get_stats() attuale: copia degli aggregati e conversione
+ */
+static void incremental_get_stats(float* min_temp, float* max_temp, float* avg_temp,
+                                  uint16_t* heater_on_minutes)
+{
+    if (s_stale) {
+        history_stats_rescan_extremes(&s_stats, s_samples, HISTORY_SAMPLES_PER_DAY);
+        s_stale = false;
+    }
+
+    history_stats_t stats = s_stats;
+    bool valid = stats.count > 0;
+
+    *min_temp = valid ? stats.t_min / 100.0f : 0.0f;
+    *max_temp = valid ? stats.t_max / 100.0f : 0.0f;
+    *avg_temp = valid ? (float)stats.t_sum / stats.count / 100.0f : 0.0f;
+    *heater_on_minutes = stats.heater_on;
+}
+
+static void day_reset(void)
+{
+    for (int m = 0; m < HISTORY_SAMPLES_PER_DAY; m++) {
+        tlog2_make_empty(&s_samples[m], m);
+    }
+    history_stats_reset(&s_stats);
+    s_stale = false;
+}
+
+/**
+ * @brief Come history_add_sample(): aggregati aggiornati, poi copia nello slot
+ */
+static void add_sample(const history_sample_t* sample)
+{
+    history_sample_t* slot = &s_samples[sample->minute_of_day];
+    if (history_stats_replace(&s_stats, slot, sample)) {
+        s_stale = true;
+    }
+    *slot = *sample;
+}
+
+static void random_sample(history_sample_t* s, uint16_t minute)
+{
+    if (rng_next() % 10 == 0) {
+        tlog2_make_empty(s, minute);
+        return;
+    }
+    s->minute_of_day = minute;
+    s->temperature = (int16_t)(1500 + rng_next() % 1000);
+    s->humidity = 50;
+    s->flags = (rng_next() % 3 == 0) ? HISTORY_FLAG_RELAY_ON : 0;
+    s->setpoint = (rng_next() % 5 == 0) ? -32768 : 2000;
+    s->active_bank = 0;
+    s->reserved = 0;
+    s->pressure = 10130;
+}
+
+static void assert_matches_rebuild(void)
+{
+    history_stats_t expected;
+    history_stats_rebuild(&expected, s_samples, HISTORY_SAMPLES_PER_DAY);
+
+    if (s_stale) {
+        history_stats_rescan_extremes(&s_stats, s_samples, HISTORY_SAMPLES_PER_DAY);
+        s_stale = false;
+    }
+
+    TEST_ASSERT_EQUAL_UINT16(expected.count, s_stats.count);
+    TEST_ASSERT_EQUAL_INT32(expected.t_sum, s_stats.t_sum);
+    TEST_ASSERT_EQUAL_UINT16(expected.heater_on, s_stats.heater_on);
+    TEST_ASSERT_EQUAL_UINT16(expected.sp_count, s_stats.sp_count);
+    TEST_ASSERT_TRUE(expected.sp_err_sq_sum == s_stats.sp_err_sq_sum);
+    if (expected.count > 0) {
+        TEST_ASSERT_EQUAL_INT16(expected.t_min, s_stats.t_min);
+        TEST_ASSERT_EQUAL_INT16(expected.t_max, s_stats.t_max);
+    }
+}
+
+static void fill_day(void)
+{
+    day_reset();
+    for (uint16_t m = 0; m < HISTORY_SAMPLES_PER_DAY; m++) {
+        history_sample_t s;
+        random_sample(&s, m);
+        add_sample(&s);
+    }
+}
+
+// ============================================================================
+// TEST
+// ============================================================================
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_sequential_day(void)
+{
+    fill_day();
+    assert_matches_rebuild();
+}
+
+static void test_random_overwrites(void)
+{
+    // Minuti riscritti (backfill, correzioni): gli aggregati restano esatti
+    fill_day();
+    for (int i = 0; i < RANDOM_WRITES; i++) {
+        history_sample_t s;
+        random_sample(&s, (uint16_t)(rng_next() % HISTORY_SAMPLES_PER_DAY));
+        add_sample(&s);
+        if (i % 997 == 0) {
+            assert_matches_rebuild();
+        }
+    }
+    assert_matches_rebuild();
+}
+
+static void test_overwrite_extreme_marks_stale(void)
+{
+    day_reset();
+    history_sample_t s;
+    random_sample(&s, 0);
+    s.temperature = 1000;
+    add_sample(&s);
+    random_sample(&s, 1);
+    s.temperature = 2000;
+    add_sample(&s);
+
+    s.minute_of_day = 0;
+    s.temperature = 1500;
+    TEST_ASSERT_TRUE(history_stats_replace(&s_stats, &s_samples[0], &s));
+    s_samples[0] = s;
+    history_stats_rescan_extremes(&s_stats, s_samples, HISTORY_SAMPLES_PER_DAY);
+    TEST_ASSERT_EQUAL_INT16(1500, s_stats.t_min);
+    TEST_ASSERT_EQUAL_INT16(2000, s_stats.t_max);
+}
+
+static void test_same_result_as_legacy_scan(void)
+{
+    fill_day();
+
+    float min_a, max_a, avg_a, min_b, max_b, avg_b;
+    uint16_t heat_a, heat_b;
+    legacy_get_stats(&min_a, &max_a, &avg_a, &heat_a);
+    incremental_get_stats(&min_b, &max_b, &avg_b, &heat_b);
+
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, min_a, min_b);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, max_a, max_b);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, avg_a, avg_b);
+    TEST_ASSERT_EQUAL_UINT16(heat_a, heat_b);
+}
+
+static void test_query_cost(void)
+{
+    fill_day();
+
+    float min_t, max_t, avg_t;
+    uint16_t heat;
+    volatile float sink = 0;
+
+    double t0 = now_us();
+    for (int i = 0; i < BENCH_QUERIES; i++) {
+        legacy_get_stats(&min_t, &max_t, &avg_t, &heat);
+        sink = sink + avg_t;
+    }
+    double t1 = now_us();
+    for (int i = 0; i < BENCH_QUERIES; i++) {
+        incremental_get_stats(&min_t, &max_t, &avg_t, &heat);
+        sink = sink + avg_t;
+    }
+    double t2 = now_us();
+
+    // Una query dopo ogni scrittura che tocca un estremo: caso peggiore
+    double t3 = now_us();
+    for (int i = 0; i < BENCH_QUERIES; i++) {
+        history_sample_t s = s_samples[i % HISTORY_SAMPLES_PER_DAY];
+        s.temperature = (s.temperature == s_stats.t_min) ? s.temperature + 1 : s_stats.t_min;
+        add_sample(&s);
+        incremental_get_stats(&min_t, &max_t, &avg_t, &heat);
+        sink = sink + avg_t;
+    }
+    double t4 = now_us();
+
+    double legacy = (t1 - t0) / BENCH_QUERIES;
+    double incremental = (t2 - t1) / BENCH_QUERIES;
+    printf("scansione 1440 sample: %8.3f us/query\n", legacy);
+    printf("aggregati incrementali: %8.3f us/query (%.0fx)\n", incremental, legacy / incremental);
+    printf("con rescan min/max:     %8.3f us/query\n", (t4 - t3) / BENCH_QUERIES);
+
+    TEST_ASSERT_TRUE(incremental < legacy);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_sequential_day);
+    RUN_TEST(test_random_overwrites);
+    RUN_TEST(test_overwrite_extreme_marks_stale);
+    RUN_TEST(test_same_result_as_legacy_scan);
+    RUN_TEST(test_query_cost);
+    return UNITY_END();
+}
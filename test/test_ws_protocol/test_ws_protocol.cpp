@@ -0,0 +1,387 @@
+/**
+ * @file test_ws_protocol.cpp
+ * @brief Frame binari /ws: round-trip, fuzz e traffico orario contro il polling JSON
+ *
+ * Il decoder qui sotto ricalca decodeWsFrame() di data/index.html (layout
+ * per tipo, campi in ordine di bit, little-endian). Il traffico è misurato
+ * facendo girare status_push_publish() reale per un'ora simulata, con le
+ * sessioni WebSocket sostituite da un contatore di byte.
+ *
+ * Esecuzione: pio test -e native -f test_ws_protocol
+ */
+
+#include <unity.h>
+
+#include "ws_protocol.cpp"
+#include "status_push.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// COSTANTI
+// ============================================================================
+
+#define FUZZ_ITERATIONS         200000
+#define WS_FRAME_OVERHEAD       2       // Header WebSocket server → client (payload < 126 B)
+#define HTTP_STATUS_OVERHEAD    450     // Richiesta + header di risposta di /api/status
+#define SIM_SECONDS             3600
+#define SIM_START               1770638400  // 2026-02-09 12:00:00
+
+// ============================================================================
+// DECODER DI RIFERIMENTO (come data/index.html)
+// ============================================================================
+
+typedef enum { F_U8, F_U16, F_I16, F_U32 } field_kind_t;
+
+typedef struct {
+    uint8_t count;
+    field_kind_t kinds[8];
+} frame_layout_t;
+
+// Indice = ws_msg_type_t
+static const frame_layout_t s_layouts[] = {
+    { 0, {} },
+    { 7, { F_U32, F_I16, F_U8, F_U16, F_I16, F_U8, F_U16 } },     // WS_MSG_STATUS
+    { 6, { F_U32, F_I16, F_U8, F_U8, F_I16, F_U16 } },            // WS_MSG_SAMPLE
+    { 2, { F_U32, F_U8 } },                                       // WS_MSG_RELAY
+    { 5, { F_I16, F_I16, F_U8, F_I16, F_U8 } },                   // WS_MSG_CONFIG
+};
+
+typedef struct {
+    uint8_t type;
+    uint8_t mask;
+    int64_t values[8];      // Valore per bit (solo i bit presenti in mask)
+} decoded_frame_t;
+
+static const size_t s_field_size[] = { 1, 2, 2, 4 };
+
+/**
+ * @return false se il frame non è riconosciuto o è troncato
+ */
+static bool decode_frame(const uint8_t* buf, size_t len, decoded_frame_t* out)
+{
+    if (len < WS_PROTO_HEADER_SIZE || buf[0] != WS_PROTO_VERSION) {
+        return false;
+    }
+
+    out->type = buf[1];
+    out->mask = buf[2];
+    if (out->type < WS_MSG_STATUS || out->type > WS_MSG_CONFIG) {
+        return false;
+    }
+
+    const frame_layout_t* layout = &s_layouts[out->type];
+    size_t offset = WS_PROTO_HEADER_SIZE;
+
+    for (uint8_t bit = 0; bit < layout->count; bit++) {
+        if (!(out->mask & (1 << bit))) {
+            continue;
+        }
+
+        field_kind_t kind = layout->kinds[bit];
+        if (offset + s_field_size[kind] > len) {
+            return false;
+        }
+
+        const uint8_t* p = &buf[offset];
+        switch (kind) {
+            case F_U8:  out->values[bit] = p[0]; break;
+            case F_U16: out->values[bit] = (uint16_t)(p[0] | p[1] << 8); break;
+            case F_I16: out->values[bit] = (int16_t)(p[0] | p[1] << 8); break;
+            case F_U32: out->values[bit] = (uint32_t)(p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24); break;
+        }
+        offset += s_field_size[kind];
+    }
+    // Bit oltre il layout: campi di una versione più nuova, ignorati
+    return true;
+}
+
+// ============================================================================
+// SOSTITUTI DI ws_session e history_manager
+// ============================================================================
+
+static uint32_t s_frames;
+static uint32_t s_frame_bytes;
+static uint32_t s_frames_by_type[5];
+static history_sample_t s_last_sample;
+
+extern "C" esp_err_t ws_session_init(ws_resync_fn_t resync)
+{
+    (void)resync;
+    return ESP_OK;
+}
+
+extern "C" int ws_session_count(void)
+{
+    return 1;
+}
+
+extern "C" void ws_session_broadcast(const uint8_t* data, size_t len)
+{
+    decoded_frame_t frame;
+    TEST_ASSERT_TRUE(len > 0);
+    TEST_ASSERT_TRUE(decode_frame(data, len, &frame));
+
+    s_frames++;
+    s_frame_bytes += len + WS_FRAME_OVERHEAD;
+    s_frames_by_type[frame.type]++;
+}
+
+extern "C" esp_err_t history_get_sample(uint16_t minute_of_day, history_sample_t* sample)
+{
+    *sample = s_last_sample;
+    sample->minute_of_day = minute_of_day;
+    return ESP_OK;
+}
+
+// ============================================================================
+// FUNZIONI PRIVATE
+// ============================================================================
+
+static uint32_t s_rng = 4242;
+
+static uint32_t rng_next(void)
+{
+    s_rng = s_rng * 1103515245u + 12345u;
+    return s_rng >> 8;
+}
+
+static void random_snapshot(status_snapshot_t* s)
+{
+    s->timestamp = SIM_START + (time_t)(rng_next() % (400 * 86400));
+    s->temperature = (int16_t)rng_next();
+    s->humidity = (uint8_t)rng_next();
+    s->pressure = (uint16_t)rng_next();
+    s->setpoint = (int16_t)rng_next();
+    s->heater_on = rng_next() & 1;
+    s->samples = (uint16_t)(rng_next() % 1441);
+}
+
+static void random_config(status_config_t* c)
+{
+    c->hysteresis = (int16_t)rng_next();
+    c->temp_correction = (int16_t)rng_next();
+    c->manual_mode = rng_next() & 1;
+    c->manual_setpoint = (int16_t)rng_next();
+    c->active_bank = (uint8_t)(rng_next() % 4);
+}
+
+// ============================================================================
+// TEST
+// ============================================================================
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_status_roundtrip(void)
+{
+    uint8_t buf[WS_PROTO_MAX_FRAME];
+
+    for (int i = 0; i < FUZZ_ITERATIONS; i++) {
+        status_snapshot_t s;
+        random_snapshot(&s);
+        uint8_t mask = (uint8_t)rng_next();
+
+        size_t len = ws_encode_status(buf, sizeof(buf), &s, mask);
+        decoded_frame_t f;
+        TEST_ASSERT_TRUE(decode_frame(buf, len, &f));
+        TEST_ASSERT_EQUAL_UINT8(WS_MSG_STATUS, f.type);
+        TEST_ASSERT_EQUAL_UINT8(mask & WS_STATUS_ALL, f.mask);
+
+        if (mask & WS_STATUS_TIME)     TEST_ASSERT_EQUAL_UINT32(ws_local_time(s.timestamp), f.values[0]);
+        if (mask & WS_STATUS_TEMP)     TEST_ASSERT_EQUAL_INT16(s.temperature, f.values[1]);
+        if (mask & WS_STATUS_HUM)      TEST_ASSERT_EQUAL_UINT8(s.humidity, f.values[2]);
+        if (mask & WS_STATUS_PRESS)    TEST_ASSERT_EQUAL_UINT16(s.pressure, f.values[3]);
+        if (mask & WS_STATUS_SETPOINT) TEST_ASSERT_EQUAL_INT16(s.setpoint, f.values[4]);
+        if (mask & WS_STATUS_HEAT)     TEST_ASSERT_EQUAL(s.heater_on ? 1 : 0, f.values[5]);
+        if (mask & WS_STATUS_SAMPLES)  TEST_ASSERT_EQUAL_UINT16(s.samples, f.values[6]);
+    }
+}
+
+static void test_other_messages_roundtrip(void)
+{
+    uint8_t buf[WS_PROTO_MAX_FRAME];
+    decoded_frame_t f;
+
+    for (int i = 0; i < FUZZ_ITERATIONS / 10; i++) {
+        history_sample_t s;
+        s.minute_of_day = (uint16_t)(rng_next() % 1440);
+        s.temperature = (int16_t)rng_next();
+        s.humidity = (uint8_t)rng_next();
+        s.flags = (uint8_t)rng_next();
+        s.setpoint = (int16_t)rng_next();
+        s.pressure = (uint16_t)rng_next();
+        uint32_t day_start = (uint32_t)(rng_next() % 30000) * 86400U;
+
+        size_t len = ws_encode_sample(buf, sizeof(buf), day_start, &s);
+        TEST_ASSERT_TRUE(decode_frame(buf, len, &f));
+        TEST_ASSERT_EQUAL_UINT8(WS_SAMPLE_ALL, f.mask);
+        TEST_ASSERT_EQUAL_UINT32(day_start + s.minute_of_day * 60U, f.values[0]);
+        TEST_ASSERT_EQUAL_INT16(s.temperature, f.values[1]);
+        TEST_ASSERT_EQUAL_UINT8(s.humidity, f.values[2]);
+        TEST_ASSERT_EQUAL_UINT8(s.flags, f.values[3]);
+        TEST_ASSERT_EQUAL_INT16(s.setpoint, f.values[4]);
+        TEST_ASSERT_EQUAL_UINT16(s.pressure, f.values[5]);
+
+        status_config_t c;
+        random_config(&c);
+        uint8_t mask = (uint8_t)rng_next();
+        len = ws_encode_config(buf, sizeof(buf), &c, mask);
+        TEST_ASSERT_TRUE(decode_frame(buf, len, &f));
+        TEST_ASSERT_EQUAL_UINT8(mask & WS_CONFIG_ALL, f.mask);
+        if (mask & WS_CONFIG_HYSTERESIS) TEST_ASSERT_EQUAL_INT16(c.hysteresis, f.values[0]);
+        if (mask & WS_CONFIG_CORRECTION) TEST_ASSERT_EQUAL_INT16(c.temp_correction, f.values[1]);
+        if (mask & WS_CONFIG_MANUAL)     TEST_ASSERT_EQUAL(c.manual_mode ? 1 : 0, f.values[2]);
+        if (mask & WS_CONFIG_MANUAL_SP)  TEST_ASSERT_EQUAL_INT16(c.manual_setpoint, f.values[3]);
+        if (mask & WS_CONFIG_BANK)       TEST_ASSERT_EQUAL_UINT8(c.active_bank, f.values[4]);
+
+        time_t when = SIM_START + (time_t)(rng_next() % 86400);
+        bool on = rng_next() & 1;
+        len = ws_encode_relay(buf, sizeof(buf), when, on);
+        TEST_ASSERT_TRUE(decode_frame(buf, len, &f));
+        TEST_ASSERT_EQUAL_UINT32(ws_local_time(when), f.values[0]);
+        TEST_ASSERT_EQUAL(on ? 1 : 0, f.values[1]);
+    }
+}
+
+static void test_encoder_respects_capacity(void)
+{
+    // Capienza casuale: o il frame intero o 0, mai un byte oltre cap
+    uint8_t buf[WS_PROTO_MAX_FRAME + 8];
+
+    for (int i = 0; i < FUZZ_ITERATIONS; i++) {
+        status_snapshot_t s;
+        random_snapshot(&s);
+        size_t cap = rng_next() % (WS_PROTO_MAX_FRAME + 1);
+        memset(buf, 0xA5, sizeof(buf));
+
+        size_t full = ws_encode_status(buf + 4, sizeof(buf) - 4, &s, WS_STATUS_ALL);
+        TEST_ASSERT_TRUE(full <= WS_PROTO_MAX_FRAME);
+
+        memset(buf, 0xA5, sizeof(buf));
+        size_t len = ws_encode_status(buf, cap, &s, WS_STATUS_ALL);
+        TEST_ASSERT_TRUE(len == 0 || len == full);
+        TEST_ASSERT_EQUAL(cap >= full, len == full);
+        for (size_t k = cap; k < sizeof(buf); k++) {
+            TEST_ASSERT_EQUAL_HEX8(0xA5, buf[k]);
+        }
+    }
+}
+
+static void test_decoder_rejects_garbage(void)
+{
+    // Byte casuali e frame troncati: rifiutati o letti entro la lunghezza
+    uint8_t buf[WS_PROTO_MAX_FRAME];
+    decoded_frame_t f;
+    uint32_t accepted = 0;
+
+    for (int i = 0; i < FUZZ_ITERATIONS; i++) {
+        size_t len = rng_next() % (sizeof(buf) + 1);
+        for (size_t k = 0; k < len; k++) {
+            buf[k] = (uint8_t)rng_next();
+        }
+        if (len > 0 && (rng_next() & 1)) {
+            buf[0] = WS_PROTO_VERSION;
+        }
+        accepted += decode_frame(buf, len, &f) ? 1 : 0;
+    }
+
+    status_snapshot_t s;
+    random_snapshot(&s);
+    size_t full = ws_encode_status(buf, sizeof(buf), &s, WS_STATUS_ALL);
+    for (size_t len = 0; len < full; len++) {
+        TEST_ASSERT_FALSE(decode_frame(buf, len, &f));
+    }
+
+    printf("frame casuali accettati: %u su %d\n", accepted, FUZZ_ITERATIONS);
+}
+
+static void test_diff_resolution(void)
+{
+    status_snapshot_t a = {};
+    a.timestamp = SIM_START;
+    a.temperature = 2034;
+    status_snapshot_t b = a;
+
+    b.temperature = 2031;       // 20.3 → 20.3: invisibile alla pagina
+    b.timestamp = SIM_START + 59;
+    TEST_ASSERT_EQUAL_UINT8(0, ws_status_diff(&a, &b));
+
+    b.temperature = 2036;       // 20.3 → 20.4
+    b.timestamp = SIM_START + 60;
+    TEST_ASSERT_EQUAL_UINT8(WS_STATUS_TEMP | WS_STATUS_TIME, ws_status_diff(&a, &b));
+}
+
+static void test_bytes_per_hour_vs_json_polling(void)
+{
+    // Un'ora di status_task: lettura al secondo con rumore sui centesimi,
+    // sample al minuto, caldaia che cambia due volte
+    TEST_ASSERT_EQUAL_INT(ESP_OK, status_push_init());
+
+    status_snapshot_t snap = {};
+    snap.timestamp = SIM_START;
+    snap.temperature = 2040;
+    snap.humidity = 48;
+    snap.pressure = 10132;
+    snap.setpoint = 2100;
+    snap.heater_on = true;
+    snap.samples = 720;
+
+    s_last_sample.temperature = snap.temperature;
+    s_last_sample.humidity = snap.humidity;
+    s_last_sample.setpoint = snap.setpoint;
+    s_last_sample.pressure = snap.pressure;
+
+    status_push_publish(&snap);
+    s_frames = 0;
+    s_frame_bytes = 0;
+    memset(s_frames_by_type, 0, sizeof(s_frames_by_type));
+
+    uint32_t json_bytes = 0;
+    char json[STATUS_JSON_MAX_LEN];
+
+    for (int t = 1; t <= SIM_SECONDS; t++) {
+        snap.timestamp = SIM_START + t;
+        snap.temperature = (int16_t)(2040 + t / 300 + (int)(rng_next() % 5) - 2);
+        if (t % 600 == 0) snap.humidity += (rng_next() & 1) ? 1 : -1;
+        if (t % 900 == 0) snap.pressure += 1;
+        if (t == 1200 || t == 2700) snap.heater_on = !snap.heater_on;
+        if (t % 60 == 0) {
+            snap.samples++;
+            s_last_sample.temperature = snap.temperature;
+        }
+
+        status_push_publish(&snap);
+
+        // Polling della pagina senza WebSocket: una richiesta al secondo
+        json_bytes += status_format_json(&snap, json, sizeof(json)) + HTTP_STATUS_OVERHEAD;
+    }
+
+    printf("push binario: %u frame (status %u, sample %u, relay %u), %u byte/ora\n",
+           s_frames, s_frames_by_type[WS_MSG_STATUS], s_frames_by_type[WS_MSG_SAMPLE],
+           s_frames_by_type[WS_MSG_RELAY], s_frame_bytes);
+    printf("polling JSON: %d richieste, %u byte/ora (%.0fx)\n",
+           SIM_SECONDS, json_bytes, (double)json_bytes / s_frame_bytes);
+
+    TEST_ASSERT_EQUAL_UINT32(60, s_frames_by_type[WS_MSG_SAMPLE]);
+    TEST_ASSERT_EQUAL_UINT32(2, s_frames_by_type[WS_MSG_RELAY]);
+    TEST_ASSERT_LESS_THAN_UINT32(json_bytes / 100, s_frame_bytes);
+}
+
+int main(void)
+{
+    // Ora locale = UTC: ws_local_time() e status_format_json() deterministici
+    setenv("TZ", "UTC0", 1);
+    tzset();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_status_roundtrip);
+    RUN_TEST(test_other_messages_roundtrip);
+    RUN_TEST(test_encoder_respects_capacity);
+    RUN_TEST(test_decoder_rejects_garbage);
+    RUN_TEST(test_diff_resolution);
+    RUN_TEST(test_bytes_per_hour_vs_json_polling);
+    return UNITY_END();
+}